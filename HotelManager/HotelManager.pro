@@ -1,4 +1,4 @@
-QT       += core gui sql
+QT       += core gui sql concurrent network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -9,14 +9,9 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
-    main.cpp \
-    hotelmanager.cpp
+    main.cpp
 
-HEADERS += \
-    hotelmanager.h
-
-FORMS += \
-    hotelmanager.ui
+include(hotelmanager.pri)
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
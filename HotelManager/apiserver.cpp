@@ -0,0 +1,594 @@
+#include "apiserver.h"
+#include "appsettings.h"
+#include "sharedoccupancy.h"
+#include "availabilitycache.h"
+#include "bookingwritequeue.h"
+#include "connectionpool.h"
+#include "sqltracer.h"
+
+#include <QThread>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QSqlError>
+#include <QDebug>
+
+namespace
+{
+    const quint16 DefaultPort = 8765;
+
+    // Ограничения на размер запроса и длину периода
+    const int MaxHeaderSize = 16 * 1024;
+    const int MaxBodySize = 64 * 1024;
+    const int MaxRangeNights = 366;
+
+    QByteArray statusText(int status)
+    {
+        switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 503: return "Service Unavailable";
+        default: return "Internal Server Error";
+        }
+    }
+
+    ApiServer::Response jsonResponse(int status, const QJsonObject &object)
+    {
+        ApiServer::Response response;
+        response.status = status;
+        response.body = QJsonDocument(object).toJson(QJsonDocument::Compact);
+        return response;
+    }
+
+    ApiServer::Response errorResponse(int status, const QString &message)
+    {
+        QJsonObject object;
+        object["error"] = message;
+        return jsonResponse(status, object);
+    }
+
+    // Проверяет период [from, to): to - дата выезда
+    bool parseRange(const QString &fromText, const QString &toText, QDate &from, QDate &to)
+    {
+        from = QDate::fromString(fromText, Qt::ISODate);
+        to = QDate::fromString(toText, Qt::ISODate);
+        return from.isValid() && to.isValid() && from < to && from.daysTo(to) <= MaxRangeNights;
+    }
+
+    // Одно клиентское соединение; создается и живет в рабочем потоке сервера
+    class ApiConnection : public QObject
+    {
+    public:
+        ApiConnection(qintptr socketDescriptor, ApiServer *server, QObject *parent)
+            : QObject(parent)
+            , server(server)
+            , socket(new QTcpSocket(this))
+        {
+            connect(socket, &QTcpSocket::readyRead, this, [this]() { onReadyRead(); });
+            connect(socket, &QTcpSocket::disconnected, this, &QObject::deleteLater);
+
+            if (!socket->setSocketDescriptor(socketDescriptor)) {
+                deleteLater();
+            }
+        }
+
+    private:
+        void onReadyRead()
+        {
+            buffer += socket->readAll();
+
+            // В буфере может оказаться несколько запросов подряд (конвейер keep-alive)
+            for (;;) {
+                int headerEnd = buffer.indexOf("\r\n\r\n");
+                if (headerEnd < 0) {
+                    if (buffer.size() > MaxHeaderSize) {
+                        reply(errorResponse(431, "Слишком большой заголовок"), false);
+                    }
+                    return;
+                }
+
+                QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+                QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+                if (requestLine.size() != 3) {
+                    reply(errorResponse(400, "Некорректная строка запроса"), false);
+                    return;
+                }
+
+                bool keepAlive = requestLine[2] == "HTTP/1.1";
+                qint64 contentLength = 0;
+                for (int i = 1; i < lines.size(); i++) {
+                    int colon = lines[i].indexOf(':');
+                    if (colon < 0) continue;
+
+                    QByteArray name = lines[i].left(colon).trimmed().toLower();
+                    QByteArray value = lines[i].mid(colon + 1).trimmed();
+                    if (name == "content-length") {
+                        contentLength = value.toLongLong();
+                    } else if (name == "connection") {
+                        keepAlive = value.toLower() != "close";
+                    }
+                }
+
+                if (contentLength < 0 || contentLength > MaxBodySize) {
+                    reply(errorResponse(413, "Слишком большое тело запроса"), false);
+                    return;
+                }
+                if (buffer.size() < headerEnd + 4 + contentLength) {
+                    return;
+                }
+
+                QByteArray body = buffer.mid(headerEnd + 4, contentLength);
+                buffer.remove(0, headerEnd + 4 + contentLength);
+
+                QUrl url(QString::fromLatin1(requestLine[1]));
+                reply(server->handle(requestLine[0], url.path(), QUrlQuery(url), body), keepAlive);
+                if (!keepAlive) return;
+            }
+        }
+
+        void reply(const ApiServer::Response &response, bool keepAlive)
+        {
+            QByteArray data;
+            data += "HTTP/1.1 " + QByteArray::number(response.status) + ' ' + statusText(response.status) + "\r\n";
+            data += "Content-Type: application/json; charset=utf-8\r\n";
+            data += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+            data += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+            data += response.body;
+            socket->write(data);
+
+            if (!keepAlive) {
+                buffer.clear();
+                socket->disconnectFromHost();
+            }
+        }
+
+        ApiServer *server;
+        QTcpSocket *socket;
+        QByteArray buffer;
+    };
+}
+
+ApiServer::ApiServer(SharedOccupancy &occupancy, AvailabilityCache &availabilityCache, QObject *parent)
+    : QTcpServer(parent)
+    , occupancy(occupancy)
+    , availabilityCache(availabilityCache)
+    , roomIndex(std::make_shared<const RoomIndex>())
+    , nextWorker(0)
+{
+}
+
+ApiServer::~ApiServer()
+{
+    stop();
+}
+
+quint16 ApiServer::configuredPort()
+{
+    AppSettings settings;
+    return quint16(settings.value("api/port", DefaultPort).toUInt());
+}
+
+bool ApiServer::start(quint16 port)
+{
+    if (isListening()) return true;
+
+    int threadCount = qMax(2, QThread::idealThreadCount());
+    for (int i = 0; i < threadCount; i++) {
+        Worker worker;
+        worker.thread = new QThread();
+        worker.thread->setObjectName(QString("api_%1").arg(i));
+        worker.context = new QObject();
+        worker.context->moveToThread(worker.thread);
+        worker.thread->start();
+        workers.append(worker);
+    }
+
+    // Только локальный интерфейс: API не предназначен для внешней сети
+    if (!listen(QHostAddress::LocalHost, port ? port : configuredPort())) {
+        qDebug() << "API сервер не запущен: " << errorString();
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void ApiServer::stop()
+{
+    close();
+
+    for (const Worker &worker : workers) {
+        // Соединения удаляются в своем потоке; соединения потока с БД закрывает пул при его завершении
+        QObject *context = worker.context;
+        QMetaObject::invokeMethod(context, [context]() {
+            delete context;
+        }, Qt::BlockingQueuedConnection);
+
+        worker.thread->quit();
+        worker.thread->wait();
+        delete worker.thread;
+    }
+    workers.clear();
+}
+
+void ApiServer::setRooms(const QVector<RoomInfo> &rooms)
+{
+    auto index = std::make_shared<RoomIndex>();
+    index->rebuild(rooms);
+    std::atomic_store(&roomIndex, std::shared_ptr<const RoomIndex>(std::move(index)));
+
+    // Набор комнат в готовых ответах больше не актуален
+    availabilityCache.clear();
+}
+
+void ApiServer::setDatabaseFile(const QString &databaseFile)
+{
+    QMutexLocker locker(&fileMutex);
+    file = databaseFile;
+}
+
+QString ApiServer::databaseFile() const
+{
+    QMutexLocker locker(&fileMutex);
+    return file;
+}
+
+void ApiServer::incomingConnection(qintptr socketDescriptor)
+{
+    if (workers.isEmpty()) return;
+
+    // Соединения раздаются потокам по кругу; сокет создается уже в рабочем потоке
+    QObject *context = workers[nextWorker++ % workers.size()].context;
+    QMetaObject::invokeMethod(context, [this, socketDescriptor, context]() {
+        new ApiConnection(socketDescriptor, this, context);
+    }, Qt::QueuedConnection);
+}
+
+ApiServer::Response ApiServer::handle(const QByteArray &method, const QString &path, const QUrlQuery &query,
+                                      const QByteArray &body)
+{
+    if (path == "/rooms") {
+        return method == "GET" ? rooms() : errorResponse(405, "Метод не поддерживается");
+    }
+    if (path == "/availability") {
+        return method == "GET" ? availability(query) : errorResponse(405, "Метод не поддерживается");
+    }
+    if (path == "/stats") {
+        return method == "GET" ? stats() : errorResponse(405, "Метод не поддерживается");
+    }
+    if (path == "/bookings") {
+        if (method == "POST") return book(body);
+        if (method == "DELETE") return cancel(query);
+        return errorResponse(405, "Метод не поддерживается");
+    }
+    return errorResponse(404, "Неизвестный адрес");
+}
+
+ApiServer::Response ApiServer::rooms() const
+{
+    std::shared_ptr<const RoomIndex> index = std::atomic_load(&roomIndex);
+
+    QJsonArray list;
+    for (const RoomInfo &room : index->rooms()) {
+        QJsonObject object;
+        object["number"] = room.number;
+        object["type"] = room.type;
+        object["capacity"] = room.capacity;
+        object["price"] = room.price;
+        object["description"] = room.description;
+        list.append(object);
+    }
+
+    QJsonObject result;
+    result["rooms"] = list;
+    return jsonResponse(200, result);
+}
+
+ApiServer::Response ApiServer::availability(const QUrlQuery &query) const
+{
+    QDate from, to;
+    if (!parseRange(query.queryItemValue("from"), query.queryItemValue("to"), from, to)) {
+        return errorResponse(400, "Некорректный период");
+    }
+
+    AvailabilityCache::Key key;
+    key.fromDay = from.toJulianDay();
+    key.toDay = to.toJulianDay();
+    key.type = query.queryItemValue("type", QUrl::FullyDecoded);
+    key.minCapacity = query.queryItemValue("capacity").toInt();
+
+    AvailabilityCache::Answer answer = availabilityCache.answer(key, [this, &key](const OccupancyStore &store) {
+        // Снимок комнат берем уже внутри расчета: если список сменится после этого,
+        // кэш будет сброшен и ответ не сохранится
+        std::shared_ptr<const RoomIndex> index = std::atomic_load(&roomIndex);
+
+        RoomIndex::Filter filter;
+        filter.type = key.type;
+        filter.minCapacity = key.minCapacity;
+
+        AvailabilityCache::Answer computed;
+        computed.rooms = index->select(filter, RoomIndex::ByNumber, false, store);
+
+        const int nights = int(key.toDay - key.fromDay);
+        computed.freeByNight.fill(0, nights);
+        for (int roomNumber : computed.rooms) {
+            bool freeAllNights = true;
+            for (int i = 0; i < nights; i++) {
+                if (store.isOccupied(roomNumber, key.fromDay + i)) {
+                    freeAllNights = false;
+                } else {
+                    computed.freeByNight[i]++;
+                }
+            }
+            if (freeAllNights) {
+                computed.freeRooms.append(roomNumber);
+            }
+        }
+        return computed;
+    });
+
+    QJsonArray freeRooms;
+    for (int roomNumber : answer.freeRooms) {
+        freeRooms.append(roomNumber);
+    }
+
+    QJsonArray byNight;
+    for (int i = 0; i < answer.freeByNight.size(); i++) {
+        QJsonObject night;
+        night["date"] = from.addDays(i).toString(Qt::ISODate);
+        night["free"] = answer.freeByNight[i];
+        byNight.append(night);
+    }
+
+    QJsonObject result;
+    result["from"] = from.toString(Qt::ISODate);
+    result["to"] = to.toString(Qt::ISODate);
+    result["rooms"] = int(answer.rooms.size());
+    result["free_rooms"] = freeRooms;
+    result["nights"] = byNight;
+    return jsonResponse(200, result);
+}
+
+ApiServer::Response ApiServer::stats() const
+{
+    AvailabilityCache::Stats cacheStats = availabilityCache.stats();
+
+    QJsonObject cache;
+    cache["hits"] = cacheStats.hits;
+    cache["misses"] = cacheStats.misses;
+    cache["hit_rate"] = cacheStats.hitRate();
+    cache["invalidated"] = cacheStats.invalidated;
+    cache["evicted"] = cacheStats.evicted;
+    cache["discarded"] = cacheStats.discarded;
+    cache["entries"] = cacheStats.entries;
+    cache["capacity"] = cacheStats.capacity;
+
+    QJsonObject result;
+    result["availability_cache"] = cache;
+    return jsonResponse(200, result);
+}
+
+ApiServer::Response ApiServer::book(const QByteArray &body)
+{
+    QJsonParseError parseError;
+    QJsonObject request = QJsonDocument::fromJson(body, &parseError).object();
+    if (parseError.error != QJsonParseError::NoError) {
+        return errorResponse(400, "Некорректный JSON: " + parseError.errorString());
+    }
+
+    int roomNumber = request.value("room").toInt();
+    QDate from, to;
+    if (!parseRange(request.value("from").toString(), request.value("to").toString(), from, to)) {
+        return errorResponse(400, "Некорректный период");
+    }
+    if (!std::atomic_load(&roomIndex)->find(roomNumber)) {
+        return errorResponse(404, QString("Комната %1 не найдена").arg(roomNumber));
+    }
+
+    const qint64 fromDay = from.toJulianDay();
+    const qint64 toDay = to.toJulianDay();
+    qint64 conflictDay = 0;
+    QString error;
+
+    // Соединение берем до блокировки писателей: ожидание места в пуле (до 30 с) под ней
+    // остановило бы все остальные записи. Очередь же читается только под блокировкой - там ее
+    // снимают и удаляют. Если очередь успели выключить, берем соединение и повторяем
+    ConnectionPool::Lease connection;
+    bool needConnection = writeQueue.load() == nullptr;
+    bool ok = false;
+    do {
+        if (needConnection) {
+            connection = ConnectionPool::instance().acquire(databaseFile());
+            if (!connection.isOpen()) {
+                return errorResponse(503, "Нет соединения с базой данных: " + connection.errorText());
+            }
+            needConnection = false;
+        }
+
+        // Проверка занятости, запись в БД и публикация нового снимка - под одной блокировкой писателей
+        ok = occupancy.update([&](OccupancyStore &store) {
+            for (qint64 day = fromDay; day < toDay; day++) {
+                if (store.isOccupied(roomNumber, day)) {
+                    conflictDay = day;
+                    return false;
+                }
+            }
+
+            BookingWriteQueue *queue = writeQueue.load();
+            if (!queue && !connection.isOpen()) {
+                needConnection = true;
+                return false;
+            }
+
+            if (queue) {
+                QVector<BookingWriteQueue::Operation> operations;
+                for (qint64 day = fromDay; day < toDay; day++) {
+                    operations.append({roomNumber, day, true});
+                }
+                if (!queue->enqueue(operations, &error)) {
+                    return false;
+                }
+                for (qint64 day = fromDay; day < toDay; day++) {
+                    store.setOccupied(roomNumber, day, true);
+                }
+                return true;
+            }
+
+            QSqlDatabase db = connection.database();
+            if (!db.transaction()) {
+                error = db.lastError().text();
+                return false;
+            }
+
+            {
+                // Ночь, которой нет в кэше, но которая уже есть в БД (запись мимо приложения),
+                // не вставляется - это конфликт, а не ошибка сервера
+                TracedQuery insert(db);
+                insert.prepare("INSERT OR IGNORE INTO bookings (room_number, booking_date) VALUES (?, ?)");
+                for (qint64 day = fromDay; day < toDay; day++) {
+                    insert.addBindValue(roomNumber);
+                    insert.addBindValue(day);
+                    if (!insert.exec()) {
+                        error = insert.lastError().text();
+                        break;
+                    }
+                    if (insert.numRowsAffected() != 1) {
+                        conflictDay = day;
+                        break;
+                    }
+                }
+            }
+
+            if (conflictDay) {
+                db.rollback();
+                return false;
+            }
+            if (!error.isEmpty() || !db.commit()) {
+                if (error.isEmpty()) error = db.lastError().text();
+                db.rollback();
+                return false;
+            }
+
+            for (qint64 day = fromDay; day < toDay; day++) {
+                store.setOccupied(roomNumber, day, true);
+            }
+            return true;
+        });
+    } while (needConnection);
+    // Запись могла пойти через очередь - тогда соединение было не нужно; возвращаем его в пул
+    connection = ConnectionPool::Lease();
+
+    if (conflictDay) {
+        QJsonObject conflict;
+        conflict["error"] = "Номер занят";
+        conflict["date"] = QDate::fromJulianDay(conflictDay).toString(Qt::ISODate);
+        return jsonResponse(409, conflict);
+    }
+    if (!ok) {
+        return errorResponse(500, "Не удалось сохранить бронирование: " + error);
+    }
+
+    emit bookingsChanged(roomNumber, fromDay, toDay - 1);
+
+    QJsonObject result;
+    result["room"] = roomNumber;
+    result["from"] = from.toString(Qt::ISODate);
+    result["to"] = to.toString(Qt::ISODate);
+    result["nights"] = int(from.daysTo(to));
+    return jsonResponse(201, result);
+}
+
+ApiServer::Response ApiServer::cancel(const QUrlQuery &query)
+{
+    int roomNumber = query.queryItemValue("room").toInt();
+    QDate from, to;
+    if (!parseRange(query.queryItemValue("from"), query.queryItemValue("to"), from, to)) {
+        return errorResponse(400, "Некорректный период");
+    }
+
+    const qint64 fromDay = from.toJulianDay();
+    const qint64 toDay = to.toJulianDay();
+    int removed = 0;
+    QString error;
+
+    // Как и при бронировании, соединение - до блокировки писателей, очередь - под ней
+    ConnectionPool::Lease connection;
+    bool needConnection = writeQueue.load() == nullptr;
+    bool ok = false;
+    do {
+        if (needConnection) {
+            connection = ConnectionPool::instance().acquire(databaseFile());
+            if (!connection.isOpen()) {
+                return errorResponse(503, "Нет соединения с базой данных: " + connection.errorText());
+            }
+            needConnection = false;
+        }
+
+        ok = occupancy.update([&](OccupancyStore &store) {
+            BookingWriteQueue *queue = writeQueue.load();
+            if (!queue && !connection.isOpen()) {
+                needConnection = true;
+                return false;
+            }
+
+            if (queue) {
+                // Кэш под блокировкой писателей совпадает с БД плюс очередь - снимаем то, что в нем есть
+                QVector<BookingWriteQueue::Operation> operations;
+                for (qint64 day = fromDay; day < toDay; day++) {
+                    if (store.isOccupied(roomNumber, day)) {
+                        operations.append({roomNumber, day, false});
+                    }
+                }
+                if (operations.isEmpty() || !queue->enqueue(operations, &error)) {
+                    return false;
+                }
+                for (const BookingWriteQueue::Operation &operation : operations) {
+                    store.setOccupied(roomNumber, operation.day, false);
+                }
+                removed = operations.size();
+                return true;
+            }
+
+            QSqlDatabase db = connection.database();
+            TracedQuery remove(db);
+            remove.prepare("DELETE FROM bookings WHERE room_number = ? AND booking_date >= ? AND booking_date < ?");
+            remove.addBindValue(roomNumber);
+            remove.addBindValue(fromDay);
+            remove.addBindValue(toDay);
+            if (!remove.exec()) {
+                error = remove.lastError().text();
+                return false;
+            }
+
+            removed = remove.numRowsAffected();
+            for (qint64 day = fromDay; day < toDay; day++) {
+                store.setOccupied(roomNumber, day, false);
+            }
+            return removed > 0;
+        });
+    } while (needConnection);
+    connection = ConnectionPool::Lease();
+
+    if (!error.isEmpty()) {
+        return errorResponse(500, "Не удалось снять бронь: " + error);
+    }
+    if (!ok) {
+        return errorResponse(404, "Бронирований за период нет");
+    }
+
+    emit bookingsChanged(roomNumber, fromDay, toDay - 1);
+
+    QJsonObject result;
+    result["room"] = roomNumber;
+    result["nights"] = removed;
+    return jsonResponse(200, result);
+}
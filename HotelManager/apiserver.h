@@ -0,0 +1,95 @@
+#ifndef APISERVER_H
+#define APISERVER_H
+
+#include <QTcpServer>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QVector>
+#include <QDate>
+#include <atomic>
+#include <memory>
+
+#include "roomindex.h"
+
+class QThread;
+class QUrlQuery;
+class SharedOccupancy;
+class AvailabilityCache;
+class BookingWriteQueue;
+
+// Локальный JSON API для менеджера каналов (HTTP/1.1 с keep-alive, только 127.0.0.1):
+//   GET    /rooms
+//   GET    /availability?from=yyyy-MM-dd&to=yyyy-MM-dd[&type=...][&capacity=N]
+//   POST   /bookings   {"room": 101, "from": "yyyy-MM-dd", "to": "yyyy-MM-dd"}
+//   DELETE /bookings?room=101&from=yyyy-MM-dd&to=yyyy-MM-dd
+//   GET    /stats      счетчики кэша доступности
+// from - дата заезда, to - дата выезда (ночь to не входит).
+// Соединения распределяются по нескольким потокам со своими циклами событий.
+// Чтение идет по снимкам кэша занятости и списка комнат без блокировок;
+// запись сериализуется через SharedOccupancy и выполняется соединением своего потока из ConnectionPool.
+// Ответы о доступности берутся из AvailabilityCache.
+class ApiServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    struct Response {
+        int status = 200;
+        QByteArray body;
+    };
+
+    ApiServer(SharedOccupancy &occupancy, AvailabilityCache &availabilityCache, QObject *parent = nullptr);
+    ~ApiServer();
+
+    // Порт хранится в настройках (api/port)
+    static quint16 configuredPort();
+    bool start(quint16 port = 0);
+    void stop();
+
+    void setRooms(const QVector<RoomInfo> &rooms);
+    // Вызывать под блокировкой писателей SharedOccupancy (внутри update), вместе с заменой кэша
+    void setDatabaseFile(const QString &databaseFile);
+    // Очередь отложенной записи окна; задавать так же под блокировкой писателей.
+    // Пока она задана, бронирования через API идут через нее, а не напрямую в БД
+    void setWriteQueue(BookingWriteQueue *queue) { writeQueue.store(queue); }
+
+    // Разбор одного запроса; потокобезопасен
+    Response handle(const QByteArray &method, const QString &path, const QUrlQuery &query,
+                    const QByteArray &body);
+
+signals:
+    // Бронирования изменены через API; испускается из рабочего потока
+    void bookingsChanged(int roomNumber, qint64 fromDay, qint64 toDay);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+
+private:
+    struct Worker {
+        QThread *thread = nullptr;
+        QObject *context = nullptr; // живет в потоке, родитель соединений
+    };
+
+    Response rooms() const;
+    Response availability(const QUrlQuery &query) const;
+    Response stats() const;
+    Response book(const QByteArray &body);
+    Response cancel(const QUrlQuery &query);
+
+    QString databaseFile() const;
+
+    SharedOccupancy &occupancy;
+    AvailabilityCache &availabilityCache;
+    std::shared_ptr<const RoomIndex> roomIndex;
+    QVector<Worker> workers;
+    int nextWorker;
+
+    // Для записи читается только под блокировкой писателей: там же очередь снимают и удаляют.
+    // Без блокировки - лишь как подсказка, нужно ли заранее брать соединение
+    std::atomic<BookingWriteQueue *> writeQueue{nullptr};
+
+    mutable QMutex fileMutex;
+    QString file;
+};
+
+#endif // APISERVER_H
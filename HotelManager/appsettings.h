@@ -0,0 +1,19 @@
+#ifndef APPSETTINGS_H
+#define APPSETTINGS_H
+
+#include <QSettings>
+
+// Настройки приложения. Все обращения к ним идут через этот класс: формат берется из
+// QSettings::defaultFormat(), поэтому инструменты в tools/ могут увести настройки в свой
+// каталог (setDefaultFormat + setPath); QSettings("HotelManager", "HotelManager") всегда
+// открывает системное хранилище и такую подмену не видит
+class AppSettings : public QSettings
+{
+public:
+    AppSettings()
+        : QSettings(QSettings::defaultFormat(), QSettings::UserScope, "HotelManager", "HotelManager")
+    {
+    }
+};
+
+#endif // APPSETTINGS_H
@@ -0,0 +1,182 @@
+#include "availabilitycache.h"
+#include "appsettings.h"
+#include "sharedoccupancy.h"
+
+#include <QMutexLocker>
+#include <QHashFunctions>
+#include <algorithm>
+
+namespace
+{
+    // Сколько последних изменений помнить для проверки параллельно посчитанных ответов
+    const int MaxLoggedChanges = 256;
+}
+
+size_t qHash(const AvailabilityCache::Key &key, size_t seed) noexcept
+{
+    return qHashMulti(seed, key.fromDay, key.toDay, key.type, key.minCapacity);
+}
+
+AvailabilityCache::AvailabilityCache(SharedOccupancy &occupancy, int capacity)
+    : occupancy(occupancy)
+    , capacity(qMax(1, capacity))
+{
+    listenerId = occupancy.addListener([this](const QVector<OccupancyStore::Change> &changes, quint64 version) {
+        invalidate(changes, version);
+    });
+}
+
+AvailabilityCache::~AvailabilityCache()
+{
+    occupancy.removeListener(listenerId);
+}
+
+int AvailabilityCache::configuredCapacity()
+{
+    AppSettings settings;
+    return settings.value("availability/cacheEntries", 1024).toInt();
+}
+
+bool AvailabilityCache::affects(const OccupancyStore::Change &change, const Key &key, const Answer &answer)
+{
+    // Ночи ответа - [fromDay, toDay - 1]
+    if (change.toDay < key.fromDay || change.fromDay >= key.toDay) {
+        return false;
+    }
+    if (change.roomNumber == OccupancyStore::AllRooms) {
+        return true;
+    }
+    return std::binary_search(answer.rooms.cbegin(), answer.rooms.cend(), change.roomNumber);
+}
+
+AvailabilityCache::Answer AvailabilityCache::answer(const Key &key,
+                                                    const std::function<Answer(const OccupancyStore &)> &compute)
+{
+    quint64 startEpoch;
+    {
+        QMutexLocker locker(&mutex);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, it->usage);
+            counters.hits++;
+            return it->answer;
+        }
+        counters.misses++;
+        startEpoch = epoch;
+    }
+
+    // Версию читаем до снимка: снимок не старше версии, и любое изменение новее нее
+    // могло не попасть в ответ
+    quint64 version = occupancy.version();
+    SharedOccupancy::Snapshot snapshot = occupancy.snapshot();
+    Answer result = compute(*snapshot);
+
+    QMutexLocker locker(&mutex);
+
+    bool stale = startEpoch != epoch || version < droppedVersion;
+    for (int i = 0; !stale && i < recentChanges.size(); i++) {
+        stale = recentChanges[i].version > version && affects(recentChanges[i].change, key, result);
+    }
+    if (stale) {
+        counters.discarded++;
+        return result;
+    }
+
+    // Ответ мог успеть посчитать и сохранить параллельный запрос
+    auto existing = entries.find(key);
+    if (existing != entries.end()) {
+        existing->answer = result;
+        recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, existing->usage);
+        return result;
+    }
+
+    if (entries.size() >= capacity) {
+        // Вытесняем давно не использованный ответ - он в конце списка
+        entries.remove(recentlyUsed.back());
+        recentlyUsed.pop_back();
+        counters.evicted++;
+    }
+
+    recentlyUsed.push_front(key);
+    Entry entry;
+    entry.answer = result;
+    entry.usage = recentlyUsed.begin();
+    entries.insert(key, entry);
+    return result;
+}
+
+void AvailabilityCache::invalidate(const QVector<OccupancyStore::Change> &changes, quint64 version)
+{
+    QMutexLocker locker(&mutex);
+
+    for (auto it = entries.begin(); it != entries.end(); ) {
+        bool hit = false;
+        for (const OccupancyStore::Change &change : changes) {
+            if (affects(change, it.key(), it->answer)) {
+                hit = true;
+                break;
+            }
+        }
+
+        if (hit) {
+            recentlyUsed.erase(it->usage);
+            it = entries.erase(it);
+            counters.invalidated++;
+        } else {
+            ++it;
+        }
+    }
+
+    for (const OccupancyStore::Change &change : changes) {
+        recentChanges.append({change, version});
+    }
+    if (recentChanges.size() > MaxLoggedChanges) {
+        int drop = recentChanges.size() - MaxLoggedChanges;
+        droppedVersion = qMax(droppedVersion, recentChanges[drop - 1].version);
+        recentChanges.remove(0, drop);
+    }
+}
+
+void AvailabilityCache::clear()
+{
+    QMutexLocker locker(&mutex);
+    entries.clear();
+    recentlyUsed.clear();
+    epoch++;
+}
+
+AvailabilityCache::Stats AvailabilityCache::stats() const
+{
+    QMutexLocker locker(&mutex);
+    Stats result = counters;
+    result.entries = entries.size();
+    result.capacity = capacity;
+    return result;
+}
+
+void AvailabilityCache::resetStats()
+{
+    QMutexLocker locker(&mutex);
+    counters = Stats();
+}
+
+QString AvailabilityCache::reportHtml() const
+{
+    Stats s = stats();
+
+    QString html;
+    html += "<h3>Кэш ответов о доступности</h3>";
+    html += QString("<p>Попаданий: %1, промахов: %2, доля попаданий: %3%<br>"
+                    "Записей: %4 из %5<br>"
+                    "Удалено при записи бронирований: %6, вытеснено: %7, "
+                    "не сохранено (устаревший снимок): %8</p>")
+                .arg(s.hits)
+                .arg(s.misses)
+                .arg(s.hitRate() * 100.0, 0, 'f', 1)
+                .arg(s.entries)
+                .arg(s.capacity)
+                .arg(s.invalidated)
+                .arg(s.evicted)
+                .arg(s.discarded);
+    return html;
+}
@@ -0,0 +1,104 @@
+#ifndef AVAILABILITYCACHE_H
+#define AVAILABILITYCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <list>
+
+#include "occupancystore.h"
+
+class SharedOccupancy;
+
+// Кэш ответов на вопросы о доступности: "сколько комнат типа T вместимостью от C свободно
+// в каждую ночь периода". Ключ - (период, тип, вместимость).
+// Инвалидация точная: запись бронирования удаляет только ответы, период которых пересекается
+// с измененными днями и в которых участвует измененная комната; остальные ответы остаются.
+// Изменения приходят из SharedOccupancy вместе с версией снимка, поэтому ответ, посчитанный
+// по снимку, который успел устареть, в кэш не попадает.
+// Кэшем пользуются запросы доступности ApiServer; сетка и отчеты считают по снимку напрямую.
+// Переполнение вытесняет давно не использованный ответ за O(1): порядок использования - список,
+// запись в хэше хранит свою позицию в нем.
+class AvailabilityCache
+{
+public:
+    struct Key {
+        qint64 fromDay = 0;   // первая ночь (юлианский день)
+        qint64 toDay = 0;     // день выезда, ночь не входит
+        QString type;         // пусто - любой тип
+        int minCapacity = 0;
+
+        bool operator==(const Key &other) const
+        {
+            return fromDay == other.fromDay && toDay == other.toDay &&
+                   minCapacity == other.minCapacity && type == other.type;
+        }
+    };
+
+    struct Answer {
+        QVector<int> rooms;        // подходящие по типу и вместимости, по возрастанию номера
+        QVector<int> freeByNight;  // свободно комнат в каждую ночь периода
+        QVector<int> freeRooms;    // свободны все ночи периода
+    };
+
+    struct Stats {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 invalidated = 0;  // удалено из-за записи бронирований
+        qint64 evicted = 0;      // вытеснено при переполнении
+        qint64 discarded = 0;    // посчитано по устаревшему снимку и не сохранено
+        int entries = 0;
+        int capacity = 0;
+
+        double hitRate() const { return hits + misses > 0 ? double(hits) / (hits + misses) : 0.0; }
+    };
+
+    explicit AvailabilityCache(SharedOccupancy &occupancy, int capacity = configuredCapacity());
+    ~AvailabilityCache();
+
+    // Размер кэша хранится в настройках (availability/cacheEntries)
+    static int configuredCapacity();
+
+    // Ответ из кэша; при промахе compute считает его по текущему снимку занятости
+    Answer answer(const Key &key, const std::function<Answer(const OccupancyStore &)> &compute);
+
+    // Полный сброс - при изменении списка комнат
+    void clear();
+
+    Stats stats() const;
+    void resetStats();
+    QString reportHtml() const;
+
+private:
+    struct Entry {
+        Answer answer;
+        std::list<Key>::iterator usage; // позиция в recentlyUsed
+    };
+
+    struct LoggedChange {
+        OccupancyStore::Change change;
+        quint64 version;
+    };
+
+    void invalidate(const QVector<OccupancyStore::Change> &changes, quint64 version);
+    static bool affects(const OccupancyStore::Change &change, const Key &key, const Answer &answer);
+
+    SharedOccupancy &occupancy;
+    int listenerId;
+
+    mutable QMutex mutex;
+    QHash<Key, Entry> entries;
+    std::list<Key> recentlyUsed; // в начале - последний использованный ответ
+    // Последние изменения: по ним отбраковываются ответы, посчитанные параллельно с записью
+    QVector<LoggedChange> recentChanges;
+    quint64 droppedVersion = 0; // изменения до этой версии включительно уже не в журнале
+    quint64 epoch = 0;          // увеличивается при clear()
+    int capacity;
+    Stats counters;
+};
+
+size_t qHash(const AvailabilityCache::Key &key, size_t seed = 0) noexcept;
+
+#endif // AVAILABILITYCACHE_H
@@ -0,0 +1,176 @@
+#include "bookingarchiver.h"
+#include "appsettings.h"
+#include "sqltracer.h"
+
+#include <QSqlError>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+
+namespace
+{
+    const int DefaultHorizonDays = 365;
+    const int DefaultBatchSize = 500;
+
+    // Пауза между порциями - интерфейс успевает обработать события
+    const int BatchPauseMs = 50;
+    // Первый запуск после старта и период между запусками
+    const int FirstRunDelayMs = 60 * 1000;
+    const int RunIntervalMs = 6 * 60 * 60 * 1000;
+}
+
+BookingArchiver::BookingArchiver(const QSqlDatabase &db, QObject *parent)
+    : QObject(parent)
+    , db(db)
+    , archivedThisRun(0)
+{
+    AppSettings settings;
+    batchSize = qMax(1, settings.value("archive/batchSize", DefaultBatchSize).toInt());
+
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &BookingArchiver::onTimer);
+}
+
+QString BookingArchiver::archiveFileFor(const QString &databaseFile)
+{
+    QFileInfo info(databaseFile);
+    QString name = info.completeBaseName() + "_archive." + (info.suffix().isEmpty() ? "db" : info.suffix());
+    return info.dir().filePath(name);
+}
+
+bool BookingArchiver::attachArchive(const QSqlDatabase &db, const QString &archiveFile, QString *error)
+{
+    TracedQuery query(db);
+
+    bool attached = false;
+    if (query.exec("PRAGMA database_list")) {
+        while (query.next()) {
+            if (query.value(1).toString() == "archive") {
+                attached = true;
+            }
+        }
+    }
+
+    if (!attached) {
+        query.prepare("ATTACH DATABASE ? AS archive");
+        query.addBindValue(archiveFile);
+        if (!query.exec()) {
+            if (error) *error = query.lastError().text();
+            return false;
+        }
+    }
+
+    // id сохраняется из рабочей таблицы: AUTOINCREMENT не переиспользует номера
+    const QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS archive.bookings ("
+        "id INTEGER PRIMARY KEY, "
+        "room_number INTEGER NOT NULL, "
+        "booking_date INTEGER NOT NULL, "
+        "created_at TIMESTAMP, "
+        "UNIQUE(room_number, booking_date)"
+        ")",
+        "CREATE INDEX IF NOT EXISTS archive.idx_archive_bookings_date ON bookings(booking_date)",
+        "CREATE TEMP VIEW IF NOT EXISTS all_bookings AS "
+        "SELECT room_number, booking_date, created_at FROM main.bookings "
+        "UNION ALL "
+        "SELECT room_number, booking_date, created_at FROM archive.bookings"
+    };
+
+    for (const QString &sql : statements) {
+        if (!query.exec(sql)) {
+            if (error) *error = query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+int BookingArchiver::horizonDays() const
+{
+    AppSettings settings;
+    return qMax(1, settings.value("archive/horizonDays", DefaultHorizonDays).toInt());
+}
+
+void BookingArchiver::setHorizonDays(int days)
+{
+    AppSettings settings;
+    settings.setValue("archive/horizonDays", qMax(1, days));
+}
+
+QDate BookingArchiver::cutoffDate() const
+{
+    return QDate::currentDate().addDays(-horizonDays());
+}
+
+void BookingArchiver::start()
+{
+    timer.start(FirstRunDelayMs);
+}
+
+void BookingArchiver::runNow()
+{
+    archivedThisRun = 0;
+    timer.start(0);
+}
+
+qint64 BookingArchiver::archiveBatch()
+{
+    const qint64 cutoff = cutoffDate().toJulianDay();
+
+    if (!db.transaction()) {
+        qDebug() << "Архивация: не удалось начать транзакцию: " << db.lastError().text();
+        return -1;
+    }
+
+    // Один и тот же порядок и LIMIT в обеих командах внутри транзакции дают одинаковый набор строк
+    TracedQuery copy(db);
+    copy.prepare("INSERT OR REPLACE INTO archive.bookings (id, room_number, booking_date, created_at) "
+                 "SELECT id, room_number, booking_date, created_at FROM main.bookings "
+                 "WHERE booking_date < ? ORDER BY booking_date, id LIMIT ?");
+    copy.addBindValue(cutoff);
+    copy.addBindValue(batchSize);
+
+    TracedQuery remove(db);
+    remove.prepare("DELETE FROM main.bookings WHERE id IN ("
+                   "SELECT id FROM main.bookings WHERE booking_date < ? ORDER BY booking_date, id LIMIT ?)");
+    remove.addBindValue(cutoff);
+    remove.addBindValue(batchSize);
+
+    if (!copy.exec() || !remove.exec()) {
+        qDebug() << "Архивация: ошибка переноса: " << copy.lastError().text() << remove.lastError().text();
+        copy.finish();
+        remove.finish();
+        db.rollback();
+        return -1;
+    }
+
+    qint64 moved = remove.numRowsAffected();
+    copy.finish();
+    remove.finish();
+
+    if (!db.commit()) {
+        qDebug() << "Архивация: не удалось зафиксировать транзакцию: " << db.lastError().text();
+        db.rollback();
+        return -1;
+    }
+    return moved;
+}
+
+void BookingArchiver::onTimer()
+{
+    qint64 moved = archiveBatch();
+
+    if (moved > 0) {
+        archivedThisRun += moved;
+    }
+
+    if (moved == batchSize) {
+        // Вероятно, есть еще - продолжаем после паузы
+        timer.start(BatchPauseMs);
+        return;
+    }
+
+    emit finished(archivedThisRun);
+    archivedThisRun = 0;
+    timer.start(RunIntervalMs);
+}
@@ -0,0 +1,51 @@
+#ifndef BOOKINGARCHIVER_H
+#define BOOKINGARCHIVER_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QTimer>
+#include <QDate>
+
+// Плановый перенос старых бронирований в отдельный файл архива.
+// Архив подключается через ATTACH как схема "archive", а временное представление
+// all_bookings объединяет рабочую и архивную таблицы для отчетов по истории.
+// Перенос идет небольшими транзакциями по таймеру, чтобы не блокировать интерфейс.
+class BookingArchiver : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BookingArchiver(const QSqlDatabase &db, QObject *parent = nullptr);
+
+    // hotel_bookings.db -> hotel_bookings_archive.db
+    static QString archiveFileFor(const QString &databaseFile);
+
+    // Подключает архив к соединению и создает в нем таблицу и представление all_bookings.
+    // Вызывать вне транзакции, для каждого нового соединения.
+    static bool attachArchive(const QSqlDatabase &db, const QString &archiveFile, QString *error = nullptr);
+
+    // Горизонт архивации в днях хранится в настройках (archive/horizonDays)
+    int horizonDays() const;
+    void setHorizonDays(int days);
+    QDate cutoffDate() const;
+
+    void start();
+    void runNow();
+
+    // Переносит одну порцию; возвращает число перенесенных строк или -1 при ошибке
+    qint64 archiveBatch();
+
+signals:
+    void finished(qint64 rowsArchived);
+
+private slots:
+    void onTimer();
+
+private:
+    QSqlDatabase db;
+    QTimer timer;
+    int batchSize;
+    qint64 archivedThisRun;
+};
+
+#endif // BOOKINGARCHIVER_H
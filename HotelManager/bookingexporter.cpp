@@ -0,0 +1,170 @@
+#include "bookingexporter.h"
+#include "sqltracer.h"
+#include "bookingarchiver.h"
+#include "connectionpool.h"
+
+#include <QThread>
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+namespace
+{
+    // Строк между сигналами прогресса и проверками отмены
+    const qint64 ProgressInterval = 1000;
+
+    QByteArray csvField(const QString &value)
+    {
+        QByteArray bytes = value.toUtf8();
+        if (bytes.contains(',') || bytes.contains('"') || bytes.contains('\n')) {
+            bytes.replace("\"", "\"\"");
+            return '"' + bytes + '"';
+        }
+        return bytes;
+    }
+}
+
+BookingExporter::BookingExporter(const QString &databaseFile, QObject *parent)
+    : QObject(parent)
+    , databaseFile(databaseFile)
+    , worker(nullptr)
+{
+}
+
+BookingExporter::~BookingExporter()
+{
+    if (worker) {
+        cancel();
+        worker->wait();
+        delete worker;
+    }
+}
+
+bool BookingExporter::isRunning() const
+{
+    return worker && worker->isRunning();
+}
+
+void BookingExporter::start(const QDate &from, const QDate &to, Format format, const QString &fileName)
+{
+    if (isRunning()) return;
+
+    delete worker;
+    cancelRequested.storeRelaxed(0);
+
+    worker = QThread::create([this, from, to, format, fileName]() {
+        run(from, to, format, fileName);
+    });
+    worker->start();
+}
+
+void BookingExporter::run(const QDate &from, const QDate &to, Format format, const QString &fileName)
+{
+    qint64 written = 0;
+    bool cancelled = false;
+    QString error;
+
+    {
+        // Соединение QSqlDatabase нельзя использовать из другого потока - берем соединение потока из пула
+        ConnectionPool::Lease connection = ConnectionPool::instance().acquire(databaseFile);
+        QSqlDatabase exportDb = connection.database();
+
+        QFile out(fileName);
+
+        if (!exportDb.isOpen()) {
+            error = "Не удалось открыть базу данных: " + connection.errorText();
+        } else if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            error = "Не удалось создать файл: " + out.errorString();
+        } else {
+            const qint64 fromDay = from.toJulianDay();
+            const qint64 toDay = to.toJulianDay();
+
+            // Период может уходить в историю - читаем рабочую таблицу вместе с архивом
+            QString source = "bookings";
+            if (BookingArchiver::attachArchive(exportDb, BookingArchiver::archiveFileFor(databaseFile))) {
+                source = "all_bookings";
+            }
+
+            // Общее число строк нужно только для индикатора прогресса
+            qint64 total = 0;
+            TracedQuery countQuery(exportDb);
+            countQuery.prepare("SELECT COUNT(*) FROM " + source + " WHERE booking_date BETWEEN ? AND ?");
+            countQuery.addBindValue(fromDay);
+            countQuery.addBindValue(toDay);
+            if (countQuery.exec() && countQuery.next()) {
+                total = countQuery.value(0).toLongLong();
+            }
+            countQuery.finish();
+            emit progress(0, total);
+
+            // Клиенты пока не привязаны к бронированиям, поэтому в выгрузке только комнаты
+            TracedQuery query(exportDb);
+            query.setForwardOnly(true);
+            query.prepare("SELECT b.room_number, b.booking_date, r.room_type, r.capacity, r.price_per_night "
+                          "FROM " + source + " b LEFT JOIN rooms r ON r.room_number = b.room_number "
+                          "WHERE b.booking_date BETWEEN ? AND ? "
+                          "ORDER BY b.booking_date, b.room_number");
+            query.addBindValue(fromDay);
+            query.addBindValue(toDay);
+
+            if (!query.exec()) {
+                error = "Ошибка запроса: " + query.lastError().text();
+            } else {
+                if (format == Csv) {
+                    out.write("room_number,booking_date,room_type,capacity,price_per_night\n");
+                }
+
+                QByteArray line;
+                while (query.next()) {
+                    line.clear();
+
+                    if (format == Csv) {
+                        line += QByteArray::number(query.value(0).toInt()) + ',';
+                        line += QDate::fromJulianDay(query.value(1).toLongLong()).toString("yyyy-MM-dd").toUtf8() + ',';
+                        line += csvField(query.value(2).toString()) + ',';
+                        line += QByteArray::number(query.value(3).toInt()) + ',';
+                        line += QByteArray::number(query.value(4).toDouble(), 'f', 2) + '\n';
+                    } else {
+                        QJsonObject row;
+                        row["room_number"] = query.value(0).toInt();
+                        row["booking_date"] = QDate::fromJulianDay(query.value(1).toLongLong()).toString("yyyy-MM-dd");
+                        row["room_type"] = query.value(2).toString();
+                        row["capacity"] = query.value(3).toInt();
+                        row["price_per_night"] = query.value(4).toDouble();
+                        line = QJsonDocument(row).toJson(QJsonDocument::Compact) + '\n';
+                    }
+
+                    if (out.write(line) != line.size()) {
+                        error = "Ошибка записи в файл: " + out.errorString();
+                        break;
+                    }
+                    written++;
+
+                    if (written % ProgressInterval == 0) {
+                        emit progress(written, total);
+                        if (cancelRequested.loadRelaxed()) {
+                            cancelled = true;
+                            break;
+                        }
+                    }
+                }
+                emit progress(written, total);
+            }
+        }
+
+        if (out.isOpen()) {
+            out.close();
+            if (cancelled || !error.isEmpty()) {
+                // Неполный файл бесполезен для бухгалтерии - удаляем
+                out.remove();
+            }
+        }
+    }
+
+    if (cancelled) {
+        error = "Экспорт отменен";
+    }
+    emit finished(error.isEmpty(), written, error);
+}
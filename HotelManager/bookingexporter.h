@@ -0,0 +1,44 @@
+#ifndef BOOKINGEXPORTER_H
+#define BOOKINGEXPORTER_H
+
+#include <QObject>
+#include <QDate>
+#include <QAtomicInt>
+
+class QThread;
+
+// Фоновая выгрузка бронирований (с типом и ценой комнаты) за период в CSV или JSON Lines.
+// Строки пишутся в файл по одной прямо из forward-only запроса, результат в памяти не собирается.
+// Работает в отдельном потоке со своим соединением к той же базе.
+class BookingExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format {
+        Csv,
+        JsonLines
+    };
+
+    explicit BookingExporter(const QString &databaseFile, QObject *parent = nullptr);
+    ~BookingExporter();
+
+    void start(const QDate &from, const QDate &to, Format format, const QString &fileName);
+    bool isRunning() const;
+
+public slots:
+    void cancel() { cancelRequested.storeRelaxed(1); }
+
+signals:
+    void progress(qint64 rowsWritten, qint64 rowsTotal);
+    void finished(bool ok, qint64 rowsWritten, const QString &error);
+
+private:
+    void run(const QDate &from, const QDate &to, Format format, const QString &fileName);
+
+    QString databaseFile;
+    QThread *worker;
+    QAtomicInt cancelRequested;
+};
+
+#endif // BOOKINGEXPORTER_H
@@ -0,0 +1,376 @@
+#include "bookingwritequeue.h"
+#include "appsettings.h"
+#include "connectionpool.h"
+#include "sqltracer.h"
+
+#include <QThread>
+#include <QSet>
+#include <QHash>
+#include <QPair>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Сколько ждать новых операций после первой, чтобы записать их одним пакетом
+    const int CoalesceMs = 100;
+
+    // Пауза перед повтором после неудачной записи (БД занята другим процессом и т.п.)
+    const int RetryMs = 1000;
+
+    QByteArray journalLine(quint64 seq, const BookingWriteQueue::Operation &operation)
+    {
+        return QByteArray::number(seq) + ' ' + (operation.occupied ? 'B' : 'C') + ' ' +
+               QByteArray::number(operation.roomNumber) + ' ' + QByteArray::number(operation.day) + '\n';
+    }
+
+    // Отметка: все операции с номером до seq включительно уже в БД
+    QByteArray flushedLine(quint64 seq)
+    {
+        return QByteArray::number(seq) + " F\n";
+    }
+}
+
+BookingWriteQueue::BookingWriteQueue(const QString &databaseFile, QObject *parent)
+    : QObject(parent)
+    , databaseFile(databaseFile)
+    , journal(journalFileFor(databaseFile))
+    , worker(nullptr)
+    , appendedSeq(0)
+    , flushedSeq(0)
+    , flushRequested(false)
+    , stopping(false)
+    , lastFlushFailed(false)
+{
+}
+
+BookingWriteQueue::~BookingWriteQueue()
+{
+    if (worker) {
+        {
+            QMutexLocker locker(&mutex);
+            stopping = true;
+            wakeUp.wakeAll();
+        }
+        worker->wait();
+        delete worker;
+    }
+}
+
+bool BookingWriteQueue::isEnabled()
+{
+    AppSettings settings;
+    return settings.value("writeBehind/enabled", false).toBool();
+}
+
+void BookingWriteQueue::setEnabled(bool enabled)
+{
+    AppSettings settings;
+    settings.setValue("writeBehind/enabled", enabled);
+}
+
+QString BookingWriteQueue::journalFileFor(const QString &databaseFile)
+{
+    // Не "-journal": это имя занято журналом отката самого SQLite
+    return databaseFile + ".pending";
+}
+
+bool BookingWriteQueue::syncFile(QFile &file)
+{
+    if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+bool BookingWriteQueue::replayJournal(const QSqlDatabase &db, QVector<Conflict> *conflicts, QString *error)
+{
+    QFile file(journalFileFor(db.databaseName()));
+    if (!file.exists() || file.size() == 0) return true;
+
+    if (!file.open(QIODevice::ReadWrite)) {
+        if (error) *error = "Не удалось открыть журнал: " + file.errorString();
+        return false;
+    }
+
+    // Сначала читаем весь журнал: отметка о записи идет после операций, которые она покрывает
+    QVector<QPair<quint64, Operation>> records;
+    quint64 watermark = 0;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        // Строка без перевода строки - запись, прерванная сбоем: операция не была принята
+        if (!line.endsWith('\n')) break;
+
+        QList<QByteArray> fields = line.trimmed().split(' ');
+        bool seqOk = false;
+        quint64 seq = fields[0].toULongLong(&seqOk);
+        if (!seqOk) break;
+
+        if (fields.size() == 2 && fields[1] == "F") {
+            watermark = qMax(watermark, seq);
+            continue;
+        }
+
+        bool roomOk = false, dayOk = false;
+        Operation operation;
+        if (fields.size() == 4) {
+            operation.occupied = fields[1] == "B";
+            operation.roomNumber = fields[2].toInt(&roomOk);
+            operation.day = fields[3].toLongLong(&dayOk);
+        }
+        if (!roomOk || !dayOk) break;
+        records.append(qMakePair(seq, operation));
+    }
+
+    // Записанные операции повторно не применяем: иначе они дали бы ложные конфликты, а
+    // записанная бронь и снятие после нее схлопнулись бы в ничто и снятие потерялось бы
+    QVector<Operation> operations;
+    for (const auto &record : records) {
+        if (record.first > watermark) operations.append(record.second);
+    }
+
+    if (!apply(db, operations, conflicts, error)) {
+        return false;
+    }
+
+    file.resize(0);
+    syncFile(file);
+    return true;
+}
+
+bool BookingWriteQueue::start(QString *error)
+{
+    if (worker) return true;
+
+    // Непримененный журнал прошлого запуска нельзя затирать - сначала replayJournal
+    if (journal.exists() && journal.size() > 0) {
+        if (error) *error = "В журнале остались незаписанные операции прошлого запуска";
+        return false;
+    }
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = "Не удалось создать журнал: " + journal.errorString();
+        return false;
+    }
+
+    worker = QThread::create([this]() { run(); });
+    worker->start();
+    return true;
+}
+
+bool BookingWriteQueue::enqueue(const QVector<Operation> &operations, QString *error)
+{
+    if (operations.isEmpty()) return true;
+
+    QMutexLocker locker(&mutex);
+
+    QByteArray data;
+    quint64 seq = appendedSeq;
+    for (const Operation &operation : operations) {
+        data += journalLine(++seq, operation);
+    }
+
+    // Операция принята только после того, как журнал на диске
+    if (journal.write(data) != data.size() || !syncFile(journal)) {
+        if (error) *error = "Не удалось записать журнал: " + journal.errorString();
+        return false;
+    }
+
+    appendedSeq = seq;
+    pending += operations;
+    wakeUp.wakeAll();
+    return true;
+}
+
+bool BookingWriteQueue::flushNow(int timeoutMs)
+{
+    QMutexLocker locker(&mutex);
+    if (!worker) return true;
+
+    flushRequested = true;
+    wakeUp.wakeAll();
+
+    QElapsedTimer timer;
+    timer.start();
+    while (flushedSeq < appendedSeq && !lastFlushFailed) {
+        qint64 left = timeoutMs - timer.elapsed();
+        if (left <= 0 || !drained.wait(&mutex, int(left))) break;
+    }
+    return flushedSeq == appendedSeq;
+}
+
+int BookingWriteQueue::pendingCount() const
+{
+    QMutexLocker locker(&mutex);
+    return int(appendedSeq - flushedSeq);
+}
+
+QVector<BookingWriteQueue::Operation> BookingWriteQueue::unflushed() const
+{
+    QMutexLocker locker(&mutex);
+    return writing + pending;
+}
+
+void BookingWriteQueue::run()
+{
+    // Соединение QSqlDatabase нельзя использовать из другого потока - соединение этого потока
+    // берется из пула на каждый пакет и закрывается пулом при завершении потока
+    QMutexLocker locker(&mutex);
+    for (;;) {
+        if (pending.isEmpty()) {
+            if (stopping) break;
+            wakeUp.wait(&mutex);
+            continue;
+        }
+
+        // Первая операция пришла - даем накопиться остальным, если запись не торопят
+        if (!stopping && !flushRequested) {
+            wakeUp.wait(&mutex, CoalesceMs);
+        }
+        flushRequested = false;
+
+        QVector<Operation> batch;
+        batch.swap(pending);
+        writing = batch;
+        quint64 batchSeq = appendedSeq;
+        locker.unlock();
+
+        QVector<Conflict> conflicts;
+        QString error;
+        bool ok = false;
+        {
+            ConnectionPool::Lease connection = ConnectionPool::instance().acquire(databaseFile);
+            QSqlDatabase db = connection.database();
+            if (db.isOpen()) {
+                ok = apply(db, batch, &conflicts, &error);
+            } else {
+                error = "Нет соединения с базой данных: " + connection.errorText();
+            }
+        }
+
+        locker.relock();
+        writing.clear();
+        if (ok) {
+            flushedSeq = batchSeq;
+            lastFlushFailed = false;
+
+            // Все принятые операции в БД - журнал больше не нужен. Иначе отмечаем записанную
+            // часть, чтобы после сбоя она не применялась второй раз
+            if (flushedSeq == appendedSeq) {
+                journal.resize(0);
+                journal.seek(0);
+                syncFile(journal);
+            } else {
+                QByteArray mark = flushedLine(flushedSeq);
+                if (journal.write(mark) != mark.size() || !syncFile(journal)) {
+                    qDebug() << "Не удалось записать отметку в журнал:" << journal.errorString();
+                }
+            }
+            drained.wakeAll();
+            locker.unlock();
+
+            emit flushed(batch.size());
+            if (!conflicts.isEmpty()) {
+                emit conflictsDetected(conflicts);
+            }
+            locker.relock();
+        } else {
+            // Пакет возвращаем в начало очереди; в журнале он остается до успешной записи
+            batch += pending;
+            pending.swap(batch);
+            lastFlushFailed = true;
+            drained.wakeAll();
+            locker.unlock();
+
+            emit flushFailed(error);
+
+            locker.relock();
+            if (stopping) break;
+            wakeUp.wait(&mutex, RetryMs);
+        }
+    }
+}
+
+bool BookingWriteQueue::apply(const QSqlDatabase &db, const QVector<Operation> &operations,
+                              QVector<Conflict> *conflicts, QString *error)
+{
+    if (operations.isEmpty()) return true;
+
+    // Повторные изменения одной комнато-ночи схлопываются: в БД идет только последнее.
+    // Если последнее возвращает ночь в состояние до первого (забронировали и сняли),
+    // в БД не идет ничего. Это верно только потому, что сюда попадают лишь еще не записанные
+    // операции: до первой из них БД в состоянии, обратном ей
+    QHash<QPair<int, qint64>, QPair<int, int>> firstAndLast;
+    for (int i = 0; i < operations.size(); i++) {
+        auto key = qMakePair(operations[i].roomNumber, operations[i].day);
+        auto it = firstAndLast.find(key);
+        if (it == firstAndLast.end()) {
+            firstAndLast.insert(key, qMakePair(i, i));
+        } else {
+            it->second = i;
+        }
+    }
+
+    QSqlDatabase database = db;
+
+    QSet<int> rooms;
+    {
+        TracedQuery roomsQuery("SELECT room_number FROM rooms", database);
+        while (roomsQuery.next()) {
+            rooms.insert(roomsQuery.value(0).toInt());
+        }
+    }
+
+    if (!database.transaction()) {
+        if (error) *error = "Не удалось начать транзакцию: " + database.lastError().text();
+        return false;
+    }
+
+    QString message;
+    {
+        TracedQuery insert(database);
+        insert.prepare("INSERT OR IGNORE INTO bookings (room_number, booking_date) VALUES (?, ?)");
+        TracedQuery remove(database);
+        remove.prepare("DELETE FROM bookings WHERE room_number = ? AND booking_date = ?");
+
+        for (auto it = firstAndLast.cbegin(); it != firstAndLast.cend(); ++it) {
+            const Operation &first = operations[it->first];
+            const Operation &operation = operations[it->second];
+            if (first.occupied != operation.occupied) continue;
+
+            if (operation.occupied && !rooms.contains(operation.roomNumber)) {
+                if (conflicts) conflicts->append({operation, "Комната удалена"});
+                continue;
+            }
+
+            TracedQuery &query = operation.occupied ? insert : remove;
+            query.addBindValue(operation.roomNumber);
+            query.addBindValue(operation.day);
+            if (!query.exec()) {
+                message = query.lastError().text();
+                break;
+            }
+
+            // Ни одной измененной строки - кто-то успел изменить эту ночь в обход очереди
+            if (query.numRowsAffected() == 0 && conflicts) {
+                conflicts->append({operation, operation.occupied ? "Ночь уже занята" : "Бронь уже снята"});
+            }
+        }
+    }
+
+    if (!message.isEmpty() || !database.commit()) {
+        if (message.isEmpty()) message = database.lastError().text();
+        database.rollback();
+        if (error) *error = "Не удалось записать бронирования: " + message;
+        return false;
+    }
+    return true;
+}
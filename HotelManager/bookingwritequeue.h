@@ -0,0 +1,94 @@
+#ifndef BOOKINGWRITEQUEUE_H
+#define BOOKINGWRITEQUEUE_H
+
+#include <QObject>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSqlDatabase>
+#include <QVector>
+
+class QThread;
+
+// Отложенная запись бронирований (write-behind).
+// Операция сначала дописывается в небольшой локальный журнал с fsync (X.db -> X.db.pending),
+// после чего считается принятой: кэш и сетка обновляются сразу. Фоновый поток со своим
+// соединением собирает операции в пакеты, схлопывает повторные изменения одной
+// комнато-ночи и записывает пакет одной транзакцией. После каждого записанного пакета в журнал
+// дописывается отметка "записано по seq N" (тоже с fsync); когда записаны все принятые операции,
+// журнал обрезается. Если приложение упало, при следующем запуске применяются только операции
+// после последней отметки.
+class BookingWriteQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Operation {
+        int roomNumber = 0;
+        qint64 day = 0;       // юлианский день
+        bool occupied = false;
+    };
+
+    // Операция, которую при записи пришлось пропустить: кто-то изменил БД в обход очереди
+    struct Conflict {
+        Operation operation;
+        QString reason;
+    };
+
+    explicit BookingWriteQueue(const QString &databaseFile, QObject *parent = nullptr);
+    // Дописывает все принятые операции и останавливает поток
+    ~BookingWriteQueue();
+
+    // Режим хранится в настройках (writeBehind/enabled)
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+
+    static QString journalFileFor(const QString &databaseFile);
+
+    // Применяет операции, оставшиеся в журнале после прошлого запуска (кроме уже записанных
+    // по отметкам), и обрезает журнал.
+    // Вызывать до загрузки кэша занятости.
+    static bool replayJournal(const QSqlDatabase &db, QVector<Conflict> *conflicts, QString *error = nullptr);
+
+    bool start(QString *error = nullptr);
+
+    // Записывает операции в журнал (одна запись и один fsync на вызов) и ставит в очередь
+    bool enqueue(const QVector<Operation> &operations, QString *error = nullptr);
+
+    // Ждет, пока все принятые операции попадут в БД (перед отчетами, экспортом, сменой отеля)
+    bool flushNow(int timeoutMs = 10000);
+
+    int pendingCount() const;
+
+    // Принятые, но еще не записанные в БД операции в порядке приема (включая пакет,
+    // который пишется сейчас) - чтобы перечитанный из БД кэш их не потерял
+    QVector<Operation> unflushed() const;
+
+signals:
+    void flushed(int operations);
+    void conflictsDetected(const QVector<BookingWriteQueue::Conflict> &conflicts);
+    void flushFailed(const QString &error);
+
+private:
+    void run();
+    static bool apply(const QSqlDatabase &db, const QVector<Operation> &operations,
+                      QVector<Conflict> *conflicts, QString *error);
+    static bool syncFile(QFile &file);
+
+    QString databaseFile;
+    QFile journal;
+    QThread *worker;
+
+    mutable QMutex mutex;
+    QWaitCondition wakeUp;
+    QWaitCondition drained;
+    QVector<Operation> pending;
+    QVector<Operation> writing; // пакет, который поток пишет сейчас
+    quint64 appendedSeq;
+    quint64 flushedSeq;
+    bool flushRequested;
+    bool stopping;
+    bool lastFlushFailed;
+};
+
+#endif // BOOKINGWRITEQUEUE_H
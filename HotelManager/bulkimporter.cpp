@@ -0,0 +1,350 @@
+#include "bulkimporter.h"
+#include "sqltracer.h"
+#include "validation.h"
+
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QDate>
+#include <QSqlError>
+
+namespace
+{
+    // Строк между сигналами прогресса и проверками отмены
+    const qint64 ProgressInterval = 4096;
+
+    // Максимальная длина одного проживания в строке бронирований
+    const int MaxStayNights = 366;
+
+    QDate parseDate(const QString &text)
+    {
+        QDate date = QDate::fromString(text, "yyyy-MM-dd");
+        if (!date.isValid()) {
+            date = QDate::fromString(text, "dd.MM.yyyy");
+        }
+        return date;
+    }
+
+    // Поле для файла отклоненных строк: в кавычках, если в нем разделитель, кавычка или перевод строки
+    QByteArray csvField(const QString &value, QChar delimiter)
+    {
+        QByteArray bytes = value.toUtf8();
+        if (value.contains(delimiter) || bytes.contains('"') || bytes.contains('\n')) {
+            bytes.replace("\"", "\"\"");
+            return '"' + bytes + '"';
+        }
+        return bytes;
+    }
+}
+
+BulkImporter::BulkImporter(const QSqlDatabase &db, QObject *parent)
+    : QObject(parent)
+    , db(db)
+    , delimiter(',')
+    , batchSize(50000)
+{
+}
+
+bool BulkImporter::readRecord(QTextStream &in, QStringList &fields, qint64 &lineNumber)
+{
+    fields.clear();
+
+    QString line;
+    if (!in.readLineInto(&line)) {
+        return false;
+    }
+    lineNumber++;
+
+    QString field;
+    bool quoted = false;
+
+    for (;;) {
+        for (int i = 0; i < line.size(); i++) {
+            QChar c = line.at(i);
+            if (quoted) {
+                if (c == '"') {
+                    if (i + 1 < line.size() && line.at(i + 1) == '"') {
+                        field += '"';
+                        i++;
+                    } else {
+                        quoted = false;
+                    }
+                } else {
+                    field += c;
+                }
+            } else if (c == '"') {
+                quoted = true;
+            } else if (c == delimiter) {
+                fields.append(field.trimmed());
+                field.clear();
+            } else {
+                field += c;
+            }
+        }
+
+        if (!quoted) break;
+
+        // Кавычки не закрыты - поле продолжается на следующей строке файла
+        if (!in.readLineInto(&line)) break;
+        lineNumber++;
+        field += '\n';
+    }
+
+    fields.append(field.trimmed());
+    return true;
+}
+
+bool BulkImporter::isHeader(Kind kind, const QStringList &fields) const
+{
+    // Заголовок узнаем по имени первой колонки; строка с испорченным номером - ошибка, а не заголовок
+    QString first = fields.first().toLower();
+    if (kind == Clients) {
+        return first == "full_name" || first == "фио";
+    }
+
+    // У комнат и бронирований первая колонка - номер комнаты (так пишет и экспорт)
+    return first == "room_number" || first == "номер" || first == "номер комнаты" || first == "комната";
+}
+
+void BulkImporter::reject(Result &result, qint64 lineNumber, const QStringList &fields, const QString &reason)
+{
+    result.rejected++;
+
+    if (!rejectsOut.isOpen()) {
+        if (!rejectsOut.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            return;
+        }
+        result.rejectsFile = rejectsOut.fileName();
+    }
+
+    const QByteArray separator = QString(delimiter).toUtf8();
+    QByteArray line = QByteArray::number(lineNumber) + separator + csvField(reason, delimiter);
+    for (const QString &field : fields) {
+        line += separator + csvField(field, delimiter);
+    }
+    rejectsOut.write(line + '\n');
+}
+
+bool BulkImporter::loadRoomNumbers()
+{
+    knownRooms.clear();
+
+    TracedQuery query("SELECT room_number FROM rooms", db);
+    if (!query.isActive()) {
+        return false;
+    }
+    while (query.next()) {
+        knownRooms.insert(query.value(0).toInt());
+    }
+    return true;
+}
+
+BulkImporter::Result BulkImporter::import(Kind kind, const QString &fileName)
+{
+    Result result;
+    QElapsedTimer timer;
+    timer.start();
+    cancelRequested.storeRelaxed(0);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        result.error = "Не удалось открыть файл: " + file.errorString();
+        return result;
+    }
+
+    // Разделитель определяем по первой строке: ';' (Excel) или ','
+    QByteArray head = file.peek(4096);
+    int eol = head.indexOf('\n');
+    QByteArray firstLine = eol >= 0 ? head.left(eol) : head;
+    delimiter = firstLine.count(';') > firstLine.count(',') ? QChar(';') : QChar(',');
+
+    if (kind == Bookings && !loadRoomNumbers()) {
+        result.error = "Не удалось загрузить список комнат";
+        return result;
+    }
+
+    rejectsOut.close();
+    rejectsOut.setFileName(fileName + ".rejected.csv");
+
+    TracedQuery insert(db);
+    bool prepared = false;
+    switch (kind) {
+    case Rooms:
+        prepared = insert.prepare("INSERT INTO rooms (room_number, room_type, capacity, price_per_night, description) "
+                                  "VALUES (?, ?, ?, ?, ?)");
+        break;
+    case Clients:
+        prepared = insert.prepare("INSERT INTO clients (full_name, phone, email, passport) VALUES (?, ?, ?, ?)");
+        break;
+    case Bookings:
+        prepared = insert.prepare("INSERT OR IGNORE INTO bookings (room_number, booking_date) VALUES (?, ?)");
+        break;
+    }
+
+    if (!prepared) {
+        result.error = "Не удалось подготовить запрос: " + insert.lastError().text();
+        return result;
+    }
+
+    if (!db.transaction()) {
+        result.error = "Не удалось начать транзакцию: " + db.lastError().text();
+        return result;
+    }
+
+    QTextStream in(&file);
+    QStringList fields;
+    qint64 lineNumber = 0;
+    qint64 processed = 0;
+    qint64 pending = 0;           // вставлено в текущей (незакоммиченной) транзакции
+    qint64 pendingDuplicates = 0; // уже бывшие в БД ночи текущей транзакции
+    bool firstRecord = true;
+
+    while (readRecord(in, fields, lineNumber)) {
+        if (fields.size() == 1 && fields.first().isEmpty()) {
+            continue;
+        }
+        if (firstRecord) {
+            firstRecord = false;
+            if (isHeader(kind, fields)) continue;
+        }
+
+        // До разбора строки: файл из одних отклоненных строк тоже показывает прогресс и отменяется
+        processed++;
+        if (processed % ProgressInterval == 0) {
+            emit progress(file.pos(), file.size(), processed);
+
+            if (cancelRequested.loadRelaxed()) {
+                result.cancelled = true;
+                break;
+            }
+        }
+
+        if (kind == Rooms) {
+            bool numberOk = false, capacityOk = true, priceOk = true;
+            int roomNumber = fields.value(0).toInt(&numberOk);
+            QString roomType = fields.value(1);
+            int capacity = fields.value(2).isEmpty() ? 2 : fields.value(2).toInt(&capacityOk);
+            double price = fields.value(3).isEmpty() ? 3000.0 : fields.value(3).toDouble(&priceOk);
+            QString description = fields.value(4);
+
+            if (!numberOk || roomNumber < Validation::MinRoomNumber || roomNumber > Validation::MaxRoomNumber) {
+                reject(result, lineNumber, fields, "Некорректный номер комнаты");
+                continue;
+            }
+            if (!Validation::isValidRoomName(roomType)) {
+                reject(result, lineNumber, fields, "Некорректный тип комнаты");
+                continue;
+            }
+            if (!capacityOk || capacity < Validation::MinCapacity || capacity > Validation::MaxCapacity) {
+                reject(result, lineNumber, fields, "Некорректная вместимость");
+                continue;
+            }
+            if (!priceOk || price < Validation::MinPrice || price > Validation::MaxPrice) {
+                reject(result, lineNumber, fields, "Некорректная цена");
+                continue;
+            }
+            if (!Validation::isValidRoomName(description)) {
+                reject(result, lineNumber, fields, "Некорректное описание");
+                continue;
+            }
+
+            insert.addBindValue(roomNumber);
+            insert.addBindValue(roomType);
+            insert.addBindValue(capacity);
+            insert.addBindValue(price);
+            insert.addBindValue(description);
+
+            if (!insert.exec()) {
+                reject(result, lineNumber, fields, insert.lastError().text());
+                continue;
+            }
+            pending++;
+        } else if (kind == Clients) {
+            if (fields.value(0).isEmpty()) {
+                reject(result, lineNumber, fields, "Пустое ФИО");
+                continue;
+            }
+
+            insert.addBindValue(fields.value(0));
+            insert.addBindValue(fields.value(1));
+            insert.addBindValue(fields.value(2));
+            insert.addBindValue(fields.value(3));
+
+            if (!insert.exec()) {
+                reject(result, lineNumber, fields, insert.lastError().text());
+                continue;
+            }
+            pending++;
+        } else {
+            bool numberOk = false;
+            int roomNumber = fields.value(0).toInt(&numberOk);
+            QDate checkIn = parseDate(fields.value(1));
+            // Без даты выезда строка означает одну ночь
+            QDate checkOut = fields.value(2).isEmpty() ? checkIn.addDays(1) : parseDate(fields.value(2));
+
+            if (!numberOk || !knownRooms.contains(roomNumber)) {
+                reject(result, lineNumber, fields, "Комната не найдена");
+                continue;
+            }
+            if (!checkIn.isValid() || !checkOut.isValid() || checkOut <= checkIn ||
+                checkIn.daysTo(checkOut) > MaxStayNights) {
+                reject(result, lineNumber, fields, "Некорректные даты");
+                continue;
+            }
+
+            // Строка уже проверена, а повторы ночей пропускает INSERT OR IGNORE - ошибка здесь
+            // означает сбой базы. Весь текущий пакет откатывается ниже, так что от строки
+            // не остается половины ночей
+            for (QDate night = checkIn; night < checkOut; night = night.addDays(1)) {
+                insert.addBindValue(roomNumber);
+                insert.addBindValue(night.toJulianDay());
+
+                if (!insert.exec()) {
+                    result.error = QString("Ошибка записи в строке %1: %2")
+                                       .arg(lineNumber).arg(insert.lastError().text());
+                    break;
+                }
+                if (insert.numRowsAffected() > 0) {
+                    pending++;
+                } else {
+                    pendingDuplicates++;
+                }
+            }
+            if (!result.error.isEmpty()) break;
+        }
+
+        if (pending >= batchSize) {
+            if (!db.commit()) {
+                result.error = "Не удалось зафиксировать транзакцию: " + db.lastError().text();
+                db.rollback();
+                pending = 0;
+                break;
+            }
+            result.imported += pending;
+            result.duplicates += pendingDuplicates;
+            pending = 0;
+            pendingDuplicates = 0;
+
+            if (!db.transaction()) {
+                result.error = "Не удалось начать транзакцию: " + db.lastError().text();
+                break;
+            }
+        }
+    }
+
+    if (result.cancelled || !result.error.isEmpty()) {
+        // Уже зафиксированные пакеты остаются в БД, текущий откатываем
+        db.rollback();
+    } else if (db.commit()) {
+        result.imported += pending;
+        result.duplicates += pendingDuplicates;
+    } else {
+        result.error = "Не удалось зафиксировать транзакцию: " + db.lastError().text();
+        db.rollback();
+    }
+
+    emit progress(file.size(), file.size(), processed);
+
+    rejectsOut.close();
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
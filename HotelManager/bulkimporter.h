@@ -0,0 +1,62 @@
+#ifndef BULKIMPORTER_H
+#define BULKIMPORTER_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QAtomicInt>
+#include <QFile>
+#include <QSet>
+
+class QTextStream;
+
+// Потоковый импорт комнат, клиентов и бронирований из CSV.
+// Файл читается построчно, строки проверяются теми же правилами, что и диалоги,
+// и вставляются крупными транзакциями через один подготовленный запрос.
+class BulkImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Kind {
+        Rooms,    // room_number, room_type, capacity, price_per_night, description
+        Clients,  // full_name, phone, email, passport
+        Bookings  // room_number, booking_date [, check_out]
+    };
+
+    struct Result {
+        qint64 imported = 0;   // вставлено строк в БД
+        qint64 rejected = 0;   // отклонено проверкой или базой
+        qint64 duplicates = 0; // бронирования, которые уже были в БД
+        qint64 elapsedMs = 0;
+        bool cancelled = false;
+        QString error;         // фатальная ошибка (файл, транзакция)
+        QString rejectsFile;   // куда записаны отклоненные строки
+    };
+
+    explicit BulkImporter(const QSqlDatabase &db, QObject *parent = nullptr);
+
+    void setBatchSize(int rows) { batchSize = qMax(1, rows); }
+    Result import(Kind kind, const QString &fileName);
+
+public slots:
+    void cancel() { cancelRequested.storeRelaxed(1); }
+
+signals:
+    void progress(qint64 bytesRead, qint64 bytesTotal, qint64 rowsProcessed);
+
+private:
+    bool readRecord(QTextStream &in, QStringList &fields, qint64 &lineNumber);
+    bool isHeader(Kind kind, const QStringList &fields) const;
+    void reject(Result &result, qint64 lineNumber, const QStringList &fields, const QString &reason);
+    bool loadRoomNumbers();
+
+    QSqlDatabase db;
+    QChar delimiter;
+    int batchSize;
+    QAtomicInt cancelRequested;
+    QFile rejectsOut;
+    QSet<int> knownRooms;
+};
+
+#endif // BULKIMPORTER_H
@@ -0,0 +1,302 @@
+#include "connectionpool.h"
+#include "appsettings.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QSqlError>
+#include <QMutexLocker>
+#include <atomic>
+
+namespace
+{
+    bool isMainThread()
+    {
+        return QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread();
+    }
+}
+
+ConnectionPool::Lease::Lease(Lease &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+ConnectionPool::Lease &ConnectionPool::Lease::operator=(Lease &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        pool = other.pool;
+        name = std::move(other.name);
+        error = std::move(other.error);
+        counted = other.counted;
+        held = other.held;
+        other.pool = nullptr;
+        other.name.clear();
+        other.counted = false;
+    }
+    return *this;
+}
+
+ConnectionPool::Lease::~Lease()
+{
+    release();
+}
+
+void ConnectionPool::Lease::release()
+{
+    if (pool && !name.isEmpty()) {
+        pool->release(name, counted, held.nsecsElapsed() / 1000);
+    }
+    pool = nullptr;
+    name.clear();
+    counted = false;
+}
+
+QSqlDatabase ConnectionPool::Lease::database() const
+{
+    return name.isEmpty() ? QSqlDatabase() : QSqlDatabase::database(name, false);
+}
+
+QString ConnectionPool::Lease::errorText() const
+{
+    return error.isEmpty() ? database().lastError().text() : error;
+}
+
+ConnectionPool::ThreadConnections::~ThreadConnections()
+{
+    // Поток завершается - его соединения больше никому не нужны
+    for (const Slot &slot : connections) {
+        pool->closeSlot(slot);
+    }
+}
+
+ConnectionPool &ConnectionPool::instance()
+{
+    static ConnectionPool pool;
+    return pool;
+}
+
+ConnectionPool::ConnectionPool()
+{
+    counters.capacity = configuredCapacity();
+    sinceReset.start();
+}
+
+void ConnectionPool::applyPragmas(const QSqlDatabase &db)
+{
+    // Несколько соединений пишут в один файл - ждем освобождения блокировки, а не падаем
+    TracedQuery("PRAGMA busy_timeout = 5000", db);
+}
+
+int ConnectionPool::configuredCapacity()
+{
+    // Глобальный пул задач и потоки API заняты одновременно, плюс запись, отчет и экспорт
+    AppSettings settings;
+    return qMax(1, settings.value("db/poolSize", 2 * QThread::idealThreadCount() + 3).toInt());
+}
+
+int ConnectionPool::capacity() const
+{
+    QMutexLocker locker(&mutex);
+    return counters.capacity;
+}
+
+void ConnectionPool::setCapacity(int capacity)
+{
+    QMutexLocker locker(&mutex);
+    counters.capacity = qMax(1, capacity);
+    released.wakeAll();
+}
+
+ConnectionPool::ThreadConnections *ConnectionPool::threadConnections()
+{
+    if (!perThread.hasLocalData()) {
+        perThread.setLocalData(new ThreadConnections(this));
+    }
+    return perThread.localData();
+}
+
+ConnectionPool::Lease ConnectionPool::acquire(const QString &databaseFile, int timeoutMs)
+{
+    ThreadConnections *thread = threadConnections();
+
+    int index = -1;
+    for (int i = 0; i < thread->connections.size(); i++) {
+        if (thread->connections[i].databaseFile == databaseFile) {
+            index = i;
+            break;
+        }
+    }
+
+    Lease lease;
+    lease.pool = this;
+
+    // Вложенная выдача в том же потоке - то же соединение, без очереди
+    if (index >= 0 && thread->connections[index].depth > 0) {
+        Slot &slot = thread->connections[index];
+        slot.depth++;
+        lease.name = slot.name;
+        lease.held.start();
+
+        QMutexLocker locker(&mutex);
+        counters.acquisitions++;
+        counters.reused++;
+        return lease;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        counters.acquisitions++;
+        if (counters.inUse >= counters.capacity) {
+            counters.waits++;
+            QElapsedTimer waited;
+            waited.start();
+            while (counters.inUse >= counters.capacity) {
+                qint64 left = timeoutMs - waited.elapsed();
+                if (left <= 0) break;
+                released.wait(&mutex, int(left));
+            }
+            counters.waitTime.add(waited.nsecsElapsed() / 1000);
+
+            if (counters.inUse >= counters.capacity) {
+                counters.timeouts++;
+                lease.pool = nullptr;
+                lease.error = QString("Нет свободного соединения с базой данных за %1 мс").arg(timeoutMs);
+                return lease;
+            }
+        }
+        counters.inUse++;
+        counters.peakInUse = qMax(counters.peakInUse, counters.inUse);
+    }
+    lease.counted = true;
+
+    if (index < 0) {
+        // Поток работал со многими файлами - закрываем давно не использованное соединение
+        if (thread->connections.size() >= MaxPerThread) {
+            int oldest = -1;
+            for (int i = 0; i < thread->connections.size(); i++) {
+                const Slot &slot = thread->connections[i];
+                if (slot.depth == 0 && (oldest < 0 || slot.lastUsed < thread->connections[oldest].lastUsed)) {
+                    oldest = i;
+                }
+            }
+            if (oldest >= 0) {
+                closeSlot(thread->connections[oldest]);
+                thread->connections.remove(oldest);
+            }
+        }
+
+        static std::atomic<int> counter(0);
+        Slot slot;
+        slot.databaseFile = databaseFile;
+        slot.name = QString("pool_%1_%2").arg(quintptr(QThread::currentThreadId())).arg(counter++);
+        QSqlDatabase::addDatabase("QSQLITE", slot.name).setDatabaseName(databaseFile);
+
+        thread->connections.append(slot);
+        index = thread->connections.size() - 1;
+
+        QMutexLocker locker(&mutex);
+        counters.open++;
+    }
+
+    Slot &slot = thread->connections[index];
+    QSqlDatabase db = QSqlDatabase::database(slot.name, false);
+    if (db.isOpen()) {
+        QMutexLocker locker(&mutex);
+        counters.reused++;
+    } else if (db.open()) {
+        applyPragmas(db);
+
+        QMutexLocker locker(&mutex);
+        counters.opened++;
+    }
+
+    slot.depth++;
+    slot.lastUsed = ++thread->useCounter;
+    lease.name = slot.name;
+    lease.held.start();
+    return lease;
+}
+
+void ConnectionPool::release(const QString &name, bool counted, qint64 heldMicros)
+{
+    if (perThread.hasLocalData()) {
+        ThreadConnections *thread = perThread.localData();
+        for (int i = 0; i < thread->connections.size(); i++) {
+            Slot &slot = thread->connections[i];
+            if (slot.name != name) continue;
+
+            slot.depth--;
+            // Главный поток работает со своими соединениями окна - пулом он пользуется редко
+            if (slot.depth == 0 && isMainThread()) {
+                closeSlot(slot);
+                thread->connections.remove(i);
+            }
+            break;
+        }
+    }
+
+    if (counted) {
+        QMutexLocker locker(&mutex);
+        counters.inUse--;
+        counters.busyMicros += heldMicros;
+        released.wakeOne();
+    }
+}
+
+void ConnectionPool::closeSlot(const Slot &slot)
+{
+    {
+        QSqlDatabase db = QSqlDatabase::database(slot.name, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(slot.name);
+
+    QMutexLocker locker(&mutex);
+    counters.open--;
+}
+
+ConnectionPool::Stats ConnectionPool::stats() const
+{
+    QMutexLocker locker(&mutex);
+    Stats s = counters;
+    s.elapsedMicros = sinceReset.nsecsElapsed() / 1000;
+    return s;
+}
+
+void ConnectionPool::resetStats()
+{
+    QMutexLocker locker(&mutex);
+    Stats fresh;
+    fresh.capacity = counters.capacity;
+    fresh.open = counters.open;
+    fresh.inUse = counters.inUse;
+    fresh.peakInUse = counters.inUse;
+    counters = fresh;
+    sinceReset.restart();
+}
+
+QString ConnectionPool::reportHtml() const
+{
+    Stats s = stats();
+
+    QString html;
+    html += "<h3>Пул соединений</h3>";
+    html += QString("<p>Мест: %1, открыто соединений: %2, занято: %3, пик: %4<br>"
+                    "Выдач: %5, из них уже открытых: %6, открыто новых: %7<br>"
+                    "Ожиданий места: %8, не дождались: %9; ожидание, мкс: среднее %10, p95 %11, макс %12<br>"
+                    "Загрузка пула: %13%</p>")
+                .arg(s.capacity)
+                .arg(s.open)
+                .arg(s.inUse)
+                .arg(s.peakInUse)
+                .arg(s.acquisitions)
+                .arg(s.reused)
+                .arg(s.opened)
+                .arg(s.waits)
+                .arg(s.timeouts)
+                .arg(s.waitTime.count() > 0 ? s.waitTime.total() / s.waitTime.count() : 0)
+                .arg(s.waitTime.percentile(0.95))
+                .arg(s.waitTime.max())
+                .arg(s.utilisation() * 100.0, 0, 'f', 1);
+    return html;
+}
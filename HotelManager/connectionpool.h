@@ -0,0 +1,128 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QThreadStorage>
+
+#include "sqltracer.h"
+
+// Соединения с БД для рабочих потоков (QThreadPool, потоки API, записи, отчетов, экспорта).
+// QSqlDatabase привязан к потоку, в котором создан, поэтому у каждого потока свои именованные
+// соединения - по одному на файл БД. Соединение открывается при первой выдаче в потоке,
+// сразу получает общие настройки (applyPragmas) и остается открытым для следующих задач того же
+// потока; закрывается оно при завершении потока (QThreadStorage) или при вытеснении, если поток
+// работал со слишком многими файлами. В главном потоке соединения не кэшируются: у окна свои.
+// Одновременно выдается не больше capacity() соединений; остальные ждут освобождения.
+class ConnectionPool
+{
+public:
+    static const int DefaultTimeoutMs = 30000;
+    // Сколько открытых соединений (файлов) держит один поток
+    static const int MaxPerThread = 4;
+
+    struct Stats {
+        int capacity = 0;
+        int open = 0;            // открытые соединения во всех потоках
+        int inUse = 0;
+        int peakInUse = 0;
+        qint64 acquisitions = 0;
+        qint64 reused = 0;       // выдано уже открытое соединение потока
+        qint64 opened = 0;
+        qint64 waits = 0;        // выдач, которым пришлось ждать места
+        qint64 timeouts = 0;
+        LatencyHistogram waitTime;
+        qint64 busyMicros = 0;   // суммарное время от выдачи до возврата
+        qint64 elapsedMicros = 0;
+
+        // Доля занятых мест за время с последнего сброса
+        double utilisation() const
+        {
+            return capacity > 0 && elapsedMicros > 0 ? double(busyMicros) / (double(capacity) * elapsedMicros) : 0.0;
+        }
+    };
+
+    // Выданное соединение; возвращается в пул в деструкторе. Использовать и уничтожать
+    // только в том потоке, где получено
+    class Lease
+    {
+    public:
+        Lease() = default;
+        Lease(Lease &&other) noexcept;
+        Lease &operator=(Lease &&other) noexcept;
+        ~Lease();
+
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+
+        QSqlDatabase database() const;
+        bool isOpen() const { return database().isOpen(); }
+        QString errorText() const;
+
+    private:
+        friend class ConnectionPool;
+
+        void release();
+
+        ConnectionPool *pool = nullptr;
+        QString name;
+        QString error;
+        bool counted = false;    // занимает место в пуле (внешняя выдача в потоке)
+        QElapsedTimer held;
+    };
+
+    static ConnectionPool &instance();
+
+    // Настройки, общие для всех соединений приложения, включая соединения окна
+    static void applyPragmas(const QSqlDatabase &db);
+
+    // Размер пула хранится в настройках (db/poolSize)
+    static int configuredCapacity();
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    // Соединение текущего потока с файлом; ждет свободного места не дольше timeoutMs.
+    // Повторная выдача того же файла в потоке, пока первая не возвращена, места не занимает
+    Lease acquire(const QString &databaseFile, int timeoutMs = DefaultTimeoutMs);
+
+    Stats stats() const;
+    void resetStats();
+    QString reportHtml() const;
+
+private:
+    struct Slot {
+        QString databaseFile;
+        QString name;
+        int depth = 0;           // невозвращенные выдачи в потоке
+        qint64 lastUsed = 0;
+    };
+
+    // Соединения одного потока; удаляется QThreadStorage при завершении потока
+    struct ThreadConnections {
+        explicit ThreadConnections(ConnectionPool *pool) : pool(pool) {}
+        ~ThreadConnections();
+
+        ConnectionPool *pool;
+        QVector<Slot> connections;
+        qint64 useCounter = 0;
+    };
+
+    ConnectionPool();
+
+    ThreadConnections *threadConnections();
+    void closeSlot(const Slot &slot);
+    void release(const QString &name, bool counted, qint64 heldMicros);
+
+    QThreadStorage<ThreadConnections *> perThread;
+
+    mutable QMutex mutex;
+    QWaitCondition released;
+    Stats counters;
+    QElapsedTimer sinceReset;
+};
+
+#endif // CONNECTIONPOOL_H
@@ -0,0 +1,76 @@
+#include "dbmigration.h"
+#include "sqltracer.h"
+
+#include <QSqlError>
+
+namespace
+{
+    const int MigrationBatchSize = 10000;
+}
+
+int DatabaseMigration::schemaVersion(const QSqlDatabase &db, const QString &schema)
+{
+    TracedQuery query(db);
+    if (query.exec(QString("PRAGMA %1.user_version").arg(schema)) && query.next()) {
+        return query.value(0).toInt();
+    }
+    return 0;
+}
+
+bool DatabaseMigration::migrateBookingDates(const QSqlDatabase &db, const QString &schema, QString *error,
+                                            qint64 *converted)
+{
+    if (converted) *converted = 0;
+    if (schemaVersion(db, schema) >= BookingDatesVersion) {
+        return true;
+    }
+
+    QSqlDatabase connection = db;
+
+    // В SQLite любое число меньше любой строки, поэтому "booking_date >= ''" по индексу
+    // по дате выбирает только еще не сконвертированные текстовые значения.
+    // julianday() дает полночь (x.5), +0.5 - номер дня как у QDate::toJulianDay().
+    const QString sql = QString(
+        "UPDATE OR REPLACE %1.bookings "
+        "SET booking_date = CAST(julianday(booking_date) + 0.5 AS INTEGER) "
+        "WHERE id IN (SELECT id FROM %1.bookings "
+        "WHERE booking_date >= '' AND julianday(booking_date) IS NOT NULL "
+        "ORDER BY booking_date LIMIT ?)").arg(schema);
+
+    for (;;) {
+        if (!connection.transaction()) {
+            if (error) *error = connection.lastError().text();
+            return false;
+        }
+
+        TracedQuery update(db);
+        update.prepare(sql);
+        update.addBindValue(MigrationBatchSize);
+
+        if (!update.exec()) {
+            if (error) *error = update.lastError().text();
+            update.finish();
+            connection.rollback();
+            return false;
+        }
+
+        int changed = update.numRowsAffected();
+        update.finish();
+
+        if (!connection.commit()) {
+            if (error) *error = connection.lastError().text();
+            connection.rollback();
+            return false;
+        }
+
+        if (converted) *converted += changed;
+        if (changed < MigrationBatchSize) break;
+    }
+
+    TracedQuery query(db);
+    if (!query.exec(QString("PRAGMA %1.user_version = %2").arg(schema).arg(BookingDatesVersion))) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef DBMIGRATION_H
+#define DBMIGRATION_H
+
+#include <QSqlDatabase>
+#include <QString>
+
+// Миграции схемы. Версия схемы хранится в PRAGMA user_version каждого файла.
+class DatabaseMigration
+{
+public:
+    // 1: bookings.booking_date - целый юлианский день вместо текста 'yyyy-MM-dd'
+    static const int BookingDatesVersion = 1;
+
+    // Переводит даты бронирований схемы (main/archive) в юлианские дни.
+    // Работает порциями в отдельных транзакциях: прерванная миграция продолжится
+    // со следующего запуска с того места, где остановилась. В converted - сколько дат переведено.
+    static bool migrateBookingDates(const QSqlDatabase &db, const QString &schema, QString *error = nullptr,
+                                    qint64 *converted = nullptr);
+
+    static int schemaVersion(const QSqlDatabase &db, const QString &schema);
+};
+
+#endif // DBMIGRATION_H
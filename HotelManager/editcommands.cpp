@@ -0,0 +1,130 @@
+#include "editcommands.h"
+
+#include <QDateTime>
+#include <QSet>
+
+BookingCommand::BookingCommand(EditTarget *target, const QVector<Change> &changes)
+    : target(target)
+    , lastEditMs(QDateTime::currentMSecsSinceEpoch())
+{
+    for (const Change &change : changes) {
+        if (change.before == change.after) continue;
+        positions.insert(qMakePair(change.roomNumber, change.day), this->changes.size());
+        this->changes.append(change);
+    }
+    updateText();
+}
+
+bool BookingCommand::isBooking() const
+{
+    return !changes.isEmpty() && changes.first().after;
+}
+
+void BookingCommand::updateText()
+{
+    QSet<int> rooms;
+    for (const Change &change : changes) {
+        rooms.insert(change.roomNumber);
+    }
+
+    setText(QString("%1: %2 ноч., комнат: %3")
+                .arg(isBooking() ? "Бронирование" : "Снятие брони")
+                .arg(changes.size())
+                .arg(rooms.size()));
+}
+
+void BookingCommand::apply(bool forward)
+{
+    QVector<EditTarget::BookingState> states;
+    states.reserve(changes.size());
+    for (const Change &change : changes) {
+        states.append({change.roomNumber, change.day, forward ? change.after : change.before});
+    }
+    target->applyBookingStates(states);
+}
+
+void BookingCommand::undo()
+{
+    apply(false);
+}
+
+void BookingCommand::redo()
+{
+    // Пустая команда (все ячейки уже были в нужном состоянии) стеку не нужна
+    if (changes.isEmpty()) {
+        setObsolete(true);
+        return;
+    }
+    apply(true);
+}
+
+bool BookingCommand::mergeWith(const QUndoCommand *other)
+{
+    const BookingCommand *next = static_cast<const BookingCommand *>(other);
+    if (next->changes.isEmpty() || next->isBooking() != isBooking() ||
+        next->lastEditMs - lastEditMs > MergeWindowMs) {
+        return false;
+    }
+
+    // Повторная правка той же ночи: исходное состояние остается от первой правки
+    for (const Change &change : next->changes) {
+        auto key = qMakePair(change.roomNumber, change.day);
+        auto it = positions.constFind(key);
+        if (it != positions.constEnd()) {
+            changes[*it].after = change.after;
+        } else {
+            positions.insert(key, changes.size());
+            changes.append(change);
+        }
+    }
+
+    lastEditMs = next->lastEditMs;
+    updateText();
+    return true;
+}
+
+AddRoomCommand::AddRoomCommand(EditTarget *target, const RoomInfo &room)
+    : target(target)
+    , room(room)
+{
+    setText(QString("Добавление комнаты %1").arg(room.number));
+}
+
+void AddRoomCommand::undo()
+{
+    // Ошибку показывает окно; команда, которую не удалось отменить, стеку больше не нужна
+    if (!target->removeRoom(room.number)) {
+        setObsolete(true);
+    }
+}
+
+void AddRoomCommand::redo()
+{
+    if (!target->insertRoom(room, QVector<qint64>())) {
+        setObsolete(true);
+    }
+}
+
+DeleteRoomCommand::DeleteRoomCommand(EditTarget *target, const RoomInfo &room, const QVector<qint64> &bookedDays)
+    : target(target)
+    , room(room)
+    , bookedDays(bookedDays)
+{
+    setText(QString("Удаление комнаты %1 (броней: %2)").arg(room.number).arg(bookedDays.size()));
+}
+
+void DeleteRoomCommand::undo()
+{
+    // Комнату не вернуть (номер уже занят заново и т.п.) - повторять удаление по redo нельзя:
+    // оно удалило бы чужую комнату. Ошибку показывает окно
+    if (!target->insertRoom(room, bookedDays)) {
+        setObsolete(true);
+    }
+}
+
+void DeleteRoomCommand::redo()
+{
+    if (!target->removeRoom(room.number)) {
+        setObsolete(true);
+    }
+}
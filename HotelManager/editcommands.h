@@ -0,0 +1,92 @@
+#ifndef EDITCOMMANDS_H
+#define EDITCOMMANDS_H
+
+#include <QUndoCommand>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+#include "roomindex.h"
+
+// Изменения, которые команды отмены применяют к отелю; реализуется окном.
+// Каждый вызов - одна пакетная запись, а не запрос на каждую ночь.
+class EditTarget
+{
+public:
+    struct BookingState {
+        int roomNumber = 0;
+        qint64 day = 0;       // юлианский день
+        bool occupied = false;
+    };
+
+    virtual ~EditTarget() = default;
+
+    virtual void applyBookingStates(const QVector<BookingState> &states) = 0;
+    // При ошибке сами сообщают о ней пользователю и возвращают false
+    virtual bool insertRoom(const RoomInfo &room, const QVector<qint64> &bookedDays) = 0;
+    virtual bool removeRoom(int roomNumber) = 0;
+};
+
+// Бронирование или снятие брони для набора комнато-ночей.
+// Следующие друг за другом правки одного вида (подряд, в пределах MergeWindowMs)
+// сливаются в одну команду: и отмена, и запись в БД идут одним пакетом.
+class BookingCommand : public QUndoCommand
+{
+public:
+    struct Change {
+        int roomNumber = 0;
+        qint64 day = 0;
+        bool before = false;
+        bool after = false;
+    };
+
+    static const int MergeWindowMs = 1500;
+
+    BookingCommand(EditTarget *target, const QVector<Change> &changes);
+
+    void undo() override;
+    void redo() override;
+    int id() const override { return 1; }
+    bool mergeWith(const QUndoCommand *other) override;
+
+private:
+    void apply(bool forward);
+    void updateText();
+    bool isBooking() const;
+
+    EditTarget *target;
+    QVector<Change> changes;
+    QHash<QPair<int, qint64>, int> positions;
+    qint64 lastEditMs;
+};
+
+// Добавление комнаты; отмена удаляет ее
+class AddRoomCommand : public QUndoCommand
+{
+public:
+    AddRoomCommand(EditTarget *target, const RoomInfo &room);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    EditTarget *target;
+    RoomInfo room;
+};
+
+// Удаление комнаты вместе с ее бронированиями; отмена возвращает и комнату, и все брони
+class DeleteRoomCommand : public QUndoCommand
+{
+public:
+    DeleteRoomCommand(EditTarget *target, const RoomInfo &room, const QVector<qint64> &bookedDays);
+
+    void undo() override;
+    void redo() override;
+
+private:
+    EditTarget *target;
+    RoomInfo room;
+    QVector<qint64> bookedDays;
+};
+
+#endif // EDITCOMMANDS_H
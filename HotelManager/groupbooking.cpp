@@ -0,0 +1,147 @@
+#include "groupbooking.h"
+#include "occupancystore.h"
+#include "roomindex.h"
+#include "sharedoccupancy.h"
+#include "sqltracer.h"
+
+#include <QSqlError>
+#include <limits>
+
+namespace
+{
+    // Свободный промежуток короче этого числа ночей считается "дырой", которую трудно продать
+    const int ShortGapNights = 3;
+
+    // Штраф за свободный промежуток длиной run ночей между блоком и соседней бронью
+    int gapPenalty(int run)
+    {
+        if (run == 0) return 0;                 // вплотную к соседней брони - лучший вариант
+        if (run <= ShortGapNights) {
+            return (ShortGapNights + 1 - run) * 2; // одна ночь - худший случай
+        }
+        return 1;                               // большой свободный участок остается продаваемым
+    }
+
+    // Длина свободного участка от day в направлении step (не дальше ShortGapNights + 1)
+    int freeRun(const OccupancyStore &occupancy, int roomNumber, qint64 day, int step, qint64 today)
+    {
+        int run = 0;
+        while (run <= ShortGapNights && day >= today && !occupancy.isOccupied(roomNumber, day)) {
+            run++;
+            day += step;
+        }
+        return run;
+    }
+}
+
+GroupBooking::Allocation GroupBooking::allocate(const Request &request, const RoomIndex &rooms,
+                                                const OccupancyStore &occupancy)
+{
+    Allocation allocation;
+
+    if (request.roomCount < 1 || request.toDay <= request.fromDay) {
+        allocation.error = "Некорректные параметры группы";
+        return allocation;
+    }
+
+    RoomIndex::Filter filter;
+    filter.type = request.type;
+    filter.minCapacity = request.minCapacity;
+    filter.freeOnly = true;
+    filter.freeFrom = request.fromDay;
+    filter.freeTo = request.toDay;
+
+    QVector<int> candidates = rooms.select(filter, RoomIndex::ByNumber, false, occupancy);
+    const int n = request.roomCount;
+    if (candidates.size() < n) {
+        allocation.error = QString("Свободно только %1 подходящих комнат из %2 нужных")
+                               .arg(candidates.size())
+                               .arg(n);
+        return allocation;
+    }
+
+    // Префиксная сумма штрафов за промежутки: стоимость окна [i, i + n) считается за O(1)
+    QVector<qint64> prefix(candidates.size() + 1, 0);
+    for (int i = 0; i < candidates.size(); i++) {
+        int room = candidates[i];
+        int before = freeRun(occupancy, room, request.fromDay - 1, -1, request.today);
+        int after = freeRun(occupancy, room, request.toDay, 1, request.today);
+        prefix[i + 1] = prefix[i] + gapPenalty(before) + gapPenalty(after);
+    }
+
+    int bestStart = -1;
+    qint64 bestCost = std::numeric_limits<qint64>::max();
+    for (int i = 0; i + n <= candidates.size(); i++) {
+        qint64 numberGaps = qint64(candidates[i + n - 1]) - candidates[i] - (n - 1);
+        qint64 cost = (prefix[i + n] - prefix[i]) + numberGaps;
+        if (cost < bestCost) {
+            bestCost = cost;
+            bestStart = i;
+        }
+    }
+
+    allocation.rooms = candidates.mid(bestStart, n);
+    allocation.numberGaps = allocation.rooms.last() - allocation.rooms.first() - (n - 1);
+    for (int room : allocation.rooms) {
+        int before = freeRun(occupancy, room, request.fromDay - 1, -1, request.today);
+        int after = freeRun(occupancy, room, request.toDay, 1, request.today);
+        if (before > 0 && before <= ShortGapNights) allocation.orphanNights += before;
+        if (after > 0 && after <= ShortGapNights) allocation.orphanNights += after;
+    }
+    return allocation;
+}
+
+bool GroupBooking::commit(const QSqlDatabase &db, SharedOccupancy &occupancy, const Request &request,
+                          const Allocation &allocation, QString *error)
+{
+    QString message;
+
+    // Проверка занятости, транзакция и публикация - под одной блокировкой писателей, как в ApiServer:
+    // запись через API не ляжет ни между проверкой и вставкой, ни между фиксацией и снимком
+    bool ok = occupancy.update([&](OccupancyStore &store) {
+        for (int room : allocation.rooms) {
+            if (store.countOccupied(room, request.fromDay, request.toDay - 1) > 0) {
+                message = QString("Комнату %1 уже заняли, подберите группу заново").arg(room);
+                return false;
+            }
+        }
+
+        QSqlDatabase database = db;
+        if (!database.transaction()) {
+            message = "Не удалось начать транзакцию: " + database.lastError().text();
+            return false;
+        }
+
+        {
+            TracedQuery insert(database);
+            insert.prepare("INSERT INTO bookings (room_number, booking_date) VALUES (?, ?)");
+            for (int room : allocation.rooms) {
+                for (qint64 day = request.fromDay; day < request.toDay && message.isEmpty(); day++) {
+                    insert.addBindValue(room);
+                    insert.addBindValue(day);
+                    if (!insert.exec()) {
+                        message = insert.lastError().text();
+                    }
+                }
+            }
+        }
+
+        if (!message.isEmpty() || !database.commit()) {
+            if (message.isEmpty()) message = database.lastError().text();
+            database.rollback();
+            return false;
+        }
+
+        for (int room : allocation.rooms) {
+            for (qint64 day = request.fromDay; day < request.toDay; day++) {
+                store.setOccupied(room, day, true);
+            }
+        }
+        return true;
+    });
+
+    if (!ok && error) {
+        *error = message;
+    }
+    return ok;
+}
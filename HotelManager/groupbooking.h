@@ -0,0 +1,47 @@
+#ifndef GROUPBOOKING_H
+#define GROUPBOOKING_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+
+class OccupancyStore;
+class RoomIndex;
+class SharedOccupancy;
+
+// Групповое бронирование: N комнат на одни и те же M ночей одной операцией.
+class GroupBooking
+{
+public:
+    struct Request {
+        int roomCount = 1;
+        qint64 fromDay = 0;   // ночь заезда (юлианский день)
+        qint64 toDay = 0;     // день выезда, ночь не входит
+        QString type;         // пусто - любой тип
+        int minCapacity = 0;
+        qint64 today = 0;     // дни раньше сегодняшнего не продаются и не считаются "дырами"
+    };
+
+    struct Allocation {
+        QVector<int> rooms;   // по возрастанию номера
+        int orphanNights = 0; // коротких свободных промежутков, оставленных рядом с блоком
+        int numberGaps = 0;   // пропущенных номеров внутри блока
+        QString error;
+
+        bool isValid() const { return error.isEmpty() && !rooms.isEmpty(); }
+    };
+
+    // Подбирает комнаты по снимку занятости. Из подходящих по типу и вместимости комнат,
+    // свободных на все ночи, выбирается окно из N соседних по номеру, у которого меньше всего
+    // штраф: короткие свободные промежутки до и после блока, которые потом не продать,
+    // и разрывы в нумерации. Один проход по кандидатам с префиксными суммами.
+    static Allocation allocate(const Request &request, const RoomIndex &rooms, const OccupancyStore &occupancy);
+
+    // Записывает все комнато-ночи одной транзакцией и публикует их в кэше.
+    // Занятость проверяется заново под блокировкой писателей кэша, там же идет транзакция:
+    // если за время подбора какую-то ночь заняли, ничего не записывается.
+    static bool commit(const QSqlDatabase &db, SharedOccupancy &occupancy, const Request &request,
+                       const Allocation &allocation, QString *error = nullptr);
+};
+
+#endif // GROUPBOOKING_H
@@ -1,4 +1,5 @@
 #include "hotelmanager.h"
+#include "appsettings.h"
 #include "ui_hotelmanager.h"
 
 #include <QDateEdit>
@@ -26,18 +27,111 @@
 #include <QRegularExpression>
 #include <QRegularExpressionValidator>
 #include <QComboBox>
+#include <QCheckBox>
+#include <QSpinBox>
+#include <QDoubleSpinBox>
+#include <QSignalBlocker>
+#include <QFormLayout>
+#include <QActionGroup>
+#include <QApplication>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QPointer>
+#include <QProgressDialog>
+#include <QProgressBar>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QCoreApplication>
+#include <QTimer>
+#include <QUndoStack>
+#include <QDockWidget>
+#include <QScrollArea>
+#include <QEventLoop>
+#include <limits>
+#include <utility>
+
+#include "apiserver.h"
+#include "availabilitycache.h"
+#include "bookingarchiver.h"
+#include "bookingexporter.h"
+#include "bookingwritequeue.h"
+#include "bulkimporter.h"
+#include "connectionpool.h"
+#include "dbmigration.h"
+#include "groupbooking.h"
+#include "propertymanager.h"
+#include "reportgenerator.h"
+#include "schema.h"
+#include "sqlitefastpath.h"
+#include "validation.h"
+#include "yearoverview.h"
 
 HotelManager::HotelManager(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::HotelManager)
+    , refreshScheduler(new RefreshScheduler([this](const RefreshScheduler::Region &region) {
+          performRefresh(region);
+      }, this))
+    , properties(new PropertyManager(this))
+    , archiver(nullptr)
+    , apiServer(nullptr)
+    , writeQueue(nullptr)
+    , traceAction(nullptr)
+    , undoStack(new QUndoStack(this))
+    , editFlushTimer(new QTimer(this))
+    , archivedFrom(0)
+    , archivedTo(-1)
+    , overviewDock(nullptr)
+    , yearOverview(nullptr)
+    , availabilityCache(occupancyCache)
+    , forecast(occupancyCache)
+    , forecastWatcher(new QFutureWatcher<OccupancyForecast::Curves>(this))
+    , reportGenerator(new ReportGenerator(this))
+    , roomsVersion(0)
+    , ratesVersion(0)
 {
     ui->setupUi(this);
 
+    // Правки сетки копятся и пишутся в БД одной транзакцией после паузы
+    editFlushTimer->setSingleShot(true);
+    editFlushTimer->setInterval(1000);
+    connect(editFlushTimer, &QTimer::timeout, this, &HotelManager::flushBookingEdits);
+
+    // Кривые догрузки готовы - показываем прогноз в заголовках сетки
+    connect(forecastWatcher, &QFutureWatcherBase::finished, this, [this]() {
+        if (forecastWatcher->property("database").toString() != db.databaseName()) return;
+        OccupancyForecast::Curves curves = forecastWatcher->result();
+        forecast.setCurves(curves);
+        refreshScheduler->request(RefreshScheduler::Headers);
+
+        // Пока кривые строились, наступил новый день - догоняем его
+        if (!curves.isEmpty() && curves.toDay < forecast.today()) {
+            advanceForecastCurves();
+        }
+    });
+
+    // Обзор года: картинка в прокручиваемой панели внизу окна
+    yearOverview = new YearOverview(occupancyCache);
+    yearOverview->setHistory(&archivedHistory);
+    QScrollArea *overviewScroll = new QScrollArea();
+    overviewScroll->setWidget(yearOverview);
+    overviewDock = new QDockWidget("Обзор года", this);
+    overviewDock->setObjectName("overviewDock");
+    overviewDock->setWidget(overviewScroll);
+    addDockWidget(Qt::BottomDockWidgetArea, overviewDock);
+    overviewDock->hide();
+    connect(yearOverview, &YearOverview::cellActivated, this, &HotelManager::showOverviewCell);
+    connect(yearOverview, &YearOverview::rendered, this, [this](int year, qint64 micros) {
+        overviewDock->setWindowTitle(QString("Обзор %1 года (отрисовка %2 мс)").arg(year).arg(micros / 1000.0, 0, 'f', 1));
+    });
+
     // Инициализируем меню
     initMenuBar();
 
     // Устанавливаем текущую дату по умолчанию
     startDate = QDate::currentDate();
+    yearOverview->setWindow(startDate, 30);
 
     // Настройка виджета даты
     ui->dateEdit->setDate(startDate);
@@ -50,14 +144,31 @@ HotelManager::HotelManager(QWidget *parent)
     // Инициализация базы данных
     initDatabase();
 
-    // Загружаем комнаты из БД
-    loadRoomsFromDB();
+    // Плановый перенос старых бронирований в архив - у каждого отеля свой
+    for (int i = 0; i < properties->count(); i++) {
+        watchArchiver(i);
+    }
 
-    // Загружаем данные о бронированиях из базы данных
-    loadOccupancyFromDB();
+    // Фильтр и сортировка номеров
+    initRoomFilter();
 
-    // Обновляем заголовки и отображение
-    updateTableHeaders();
+    // Загружаем комнаты и бронирования всех отелей параллельно
+    properties->loadAll();
+
+    // Показываем активный отель (заголовки и отображение обновляются там же)
+    activateProperty();
+    rebuildPropertyMenu();
+
+    // Отложенная запись и API - если были включены в прошлый раз
+    if (BookingWriteQueue::isEnabled()) {
+        writeBehindAction->setChecked(true);
+    }
+    if (OperationTrace::isEnabled()) {
+        traceAction->setChecked(true);
+    }
+    if (AppSettings().value("api/enabled", false).toBool()) {
+        apiAction->setChecked(true);
+    }
 
     // Подключаем сигналы
     connect(ui->dateEdit, &QDateEdit::dateChanged, this, &HotelManager::onDateChanged);
@@ -67,6 +178,7 @@ HotelManager::HotelManager(QWidget *parent)
     ui->tableWidget->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(ui->tableWidget, &QTableWidget::customContextMenuRequested,
             this, [this](const QPoint &pos) {
+        refreshScheduler->flush();
         QMenu menu(this);
         QAction *addAction = menu.addAction("Забронировать номер");
         QAction *removeAction = menu.addAction("Снять бронь");
@@ -87,11 +199,10 @@ HotelManager::HotelManager(QWidget *parent)
             QModelIndexList selected = ui->tableWidget->selectionModel()->selectedIndexes();
             if (!selected.isEmpty()) {
                 int row = selected.first().row();
-                QString roomText = ui->tableWidget->item(row, 0)->text();
-                int roomNumber = roomText.mid(9).toInt(); // "Комната 101" -> 101
+                int roomNumber = roomNumberAtRow(row);
 
                 // Получаем информацию о номере из БД
-                QSqlQuery query;
+                TracedQuery query(db);
                 query.prepare("SELECT room_type, capacity, price_per_night, description FROM rooms WHERE room_number = ?");
                 query.addBindValue(roomNumber);
 
@@ -100,11 +211,14 @@ HotelManager::HotelManager(QWidget *parent)
                                           "Тип: %2\n"
                                           "Вместимость: %3 чел.\n"
                                           "Цена за ночь: %4 руб.\n"
-                                          "Описание: %5")
+                                          "По тарифу на %5: %6 руб.\n"
+                                          "Описание: %7")
                                   .arg(roomNumber)
                                   .arg(query.value(0).toString())
                                   .arg(query.value(1).toInt())
                                   .arg(query.value(2).toDouble())
+                                  .arg(startDate.toString("dd.MM.yyyy"))
+                                  .arg(rateTable.priceOn(roomNumber, startDate.toJulianDay()))
                                   .arg(query.value(3).toString());
 
                     QMessageBox::information(this, "Информация о номере", info);
@@ -114,8 +228,7 @@ HotelManager::HotelManager(QWidget *parent)
             QModelIndexList selected = ui->tableWidget->selectionModel()->selectedIndexes();
             if (!selected.isEmpty()) {
                 int row = selected.first().row();
-                QString roomText = ui->tableWidget->item(row, 0)->text();
-                int roomNumber = roomText.mid(9).toInt();
+                int roomNumber = roomNumberAtRow(row);
 
                 // Здесь можно добавить функционал редактирования номера
                 QMessageBox::information(this, "Редактирование",
@@ -133,12 +246,24 @@ HotelManager::HotelManager(QWidget *parent)
 
     connect(ui->btnRefresh, &QPushButton::clicked, this, [this]() {
         loadOccupancyFromDB();
-        updateTableHeaders();
+        applyRoomFilter();
     });
 }
 
 HotelManager::~HotelManager()
 {
+    // Правки, которые еще ждут таймера
+    flushBookingEdits();
+
+    // Рабочие потоки API читают кэш занятости - останавливаем их до разрушения членов окна
+    delete apiServer;
+
+    // Дописываем в БД все принятые бронирования
+    delete writeQueue;
+
+    // Обзор подписан на кэш занятости, а дочерние виджеты удаляются уже после членов окна
+    delete overviewDock;
+
     // Закрываем базу данных
     if (db.isOpen()) {
         db.close();
@@ -155,6 +280,10 @@ void HotelManager::initMenuBar()
     // Меню "Файл"
     QMenu *fileMenu = menuBar->addMenu("&Файл");
 
+    // Список отелей группы заполняется после подключения их баз
+    propertyMenu = fileMenu->addMenu("&Отель");
+    fileMenu->addSeparator();
+
     QAction *addRoomAction = new QAction("&Добавить комнату", this);
     addRoomAction->setShortcut(QKeySequence("Ctrl+N"));
     connect(addRoomAction, &QAction::triggered, this, &HotelManager::addRoom);
@@ -167,11 +296,48 @@ void HotelManager::initMenuBar()
 
     fileMenu->addSeparator();
 
+    QAction *importAction = new QAction("&Импорт из CSV...", this);
+    importAction->setShortcut(QKeySequence("Ctrl+I"));
+    connect(importAction, &QAction::triggered, this, &HotelManager::importFromCsv);
+    fileMenu->addAction(importAction);
+
+    QAction *archiveAction = new QAction("&Архивация бронирований...", this);
+    connect(archiveAction, &QAction::triggered, this, &HotelManager::configureArchive);
+    fileMenu->addAction(archiveAction);
+
+    apiAction = new QAction("API для менеджера &каналов", this);
+    apiAction->setCheckable(true);
+    connect(apiAction, &QAction::toggled, this, &HotelManager::toggleApiServer);
+    fileMenu->addAction(apiAction);
+
+    writeBehindAction = new QAction("&Отложенная запись бронирований", this);
+    writeBehindAction->setCheckable(true);
+    connect(writeBehindAction, &QAction::toggled, this, &HotelManager::toggleWriteBehind);
+    fileMenu->addAction(writeBehindAction);
+
+    traceAction = new QAction("&Запись трассы операций", this);
+    traceAction->setCheckable(true);
+    connect(traceAction, &QAction::toggled, this, &HotelManager::toggleTrace);
+    fileMenu->addAction(traceAction);
+
+    fileMenu->addSeparator();
+
     QAction *exitAction = new QAction("&Выход", this);
     exitAction->setShortcut(QKeySequence::Quit);
     connect(exitAction, &QAction::triggered, this, &QWidget::close);
     fileMenu->addAction(exitAction);
 
+    // Меню "Правка"
+    QMenu *editMenu = menuBar->addMenu("&Правка");
+
+    QAction *undoAction = undoStack->createUndoAction(this, "&Отменить");
+    undoAction->setShortcut(QKeySequence::Undo);
+    editMenu->addAction(undoAction);
+
+    QAction *redoAction = undoStack->createRedoAction(this, "&Повторить");
+    redoAction->setShortcut(QKeySequence::Redo);
+    editMenu->addAction(redoAction);
+
     // Меню "Клиенты"
     QMenu *clientsMenu = menuBar->addMenu("&Клиенты");
 
@@ -193,6 +359,19 @@ void HotelManager::initMenuBar()
     connect(newBookingAction, &QAction::triggered, this, &HotelManager::addBooking);
     bookingMenu->addAction(newBookingAction);
 
+    QAction *groupBookingAction = new QAction("&Групповое бронирование...", this);
+    groupBookingAction->setShortcut(QKeySequence("Ctrl+G"));
+    connect(groupBookingAction, &QAction::triggered, this, &HotelManager::addGroupBooking);
+    bookingMenu->addAction(groupBookingAction);
+
+    QAction *quoteAction = new QAction("&Расчет стоимости...", this);
+    connect(quoteAction, &QAction::triggered, this, &HotelManager::quoteStay);
+    bookingMenu->addAction(quoteAction);
+
+    QAction *ratesAction = new QAction("&Тарифы...", this);
+    connect(ratesAction, &QAction::triggered, this, &HotelManager::manageRates);
+    bookingMenu->addAction(ratesAction);
+
     QAction *viewBookingsAction = new QAction("&Все бронирования", this);
     viewBookingsAction->setShortcut(QKeySequence("Ctrl+Shift+B"));
     connect(viewBookingsAction, &QAction::triggered, this, []() {
@@ -220,27 +399,37 @@ void HotelManager::initMenuBar()
     connect(viewReportsAction, &QAction::triggered, this, &HotelManager::viewReports);
     reportsMenu->addAction(viewReportsAction);
 
+    QAction *groupReportAction = new QAction("Сводка по &группе отелей", this);
+    connect(groupReportAction, &QAction::triggered, this, &HotelManager::viewGroupReport);
+    reportsMenu->addAction(groupReportAction);
+
     QAction *statisticsAction = new QAction("&Статистика", this);
     connect(statisticsAction, &QAction::triggered, this, []() {
         QMessageBox::information(nullptr, "Статистика", "Статистика загруженности отеля");
     });
     reportsMenu->addAction(statisticsAction);
 
-    QAction *calendarAction = new QAction("&Календарь", this);
+    QAction *calendarAction = overviewDock->toggleViewAction();
+    calendarAction->setText("Обзор &года");
     calendarAction->setShortcut(QKeySequence("Ctrl+K"));
-    connect(calendarAction, &QAction::triggered, this, []() {
-        QMessageBox::information(nullptr, "Календарь", "Просмотр в календарном виде");
-    });
     reportsMenu->addAction(calendarAction);
+
+    QAction *exportAction = new QAction("&Экспорт бронирований...", this);
+    exportAction->setShortcut(QKeySequence("Ctrl+E"));
+    connect(exportAction, &QAction::triggered, this, &HotelManager::exportBookings);
+    reportsMenu->addAction(exportAction);
+
+    reportsMenu->addSeparator();
+
+    QAction *sqlProfileAction = new QAction("&Профиль SQL", this);
+    connect(sqlProfileAction, &QAction::triggered, this, &HotelManager::showSqlProfile);
+    reportsMenu->addAction(sqlProfileAction);
 }
 
 bool HotelManager::isValidRoomName(const QString &name)
 {
-    // Регулярное выражение: кириллица, латиница, цифры, пробелы и разрешенные символы
-    // Добавлены точка и запятая для более гибкого описания
-    QRegularExpression regex("^[а-яА-ЯёЁa-zA-Z0-9\\s\\(\\)\\/\\-\\.\\,]+$");
-    QRegularExpressionMatch match = regex.match(name);
-    return match.hasMatch() && !name.trimmed().isEmpty();
+    // Кириллица, латиница, цифры, пробелы и ( ) / - . , - те же правила, что и при импорте
+    return Validation::isValidRoomName(name);
 }
 
 QString HotelManager::getRoomNameFromUser(const QString &title, const QString &label, const QString &defaultValue)
@@ -293,350 +482,1429 @@ QString HotelManager::getRoomNameFromUser(const QString &title, const QString &l
 
 void HotelManager::initDatabase()
 {
-    // Инициализация базы данных SQLite
-    db = QSqlDatabase::addDatabase("QSQLITE");
-    db.setDatabaseName("hotel_bookings.db");
-
-    if (!db.open()) {
-        QMessageBox::critical(this, "Ошибка", "Не удалось открыть базу данных: " + db.lastError().text());
-        return;
-    }
-
-    // Создаем таблицу бронирований, если она не существует
-    QSqlQuery query;
-    QString createBookingsTable =
-        "CREATE TABLE IF NOT EXISTS bookings ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-        "room_number INTEGER NOT NULL, "
-        "booking_date DATE NOT NULL, "
-        "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
-        "UNIQUE(room_number, booking_date)"
-        ")";
-
-    if (!query.exec(createBookingsTable)) {
-        QMessageBox::critical(this, "Ошибка", "Не удалось создать таблицу бронирований: " + query.lastError().text());
-    }
-
-    // Создаем таблицу комнат, если она не существует
-    QString createRoomsTable =
-        "CREATE TABLE IF NOT EXISTS rooms ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-        "room_number INTEGER UNIQUE NOT NULL, "
-        "room_type TEXT DEFAULT 'Стандарт', "
-        "capacity INTEGER DEFAULT 2, "
-        "price_per_night REAL DEFAULT 3000.0, "
-        "description TEXT, "
-        "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
-        ")";
-
-    if (!query.exec(createRoomsTable)) {
-        QMessageBox::critical(this, "Ошибка", "Не удалось создать таблицу комнат: " + query.lastError().text());
-    }
-
-    // Создаем таблицу клиентов, если она не существует
-    QString createClientsTable =
-        "CREATE TABLE IF NOT EXISTS clients ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-        "full_name TEXT NOT NULL, "
-        "phone TEXT, "
-        "email TEXT, "
-        "passport TEXT, "
-        "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
-        ")";
+    // Каждый отель группы - свой файл SQLite со своим именованным соединением
+    properties->loadSettings();
+
+    for (int i = 0; i < properties->count(); i++) {
+        QString error;
+        if (!properties->openDatabase(i, &error)) {
+            QMessageBox::critical(this, "Ошибка",
+                QString("Не удалось открыть базу данных отеля \"%1\": %2")
+                    .arg(properties->property(i).name)
+                    .arg(error));
+            continue;
+        }
+        initSchema(properties->database(i));
 
-    if (!query.exec(createClientsTable)) {
-        QMessageBox::critical(this, "Ошибка", "Не удалось создать таблицу клиентов: " + query.lastError().text());
+        // Бронирования, принятые до сбоя, но не успевшие попасть в БД
+        QVector<BookingWriteQueue::Conflict> conflicts;
+        QString replayError;
+        if (!BookingWriteQueue::replayJournal(properties->database(i), &conflicts, &replayError)) {
+            QMessageBox::warning(this, "Ошибка",
+                QString("Не удалось применить журнал отложенной записи отеля \"%1\": %2")
+                    .arg(properties->property(i).name)
+                    .arg(replayError));
+        } else if (!conflicts.isEmpty()) {
+            reportWriteConflicts(conflicts);
+        }
     }
 
-    // Создаем таблицу услуг, если она не существует
-    QString createServicesTable =
-        "CREATE TABLE IF NOT EXISTS services ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-        "service_name TEXT NOT NULL, "
-        "price REAL DEFAULT 0.0, "
-        "description TEXT"
-        ")";
-
-    if (!query.exec(createServicesTable)) {
-        QMessageBox::critical(this, "Ошибка", "Не удалось создать таблицу услуг: " + query.lastError().text());
-    }
+    db = properties->database(properties->activeIndex());
 
     statusBar()->showMessage("База данных подключена", 3000);
 }
 
-void HotelManager::loadRoomsFromDB()
+void HotelManager::rebuildPropertyMenu()
 {
-    QSqlQuery query("SELECT room_number, room_type FROM rooms ORDER BY room_number");
-
-    int row = 0;
-    ui->tableWidget->setRowCount(0);
-
-    while (query.next()) {
-        int roomNumber = query.value(0).toInt();
-        QString roomType = query.value(1).toString();
-
-        ui->tableWidget->insertRow(row);
-        ui->tableWidget->setItem(row, 0, new QTableWidgetItem(
-            QString("Комната %1 (%2)").arg(roomNumber).arg(roomType)));
-        row++;
+    qDeleteAll(propertyMenu->findChildren<QActionGroup *>());
+    propertyMenu->clear();
+
+    QActionGroup *group = new QActionGroup(propertyMenu);
+    for (int i = 0; i < properties->count(); i++) {
+        QAction *action = propertyMenu->addAction(properties->property(i).name);
+        action->setCheckable(true);
+        action->setChecked(i == properties->activeIndex());
+        group->addAction(action);
+        connect(action, &QAction::triggered, this, [this, i]() {
+            switchProperty(i);
+        });
     }
-}
 
-void HotelManager::loadOccupancyFromDB()
-{
-    occupancyCache.clear();
-
-    QSqlQuery query;
-    query.prepare("SELECT room_number, booking_date FROM bookings");
-
-    if (query.exec()) {
-        while (query.next()) {
-            int roomNumber = query.value(0).toInt();
-            QDate date = query.value(1).toDate();
+    propertyMenu->addSeparator();
 
-            // Сохраняем в кэш
-            occupancyCache[qMakePair(roomNumber, date)] = true;
-        }
-    } else {
-        qDebug() << "Ошибка загрузки данных: " << query.lastError().text();
-    }
+    QAction *addPropertyAction = propertyMenu->addAction("Добавить отель...");
+    connect(addPropertyAction, &QAction::triggered, this, &HotelManager::addProperty);
 }
 
-void HotelManager::saveOccupancyToDB(int roomNumber, const QDate &date, bool occupied)
+void HotelManager::watchArchiver(int index)
 {
-    if (occupied) {
-        // Добавляем бронирование
-        QSqlQuery query;
-        query.prepare("INSERT OR REPLACE INTO bookings (room_number, booking_date) VALUES (?, ?)");
-        query.addBindValue(roomNumber);
-        query.addBindValue(date.toString("yyyy-MM-dd"));
+    BookingArchiver *propertyArchiver = properties->property(index).archiver;
+    if (!propertyArchiver) return;
 
-        if (!query.exec()) {
-            QMessageBox::warning(this, "Ошибка",
-                "Не удалось сохранить бронирование: " + query.lastError().text());
-            return;
-        }
-
-        // Обновляем кэш
-        occupancyCache[qMakePair(roomNumber, date)] = true;
-    } else {
-        // Удаляем бронирование
-        QSqlQuery query;
-        query.prepare("DELETE FROM bookings WHERE room_number = ? AND booking_date = ?");
-        query.addBindValue(roomNumber);
-        query.addBindValue(date.toString("yyyy-MM-dd"));
+    connect(propertyArchiver, &BookingArchiver::finished, this, [this, index, propertyArchiver](qint64 rows) {
+        if (rows <= 0) return;
 
-        if (!query.exec()) {
-            QMessageBox::warning(this, "Ошибка",
-                "Не удалось удалить бронирование: " + query.lastError().text());
+        // Перенесенные даты старше горизонта - убираем их из кэша без полной перезагрузки
+        qint64 cutoff = propertyArchiver->cutoffDate().toJulianDay();
+        if (index != properties->activeIndex()) {
+            properties->property(index).data.occupancy.removeBefore(cutoff);
             return;
         }
 
-        // Удаляем из кэша
-        occupancyCache.remove(qMakePair(roomNumber, date));
-    }
-}
+        occupancyCache.update([cutoff](OccupancyStore &store) {
+            store.removeBefore(cutoff);
+            return true;
+        });
+        archivedTo = archivedFrom - 1;
+        loadArchivedHistory();
+        loadArchivedOccupancy();
+        refreshScheduler->request(RefreshScheduler::AllCells);
 
-bool HotelManager::isRoomOccupied(int roomNumber, const QDate &date)
-{
-    return occupancyCache.contains(qMakePair(roomNumber, date));
+        statusBar()->showMessage(QString("Перенесено в архив бронирований: %1").arg(rows), 5000);
+    });
+    propertyArchiver->start();
 }
 
-void HotelManager::onDateChanged()
+void HotelManager::activateProperty()
 {
-    startDate = ui->dateEdit->date();
-    updateTableHeaders();
+    int index = properties->activeIndex();
+    PropertyManager::Property &property = properties->property(index);
+
+    db = properties->database(index);
+    archiver = property.archiver;
+
+    // Данные отеля уже в памяти: забираем их у менеджера без обращения к БД.
+    // Файл для API меняется вместе с кэшем, чтобы запись через API не попала в другой отель
+    occupancyCache.update([this, &property](OccupancyStore &store) {
+        store = std::move(property.data.occupancy);
+        if (apiServer) apiServer->setDatabaseFile(property.databaseFile);
+        return true;
+    });
+    // Архивных ночей в новом кэше нет
+    archivedTo = archivedFrom - 1;
+    reloadRates();
+    setRooms(property.data.rooms);
+    loadArchivedHistory();
+    loadArchivedOccupancy();
+    buildForecast();
+    refreshScheduler->request(RefreshScheduler::AllCells);
+
+    setWindowTitle(QString("Hotel Manager - %1").arg(property.name));
 }
 
-void HotelManager::onTableClicked(const QModelIndex &index)
+void HotelManager::switchProperty(int index)
 {
-    // Если кликнули не на ячейку с датой, игнорируем
-    if (index.column() == 0) return;
-
-    int row = index.row();
-    int col = index.column();
-
-    // Получаем номер комнаты
-    QString roomText = ui->tableWidget->item(row, 0)->text();
-    // Извлекаем номер из строки типа "Комната 101 (Стандарт)"
-    int roomNumber = 0;
-    QRegularExpression re("Комната\\s+(\\d+)");
-    QRegularExpressionMatch match = re.match(roomText);
-    if (match.hasMatch()) {
-        roomNumber = match.captured(1).toInt();
+    if (index == properties->activeIndex() || index < 0 || index >= properties->count()) return;
+
+    // Очередь отложенной записи привязана к файлу отеля: дописываем ее и открываем новую
+    bool writeBehind = writeQueue != nullptr;
+    flushBookingEdits();
+    stopWriteQueue();
+
+    // Команды ссылаются на комнаты и бронирования текущего отеля
+    undoStack->clear();
+
+    // Состояние текущего отеля возвращаем менеджеру, остальные отели не перечитываются
+    PropertyManager::Property &current = properties->property(properties->activeIndex());
+    current.data.rooms = roomIndex.rooms();
+    current.data.occupancy = *occupancyCache.snapshot();
+    // Подгруженные для окна архивные ночи в данных отеля не храним - при возврате окно подгрузится заново
+    dropArchivedNights(current.data.occupancy, 0, -1);
+
+    properties->setActiveIndex(index);
+    activateProperty();
+    if (writeBehind) {
+        startWriteQueue();
     }
-
-    // Получаем дату для этой колонки
-    QDate cellDate = startDate.addDays(col - 1);
-
-    // Создаем меню действий
-    QMenu menu(this);
-
-    if (isRoomOccupied(roomNumber, cellDate)) {
-        menu.addAction("Снять бронь", this, &HotelManager::removeBooking);
-    } else {
-        menu.addAction("Забронировать", this, &HotelManager::addBooking);
+    // Трасса воспроизводится на копии одной базы - у каждого отеля свой файл
+    if (trace.isRecording()) {
+        startTrace();
     }
 
-    menu.exec(QCursor::pos());
+    statusBar()->showMessage("Активный отель: " + properties->property(index).name, 3000);
 }
 
-void HotelManager::addRoom()
+void HotelManager::addProperty()
 {
     bool ok;
+    QString name = QInputDialog::getText(this, "Добавить отель", "Название отеля:",
+                                         QLineEdit::Normal, "", &ok).trimmed();
+    if (!ok || name.isEmpty()) return;
 
-    // Получаем номер комнаты
-    int roomNumber = QInputDialog::getInt(this, "Добавить комнату",
-                                         "Введите номер комнаты:",
-                                         101, 1, 999, 1, &ok);
-
-    if (!ok) return;
+    // Можно выбрать существующий файл - тогда отель подключится со своими данными
+    QString fileName = QFileDialog::getSaveFileName(this, "Файл базы данных отеля", name + ".db",
+                                                    "SQLite (*.db);;Все файлы (*)", nullptr,
+                                                    QFileDialog::DontConfirmOverwrite);
+    if (fileName.isEmpty()) return;
 
-    // Проверяем, существует ли уже комната с таким номером
-    QSqlQuery checkQuery;
-    checkQuery.prepare("SELECT COUNT(*) FROM rooms WHERE room_number = ?");
-    checkQuery.addBindValue(roomNumber);
+    int index = properties->addProperty(name, fileName);
 
-    if (checkQuery.exec() && checkQuery.next() && checkQuery.value(0).toInt() > 0) {
-        QMessageBox::warning(this, "Ошибка",
-            QString("Комната с номером %1 уже существует!").arg(roomNumber));
+    QString error;
+    if (!properties->openDatabase(index, &error)) {
+        QMessageBox::critical(this, "Ошибка", "Не удалось открыть базу данных отеля: " + error);
         return;
     }
+    initSchema(properties->database(index));
+    properties->property(index).data = PropertyManager::loadSnapshot(fileName);
+    watchArchiver(index);
 
-    // Получаем тип комнаты
-    QStringList roomTypes = QStringList() << "Стандарт" << "Люкс" << "Семейный" << "Бизнес" << "Апартаменты";
-    QString roomType = QInputDialog::getItem(this, "Тип комнаты",
-                                            "Выберите тип комнаты:",
-                                            roomTypes, 0, false, &ok);
-    if (!ok) return;
+    switchProperty(index);
+    rebuildPropertyMenu();
+}
 
-    // Получаем вместимость
-    int capacity = QInputDialog::getInt(this, "Вместимость",
-                                       "Введите вместимость (человек):",
-                                       2, 1, 10, 1, &ok);
-    if (!ok) return;
+void HotelManager::viewGroupReport()
+{
+    QDialog *dialog = new QDialog(this);
+    dialog->setWindowTitle("Сводка по группе отелей");
+    dialog->resize(700, 400);
 
-    // Получаем цену
-    double price = QInputDialog::getDouble(this, "Цена",
-                                          "Введите цену за ночь:",
-                                          3000.0, 500.0, 50000.0, 2, &ok);
-    if (!ok) return;
+    QVBoxLayout *layout = new QVBoxLayout(dialog);
 
-    // Создаем кастомный диалог для ввода описания
-    QDialog dialog(this);
-    dialog.setWindowTitle("Описание комнаты");
+    QHBoxLayout *periodLayout = new QHBoxLayout();
+    QDate today = QDate::currentDate();
+    QDateEdit *fromEdit = new QDateEdit(QDate(today.year(), today.month(), 1), dialog);
+    QDateEdit *toEdit = new QDateEdit(QDate(today.year(), today.month(), today.daysInMonth()), dialog);
+    fromEdit->setCalendarPopup(true);
+    toEdit->setCalendarPopup(true);
+    QPushButton *buildButton = new QPushButton("Построить", dialog);
+    periodLayout->addWidget(new QLabel("С:", dialog));
+    periodLayout->addWidget(fromEdit);
+    periodLayout->addWidget(new QLabel("по:", dialog));
+    periodLayout->addWidget(toEdit);
+    periodLayout->addWidget(buildButton);
+    periodLayout->addStretch();
+    layout->addLayout(periodLayout);
 
-    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    QTextEdit *reportText = new QTextEdit(dialog);
+    reportText->setReadOnly(true);
+    layout->addWidget(reportText);
 
-    QLabel *label = new QLabel("Введите описание комнаты (можно использовать кириллицу, латиницу, цифры, (), /, -, пробелы):", &dialog);
-    layout->addWidget(label);
+    // Отели считаются в пуле потоков, диалог не блокирует интерфейс
+    QFutureWatcher<PropertyReport> *watcher = new QFutureWatcher<PropertyReport>(dialog);
+    connect(watcher, &QFutureWatcherBase::finished, dialog, [watcher, reportText, buildButton]() {
+        buildButton->setEnabled(true);
+
+        QDate from = watcher->property("from").toDate();
+        QDate to = watcher->property("to").toDate();
+        QList<PropertyReport> reports = watcher->future().results();
+
+        QString report;
+        report += "<h2>Сводка по группе отелей</h2>";
+        report += "<h3>" + from.toString("dd.MM.yyyy") + " - " + to.toString("dd.MM.yyyy") + "</h3>";
+        report += "<table border=\"1\" cellspacing=\"0\" cellpadding=\"3\">"
+                  "<tr><th>Отель</th><th>Комнат</th><th>Занято ночей</th>"
+                  "<th>Загрузка</th><th>Выручка, руб.</th></tr>";
+
+        PropertyReport total;
+        for (const PropertyReport &row : reports) {
+            double rate = row.roomNights > 0 ? row.bookedNights * 100.0 / row.roomNights : 0.0;
+            report += QString("<tr><td>%1</td><td>%2</td><td>%3</td><td>%4%</td><td>%5</td></tr>")
+                          .arg(row.name.toHtmlEscaped() +
+                               (row.error.isEmpty() ? QString() : " (ошибка: " + row.error.toHtmlEscaped() + ")"))
+                          .arg(row.rooms)
+                          .arg(row.bookedNights)
+                          .arg(rate, 0, 'f', 1)
+                          .arg(row.revenue, 0, 'f', 2);
+
+            total.rooms += row.rooms;
+            total.roomNights += row.roomNights;
+            total.bookedNights += row.bookedNights;
+            total.revenue += row.revenue;
+        }
 
-    QLineEdit *lineEdit = new QLineEdit(&dialog);
+        double totalRate = total.roomNights > 0 ? total.bookedNights * 100.0 / total.roomNights : 0.0;
+        report += QString("<tr><td><b>Итого</b></td><td><b>%1</b></td><td><b>%2</b></td>"
+                          "<td><b>%3%</b></td><td><b>%4</b></td></tr>")
+                      .arg(total.rooms)
+                      .arg(total.bookedNights)
+                      .arg(totalRate, 0, 'f', 1)
+                      .arg(total.revenue, 0, 'f', 2);
+        report += "</table>";
 
-    // Устанавливаем валидатор с правильным регулярным выражением
-    QRegularExpressionValidator *validator = new QRegularExpressionValidator(
-        QRegularExpression("^[а-яА-ЯёЁa-zA-Z0-9\\s\\(\\)\\/\\-\\.\\,]+$"), &dialog);
-    lineEdit->setValidator(validator);
+        reportText->setHtml(report);
+    });
 
-    // Разрешаем длинный текст
-    lineEdit->setMaxLength(500);
+    auto build = [this, fromEdit, toEdit, reportText, buildButton, watcher]() {
+        QDate from = fromEdit->date();
+        QDate to = toEdit->date();
+        if (from > to) {
+            reportText->setHtml("<p>Начало периода позже его окончания</p>");
+            return;
+        }
+        if (watcher->isRunning()) {
+            return;
+        }
 
-    layout->addWidget(lineEdit);
+        // Каждый отель считается в своем потоке пула со своим соединением
+        flushPendingWrites();
+        buildButton->setEnabled(false);
+        reportText->setHtml("<p>Сводка строится...</p>");
+        watcher->setProperty("from", from);
+        watcher->setProperty("to", to);
+        watcher->setFuture(properties->groupReport(from, to));
+    };
 
-    QHBoxLayout *buttonLayout = new QHBoxLayout();
-    QPushButton *okButton = new QPushButton("OK", &dialog);
-    QPushButton *cancelButton = new QPushButton("Отмена", &dialog);
+    connect(buildButton, &QPushButton::clicked, dialog, build);
+    build();
 
-    buttonLayout->addWidget(okButton);
-    buttonLayout->addWidget(cancelButton);
-    layout->addLayout(buttonLayout);
+    QPushButton *closeButton = new QPushButton("Закрыть", dialog);
+    connect(closeButton, &QPushButton::clicked, dialog, &QDialog::close);
 
-    QString description;
+    layout->addWidget(closeButton);
+    dialog->setLayout(layout);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->open();
+}
 
-    connect(okButton, &QPushButton::clicked, &dialog, [&dialog, lineEdit, &description]() {
-        QString text = lineEdit->text().trimmed();
-        if (!text.isEmpty()) {
-            description = text;
-            dialog.accept();
+void HotelManager::toggleApiServer(bool enabled)
+{
+    AppSettings().setValue("api/enabled", enabled);
+
+    if (!enabled) {
+        delete apiServer;
+        apiServer = nullptr;
+        statusBar()->showMessage("API остановлен", 3000);
+        return;
+    }
+    if (apiServer) return;
+
+    // Дальше правки сетки пишутся сразу - отложенные дописываем до запуска
+    flushBookingEdits();
+    apiServer = new ApiServer(occupancyCache, availabilityCache, this);
+    apiServer->setRooms(roomIndex.rooms());
+    apiServer->setDatabaseFile(db.databaseName());
+    apiServer->setWriteQueue(writeQueue);
+
+    // Бронирования из API приходят из рабочих потоков - перерисовываем в потоке окна
+    connect(apiServer, &ApiServer::bookingsChanged, this, [this](int roomNumber, qint64 fromDay, qint64 toDay) {
+        if (ui->checkFilterFree->isChecked()) {
+            refreshScheduler->request(RefreshScheduler::Layout);
         } else {
-            QMessageBox::warning(&dialog, "Ошибка", "Описание комнаты не может быть пустым!");
+            refreshScheduler->requestCells(roomNumber, fromDay, toDay);
+            refreshScheduler->request(RefreshScheduler::Headers);
         }
     });
 
-    connect(cancelButton, &QPushButton::clicked, &dialog, &QDialog::reject);
-
-    if (dialog.exec() != QDialog::Accepted) {
-        return; // Пользователь отменил
+    if (!apiServer->start()) {
+        QMessageBox::warning(this, "Ошибка", "Не удалось запустить API: " + apiServer->errorString());
+        QSignalBlocker blocker(apiAction);
+        apiAction->setChecked(false);
+        delete apiServer;
+        apiServer = nullptr;
+        return;
     }
 
-    // Добавляем комнату в базу данных
-    QSqlQuery query;
-    query.prepare("INSERT INTO rooms (room_number, room_type, capacity, price_per_night, description) "
-                 "VALUES (?, ?, ?, ?, ?)");
-    query.addBindValue(roomNumber);
-    query.addBindValue(roomType);
-    query.addBindValue(capacity);
-    query.addBindValue(price);
-    query.addBindValue(description);
+    statusBar()->showMessage(QString("API доступен на http://127.0.0.1:%1").arg(apiServer->serverPort()), 5000);
+}
 
-    if (query.exec()) {
-        // Обновляем таблицу
-        loadRoomsFromDB();
-        updateTableHeaders();
+void HotelManager::toggleWriteBehind(bool enabled)
+{
+    BookingWriteQueue::setEnabled(enabled);
 
-        QMessageBox::information(this, "Успех",
-            QString("Комната %1 (%2) успешно добавлена!\nОписание: %3")
-                .arg(roomNumber)
-                .arg(roomType)
-                .arg(description));
-        statusBar()->showMessage(QString("Добавлена комната %1").arg(roomNumber), 3000);
+    if (enabled) {
+        startWriteQueue();
     } else {
-        QMessageBox::critical(this, "Ошибка",
-            "Не удалось добавить комнату: " + query.lastError().text());
+        stopWriteQueue();
+        statusBar()->showMessage("Бронирования записываются сразу в БД", 3000);
     }
 }
-void HotelManager::deleteRoom()
+
+void HotelManager::toggleTrace(bool enabled)
 {
-    // Получаем список всех комнат для выбора
-    QSqlQuery query("SELECT room_number, room_type FROM rooms ORDER BY room_number");
+    OperationTrace::setEnabled(enabled);
 
-    QStringList rooms;
-    QMap<QString, int> roomMap; // Для сопоставления строки с номером комнаты
+    if (enabled) {
+        startTrace();
+    } else {
+        trace.stop();
+        statusBar()->showMessage("Запись трассы остановлена", 3000);
+    }
+}
 
-    while (query.next()) {
-        int roomNumber = query.value(0).toInt();
-        QString roomType = query.value(1).toString();
-        QString roomString = QString("%1 (%2)").arg(roomNumber).arg(roomType);
-        rooms.append(roomString);
-        roomMap[roomString] = roomNumber;
+void HotelManager::startTrace()
+{
+    QString error;
+    if (!trace.start(OperationTrace::traceFileFor(db.databaseName()), &error)) {
+        QMessageBox::warning(this, "Ошибка", "Не удалось начать запись трассы: " + error);
+        QSignalBlocker blocker(traceAction);
+        traceAction->setChecked(false);
+        return;
     }
+    statusBar()->showMessage("Трасса операций пишется в " + trace.fileName(), 5000);
+}
 
-    if (rooms.isEmpty()) {
-        QMessageBox::information(this, "Удаление комнаты", "Нет комнат для удаления");
+void HotelManager::startWriteQueue()
+{
+    // Журнал, который не удалось дописать при остановке прошлой очереди (например, при смене
+    // отеля), применяем сейчас - иначе очередь не запустится до перезапуска приложения
+    QVector<BookingWriteQueue::Conflict> conflicts;
+    QString error;
+    if (!BookingWriteQueue::replayJournal(db, &conflicts, &error)) {
+        QMessageBox::warning(this, "Ошибка", "Не удалось применить журнал отложенной записи: " + error);
+        QSignalBlocker blocker(writeBehindAction);
+        writeBehindAction->setChecked(false);
         return;
     }
 
-    bool ok;
-    QString selectedRoom = QInputDialog::getItem(this, "Удалить комнату",
-                                                "Выберите комнату для удаления:",
-                                                rooms, 0, false, &ok);
+    BookingWriteQueue *queue = new BookingWriteQueue(db.databaseName(), this);
+    if (!queue->start(&error)) {
+        delete queue;
+        QMessageBox::warning(this, "Ошибка", "Не удалось включить отложенную запись: " + error);
+        QSignalBlocker blocker(writeBehindAction);
+        writeBehindAction->setChecked(false);
+        return;
+    }
 
-    if (!ok || selectedRoom.isEmpty()) return;
+    connect(queue, &BookingWriteQueue::conflictsDetected, this, &HotelManager::reportWriteConflicts);
+    connect(queue, &BookingWriteQueue::flushFailed, this, [this](const QString &error) {
+        statusBar()->showMessage(error + " - повтор через секунду", 3000);
+    });
 
-    int roomNumber = roomMap[selectedRoom];
+    // Очередь подключается под блокировкой писателей, чтобы API не писал мимо нее
+    occupancyCache.update([this, queue](OccupancyStore &) {
+        writeQueue = queue;
+        if (apiServer) apiServer->setWriteQueue(queue);
+        return false;
+    });
 
-    // Проверяем, есть ли активные бронирования у этой комнаты
-    QSqlQuery checkBookingsQuery;
-    checkBookingsQuery.prepare("SELECT COUNT(*) FROM bookings WHERE room_number = ? AND booking_date >= ?");
-    checkBookingsQuery.addBindValue(roomNumber);
-    checkBookingsQuery.addBindValue(QDate::currentDate().toString("yyyy-MM-dd"));
+    if (!conflicts.isEmpty()) {
+        reportWriteConflicts(conflicts);
+    }
+}
 
-    if (checkBookingsQuery.exec() && checkBookingsQuery.next()) {
-        int activeBookings = checkBookingsQuery.value(0).toInt();
+void HotelManager::stopWriteQueue()
+{
+    if (!writeQueue) return;
 
-        if (activeBookings > 0) {
-            QMessageBox::StandardButton reply = QMessageBox::question(
-                this, "Подтверждение удаления",
+    BookingWriteQueue *queue = writeQueue;
+    occupancyCache.update([this](OccupancyStore &) {
+        if (apiServer) apiServer->setWriteQueue(nullptr);
+        writeQueue = nullptr;
+        return false;
+    });
+
+    // Деструктор дописывает в БД все, что осталось в очереди
+    delete queue;
+}
+
+void HotelManager::flushPendingWrites()
+{
+    // Отчеты, экспорт и удаление комнат читают БД напрямую - сначала дописываем правки и очередь
+    flushBookingEdits();
+    if (writeQueue && !writeQueue->flushNow()) {
+        statusBar()->showMessage(QString("Не все бронирования записаны в БД (в очереди %1)")
+                                     .arg(writeQueue->pendingCount()), 5000);
+    }
+}
+
+void HotelManager::reportWriteConflicts(const QVector<BookingWriteQueue::Conflict> &conflicts)
+{
+    QStringList lines;
+    for (const BookingWriteQueue::Conflict &conflict : conflicts) {
+        if (lines.size() == 20) {
+            lines << QString("... и еще %1").arg(conflicts.size() - 20);
+            break;
+        }
+        lines << QString("Комната %1, %2: %3 (%4)")
+                     .arg(conflict.operation.roomNumber)
+                     .arg(QDate::fromJulianDay(conflict.operation.day).toString("dd.MM.yyyy"))
+                     .arg(conflict.operation.occupied ? "бронирование" : "снятие брони")
+                     .arg(conflict.reason);
+    }
+
+    QMessageBox::warning(this, "Конфликты при записи бронирований",
+        "Эти изменения не записаны, потому что БД уже была изменена:\n\n" + lines.join("\n"));
+
+    // Приводим кэш и сетку к тому, что на самом деле в БД
+    if (db.isOpen()) {
+        loadOccupancyFromDB();
+        applyRoomFilter();
+    }
+}
+
+void HotelManager::initSchema(QSqlDatabase database)
+{
+    // Создаем таблицу бронирований, если она не существует
+    TracedQuery query(database);
+    if (!query.exec(Schema::createSql<Schema::Bookings>())) {
+        QMessageBox::critical(this, "Ошибка", "Не удалось создать таблицу бронирований: " + query.lastError().text());
+    }
+
+    // Индекс по дате для выборок за период (отчеты, экспорт)
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_bookings_date ON bookings(booking_date)")) {
+        qDebug() << "Не удалось создать индекс по дате: " << query.lastError().text();
+    }
+
+    // Создаем таблицу комнат, если она не существует
+    if (!query.exec(Schema::createSql<Schema::Rooms>())) {
+        QMessageBox::critical(this, "Ошибка", "Не удалось создать таблицу комнат: " + query.lastError().text());
+    }
+
+    // Создаем таблицу клиентов, если она не существует
+    if (!query.exec(Schema::createSql<Schema::Clients>())) {
+        QMessageBox::critical(this, "Ошибка", "Не удалось создать таблицу клиентов: " + query.lastError().text());
+    }
+
+    // Создаем таблицу услуг, если она не существует
+    if (!query.exec(Schema::createSql<Schema::Services>())) {
+        QMessageBox::critical(this, "Ошибка", "Не удалось создать таблицу услуг: " + query.lastError().text());
+    }
+
+    // Тарифы: цена за ночь для типа или конкретной комнаты на диапазон дат (включительно).
+    // Без подходящего тарифа действует rooms.price_per_night
+    QString createRatesTable =
+        "CREATE TABLE IF NOT EXISTS rates ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "room_type TEXT, "
+        "room_number INTEGER, "
+        "from_date INTEGER NOT NULL, "
+        "to_date INTEGER NOT NULL, "
+        "price REAL NOT NULL, "
+        "CHECK (room_type IS NOT NULL OR room_number IS NOT NULL)"
+        ")";
+
+    if (!query.exec(createRatesTable)) {
+        QMessageBox::critical(this, "Ошибка", "Не удалось создать таблицу тарифов: " + query.lastError().text());
+    }
+
+    // Архив прошлых бронирований - отдельный файл, подключенный к тому же соединению
+    QString archiveError;
+    if (!BookingArchiver::attachArchive(database, BookingArchiver::archiveFileFor(database.databaseName()), &archiveError)) {
+        qDebug() << "Не удалось подключить архив: " << archiveError;
+    }
+
+    // Старые базы хранили даты текстом - переводим в юлианские дни (возобновляемо)
+    QString migrationError;
+    qint64 converted = 0;
+    qint64 convertedArchived = 0;
+    if (!DatabaseMigration::migrateBookingDates(database, "main", &migrationError, &converted)) {
+        QMessageBox::critical(this, "Ошибка", "Не удалось обновить формат дат бронирований: " + migrationError);
+    }
+    if (archiveError.isEmpty() &&
+        !DatabaseMigration::migrateBookingDates(database, "archive", &migrationError, &convertedArchived)) {
+        qDebug() << "Не удалось обновить формат дат в архиве: " << migrationError;
+    }
+    if (converted + convertedArchived > 0) {
+        statusBar()->showMessage(QString("Формат дат бронирований обновлен: %1").arg(converted + convertedArchived), 5000);
+    }
+}
+
+void HotelManager::loadRoomsFromDB()
+{
+    setRooms(PropertyManager::loadRooms(db));
+}
+
+void HotelManager::setRooms(const QVector<RoomInfo> &rooms)
+{
+    roomIndex.rebuild(rooms);
+    rateTable.setRooms(rooms);
+    roomsVersion++;
+
+    QVector<int> roomNumbers;
+    roomNumbers.reserve(rooms.size());
+    for (const RoomInfo &room : rooms) {
+        roomNumbers.append(room.number);
+    }
+    forecast.setRooms(roomNumbers);
+
+    availabilityCache.clear();
+    if (apiServer) {
+        apiServer->setRooms(rooms);
+    }
+
+    // Список типов в фильтре зависит от набора комнат; выбранный тип сохраняем
+    QString currentType = ui->comboFilterType->currentData().toString();
+    {
+        QSignalBlocker blocker(ui->comboFilterType);
+        ui->comboFilterType->clear();
+        ui->comboFilterType->addItem("Все типы", QString());
+        for (const QString &type : roomIndex.types()) {
+            ui->comboFilterType->addItem(type, type);
+        }
+        int index = ui->comboFilterType->findData(currentType);
+        ui->comboFilterType->setCurrentIndex(index >= 0 ? index : 0);
+    }
+
+    refreshScheduler->request(RefreshScheduler::Layout);
+}
+
+void HotelManager::reloadRates()
+{
+    QString error;
+    QVector<RateTable::Rule> rules = RateTable::loadRules(db, &error);
+    if (!error.isEmpty()) {
+        qDebug() << "Ошибка загрузки тарифов: " << error;
+    }
+
+    // Окно цен отсчитывается от сегодняшнего дня; комнаты прежние, кроме смены отеля - их передаст setRooms
+    rateTable.compile(roomIndex.rooms(), rules,
+                      QDate::currentDate().toJulianDay() - RateTable::PastDays,
+                      RateTable::PastDays + RateTable::FutureDays);
+    ratesVersion++;
+}
+
+void HotelManager::buildForecast()
+{
+    qint64 today = QDate::currentDate().toJulianDay();
+    forecast.setCurves(OccupancyForecast::Curves());
+    forecast.setToday(today);
+
+    // История читается своими соединениями в пуле потоков; окно не ждет
+    QString databaseFile = db.databaseName();
+    forecastWatcher->setProperty("database", databaseFile);
+    forecastWatcher->setFuture(QtConcurrent::run([databaseFile, today]() {
+        return OccupancyForecast::buildCurves(databaseFile, today - OccupancyForecast::HistoryDays, today);
+    }));
+}
+
+void HotelManager::advanceForecast()
+{
+    qint64 today = QDate::currentDate().toJulianDay();
+    if (forecast.today() == today) return;
+
+    // Наступил новый день: окно сдвигается сразу, кривые - в пуле потоков.
+    // Если кривые еще строятся, их догонит обработчик завершения
+    forecast.setToday(today);
+    if (!forecastWatcher->isRunning()) {
+        advanceForecastCurves();
+    }
+}
+
+void HotelManager::advanceForecastCurves()
+{
+    // Тем же путем, что и построение: завершившиеся ночи дописываются, ночи старше истории отрезаются
+    OccupancyForecast::Curves curves = forecast.curves();
+    qint64 today = forecast.today();
+    QString databaseFile = db.databaseName();
+    forecastWatcher->setProperty("database", databaseFile);
+    forecastWatcher->setFuture(QtConcurrent::run([databaseFile, curves, today]() {
+        return OccupancyForecast::advanceCurves(databaseFile, curves, today);
+    }));
+}
+
+void HotelManager::initRoomFilter()
+{
+    ui->comboSort->addItem("Номер", RoomIndex::ByNumber);
+    ui->comboSort->addItem("Тип", RoomIndex::ByType);
+    ui->comboSort->addItem("Вместимость", RoomIndex::ByCapacity);
+    ui->comboSort->addItem("Цена", RoomIndex::ByPrice);
+
+    ui->dateFilterFrom->setDate(QDate::currentDate());
+    ui->dateFilterTo->setMinimumDate(QDate::currentDate().addDays(1));
+    ui->dateFilterTo->setDate(QDate::currentDate().addDays(1));
+
+    // Выезд не раньше следующего дня после заезда: перевернутый диапазон не выбрать
+    connect(ui->dateFilterFrom, &QDateEdit::dateChanged, this, [this](const QDate &date) {
+        ui->dateFilterTo->setMinimumDate(date.addDays(1));
+    });
+
+    // Любое изменение фильтра - только перераскладка сетки из индексов в памяти
+    connect(ui->comboFilterType, &QComboBox::currentIndexChanged, this, &HotelManager::applyRoomFilter);
+    connect(ui->comboSort, &QComboBox::currentIndexChanged, this, &HotelManager::applyRoomFilter);
+    connect(ui->checkSortDesc, &QCheckBox::toggled, this, &HotelManager::applyRoomFilter);
+    connect(ui->checkFilterFree, &QCheckBox::toggled, this, &HotelManager::applyRoomFilter);
+    connect(ui->spinFilterCapacity, &QSpinBox::valueChanged, this, &HotelManager::applyRoomFilter);
+    connect(ui->spinFilterPriceFrom, &QDoubleSpinBox::valueChanged, this, &HotelManager::applyRoomFilter);
+    connect(ui->spinFilterPriceTo, &QDoubleSpinBox::valueChanged, this, &HotelManager::applyRoomFilter);
+    connect(ui->dateFilterFrom, &QDateEdit::dateChanged, this, &HotelManager::applyRoomFilter);
+    connect(ui->dateFilterTo, &QDateEdit::dateChanged, this, &HotelManager::applyRoomFilter);
+
+    connect(ui->btnResetFilter, &QPushButton::clicked, this, [this]() {
+        {
+            QSignalBlocker typeBlocker(ui->comboFilterType);
+            QSignalBlocker sortBlocker(ui->comboSort);
+            QSignalBlocker descBlocker(ui->checkSortDesc);
+            QSignalBlocker freeBlocker(ui->checkFilterFree);
+            QSignalBlocker capacityBlocker(ui->spinFilterCapacity);
+            QSignalBlocker priceFromBlocker(ui->spinFilterPriceFrom);
+            QSignalBlocker priceToBlocker(ui->spinFilterPriceTo);
+
+            ui->comboFilterType->setCurrentIndex(0);
+            ui->comboSort->setCurrentIndex(0);
+            ui->checkSortDesc->setChecked(false);
+            ui->checkFilterFree->setChecked(false);
+            ui->spinFilterCapacity->setValue(0);
+            ui->spinFilterPriceFrom->setValue(0);
+            ui->spinFilterPriceTo->setValue(ui->spinFilterPriceTo->maximum());
+        }
+        applyRoomFilter();
+    });
+}
+
+void HotelManager::layoutRoomRows()
+{
+    RoomIndex::Filter filter;
+    filter.type = ui->comboFilterType->currentData().toString();
+    filter.minCapacity = ui->spinFilterCapacity->value();
+    filter.minPrice = ui->spinFilterPriceFrom->value();
+    filter.maxPrice = ui->spinFilterPriceTo->value() < ui->spinFilterPriceTo->maximum()
+                          ? ui->spinFilterPriceTo->value() : 0.0;
+    filter.freeOnly = ui->checkFilterFree->isChecked();
+    filter.freeFrom = ui->dateFilterFrom->date().toJulianDay();
+    filter.freeTo = ui->dateFilterTo->date().toJulianDay();
+
+    RoomIndex::SortKey key = RoomIndex::SortKey(ui->comboSort->currentData().toInt());
+    visibleRooms = roomIndex.select(filter, key, ui->checkSortDesc->isChecked(), *occupancyCache.snapshot());
+
+    ui->tableWidget->setRowCount(visibleRooms.size());
+    for (int row = 0; row < visibleRooms.size(); row++) {
+        const RoomInfo *room = roomIndex.find(visibleRooms[row]);
+        ui->tableWidget->setItem(row, 0, new QTableWidgetItem(
+            QString("Комната %1 (%2)").arg(room->number).arg(room->type)));
+    }
+
+    ui->groupBoxFilter->setTitle(QString("Фильтр и сортировка номеров (показано %1 из %2)")
+                                     .arg(visibleRooms.size())
+                                     .arg(roomIndex.rooms().size()));
+
+    yearOverview->setRooms(visibleRooms);
+}
+
+void HotelManager::applyRoomFilter()
+{
+    // Серия изменений фильтра подряд (сброс, прокрутка спинбокса) - одна перераскладка
+    refreshScheduler->request(RefreshScheduler::Layout);
+}
+
+void HotelManager::refreshGrid()
+{
+    // С фильтром "только свободные" правка может убрать или вернуть строки
+    refreshScheduler->request(ui->checkFilterFree->isChecked() ? RefreshScheduler::Layout
+                                                               : RefreshScheduler::AllCells);
+}
+
+int HotelManager::roomNumberAtRow(int row) const
+{
+    return row >= 0 && row < visibleRooms.size() ? visibleRooms[row] : 0;
+}
+
+void HotelManager::loadOccupancyFromDB()
+{
+    // Иначе перечитанный кэш потеряет правки, которые ждут таймера, и операции очереди
+    flushPendingWrites();
+
+    // Если очередь записать не успела, ее операции накладываются на прочитанное. Чтение идет
+    // под блокировкой писателей: новые операции в очередь за это время не попадут
+    occupancyCache.update([this](OccupancyStore &current) {
+        OccupancyStore store;
+        PropertyManager::loadOccupancy(db, store);
+        if (writeQueue) {
+            for (const BookingWriteQueue::Operation &operation : writeQueue->unflushed()) {
+                store.setOccupied(operation.roomNumber, operation.day, operation.occupied);
+            }
+        }
+        current = std::move(store);
+        return true;
+    });
+    archivedTo = archivedFrom - 1;
+    loadArchivedOccupancy();
+}
+
+void HotelManager::loadArchivedHistory()
+{
+    // Архив меняет только архиватор - читаем его целиком один раз, а не при каждой смене даты
+    archivedHistory.clear();
+    if (!archiver) return;
+
+    QString error;
+    if (!OccupancyHistory::load(db, "archive.bookings", std::numeric_limits<qint64>::min(),
+                                std::numeric_limits<qint64>::max(), &archivedHistory, &error)) {
+        qDebug() << "Ошибка загрузки архива: " << error;
+    }
+    yearOverview->redraw();
+}
+
+void HotelManager::loadArchivedOccupancy()
+{
+    // В кэше только рабочая таблица; из архива добавляем лишь видимое окно в прошлом.
+    // Ночи прежнего окна, которые в новое не попали, из кэша убираются: иначе каждая
+    // прокрутка в прошлое навсегда раздувала бы кэш, по которому отвечают API и проверки доступности
+    qint64 fromDay = 0;
+    qint64 toDay = -1;
+    if (archiver && startDate < archiver->cutoffDate()) {
+        fromDay = startDate.toJulianDay();
+        toDay = startDate.addDays(29).toJulianDay();
+    }
+
+    if (archivedFrom > archivedTo && fromDay > toDay) return;
+
+    // Все ночи окна публикуются одним снимком
+    occupancyCache.update([&](OccupancyStore &store) {
+        bool changed = dropArchivedNights(store, fromDay, toDay);
+        if (fromDay <= toDay) {
+            for (int roomNumber : archivedHistory.roomNumbers()) {
+                for (const OccupancyHistory::Run &run : archivedHistory.runs(roomNumber, fromDay, toDay)) {
+                    for (qint64 day = run.start; day < run.start + run.length; day++) {
+                        if (store.isOccupied(roomNumber, day)) continue;
+                        store.setOccupied(roomNumber, day, true);
+                        changed = true;
+                    }
+                }
+            }
+        }
+        return changed;
+    });
+    archivedFrom = fromDay;
+    archivedTo = toDay;
+}
+
+bool HotelManager::dropArchivedNights(OccupancyStore &store, qint64 keepFrom, qint64 keepTo) const
+{
+    // Убирает архивные ночи подгруженного окна [archivedFrom, archivedTo], кроме [keepFrom, keepTo]
+    bool changed = false;
+    if (archivedFrom > archivedTo) return changed;
+
+    for (int roomNumber : archivedHistory.roomNumbers()) {
+        for (const OccupancyHistory::Run &run : archivedHistory.runs(roomNumber, archivedFrom, archivedTo)) {
+            for (qint64 day = run.start; day < run.start + run.length; day++) {
+                if ((day >= keepFrom && day <= keepTo) || !store.isOccupied(roomNumber, day)) continue;
+                store.setOccupied(roomNumber, day, false);
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+void HotelManager::applyBookingStates(const QVector<BookingState> &states)
+{
+    qint64 cutoff = archiver ? archiver->cutoffDate().toJulianDay() : std::numeric_limits<qint64>::min();
+    QString error;
+
+    // Отложенная запись: правка принята, как только она в журнале.
+    // Архивные даты пишутся сами - их нужно удалять и из архива
+    QVector<BookingWriteQueue::Operation> queued;
+    QVector<BookingState> direct;
+    for (const BookingState &state : states) {
+        if (writeQueue && state.day >= cutoff) {
+            queued.append({state.roomNumber, state.day, state.occupied});
+        } else {
+            direct.append(state);
+        }
+    }
+
+    // Пока работает API, пишем сразу, иначе копим до паузы в правках. Запись, журнал очереди
+    // и публикация идут под одной блокировкой писателей, как в ApiServer: отмена через API
+    // не вклинится между фиксацией в БД и снимком, а порядок операций в журнале - порядок снимков
+    const bool writeNow = apiServer && apiServer->isListening();
+    bool written = true;
+    bool queuedOk = true;
+    occupancyCache.update([&](OccupancyStore &store) {
+        if (writeNow && !writeBookingStates(direct, &error)) {
+            written = false;
+            return false;
+        }
+
+        queuedOk = queued.isEmpty() || writeQueue->enqueue(queued, &error);
+        const QVector<BookingState> &applied = queuedOk ? states : direct;
+        if (!queuedOk && !writeNow) return false;
+
+        // Прямые правки уже в БД - кэш показывает их, даже если очередь отказала
+        for (const BookingState &state : applied) {
+            store.setOccupied(state.roomNumber, state.day, state.occupied);
+        }
+        return !applied.isEmpty();
+    });
+    if (!written) {
+        QMessageBox::warning(this, "Ошибка", "Изменение не сохранено: " + error);
+        return;
+    }
+    if (queuedOk && !writeNow) {
+        pendingEdits += direct;
+    }
+
+    if (!error.isEmpty()) {
+        QMessageBox::warning(this, "Ошибка", "Изменение не сохранено: " + error);
+        // Записанные напрямую правки все равно нужно показать в сетке
+        if (!writeNow || direct.isEmpty()) return;
+    }
+
+    if (!pendingEdits.isEmpty()) {
+        editFlushTimer->start();
+    }
+
+    // Сюда приходят и правки сетки, и отмена с повтором - трасса видит их все одинаково
+    recordBookingStates(queuedOk ? states : direct);
+
+    // Перерисовываются только правленые ячейки; заголовки - ради числа броней в прогнозе
+    if (ui->checkFilterFree->isChecked()) {
+        refreshScheduler->request(RefreshScheduler::Layout);
+        return;
+    }
+    for (const BookingState &state : states) {
+        refreshScheduler->requestCells(state.roomNumber, state.day, state.day);
+    }
+    refreshScheduler->request(RefreshScheduler::Headers);
+}
+
+void HotelManager::recordBookingStates(const QVector<BookingState> &states)
+{
+    if (!trace.isRecording()) return;
+
+    OperationTrace::Operation booked;
+    booked.kind = OperationTrace::Book;
+    OperationTrace::Operation cancelled;
+    cancelled.kind = OperationTrace::Cancel;
+    for (const BookingState &state : states) {
+        (state.occupied ? booked : cancelled).cells.append({state.roomNumber, state.day});
+    }
+    if (!booked.cells.isEmpty()) trace.record(booked);
+    if (!cancelled.cells.isEmpty()) trace.record(cancelled);
+}
+
+void HotelManager::flushBookingEdits()
+{
+    editFlushTimer->stop();
+    if (pendingEdits.isEmpty()) return;
+
+    QVector<BookingState> edits;
+    edits.swap(pendingEdits);
+
+    // Кэш уже показывает эти правки; правки копятся, только пока API не слушает
+    // (см. applyBookingStates), так что писать можно без блокировки писателей кэша
+    QString error;
+    writeBookingStates(edits, &error);
+
+    if (!error.isEmpty()) {
+        QMessageBox::warning(this, "Ошибка", error);
+
+        // Кэш уже показывает несохраненные правки - возвращаем его к БД
+        if (db.isOpen()) {
+            loadOccupancyFromDB();
+            applyRoomFilter();
+        }
+    }
+}
+
+bool HotelManager::writeBookingStates(const QVector<BookingState> &states, QString *error)
+{
+    if (states.isEmpty()) return true;
+
+    // Несколько правок одной ночи сводятся к последней
+    QMap<QPair<int, qint64>, bool> finalStates;
+    for (const BookingState &state : states) {
+        finalStates.insert(qMakePair(state.roomNumber, state.day), state.occupied);
+    }
+
+    qint64 cutoff = archiver ? archiver->cutoffDate().toJulianDay() : std::numeric_limits<qint64>::min();
+
+    if (!db.transaction()) {
+        if (error) *error = "Не удалось начать транзакцию: " + db.lastError().text();
+        return false;
+    }
+
+    QString message;
+    {
+        TracedQuery insert(db);
+        insert.prepare("INSERT OR IGNORE INTO bookings (room_number, booking_date) VALUES (?, ?)");
+        TracedQuery remove(db);
+        remove.prepare("DELETE FROM bookings WHERE room_number = ? AND booking_date = ?");
+        TracedQuery removeArchived(db);
+        if (archiver) {
+            removeArchived.prepare("DELETE FROM archive.bookings WHERE room_number = ? AND booking_date = ?");
+        }
+
+        for (auto it = finalStates.cbegin(); it != finalStates.cend() && message.isEmpty(); ++it) {
+            TracedQuery &query = it.value() ? insert : remove;
+            query.addBindValue(it.key().first);
+            query.addBindValue(it.key().second);
+            if (!query.exec()) {
+                message = query.lastError().text();
+                break;
+            }
+
+            // Бронь могла уже уехать в архив
+            if (!it.value() && it.key().second < cutoff) {
+                removeArchived.addBindValue(it.key().first);
+                removeArchived.addBindValue(it.key().second);
+                if (!removeArchived.exec()) {
+                    message = removeArchived.lastError().text();
+                }
+            }
+        }
+    }
+
+    if (!message.isEmpty() || !db.commit()) {
+        if (message.isEmpty()) message = db.lastError().text();
+        db.rollback();
+        if (error) *error = "Не удалось записать бронирования: " + message;
+        return false;
+    }
+
+    // Снятые архивные брони убираем и из истории в памяти
+    for (auto it = finalStates.cbegin(); it != finalStates.cend(); ++it) {
+        if (!it.value() && it.key().second < cutoff) {
+            archivedHistory.setOccupied(it.key().first, it.key().second, false);
+            yearOverview->redraw(it.key().first, it.key().second, it.key().second);
+        }
+    }
+    return true;
+}
+
+bool HotelManager::insertRoom(const RoomInfo &room, const QVector<qint64> &bookedDays)
+{
+    flushPendingWrites();
+
+    // Комната и ее брони возвращаются одной транзакцией; ночи старше горизонта - обратно в архив.
+    // Транзакция и публикация - под одной блокировкой писателей кэша, чтобы запись через API
+    // не легла между ними
+    qint64 cutoff = archiver ? archiver->cutoffDate().toJulianDay() : std::numeric_limits<qint64>::min();
+    QString message;
+    bool ok = occupancyCache.update([&](OccupancyStore &store) {
+        if (!db.transaction()) {
+            message = db.lastError().text();
+            return false;
+        }
+
+        {
+            TracedQuery query(db);
+            query.prepare(Schema::insertSql<Schema::Rooms>());
+            Schema::bindInsert<Schema::Rooms>(query, room);
+            if (!query.exec()) {
+                message = query.lastError().text();
+            }
+
+            TracedQuery insert(db);
+            insert.prepare("INSERT OR IGNORE INTO main.bookings (room_number, booking_date) VALUES (?, ?)");
+            TracedQuery insertArchived(db);
+            if (archiver) {
+                insertArchived.prepare("INSERT OR IGNORE INTO archive.bookings (room_number, booking_date) VALUES (?, ?)");
+            }
+            for (int i = 0; i < bookedDays.size() && message.isEmpty(); i++) {
+                TracedQuery &target = bookedDays[i] < cutoff ? insertArchived : insert;
+                target.addBindValue(room.number);
+                target.addBindValue(bookedDays[i]);
+                if (!target.exec()) {
+                    message = target.lastError().text();
+                }
+            }
+        }
+
+        if (!message.isEmpty() || !db.commit()) {
+            if (message.isEmpty()) message = db.lastError().text();
+            db.rollback();
+            return false;
+        }
+
+        for (qint64 day : bookedDays) {
+            if (day >= cutoff) store.setOccupied(room.number, day, true);
+        }
+        return true;
+    });
+
+    if (ok) {
+        for (qint64 day : bookedDays) {
+            if (day < cutoff) archivedHistory.setOccupied(room.number, day, true);
+        }
+        // Архивные ночи видимого окна - в кэш, как при смене даты
+        loadArchivedOccupancy();
+    }
+
+    if (!ok) {
+        QMessageBox::critical(this, "Ошибка",
+            QString("Не удалось добавить комнату %1: %2").arg(room.number).arg(message));
+        return false;
+    }
+
+    // Добавление комнаты и отмена ее удаления - в трассе как добавление и брони
+    OperationTrace::Operation operation;
+    operation.kind = OperationTrace::AddRoom;
+    operation.room = room;
+    trace.record(operation);
+    QVector<BookingState> restored;
+    for (qint64 day : bookedDays) {
+        restored.append({room.number, day, true});
+    }
+    recordBookingStates(restored);
+
+    loadRoomsFromDB();
+    refreshScheduler->request(RefreshScheduler::AllCells);
+    return true;
+}
+
+bool HotelManager::removeRoom(int roomNumber)
+{
+    flushPendingWrites();
+
+    // Брони и комната удаляются вместе: либо обе операции, либо ни одной.
+    // Как и при добавлении, транзакция и публикация - под одной блокировкой писателей кэша
+    QString message;
+    bool ok = occupancyCache.update([&](OccupancyStore &store) {
+        if (!db.transaction()) {
+            message = db.lastError().text();
+            return false;
+        }
+
+        {
+            TracedQuery deleteBookingsQuery(db);
+            deleteBookingsQuery.prepare("DELETE FROM main.bookings WHERE room_number = ?");
+            deleteBookingsQuery.addBindValue(roomNumber);
+            if (!deleteBookingsQuery.exec()) {
+                message = deleteBookingsQuery.lastError().text();
+            }
+
+            // Иначе новая комната с тем же номером унаследует архивные ночи в отчетах и истории
+            if (archiver && message.isEmpty()) {
+                TracedQuery deleteArchivedQuery(db);
+                deleteArchivedQuery.prepare("DELETE FROM archive.bookings WHERE room_number = ?");
+                deleteArchivedQuery.addBindValue(roomNumber);
+                if (!deleteArchivedQuery.exec()) {
+                    message = deleteArchivedQuery.lastError().text();
+                }
+            }
+
+            TracedQuery deleteRoomQuery(db);
+            deleteRoomQuery.prepare("DELETE FROM rooms WHERE room_number = ?");
+            deleteRoomQuery.addBindValue(roomNumber);
+            if (message.isEmpty() && !deleteRoomQuery.exec()) {
+                message = deleteRoomQuery.lastError().text();
+            }
+        }
+
+        if (!message.isEmpty() || !db.commit()) {
+            if (message.isEmpty()) message = db.lastError().text();
+            db.rollback();
+            return false;
+        }
+
+        store.removeRoom(roomNumber);
+        return true;
+    });
+
+    if (!ok) {
+        QMessageBox::critical(this, "Ошибка",
+            QString("Не удалось удалить комнату %1: %2").arg(roomNumber).arg(message));
+        return false;
+    }
+    archivedHistory.removeRoom(roomNumber);
+
+    OperationTrace::Operation operation;
+    operation.kind = OperationTrace::DeleteRoom;
+    operation.room.number = roomNumber;
+    trace.record(operation);
+
+    loadRoomsFromDB();
+    refreshScheduler->request(RefreshScheduler::AllCells);
+    return true;
+}
+
+bool HotelManager::isRoomOccupied(int roomNumber, const QDate &date)
+{
+    return occupancyCache.snapshot()->isOccupied(roomNumber, date);
+}
+
+void HotelManager::onDateChanged()
+{
+    // Удержанная стрелка в поле даты дает серию дат - сетка догоняет последнюю одним сдвигом
+    startDate = ui->dateEdit->date();
+    refreshScheduler->request(RefreshScheduler::Window);
+
+    OperationTrace::Operation operation;
+    operation.kind = OperationTrace::DateChange;
+    operation.fromDay = startDate.toJulianDay();
+    trace.record(operation);
+}
+
+void HotelManager::showOverviewCell(int roomNumber, const QDate &date)
+{
+    // Выбранная ночь становится первым столбцом сетки
+    ui->dateEdit->setDate(date);
+    refreshScheduler->flush();
+
+    int row = visibleRooms.indexOf(roomNumber);
+    if (row < 0) return;
+    ui->tableWidget->setCurrentCell(row, 1);
+    ui->tableWidget->scrollToItem(ui->tableWidget->item(row, 1), QAbstractItemView::PositionAtCenter);
+}
+
+void HotelManager::onTableClicked(const QModelIndex &index)
+{
+    // Если кликнули не на ячейку с датой, игнорируем
+    if (index.column() == 0) return;
+    refreshScheduler->flush();
+
+    int row = index.row();
+    int col = index.column();
+
+    // Получаем номер комнаты
+    int roomNumber = roomNumberAtRow(row);
+
+    // Получаем дату для этой колонки
+    QDate cellDate = startDate.addDays(col - 1);
+
+    // Создаем меню действий
+    QMenu menu(this);
+
+    if (isRoomOccupied(roomNumber, cellDate)) {
+        menu.addAction("Снять бронь", this, &HotelManager::removeBooking);
+    } else {
+        menu.addAction("Забронировать", this, &HotelManager::addBooking);
+    }
+
+    menu.exec(QCursor::pos());
+}
+
+void HotelManager::addRoom()
+{
+    bool ok;
+
+    // Получаем номер комнаты
+    int roomNumber = QInputDialog::getInt(this, "Добавить комнату",
+                                         "Введите номер комнаты:",
+                                         101, 1, 999, 1, &ok);
+
+    if (!ok) return;
+
+    // Проверяем, существует ли уже комната с таким номером
+    TracedQuery checkQuery(db);
+    checkQuery.prepare("SELECT COUNT(*) FROM rooms WHERE room_number = ?");
+    checkQuery.addBindValue(roomNumber);
+
+    if (checkQuery.exec() && checkQuery.next() && checkQuery.value(0).toInt() > 0) {
+        QMessageBox::warning(this, "Ошибка",
+            QString("Комната с номером %1 уже существует!").arg(roomNumber));
+        return;
+    }
+
+    // Получаем тип комнаты
+    QStringList roomTypes = QStringList() << "Стандарт" << "Люкс" << "Семейный" << "Бизнес" << "Апартаменты";
+    QString roomType = QInputDialog::getItem(this, "Тип комнаты",
+                                            "Выберите тип комнаты:",
+                                            roomTypes, 0, false, &ok);
+    if (!ok) return;
+
+    // Получаем вместимость
+    int capacity = QInputDialog::getInt(this, "Вместимость",
+                                       "Введите вместимость (человек):",
+                                       2, 1, 10, 1, &ok);
+    if (!ok) return;
+
+    // Получаем цену
+    double price = QInputDialog::getDouble(this, "Цена",
+                                          "Введите цену за ночь:",
+                                          3000.0, 500.0, 50000.0, 2, &ok);
+    if (!ok) return;
+
+    // Создаем кастомный диалог для ввода описания
+    QDialog dialog(this);
+    dialog.setWindowTitle("Описание комнаты");
+
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+
+    QLabel *label = new QLabel("Введите описание комнаты (можно использовать кириллицу, латиницу, цифры, (), /, -, пробелы):", &dialog);
+    layout->addWidget(label);
+
+    QLineEdit *lineEdit = new QLineEdit(&dialog);
+
+    // Устанавливаем валидатор с правильным регулярным выражением
+    QRegularExpressionValidator *validator = new QRegularExpressionValidator(
+        Validation::roomNamePattern(), &dialog);
+    lineEdit->setValidator(validator);
+
+    // Разрешаем длинный текст
+    lineEdit->setMaxLength(500);
+
+    layout->addWidget(lineEdit);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QPushButton *okButton = new QPushButton("OK", &dialog);
+    QPushButton *cancelButton = new QPushButton("Отмена", &dialog);
+
+    buttonLayout->addWidget(okButton);
+    buttonLayout->addWidget(cancelButton);
+    layout->addLayout(buttonLayout);
+
+    QString description;
+
+    connect(okButton, &QPushButton::clicked, &dialog, [&dialog, lineEdit, &description]() {
+        QString text = lineEdit->text().trimmed();
+        if (!text.isEmpty()) {
+            description = text;
+            dialog.accept();
+        } else {
+            QMessageBox::warning(&dialog, "Ошибка", "Описание комнаты не может быть пустым!");
+        }
+    });
+
+    connect(cancelButton, &QPushButton::clicked, &dialog, &QDialog::reject);
+
+    if (dialog.exec() != QDialog::Accepted) {
+        return; // Пользователь отменил
+    }
+
+    // Добавляем комнату через стек отмены
+    RoomInfo room;
+    room.number = roomNumber;
+    room.type = roomType;
+    room.capacity = capacity;
+    room.price = price;
+    room.description = description;
+    undoStack->push(new AddRoomCommand(this, room));
+
+    // Ошибку записи уже показал insertRoom
+    if (roomIndex.find(roomNumber)) {
+        QMessageBox::information(this, "Успех",
+            QString("Комната %1 (%2) успешно добавлена!\nОписание: %3")
+                .arg(roomNumber)
+                .arg(roomType)
+                .arg(description));
+        statusBar()->showMessage(QString("Добавлена комната %1").arg(roomNumber), 3000);
+    }
+}
+
+void HotelManager::reloadAfterImport()
+{
+    // Прежние команды отмены могли бы затереть импортированное
+    loadRoomsFromDB();
+    loadOccupancyFromDB();
+    refreshScheduler->request(RefreshScheduler::AllCells);
+    undoStack->clear();
+}
+
+void HotelManager::importFromCsv()
+{
+    QStringList kinds = QStringList() << "Комнаты" << "Клиенты" << "Бронирования";
+    bool ok;
+    QString kindName = QInputDialog::getItem(this, "Импорт из CSV",
+                                             "Что импортировать:", kinds, 0, false, &ok);
+    if (!ok) return;
+
+    QString fileName = QFileDialog::getOpenFileName(this, "Файл для импорта", QString(),
+                                                    "CSV (*.csv *.txt);;Все файлы (*)");
+    if (fileName.isEmpty()) return;
+
+    // Импорт идет мимо стека отмены, поэтому после него история правок сбрасывается
+    if (undoStack->count() > 0) {
+        QMessageBox::StandardButton reply = QMessageBox::question(this, "Импорт из CSV",
+            "После импорта историю правок нельзя будет отменить: стек отмены будет очищен.\n"
+            "Продолжить?");
+        if (reply != QMessageBox::Yes) return;
+    }
+
+    BulkImporter::Kind kind = BulkImporter::Rooms;
+    if (kindName == "Клиенты") {
+        kind = BulkImporter::Clients;
+    } else if (kindName == "Бронирования") {
+        kind = BulkImporter::Bookings;
+    }
+
+    flushPendingWrites();
+    BulkImporter importer(db);
+
+    QProgressDialog progress("Импорт: " + kindName, "Отмена", 0, 1000, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(300);
+
+    connect(&progress, &QProgressDialog::canceled, &importer, &BulkImporter::cancel);
+    connect(&importer, &BulkImporter::progress, &progress,
+            [&progress](qint64 bytesRead, qint64 bytesTotal, qint64 rows) {
+        progress.setValue(bytesTotal > 0 ? int(bytesRead * 1000 / bytesTotal) : 0);
+        progress.setLabelText(QString("Обработано строк: %1").arg(rows));
+        // Импорт идет в потоке интерфейса - даем обработать кнопку "Отмена"
+        QCoreApplication::processEvents();
+    });
+
+    BulkImporter::Result result = importer.import(kind, fileName);
+    progress.reset();
+
+    // Перечитываем данные, даже если импорт прерван: часть пакетов уже в БД
+    reloadAfterImport();
+
+    // Прерванный импорт по файлу не повторить - в трассу идет только завершенный
+    if (result.error.isEmpty() && !result.cancelled) {
+        OperationTrace::Operation operation;
+        operation.kind = OperationTrace::Import;
+        operation.importKind = kind;
+        operation.fileName = QFileInfo(fileName).absoluteFilePath();
+        trace.record(operation);
+    }
+
+    if (!result.error.isEmpty()) {
+        QMessageBox::critical(this, "Ошибка импорта", result.error);
+        return;
+    }
+
+    QString summary = QString("Импортировано: %1\nОтклонено: %2\nУже существовало: %3\nВремя: %4 с")
+                          .arg(result.imported)
+                          .arg(result.rejected)
+                          .arg(result.duplicates)
+                          .arg(result.elapsedMs / 1000.0, 0, 'f', 1);
+    if (result.cancelled) {
+        summary.prepend("Импорт прерван пользователем.\n");
+    }
+    if (!result.rejectsFile.isEmpty()) {
+        summary += "\nОтклоненные строки: " + result.rejectsFile;
+    }
+
+    QMessageBox::information(this, "Импорт из CSV", summary);
+    statusBar()->showMessage(QString("Импортировано записей: %1").arg(result.imported), 3000);
+}
+
+void HotelManager::configureArchive()
+{
+    bool ok;
+    int days = QInputDialog::getInt(this, "Архивация бронирований",
+                                    "Переносить в архив бронирования старше (дней):",
+                                    archiver->horizonDays(), 30, 3650, 1, &ok);
+    if (!ok) return;
+
+    archiver->setHorizonDays(days);
+
+    QMessageBox::StandardButton reply = QMessageBox::question(
+        this, "Архивация бронирований",
+        QString("Бронирования до %1 будут перенесены в архив.\nЗапустить сейчас?")
+            .arg(archiver->cutoffDate().toString("dd.MM.yyyy")),
+        QMessageBox::Yes | QMessageBox::No);
+
+    if (reply == QMessageBox::Yes) {
+        archiver->runNow();
+    }
+}
+
+void HotelManager::deleteRoom()
+{
+    flushPendingWrites();
+
+    // Получаем список всех комнат для выбора
+    TracedQuery query("SELECT room_number, room_type FROM rooms ORDER BY room_number", db);
+
+    QStringList rooms;
+    QMap<QString, int> roomMap; // Для сопоставления строки с номером комнаты
+
+    while (query.next()) {
+        int roomNumber = query.value(0).toInt();
+        QString roomType = query.value(1).toString();
+        QString roomString = QString("%1 (%2)").arg(roomNumber).arg(roomType);
+        rooms.append(roomString);
+        roomMap[roomString] = roomNumber;
+    }
+
+    if (rooms.isEmpty()) {
+        QMessageBox::information(this, "Удаление комнаты", "Нет комнат для удаления");
+        return;
+    }
+
+    bool ok;
+    QString selectedRoom = QInputDialog::getItem(this, "Удалить комнату",
+                                                "Выберите комнату для удаления:",
+                                                rooms, 0, false, &ok);
+
+    if (!ok || selectedRoom.isEmpty()) return;
+
+    int roomNumber = roomMap[selectedRoom];
+
+    // Проверяем, есть ли активные бронирования у этой комнаты
+    TracedQuery checkBookingsQuery(db);
+    checkBookingsQuery.prepare("SELECT COUNT(*) FROM bookings WHERE room_number = ? AND booking_date >= ?");
+    checkBookingsQuery.addBindValue(roomNumber);
+    checkBookingsQuery.addBindValue(QDate::currentDate().toJulianDay());
+
+    if (checkBookingsQuery.exec() && checkBookingsQuery.next()) {
+        int activeBookings = checkBookingsQuery.value(0).toInt();
+
+        if (activeBookings > 0) {
+            QMessageBox::StandardButton reply = QMessageBox::question(
+                this, "Подтверждение удаления",
                 QString("У комнаты %1 есть активные бронирования (%2 шт.).\n"
                        "При удалении комнаты все бронирования будут также удалены.\n"
                        "Продолжить?").arg(roomNumber).arg(activeBookings),
@@ -649,195 +1917,869 @@ void HotelManager::deleteRoom()
         }
     }
 
-    // Удаляем все бронирования этой комнаты
-    QSqlQuery deleteBookingsQuery;
-    deleteBookingsQuery.prepare("DELETE FROM bookings WHERE room_number = ?");
-    deleteBookingsQuery.addBindValue(roomNumber);
+    QString error;
+    if (!pushDeleteRoom(roomNumber, &error)) {
+        if (!error.isEmpty()) QMessageBox::warning(this, "Ошибка", error);
+        return;
+    }
+
+    if (!roomIndex.find(roomNumber)) {
+        statusBar()->showMessage(QString("Удалена комната %1 (Ctrl+Z - отменить)").arg(roomNumber), 5000);
+    }
+}
+
+bool HotelManager::pushDeleteRoom(int roomNumber, QString *error)
+{
+    // Запоминаем комнату и все ее брони, включая архивные, чтобы удаление можно было отменить
+    const RoomInfo *room = roomIndex.find(roomNumber);
+    if (!room) return false;
+
+    QVector<qint64> bookedDays;
+    TracedQuery bookedQuery(db);
+    bookedQuery.setForwardOnly(true);
+    bookedQuery.prepare(QString("SELECT booking_date FROM %1 WHERE room_number = ?")
+                            .arg(archiver ? "all_bookings" : "main.bookings"));
+    bookedQuery.addBindValue(roomNumber);
+    if (!bookedQuery.exec()) {
+        if (error) *error = "Не удалось прочитать бронирования комнаты: " + bookedQuery.lastError().text();
+        return false;
+    }
+    while (bookedQuery.next()) {
+        bookedDays.append(bookedQuery.value(0).toLongLong());
+    }
+
+    undoStack->push(new DeleteRoomCommand(this, *room, bookedDays));
+    return true;
+}
+
+// ... остальные методы (manageClients, manageServices, viewReports, addBooking, removeBooking, updateTableHeaders)
+// остаются такими же, как в предыдущем ответе ...
+
+void HotelManager::manageClients()
+{
+    // Создаем диалог для управления клиентами
+    QDialog *dialog = new QDialog(this);
+    dialog->setWindowTitle("Управление клиентами");
+    dialog->resize(600, 400);
+
+    QVBoxLayout *layout = new QVBoxLayout(dialog);
+
+    // Таблица клиентов
+    QTableWidget *clientsTable = new QTableWidget(dialog);
+    clientsTable->setColumnCount(5);
+    clientsTable->setHorizontalHeaderLabels(QStringList() << "ID" << "ФИО" << "Телефон" << "Email" << "Паспорт");
+
+    // Загружаем клиентов из БД - напрямую через sqlite3, если это возможно
+    QVector<Schema::Client> clients;
+    if (!SqliteFastPath::loadClients(db, &clients)) {
+        TracedQuery query(Schema::selectSql<Schema::Clients>(), db);
+        Schema::Client client;
+        while (query.next()) {
+            Schema::read<Schema::Clients>(query, client);
+            clients.append(client);
+        }
+    }
+    clientsTable->setRowCount(clients.size());
+    for (int row = 0; row < clients.size(); row++) {
+        const Schema::Client &client = clients[row];
+        clientsTable->setItem(row, 0, new QTableWidgetItem(QString::number(client.id)));
+        clientsTable->setItem(row, 1, new QTableWidgetItem(client.fullName));
+        clientsTable->setItem(row, 2, new QTableWidgetItem(client.phone));
+        clientsTable->setItem(row, 3, new QTableWidgetItem(client.email));
+        clientsTable->setItem(row, 4, new QTableWidgetItem(client.passport));
+    }
+
+    layout->addWidget(clientsTable);
+
+    // Кнопки
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+
+    QPushButton *addButton = new QPushButton("Добавить клиента", dialog);
+    connect(addButton, &QPushButton::clicked, dialog, [this, dialog, clientsTable]() {
+        bool ok;
+        QString name = QInputDialog::getText(dialog, "Добавить клиента",
+                                           "Введите ФИО:", QLineEdit::Normal, "", &ok);
+        if (!ok || name.isEmpty()) return;
+
+        QString phone = QInputDialog::getText(dialog, "Телефон",
+                                            "Введите телефон:", QLineEdit::Normal, "", &ok);
+        if (!ok) return;
+
+        QString email = QInputDialog::getText(dialog, "Email",
+                                            "Введите email:", QLineEdit::Normal, "", &ok);
+        if (!ok) return;
+
+        QString passport = QInputDialog::getText(dialog, "Паспорт",
+                                               "Введите паспортные данные:", QLineEdit::Normal, "", &ok);
+        if (!ok) return;
+
+        Schema::Client client;
+        client.fullName = name;
+        client.phone = phone;
+        client.email = email;
+        client.passport = passport;
+
+        TracedQuery query(db);
+        query.prepare(Schema::insertSql<Schema::Clients>());
+        Schema::bindInsert<Schema::Clients>(query, client);
+
+        if (query.exec()) {
+            // Обновляем таблицу
+            int row = clientsTable->rowCount();
+            clientsTable->insertRow(row);
+            clientsTable->setItem(row, 0, new QTableWidgetItem(query.lastInsertId().toString()));
+            clientsTable->setItem(row, 1, new QTableWidgetItem(name));
+            clientsTable->setItem(row, 2, new QTableWidgetItem(phone));
+            clientsTable->setItem(row, 3, new QTableWidgetItem(email));
+            clientsTable->setItem(row, 4, new QTableWidgetItem(passport));
+        }
+    });
+
+    QPushButton *closeButton = new QPushButton("Закрыть", dialog);
+    connect(closeButton, &QPushButton::clicked, dialog, &QDialog::close);
+
+    buttonLayout->addWidget(addButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+
+    layout->addLayout(buttonLayout);
+    dialog->setLayout(layout);
+    dialog->exec();
+}
+
+void HotelManager::manageServices()
+{
+    QDialog *dialog = new QDialog(this);
+    dialog->setWindowTitle("Управление услугами");
+    dialog->resize(500, 300);
+
+    QVBoxLayout *layout = new QVBoxLayout(dialog);
+
+    // Таблица услуг
+    QTableWidget *servicesTable = new QTableWidget(dialog);
+    servicesTable->setColumnCount(3);
+    servicesTable->setHorizontalHeaderLabels(QStringList() << "Услуга" << "Цена" << "Описание");
+
+    TracedQuery query(Schema::selectSql<Schema::Services>(), db);
+    Schema::Service service;
+    int row = 0;
+    while (query.next()) {
+        Schema::read<Schema::Services>(query, service);
+        servicesTable->insertRow(row);
+        servicesTable->setItem(row, 0, new QTableWidgetItem(service.name));
+        servicesTable->setItem(row, 1, new QTableWidgetItem(QString::number(service.price)));
+        servicesTable->setItem(row, 2, new QTableWidgetItem(service.description));
+        row++;
+    }
+
+    layout->addWidget(servicesTable);
+
+    // Кнопки
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+
+    QPushButton *addButton = new QPushButton("Добавить услугу", dialog);
+    connect(addButton, &QPushButton::clicked, dialog, [this, dialog, servicesTable]() {
+        bool ok;
+        QString name = QInputDialog::getText(dialog, "Добавить услугу",
+                                           "Название услуги:", QLineEdit::Normal, "", &ok);
+        if (!ok || name.isEmpty()) return;
+
+        double price = QInputDialog::getDouble(dialog, "Цена",
+                                              "Цена услуги:", 0, 0, 100000, 2, &ok);
+        if (!ok) return;
+
+        QString description = QInputDialog::getText(dialog, "Описание",
+                                                  "Описание услуги:", QLineEdit::Normal, "", &ok);
+        if (!ok) return;
+
+        Schema::Service service;
+        service.name = name;
+        service.price = price;
+        service.description = description;
+
+        TracedQuery query(db);
+        query.prepare(Schema::insertSql<Schema::Services>());
+        Schema::bindInsert<Schema::Services>(query, service);
+
+        if (query.exec()) {
+            int row = servicesTable->rowCount();
+            servicesTable->insertRow(row);
+            servicesTable->setItem(row, 0, new QTableWidgetItem(name));
+            servicesTable->setItem(row, 1, new QTableWidgetItem(QString::number(price)));
+            servicesTable->setItem(row, 2, new QTableWidgetItem(description));
+        }
+    });
+
+    QPushButton *closeButton = new QPushButton("Закрыть", dialog);
+    connect(closeButton, &QPushButton::clicked, dialog, &QDialog::close);
+
+    buttonLayout->addWidget(addButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+
+    layout->addLayout(buttonLayout);
+    dialog->setLayout(layout);
+    dialog->exec();
+}
+
+void HotelManager::viewReports()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("Отчеты и обзор");
+    dialog.resize(700, 550);
+
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+
+    QHBoxLayout *periodLayout = new QHBoxLayout();
+    QDateEdit *fromEdit = new QDateEdit(QDate::currentDate(), &dialog);
+    QDateEdit *toEdit = new QDateEdit(QDate::currentDate().addMonths(3), &dialog);
+    fromEdit->setCalendarPopup(true);
+    toEdit->setCalendarPopup(true);
+    QPushButton *buildButton = new QPushButton("Сформировать", &dialog);
+    periodLayout->addWidget(new QLabel("С:", &dialog));
+    periodLayout->addWidget(fromEdit);
+    periodLayout->addWidget(new QLabel("по:", &dialog));
+    periodLayout->addWidget(toEdit);
+    periodLayout->addWidget(buildButton);
+    layout->addLayout(periodLayout);
+
+    QHBoxLayout *progressLayout = new QHBoxLayout();
+    QProgressBar *progressBar = new QProgressBar(&dialog);
+    QPushButton *stopButton = new QPushButton("Отмена", &dialog);
+    progressLayout->addWidget(progressBar);
+    progressLayout->addWidget(stopButton);
+    layout->addLayout(progressLayout);
+    progressBar->setVisible(false);
+    stopButton->setVisible(false);
+
+    QTextEdit *reportText = new QTextEdit(&dialog);
+    reportText->setReadOnly(true);
+    layout->addWidget(reportText);
+
+    QPushButton *closeButton = new QPushButton("Закрыть", &dialog);
+    connect(closeButton, &QPushButton::clicked, &dialog, &QDialog::close);
+    layout->addWidget(closeButton);
+
+    connect(stopButton, &QPushButton::clicked, reportGenerator, &ReportGenerator::cancel);
+    connect(reportGenerator, &ReportGenerator::progress, &dialog, [progressBar](int done, int total) {
+        progressBar->setMaximum(total);
+        progressBar->setValue(done);
+    });
+    connect(reportGenerator, &ReportGenerator::finished, &dialog,
+            [progressBar, stopButton, buildButton, reportText](bool ok, const QString &html, const QString &error) {
+        progressBar->setVisible(false);
+        stopButton->setVisible(false);
+        buildButton->setEnabled(true);
+        if (ok) {
+            reportText->setHtml(html);
+        } else {
+            reportText->setPlainText(error);
+        }
+    });
+
+    auto build = [this, fromEdit, toEdit, progressBar, stopButton, buildButton, reportText]() {
+        if (reportGenerator->isRunning()) return;
+        if (fromEdit->date() > toEdit->date()) {
+            QMessageBox::warning(this, "Ошибка", "Начало периода позже его окончания");
+            return;
+        }
+
+        OperationTrace::Operation operation;
+        operation.kind = OperationTrace::Report;
+        operation.fromDay = fromEdit->date().toJulianDay();
+        operation.toDay = toEdit->date().toJulianDay();
+        trace.record(operation);
+
+        // Отчет читает БД напрямую - сначала дописываем правки и очередь
+        flushPendingWrites();
+        advanceForecast();
+
+        ReportGenerator::DataVersion version = reportVersion(fromEdit->date(), toEdit->date());
+        QString html;
+        if (reportGenerator->cached(fromEdit->date(), toEdit->date(), version, &html)) {
+            reportText->setHtml(html);
+            statusBar()->showMessage("Отчет не изменился с прошлого раза - показан сохраненный", 3000);
+            return;
+        }
+
+        progressBar->setValue(0);
+        progressBar->setVisible(true);
+        stopButton->setVisible(true);
+        buildButton->setEnabled(false);
+        reportText->setPlainText("Отчет строится...");
+        reportGenerator->start(reportRequest(fromEdit->date(), toEdit->date()), version);
+    };
+    connect(buildButton, &QPushButton::clicked, &dialog, build);
+
+    build();
+    dialog.exec();
+
+    // Диалог закрыт - незаконченный отчет больше не нужен
+    reportGenerator->stop();
+}
+
+ReportGenerator::DataVersion HotelManager::reportVersion(const QDate &from, const QDate &to) const
+{
+    // Отчет читает ночи периода, а прогноз в нем - окно от сегодняшнего дня
+    qint64 today = QDate::currentDate().toJulianDay();
+    ReportGenerator::DataVersion version;
+    version.databaseFile = db.databaseName();
+    version.occupancy = qMax(occupancyCache.changedVersion(from.toJulianDay(), to.toJulianDay()),
+                             occupancyCache.changedVersion(today, today + OccupancyForecast::HorizonDays - 1));
+    version.rooms = roomsVersion;
+    version.history = forecast.curves().toDay;
+    version.rates = ratesVersion;
+    return version;
+}
+
+ReportGenerator::Request HotelManager::reportRequest(const QDate &from, const QDate &to) const
+{
+    ReportGenerator::Request request;
+    request.from = from;
+    request.to = to;
+    request.forecast = forecast.forecast(QDate::currentDate().toJulianDay(), OccupancyForecast::HorizonDays);
+    // Период отчета может лежать вне окна цен сетки - компилируем тарифы ровно на него
+    request.rates.compile(roomIndex.rooms(), rateTable.rules(), from.toJulianDay(), int(from.daysTo(to)) + 1);
+    return request;
+}
+
+void HotelManager::exportBookings()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("Экспорт бронирований");
+
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+
+    QHBoxLayout *periodLayout = new QHBoxLayout();
+    QDateEdit *fromEdit = new QDateEdit(QDate::currentDate().addMonths(-1), &dialog);
+    QDateEdit *toEdit = new QDateEdit(QDate::currentDate(), &dialog);
+    fromEdit->setCalendarPopup(true);
+    toEdit->setCalendarPopup(true);
+    periodLayout->addWidget(new QLabel("С:", &dialog));
+    periodLayout->addWidget(fromEdit);
+    periodLayout->addWidget(new QLabel("по:", &dialog));
+    periodLayout->addWidget(toEdit);
+    layout->addLayout(periodLayout);
+
+    QComboBox *formatBox = new QComboBox(&dialog);
+    formatBox->addItem("CSV", BookingExporter::Csv);
+    formatBox->addItem("JSON Lines", BookingExporter::JsonLines);
+    layout->addWidget(formatBox);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QPushButton *okButton = new QPushButton("Выгрузить", &dialog);
+    QPushButton *cancelButton = new QPushButton("Отмена", &dialog);
+    buttonLayout->addWidget(okButton);
+    buttonLayout->addWidget(cancelButton);
+    layout->addLayout(buttonLayout);
+
+    connect(okButton, &QPushButton::clicked, &dialog, &QDialog::accept);
+    connect(cancelButton, &QPushButton::clicked, &dialog, &QDialog::reject);
+
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    QDate from = fromEdit->date();
+    QDate to = toEdit->date();
+    if (from > to) {
+        QMessageBox::warning(this, "Ошибка", "Начало периода позже его окончания");
+        return;
+    }
+
+    BookingExporter::Format format = BookingExporter::Format(formatBox->currentData().toInt());
+    QString filter = format == BookingExporter::Csv ? "CSV (*.csv)" : "JSON Lines (*.jsonl)";
+    QString suggested = QString("bookings_%1_%2.%3")
+                            .arg(from.toString("yyyyMMdd"))
+                            .arg(to.toString("yyyyMMdd"))
+                            .arg(format == BookingExporter::Csv ? "csv" : "jsonl");
+
+    QString fileName = QFileDialog::getSaveFileName(this, "Сохранить выгрузку", suggested, filter);
+    if (fileName.isEmpty()) return;
+
+    // Выгрузка идет в фоне: окно остается доступным, прогресс - в немодальном диалоге
+    flushPendingWrites();
+    BookingExporter *exporter = new BookingExporter(db.databaseName(), this);
+    QProgressDialog *progress = new QProgressDialog("Экспорт бронирований...", "Отмена", 0, 0, this);
+    progress->setAttribute(Qt::WA_DeleteOnClose);
+    progress->setMinimumDuration(0);
+
+    connect(progress, &QProgressDialog::canceled, exporter, &BookingExporter::cancel);
+    connect(exporter, &BookingExporter::progress, progress, [progress](qint64 rows, qint64 total) {
+        progress->setMaximum(total > 0 ? 1000 : 0);
+        progress->setValue(total > 0 ? int(rows * 1000 / total) : 0);
+        progress->setLabelText(QString("Выгружено строк: %1 из %2").arg(rows).arg(total));
+    });
+    // Диалог удаляется при закрытии, в том числе пользователем по Esc до конца выгрузки
+    QPointer<QProgressDialog> guard(progress);
+    connect(exporter, &BookingExporter::finished, this,
+            [this, exporter, guard, fileName](bool ok, qint64 rows, const QString &error) {
+        if (guard) guard->close();
+        exporter->deleteLater();
+
+        if (ok) {
+            statusBar()->showMessage(QString("Выгружено %1 строк в %2").arg(rows).arg(fileName), 5000);
+        } else {
+            QMessageBox::warning(this, "Экспорт", error);
+        }
+    });
+
+    exporter->start(from, to, format, fileName);
+}
+
+void HotelManager::showSqlProfile()
+{
+    QDialog *dialog = new QDialog(this);
+    dialog->setWindowTitle("Профиль SQL");
+    dialog->resize(900, 500);
+
+    QVBoxLayout *layout = new QVBoxLayout(dialog);
+
+    QTextEdit *profileText = new QTextEdit(dialog);
+    profileText->setReadOnly(true);
+    profileText->setHtml(SqlTracer::instance().reportHtml() + availabilityCache.reportHtml() +
+                         ConnectionPool::instance().reportHtml() + refreshScheduler->reportHtml());
+    layout->addWidget(profileText);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+
+    // Планы выполнения для самых дорогих запросов - ищем недостающие индексы
+    QPushButton *explainButton = new QPushButton("Планы запросов", dialog);
+    connect(explainButton, &QPushButton::clicked, dialog, [this, profileText]() {
+        profileText->setHtml(SqlTracer::instance().reportHtml() +
+                             SqlTracer::instance().explainTopOffenders(db));
+    });
+
+    QPushButton *thresholdButton = new QPushButton("Порог медленных...", dialog);
+    connect(thresholdButton, &QPushButton::clicked, dialog, [dialog, profileText]() {
+        bool ok;
+        int ms = QInputDialog::getInt(dialog, "Порог медленных запросов",
+                                      "Порог, мс:", SqlTracer::instance().slowThresholdMs(),
+                                      0, 60000, 1, &ok);
+        if (!ok) return;
+
+        SqlTracer::instance().setSlowThresholdMs(ms);
+        profileText->setHtml(SqlTracer::instance().reportHtml());
+    });
+
+    QPushButton *resetButton = new QPushButton("Сбросить", dialog);
+    connect(resetButton, &QPushButton::clicked, dialog, [this, profileText]() {
+        SqlTracer::instance().reset();
+        availabilityCache.resetStats();
+        ConnectionPool::instance().resetStats();
+        refreshScheduler->resetStats();
+        profileText->setHtml(SqlTracer::instance().reportHtml() + availabilityCache.reportHtml() +
+                             ConnectionPool::instance().reportHtml() + refreshScheduler->reportHtml());
+    });
+
+    QPushButton *closeButton = new QPushButton("Закрыть", dialog);
+    connect(closeButton, &QPushButton::clicked, dialog, &QDialog::close);
+
+    buttonLayout->addWidget(explainButton);
+    buttonLayout->addWidget(thresholdButton);
+    buttonLayout->addWidget(resetButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+
+    layout->addLayout(buttonLayout);
+    dialog->setLayout(layout);
+    dialog->exec();
+}
+
+void HotelManager::addBooking()
+{
+    editSelectedCells(true);
+}
+
+void HotelManager::editSelectedCells(bool occupied)
+{
+    // Выделение читаем по уже перерисованной сетке
+    refreshScheduler->flush();
+
+    QModelIndexList selected = ui->tableWidget->selectionModel()->selectedIndexes();
+    if (selected.isEmpty()) {
+        QMessageBox::information(this, occupied ? "Бронирование" : "Снять бронь",
+            occupied ? "Выберите ячейку в таблице для бронирования"
+                     : "Выберите занятую ячейку для снятия брони");
+        return;
+    }
+
+    // Все выделенные ячейки - одна команда: и отмена, и запись идут одним пакетом
+    QVector<OperationTrace::Cell> cells;
+    for (const QModelIndex &index : selected) {
+        if (index.column() == 0) continue; // Столбец с номерами
+        cells.append({roomNumberAtRow(index.row()), startDate.addDays(index.column() - 1).toJulianDay()});
+    }
 
-    if (!deleteBookingsQuery.exec()) {
-        QMessageBox::warning(this, "Ошибка",
-            "Не удалось удалить бронирования комнаты: " + deleteBookingsQuery.lastError().text());
+    QVector<BookingCommand::Change> changes = bookingChanges(cells, occupied);
+    if (changes.isEmpty()) {
+        statusBar()->showMessage(occupied ? "Выбранные ночи уже заняты" : "Выбранные ночи уже свободны", 3000);
         return;
     }
 
-    // Удаляем комнату
-    QSqlQuery deleteRoomQuery;
-    deleteRoomQuery.prepare("DELETE FROM rooms WHERE room_number = ?");
-    deleteRoomQuery.addBindValue(roomNumber);
+    // В трассу правку пишет applyBookingStates
+    undoStack->push(new BookingCommand(this, changes));
 
-    if (deleteRoomQuery.exec()) {
-        // Очищаем кэш для этой комнаты
-        QList<QPair<int, QDate>> keysToRemove;
-        for (auto it = occupancyCache.begin(); it != occupancyCache.end(); ++it) {
-            if (it.key().first == roomNumber) {
-                keysToRemove.append(it.key());
-            }
+    QString message = changes.size() == 1
+        ? QString(occupied ? "Комната %1 забронирована на %2" : "Бронь комнаты %1 на %2 снята")
+              .arg(changes.first().roomNumber)
+              .arg(QDate::fromJulianDay(changes.first().day).toString("dd.MM.yyyy"))
+        : QString(occupied ? "Забронировано ночей: %1" : "Снято броней: %1").arg(changes.size());
+    statusBar()->showMessage(message + " (Ctrl+Z - отменить)", 5000);
+}
+
+QVector<BookingCommand::Change> HotelManager::bookingChanges(const QVector<OperationTrace::Cell> &cells, bool occupied) const
+{
+    // Только ночи, которые действительно меняются
+    SharedOccupancy::Snapshot occupancy = occupancyCache.snapshot();
+    QVector<BookingCommand::Change> changes;
+    for (const OperationTrace::Cell &cell : cells) {
+        bool before = occupancy->isOccupied(cell.roomNumber, cell.day);
+        if (cell.roomNumber > 0 && before != occupied) {
+            changes.append({cell.roomNumber, cell.day, before, occupied});
         }
+    }
+    return changes;
+}
 
-        for (const auto &key : keysToRemove) {
-            occupancyCache.remove(key);
+bool HotelManager::replay(const OperationTrace::Operation &operation, QString *error)
+{
+    switch (operation.kind) {
+    case OperationTrace::Book:
+    case OperationTrace::Cancel: {
+        QVector<OperationTrace::Cell> cells;
+        for (const OperationTrace::Cell &cell : operation.cells) {
+            if (roomIndex.find(cell.roomNumber)) cells.append(cell);
+        }
+        if (cells.size() != operation.cells.size()) {
+            if (error) *error = "В трассе есть комнаты, которых нет в базе";
         }
 
-        // Обновляем таблицу
-        loadRoomsFromDB();
-        updateTableHeaders();
+        QVector<BookingCommand::Change> changes = bookingChanges(cells, operation.kind == OperationTrace::Book);
+        if (!changes.isEmpty()) {
+            undoStack->push(new BookingCommand(this, changes));
+        }
+        return cells.size() == operation.cells.size();
+    }
+    case OperationTrace::DateChange:
+        ui->dateEdit->setDate(QDate::fromJulianDay(operation.fromDay));
+        return true;
+    case OperationTrace::AddRoom:
+        if (roomIndex.find(operation.room.number)) {
+            if (error) *error = QString("Комната %1 уже существует").arg(operation.room.number);
+            return false;
+        }
+        undoStack->push(new AddRoomCommand(this, operation.room));
+        return roomIndex.find(operation.room.number) != nullptr;
+    case OperationTrace::DeleteRoom:
+        flushPendingWrites();
+        if (!roomIndex.find(operation.room.number)) {
+            if (error) *error = QString("Комнаты %1 нет").arg(operation.room.number);
+            return false;
+        }
+        return pushDeleteRoom(operation.room.number, error) && !roomIndex.find(operation.room.number);
+    case OperationTrace::Report: {
+        if (reportGenerator->isRunning()) reportGenerator->stop();
+
+        flushPendingWrites();
+        advanceForecast();
+
+        QDate from = QDate::fromJulianDay(operation.fromDay);
+        QDate to = QDate::fromJulianDay(operation.toDay);
+        ReportGenerator::DataVersion version = reportVersion(from, to);
+        QString html;
+        if (reportGenerator->cached(from, to, version, &html)) return true;
+
+        bool ok = false;
+        QEventLoop loop;
+        connect(reportGenerator, &ReportGenerator::finished, &loop,
+                [&loop, &ok, error](bool done, const QString &, const QString &message) {
+            ok = done;
+            if (!done && error) *error = message;
+            loop.quit();
+        });
+        reportGenerator->start(reportRequest(from, to), version);
+        loop.exec();
+        return ok;
+    }
+    case OperationTrace::GroupBook: {
+        flushPendingWrites();
+
+        GroupBooking::Request request;
+        request.roomCount = operation.rooms.size();
+        request.fromDay = operation.fromDay;
+        request.toDay = operation.toDay;
+        GroupBooking::Allocation allocation;
+        allocation.rooms = operation.rooms;
+        if (!GroupBooking::commit(db, occupancyCache, request, allocation, error)) return false;
+
+        refreshGrid();
+        return true;
+    }
+    case OperationTrace::Import: {
+        if (operation.importKind < BulkImporter::Rooms || operation.importKind > BulkImporter::Bookings) {
+            if (error) *error = "Неизвестный вид импорта";
+            return false;
+        }
 
-        QMessageBox::information(this, "Успех",
-            QString("Комната %1 успешно удалена!").arg(roomNumber));
-        statusBar()->showMessage(QString("Удалена комната %1").arg(roomNumber), 3000);
-    } else {
-        QMessageBox::critical(this, "Ошибка",
-            "Не удалось удалить комнату: " + deleteRoomQuery.lastError().text());
+        flushPendingWrites();
+        BulkImporter importer(db);
+        BulkImporter::Result result = importer.import(BulkImporter::Kind(operation.importKind), operation.fileName);
+        reloadAfterImport();
+        if (!result.error.isEmpty() && error) *error = result.error;
+        return result.error.isEmpty();
+    }
     }
+    return false;
 }
 
-// ... остальные методы (manageClients, manageServices, viewReports, addBooking, removeBooking, updateTableHeaders)
-// остаются такими же, как в предыдущем ответе ...
-
-void HotelManager::manageClients()
+void HotelManager::addGroupBooking()
 {
-    // Создаем диалог для управления клиентами
     QDialog *dialog = new QDialog(this);
-    dialog->setWindowTitle("Управление клиентами");
-    dialog->resize(600, 400);
+    dialog->setWindowTitle("Групповое бронирование");
 
-    QVBoxLayout *layout = new QVBoxLayout(dialog);
+    QFormLayout *form = new QFormLayout();
 
-    // Таблица клиентов
-    QTableWidget *clientsTable = new QTableWidget(dialog);
-    clientsTable->setColumnCount(5);
-    clientsTable->setHorizontalHeaderLabels(QStringList() << "ID" << "ФИО" << "Телефон" << "Email" << "Паспорт");
+    QSpinBox *countSpin = new QSpinBox(dialog);
+    countSpin->setRange(1, qMax(1, int(roomIndex.rooms().size())));
+    countSpin->setValue(qMin(10, countSpin->maximum()));
+    form->addRow("Комнат:", countSpin);
 
-    // Загружаем клиентов из БД
-    QSqlQuery query("SELECT id, full_name, phone, email, passport FROM clients ORDER BY full_name");
-    int row = 0;
-    while (query.next()) {
-        clientsTable->insertRow(row);
-        for (int col = 0; col < 5; col++) {
-            clientsTable->setItem(row, col, new QTableWidgetItem(query.value(col).toString()));
-        }
-        row++;
-    }
+    QDateEdit *checkInEdit = new QDateEdit(startDate, dialog);
+    checkInEdit->setCalendarPopup(true);
+    form->addRow("Заезд:", checkInEdit);
 
-    layout->addWidget(clientsTable);
+    QSpinBox *nightsSpin = new QSpinBox(dialog);
+    nightsSpin->setRange(1, 366);
+    nightsSpin->setValue(1);
+    form->addRow("Ночей:", nightsSpin);
 
-    // Кнопки
-    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QComboBox *typeCombo = new QComboBox(dialog);
+    typeCombo->addItem("Любой тип", QString());
+    for (const QString &type : roomIndex.types()) {
+        typeCombo->addItem(type, type);
+    }
+    form->addRow("Тип комнаты:", typeCombo);
 
-    QPushButton *addButton = new QPushButton("Добавить клиента", dialog);
-    connect(addButton, &QPushButton::clicked, dialog, [dialog, clientsTable]() {
-        bool ok;
-        QString name = QInputDialog::getText(dialog, "Добавить клиента",
-                                           "Введите ФИО:", QLineEdit::Normal, "", &ok);
-        if (!ok || name.isEmpty()) return;
+    QSpinBox *capacitySpin = new QSpinBox(dialog);
+    capacitySpin->setRange(0, Validation::MaxCapacity);
+    capacitySpin->setSpecialValueText("Любая");
+    form->addRow("Вместимость от:", capacitySpin);
 
-        QString phone = QInputDialog::getText(dialog, "Телефон",
-                                            "Введите телефон:", QLineEdit::Normal, "", &ok);
-        if (!ok) return;
+    QVBoxLayout *layout = new QVBoxLayout(dialog);
+    layout->addLayout(form);
 
-        QString email = QInputDialog::getText(dialog, "Email",
-                                            "Введите email:", QLineEdit::Normal, "", &ok);
-        if (!ok) return;
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QPushButton *okButton = new QPushButton("Подобрать", dialog);
+    QPushButton *cancelButton = new QPushButton("Отмена", dialog);
+    buttonLayout->addWidget(okButton);
+    buttonLayout->addWidget(cancelButton);
+    layout->addLayout(buttonLayout);
 
-        QString passport = QInputDialog::getText(dialog, "Паспорт",
-                                               "Введите паспортные данные:", QLineEdit::Normal, "", &ok);
-        if (!ok) return;
+    connect(okButton, &QPushButton::clicked, dialog, &QDialog::accept);
+    connect(cancelButton, &QPushButton::clicked, dialog, &QDialog::reject);
+
+    // Значения полей читаются сразу: после вопросов ниже диалог уже может быть удален
+    connect(dialog, &QDialog::accepted, this, [this, countSpin, checkInEdit, nightsSpin, typeCombo, capacitySpin]() {
+        GroupBooking::Request request;
+        request.roomCount = countSpin->value();
+        request.fromDay = checkInEdit->date().toJulianDay();
+        request.toDay = request.fromDay + nightsSpin->value();
+        request.type = typeCombo->currentData().toString();
+        request.minCapacity = capacitySpin->value();
+        request.today = QDate::currentDate().toJulianDay();
+
+        const int nights = int(request.toDay - request.fromDay);
+
+        // Подбор идет по снимку кэша в памяти, без запросов к БД
+        GroupBooking::Allocation allocation = GroupBooking::allocate(request, roomIndex, *occupancyCache.snapshot());
+        if (!allocation.isValid()) {
+            QMessageBox::warning(this, "Групповое бронирование", allocation.error);
+            return;
+        }
 
-        QSqlQuery query;
-        query.prepare("INSERT INTO clients (full_name, phone, email, passport) "
-                     "VALUES (?, ?, ?, ?)");
-        query.addBindValue(name);
-        query.addBindValue(phone);
-        query.addBindValue(email);
-        query.addBindValue(passport);
+        QStringList roomNumbers;
+        for (int room : allocation.rooms) {
+            roomNumbers << QString::number(room);
+        }
 
-        if (query.exec()) {
-            // Обновляем таблицу
-            int row = clientsTable->rowCount();
-            clientsTable->insertRow(row);
-            clientsTable->setItem(row, 0, new QTableWidgetItem(query.lastInsertId().toString()));
-            clientsTable->setItem(row, 1, new QTableWidgetItem(name));
-            clientsTable->setItem(row, 2, new QTableWidgetItem(phone));
-            clientsTable->setItem(row, 3, new QTableWidgetItem(email));
-            clientsTable->setItem(row, 4, new QTableWidgetItem(passport));
+        QString proposal = QString("Комнаты: %1\n"
+                                   "Период: %2 - %3 (%4 ноч.)\n"
+                                   "Пропусков в нумерации: %5\n"
+                                   "Остается коротких свободных ночей рядом с блоком: %6\n\n"
+                                   "Забронировать?")
+                               .arg(roomNumbers.join(", "))
+                               .arg(QDate::fromJulianDay(request.fromDay).toString("dd.MM.yyyy"))
+                               .arg(QDate::fromJulianDay(request.toDay).toString("dd.MM.yyyy"))
+                               .arg(nights)
+                               .arg(allocation.numberGaps)
+                               .arg(allocation.orphanNights);
+
+        if (QMessageBox::question(this, "Групповое бронирование", proposal,
+                                  QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes) {
+            return;
         }
-    });
 
-    QPushButton *closeButton = new QPushButton("Закрыть", dialog);
-    connect(closeButton, &QPushButton::clicked, dialog, &QDialog::close);
+        // Все комнато-ночи - одной транзакцией: либо группа забронирована целиком, либо ничего
+        flushPendingWrites();
+        QString error;
+        if (!GroupBooking::commit(db, occupancyCache, request, allocation, &error)) {
+            QMessageBox::warning(this, "Ошибка", "Группа не забронирована: " + error);
+            return;
+        }
 
-    buttonLayout->addWidget(addButton);
-    buttonLayout->addStretch();
-    buttonLayout->addWidget(closeButton);
+        OperationTrace::Operation operation;
+        operation.kind = OperationTrace::GroupBook;
+        operation.fromDay = request.fromDay;
+        operation.toDay = request.toDay;
+        operation.rooms = allocation.rooms;
+        trace.record(operation);
 
-    layout->addLayout(buttonLayout);
-    dialog->setLayout(layout);
-    dialog->exec();
+        refreshGrid();
+
+        statusBar()->showMessage(QString("Забронировано комнат: %1 на %2 ноч.")
+                                     .arg(allocation.rooms.size())
+                                     .arg(nights), 5000);
+    });
+
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->open();
 }
 
-void HotelManager::manageServices()
+void HotelManager::manageRates()
 {
     QDialog *dialog = new QDialog(this);
-    dialog->setWindowTitle("Управление услугами");
-    dialog->resize(500, 300);
+    dialog->setWindowTitle("Тарифы");
+    dialog->resize(600, 350);
 
     QVBoxLayout *layout = new QVBoxLayout(dialog);
 
-    // Таблица услуг
-    QTableWidget *servicesTable = new QTableWidget(dialog);
-    servicesTable->setColumnCount(3);
-    servicesTable->setHorizontalHeaderLabels(QStringList() << "Услуга" << "Цена" << "Описание");
-
-    QSqlQuery query("SELECT service_name, price, description FROM services");
-    int row = 0;
-    while (query.next()) {
-        servicesTable->insertRow(row);
-        for (int col = 0; col < 3; col++) {
-            servicesTable->setItem(row, col, new QTableWidgetItem(query.value(col).toString()));
+    QLabel *hint = new QLabel("Тариф для комнаты важнее тарифа для типа; из пересекающихся "
+                              "действует добавленный позже. Без тарифа - базовая цена комнаты.", dialog);
+    hint->setWordWrap(true);
+    layout->addWidget(hint);
+
+    QTableWidget *ratesTable = new QTableWidget(dialog);
+    ratesTable->setColumnCount(4);
+    ratesTable->setHorizontalHeaderLabels(QStringList() << "Для" << "С" << "По" << "Цена за ночь");
+    ratesTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    ratesTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ratesTable->horizontalHeader()->setStretchLastSection(true);
+    layout->addWidget(ratesTable);
+
+    auto fillTable = [this, ratesTable]() {
+        const QVector<RateTable::Rule> &rules = rateTable.rules();
+        ratesTable->setRowCount(rules.size());
+        for (int row = 0; row < rules.size(); row++) {
+            const RateTable::Rule &rule = rules[row];
+            QTableWidgetItem *target = new QTableWidgetItem(
+                rule.roomNumber > 0 ? QString("Комната %1").arg(rule.roomNumber) : "Тип: " + rule.roomType);
+            target->setData(Qt::UserRole, rule.id);
+            ratesTable->setItem(row, 0, target);
+            ratesTable->setItem(row, 1, new QTableWidgetItem(QDate::fromJulianDay(rule.fromDay).toString("dd.MM.yyyy")));
+            ratesTable->setItem(row, 2, new QTableWidgetItem(QDate::fromJulianDay(rule.toDay).toString("dd.MM.yyyy")));
+            ratesTable->setItem(row, 3, new QTableWidgetItem(QString::number(rule.price, 'f', 2)));
         }
-        row++;
-    }
-
-    layout->addWidget(servicesTable);
+    };
+    fillTable();
 
-    // Кнопки
     QHBoxLayout *buttonLayout = new QHBoxLayout();
 
-    QPushButton *addButton = new QPushButton("Добавить услугу", dialog);
-    connect(addButton, &QPushButton::clicked, dialog, [dialog, servicesTable]() {
-        bool ok;
-        QString name = QInputDialog::getText(dialog, "Добавить услугу",
-                                           "Название услуги:", QLineEdit::Normal, "", &ok);
-        if (!ok || name.isEmpty()) return;
+    QPushButton *addButton = new QPushButton("Добавить тариф", dialog);
+    connect(addButton, &QPushButton::clicked, dialog, [this, dialog, fillTable]() {
+        QDialog ruleDialog(dialog);
+        ruleDialog.setWindowTitle("Новый тариф");
 
-        double price = QInputDialog::getDouble(dialog, "Цена",
-                                              "Цена услуги:", 0, 0, 100000, 2, &ok);
-        if (!ok) return;
+        QFormLayout *form = new QFormLayout();
 
-        QString description = QInputDialog::getText(dialog, "Описание",
-                                                  "Описание услуги:", QLineEdit::Normal, "", &ok);
-        if (!ok) return;
+        QComboBox *targetCombo = new QComboBox(&ruleDialog);
+        for (const QString &type : roomIndex.types()) {
+            targetCombo->addItem("Тип: " + type, type);
+        }
+        targetCombo->addItem("Отдельная комната", QString());
+        form->addRow("Для:", targetCombo);
+
+        QSpinBox *roomSpin = new QSpinBox(&ruleDialog);
+        roomSpin->setRange(1, 999);
+        roomSpin->setEnabled(targetCombo->count() == 1);
+        form->addRow("Комната:", roomSpin);
+        connect(targetCombo, &QComboBox::currentIndexChanged, roomSpin, [targetCombo, roomSpin]() {
+            roomSpin->setEnabled(targetCombo->currentData().toString().isEmpty());
+        });
+
+        QDateEdit *fromEdit = new QDateEdit(startDate, &ruleDialog);
+        fromEdit->setCalendarPopup(true);
+        form->addRow("С (первая ночь):", fromEdit);
+
+        QDateEdit *toEdit = new QDateEdit(startDate.addDays(6), &ruleDialog);
+        toEdit->setCalendarPopup(true);
+        form->addRow("По (последняя ночь):", toEdit);
+
+        QDoubleSpinBox *priceSpin = new QDoubleSpinBox(&ruleDialog);
+        priceSpin->setRange(0.0, 1000000.0);
+        priceSpin->setDecimals(2);
+        priceSpin->setValue(3000.0);
+        form->addRow("Цена за ночь:", priceSpin);
+
+        QVBoxLayout *ruleLayout = new QVBoxLayout(&ruleDialog);
+        ruleLayout->addLayout(form);
+
+        QHBoxLayout *ruleButtons = new QHBoxLayout();
+        QPushButton *okButton = new QPushButton("OK", &ruleDialog);
+        QPushButton *cancelButton = new QPushButton("Отмена", &ruleDialog);
+        ruleButtons->addWidget(okButton);
+        ruleButtons->addWidget(cancelButton);
+        ruleLayout->addLayout(ruleButtons);
+
+        connect(okButton, &QPushButton::clicked, &ruleDialog, &QDialog::accept);
+        connect(cancelButton, &QPushButton::clicked, &ruleDialog, &QDialog::reject);
+
+        if (ruleDialog.exec() != QDialog::Accepted) return;
+
+        if (toEdit->date() < fromEdit->date()) {
+            QMessageBox::warning(dialog, "Ошибка", "Последняя ночь раньше первой");
+            return;
+        }
 
-        QSqlQuery query;
-        query.prepare("INSERT INTO services (service_name, price, description) "
-                     "VALUES (?, ?, ?)");
-        query.addBindValue(name);
-        query.addBindValue(price);
-        query.addBindValue(description);
+        RateTable::Rule rule;
+        rule.roomType = targetCombo->currentData().toString();
+        if (rule.roomType.isEmpty()) {
+            rule.roomNumber = roomSpin->value();
+            if (!roomIndex.find(rule.roomNumber)) {
+                QMessageBox::warning(dialog, "Ошибка", QString("Комнаты %1 нет").arg(rule.roomNumber));
+                return;
+            }
+        }
+        rule.fromDay = fromEdit->date().toJulianDay();
+        rule.toDay = toEdit->date().toJulianDay();
+        rule.price = priceSpin->value();
 
-        if (query.exec()) {
-            int row = servicesTable->rowCount();
-            servicesTable->insertRow(row);
-            servicesTable->setItem(row, 0, new QTableWidgetItem(name));
-            servicesTable->setItem(row, 1, new QTableWidgetItem(QString::number(price)));
-            servicesTable->setItem(row, 2, new QTableWidgetItem(description));
+        QString error;
+        if (!RateTable::addRule(db, rule, &error)) {
+            QMessageBox::warning(dialog, "Ошибка", "Не удалось добавить тариф: " + error);
+            return;
+        }
+        reloadRates();
+        fillTable();
+    });
+
+    QPushButton *removeButton = new QPushButton("Удалить тариф", dialog);
+    connect(removeButton, &QPushButton::clicked, dialog, [this, dialog, ratesTable, fillTable]() {
+        int row = ratesTable->currentRow();
+        if (row < 0) return;
+
+        QString error;
+        if (!RateTable::removeRule(db, ratesTable->item(row, 0)->data(Qt::UserRole).toLongLong(), &error)) {
+            QMessageBox::warning(dialog, "Ошибка", "Не удалось удалить тариф: " + error);
+            return;
         }
+        reloadRates();
+        fillTable();
     });
 
     QPushButton *closeButton = new QPushButton("Закрыть", dialog);
     connect(closeButton, &QPushButton::clicked, dialog, &QDialog::close);
 
     buttonLayout->addWidget(addButton);
+    buttonLayout->addWidget(removeButton);
     buttonLayout->addStretch();
     buttonLayout->addWidget(closeButton);
 
@@ -846,236 +2788,266 @@ void HotelManager::manageServices()
     dialog->exec();
 }
 
-void HotelManager::viewReports()
+void HotelManager::quoteStay()
 {
-    QDialog *dialog = new QDialog(this);
-    dialog->setWindowTitle("Отчеты и обзор");
-    dialog->resize(400, 300);
+    QDialog dialog(this);
+    dialog.setWindowTitle("Расчет стоимости");
+    dialog.resize(450, 450);
 
-    QVBoxLayout *layout = new QVBoxLayout(dialog);
+    QFormLayout *form = new QFormLayout();
 
-    QTextEdit *reportText = new QTextEdit(dialog);
-    reportText->setReadOnly(true);
+    QDateEdit *checkInEdit = new QDateEdit(startDate, &dialog);
+    checkInEdit->setCalendarPopup(true);
+    form->addRow("Заезд:", checkInEdit);
 
-    // Генерируем отчет
-    QString report;
-    report += "<h2>Отчет по отелю</h2>";
-    report += "<h3>Статистика на " + QDate::currentDate().toString("dd.MM.yyyy") + "</h3>";
+    QSpinBox *nightsSpin = new QSpinBox(&dialog);
+    nightsSpin->setRange(1, 366);
+    nightsSpin->setValue(1);
+    form->addRow("Ночей:", nightsSpin);
 
-    // Общее количество комнат
-    QSqlQuery roomQuery("SELECT COUNT(*) FROM rooms");
-    if (roomQuery.next()) {
-        report += "<p><b>Всего комнат:</b> " + roomQuery.value(0).toString() + "</p>";
+    QComboBox *typeCombo = new QComboBox(&dialog);
+    typeCombo->addItem("Любой тип", QString());
+    for (const QString &type : roomIndex.types()) {
+        typeCombo->addItem(type, type);
     }
+    form->addRow("Тип комнаты:", typeCombo);
 
-    // Занятость на сегодня
-    QSqlQuery occupancyQuery;
-    occupancyQuery.prepare("SELECT COUNT(DISTINCT room_number) FROM bookings WHERE booking_date = ?");
-    occupancyQuery.addBindValue(QDate::currentDate().toString("yyyy-MM-dd"));
-
-    if (occupancyQuery.exec() && occupancyQuery.next()) {
-        int occupiedToday = occupancyQuery.value(0).toInt();
-
-        // Повторно выполняем запрос для получения общего количества комнат
-        roomQuery.exec("SELECT COUNT(*) FROM rooms");
-        int totalRooms = 0;
-        if (roomQuery.next()) {
-            totalRooms = roomQuery.value(0).toInt();
-        }
-
-        double occupancyRate = totalRooms > 0 ? (occupiedToday * 100.0 / totalRooms) : 0;
-
-        report += "<p><b>Занято сегодня:</b> " + QString::number(occupiedToday) + " из " +
-                 QString::number(totalRooms) + " (" + QString::number(occupancyRate, 'f', 1) + "%)</p>";
-    }
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    layout->addLayout(form);
 
-    // Предстоящие бронирования
-    report += "<h3>Предстоящие бронирования (7 дней)</h3>";
+    QTextEdit *resultText = new QTextEdit(&dialog);
+    resultText->setReadOnly(true);
+    layout->addWidget(resultText);
 
-    QSqlQuery upcomingQuery;
-    upcomingQuery.prepare("SELECT room_number, booking_date FROM bookings "
-                         "WHERE booking_date BETWEEN ? AND ? "
-                         "ORDER BY booking_date, room_number");
-    QDate today = QDate::currentDate();
-    upcomingQuery.addBindValue(today.toString("yyyy-MM-dd"));
-    upcomingQuery.addBindValue(today.addDays(7).toString("yyyy-MM-dd"));
-
-    if (upcomingQuery.exec()) {
-        QMap<QDate, QStringList> bookingsByDate;
-        while (upcomingQuery.next()) {
-            QDate date = upcomingQuery.value(1).toDate();
-            int room = upcomingQuery.value(0).toInt();
-            bookingsByDate[date].append(QString::number(room));
-        }
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    QPushButton *quoteButton = new QPushButton("Рассчитать", &dialog);
+    QPushButton *closeButton = new QPushButton("Закрыть", &dialog);
+    buttonLayout->addWidget(quoteButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+    layout->addLayout(buttonLayout);
 
-        if (bookingsByDate.isEmpty()) {
-            report += "<p>Нет предстоящих бронирований на ближайшие 7 дней</p>";
-        } else {
-            for (auto it = bookingsByDate.begin(); it != bookingsByDate.end(); ++it) {
-                report += "<p><b>" + it.key().toString("dd.MM") + ":</b> " +
-                         it.value().join(", ") + "</p>";
+    connect(closeButton, &QPushButton::clicked, &dialog, &QDialog::accept);
+    connect(quoteButton, &QPushButton::clicked, &dialog, [this, checkInEdit, nightsSpin, typeCombo, resultText]() {
+        qint64 fromDay = checkInEdit->date().toJulianDay();
+        qint64 toDay = fromDay + nightsSpin->value();
+
+        // Свободные комнаты - по снимку кэша, цены - из массивов тарифов; БД не нужна
+        QElapsedTimer timer;
+        timer.start();
+        QVector<RateTable::Quote> quotes = rateTable.quoteFree(roomIndex, *occupancyCache.snapshot(),
+                                                               fromDay, toDay, typeCombo->currentData().toString());
+        double elapsedMs = timer.nsecsElapsed() / 1e6;
+
+        QString html = QString("<p>Свободно комнат: <b>%1</b> (расчет %2 мс)</p>")
+                           .arg(quotes.size())
+                           .arg(elapsedMs, 0, 'f', 2);
+        if (!quotes.isEmpty()) {
+            html += "<table cellpadding='3'><tr><th>Комната</th><th>Тип</th><th>Итого</th><th>За ночь</th></tr>";
+            for (int i = 0; i < quotes.size() && i < 100; i++) {
+                const RoomInfo *room = roomIndex.find(quotes[i].roomNumber);
+                html += QString("<tr><td>%1</td><td>%2</td><td align='right'>%3</td><td align='right'>%4</td></tr>")
+                            .arg(quotes[i].roomNumber)
+                            .arg(room ? room->type.toHtmlEscaped() : QString())
+                            .arg(quotes[i].total, 0, 'f', 2)
+                            .arg(quotes[i].total / nightsSpin->value(), 0, 'f', 2);
+            }
+            html += "</table>";
+            if (quotes.size() > 100) {
+                html += QString("<p>... и еще %1</p>").arg(quotes.size() - 100);
             }
         }
-    }
-
-    reportText->setHtml(report);
-    layout->addWidget(reportText);
-
-    QPushButton *closeButton = new QPushButton("Закрыть", dialog);
-    connect(closeButton, &QPushButton::clicked, dialog, &QDialog::close);
+        resultText->setHtml(html);
+    });
 
-    layout->addWidget(closeButton);
-    dialog->setLayout(layout);
-    dialog->exec();
+    dialog.exec();
 }
 
-void HotelManager::addBooking()
+void HotelManager::removeBooking()
 {
-    QModelIndexList selected = ui->tableWidget->selectionModel()->selectedIndexes();
-    if (selected.isEmpty()) {
-        QMessageBox::information(this, "Бронирование",
-            "Выберите ячейку в таблице для бронирования");
-        return;
-    }
+    editSelectedCells(false);
+}
 
-    QModelIndex index = selected.first();
-    int row = index.row();
-    int col = index.column();
+void HotelManager::performRefresh(const RefreshScheduler::Region &region)
+{
+    RefreshScheduler::Parts parts = region.parts;
 
-    if (col == 0) return; // Нельзя забронировать столбец с номерами
+    if (parts & RefreshScheduler::Layout) {
+        layoutRoomRows();
+        parts |= RefreshScheduler::AllCells;
+    }
 
-    // Получаем номер комнаты
-    QString roomText = ui->tableWidget->item(row, 0)->text();
-    int roomNumber = 0;
-    QRegularExpression re("Комната\\s+(\\d+)");
-    QRegularExpressionMatch match = re.match(roomText);
-    if (match.hasMatch()) {
-        roomNumber = match.captured(1).toInt();
+    if (parts & RefreshScheduler::Window) {
+        yearOverview->setWindow(startDate, ui->tableWidget->columnCount() - 1);
+        loadArchivedOccupancy();
+
+        // Пересекающиеся дни уже в сетке - сдвигаем их вместо полной перерисовки
+        qint64 shift = gridStartDate.isValid() ? gridStartDate.daysTo(startDate) : 0;
+        if (shift != 0 && qAbs(shift) < ui->tableWidget->columnCount() - 1 &&
+            !(parts & RefreshScheduler::AllCells)) {
+            shiftDayColumns(int(shift));
+        } else if (shift != 0 || !gridStartDate.isValid()) {
+            parts |= RefreshScheduler::AllCells;
+        }
     }
 
-    // Получаем дату
-    QDate cellDate = startDate.addDays(col - 1);
+    if (parts & RefreshScheduler::AllCells) {
+        updateTableHeaders();
+        return;
+    }
 
-    // Сохраняем в БД
-    saveOccupancyToDB(roomNumber, cellDate, true);
+    if (parts & RefreshScheduler::Headers) {
+        updateDateHeaders();
+    }
+    if (region.cells.isEmpty()) return;
 
-    // Обновляем отображение
-    updateTableHeaders();
+    // Только изменившиеся ночи видимого окна
+    QHash<int, int> rowOfRoom;
+    rowOfRoom.reserve(visibleRooms.size());
+    for (int row = 0; row < visibleRooms.size(); row++) {
+        rowOfRoom.insert(visibleRooms[row], row);
+    }
 
-    QMessageBox::information(this, "Успех",
-        QString("Комната %1 забронирована на %2").arg(roomNumber).arg(cellDate.toString("dd.MM.yyyy")));
+    const qint64 firstDay = startDate.toJulianDay();
+    const qint64 lastDay = firstDay + ui->tableWidget->columnCount() - 2;
+    SharedOccupancy::Snapshot occupancy = occupancyCache.snapshot();
+    for (auto it = region.cells.cbegin(); it != region.cells.cend(); ++it) {
+        int row = rowOfRoom.value(it.key(), -1);
+        if (row < 0) continue;
+        for (qint64 day = qMax(it->first, firstDay); day <= qMin(it->second, lastDay); day++) {
+            fillCell(row, int(day - firstDay) + 1, *occupancy);
+        }
+    }
 }
 
-void HotelManager::removeBooking()
+void HotelManager::updateTableHeaders()
 {
-    QModelIndexList selected = ui->tableWidget->selectionModel()->selectedIndexes();
-    if (selected.isEmpty()) {
-        QMessageBox::information(this, "Снять бронь",
-            "Выберите занятую ячейку для снятия брони");
-        return;
-    }
-
-    QModelIndex index = selected.first();
-    int row = index.row();
-    int col = index.column();
-
-    if (col == 0) return;
+    // Ожидаемая загрузка в заголовках; сами ячейки - по одному снимку кэша на всю сетку
+    updateDateHeaders();
 
-    // Получаем номер комнаты
-    QString roomText = ui->tableWidget->item(row, 0)->text();
-    int roomNumber = 0;
-    QRegularExpression re("Комната\\s+(\\d+)");
-    QRegularExpressionMatch match = re.match(roomText);
-    if (match.hasMatch()) {
-        roomNumber = match.captured(1).toInt();
+    SharedOccupancy::Snapshot occupancy = occupancyCache.snapshot();
+    for (int col = 1; col < ui->tableWidget->columnCount(); col++) {
+        fillDayColumn(col, *occupancy);
     }
+    gridStartDate = startDate;
 
-    // Получаем дату
-    QDate cellDate = startDate.addDays(col - 1);
-
-    // Удаляем из БД
-    saveOccupancyToDB(roomNumber, cellDate, false);
+    // Настройка ширины столбцов
+    ui->tableWidget->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
+    for (int i = 1; i < ui->tableWidget->columnCount(); i++) {
+        ui->tableWidget->horizontalHeader()->setSectionResizeMode(i, QHeaderView::Fixed);
+        ui->tableWidget->horizontalHeader()->resizeSection(i, 80);
+    }
 
-    // Обновляем отображение
-    updateTableHeaders();
+    // Делаем первую колонку (номера) нередактируемой
+    for (int row = 0; row < ui->tableWidget->rowCount(); row++) {
+        if (ui->tableWidget->item(row, 0)) {
+            ui->tableWidget->item(row, 0)->setFlags(ui->tableWidget->item(row, 0)->flags() & ~Qt::ItemIsEditable);
+        }
+    }
 
-    QMessageBox::information(this, "Успех",
-        QString("Бронь комнаты %1 на %2 снята").arg(roomNumber).arg(cellDate.toString("dd.MM.yyyy")));
+    // Устанавливаем высоту строк
+    ui->tableWidget->verticalHeader()->setDefaultSectionSize(30);
 }
 
-void HotelManager::updateTableHeaders()
+void HotelManager::shiftDayColumns(int days)
 {
-    // Очищаем все ячейки кроме первой колонки
-    for (int row = 0; row < ui->tableWidget->rowCount(); row++) {
-        for (int col = 1; col < ui->tableWidget->columnCount(); col++) {
-            if (ui->tableWidget->item(row, col)) {
-                delete ui->tableWidget->item(row, col);
-            }
+    // Сдвиг на день-другой: столбцы пересекающихся дней переезжают вместе с ячейками,
+    // заново заполняются только открывшиеся дни
+    const int dayColumns = ui->tableWidget->columnCount() - 1;
+    const int shift = qAbs(days);
+
+    for (int i = 0; i < shift; i++) {
+        if (days > 0) {
+            ui->tableWidget->removeColumn(1);
+            ui->tableWidget->insertColumn(ui->tableWidget->columnCount());
+        } else {
+            ui->tableWidget->removeColumn(ui->tableWidget->columnCount() - 1);
+            ui->tableWidget->insertColumn(1);
         }
     }
 
+    updateDateHeaders();
+
+    SharedOccupancy::Snapshot occupancy = occupancyCache.snapshot();
+    int firstNew = days > 0 ? dayColumns - shift + 1 : 1;
+    for (int col = firstNew; col < firstNew + shift; col++) {
+        fillDayColumn(col, *occupancy);
+        ui->tableWidget->horizontalHeader()->setSectionResizeMode(col, QHeaderView::Fixed);
+        ui->tableWidget->horizontalHeader()->resizeSection(col, 80);
+    }
+    gridStartDate = startDate;
+}
+
+void HotelManager::updateDateHeaders()
+{
     // Устанавливаем заголовки для колонок с датами
     QStringList headers;
     headers << "Комнаты";
 
+    // Ожидаемая загрузка - в заголовке дня, если он в окне прогноза
+    advanceForecast();
+    QHash<qint64, OccupancyForecast::Day> forecastDays;
+    for (const OccupancyForecast::Day &day : forecast.forecast(startDate.toJulianDay(), 30)) {
+        forecastDays.insert(day.day, day);
+    }
+
     for (int i = 0; i < 30; i++) {
         QDate currentDate = startDate.addDays(i);
-        headers << currentDate.toString("dd.MM\nyyyy");
+        QString header = currentDate.toString("dd.MM\nyyyy");
+        auto it = forecastDays.constFind(currentDate.toJulianDay());
+        if (it != forecastDays.constEnd()) {
+            header += QString("\n≈%1%").arg(qRound(it->expectedRate() * 100));
+        }
+        headers << header;
     }
 
     ui->tableWidget->setHorizontalHeaderLabels(headers);
 
-    // Заполняем таблицу данными о занятости
+    for (int i = 0; i < 30; i++) {
+        auto it = forecastDays.constFind(startDate.addDays(i).toJulianDay());
+        if (it == forecastDays.constEnd()) continue;
+        ui->tableWidget->horizontalHeaderItem(i + 1)->setToolTip(
+            QString("Забронировано: %1 из %2\nПрогноз: %3 (%4%)")
+                .arg(it->onBooks)
+                .arg(it->rooms)
+                .arg(it->expected, 0, 'f', 1)
+                .arg(it->expectedRate() * 100, 0, 'f', 1));
+    }
+}
+
+void HotelManager::fillDayColumn(int col, const OccupancyStore &occupancy)
+{
     for (int row = 0; row < ui->tableWidget->rowCount(); row++) {
-        // Получаем номер комнаты из первой колонки
-        QString roomText = ui->tableWidget->item(row, 0)->text();
-        int roomNumber = 0;
-        QRegularExpression re("Комната\\s+(\\d+)");
-        QRegularExpressionMatch match = re.match(roomText);
-        if (match.hasMatch()) {
-            roomNumber = match.captured(1).toInt();
-        }
+        fillCell(row, col, occupancy);
+    }
+}
 
-        for (int col = 1; col < ui->tableWidget->columnCount(); col++) {
-            QDate cellDate = startDate.addDays(col - 1);
-
-            QTableWidgetItem *item = new QTableWidgetItem();
-
-            // Проверяем занятость через кэш/БД
-            if (isRoomOccupied(roomNumber, cellDate)) {
-                item->setBackground(QBrush(QColor(144, 238, 144))); // светло-зеленый
-                item->setText("Занят");
-                item->setToolTip(QString("Комната %1 занята на %2")
-                    .arg(roomNumber)
-                    .arg(cellDate.toString("dd.MM.yyyy")));
-            } else {
-                item->setBackground(QBrush(QColor(255, 255, 255))); // белый
-                item->setText("Свободен");
-                item->setToolTip(QString("Комната %1 свободна на %2")
-                    .arg(roomNumber)
-                    .arg(cellDate.toString("dd.MM.yyyy")));
-            }
+void HotelManager::fillCell(int row, int col, const OccupancyStore &occupancy)
+{
+    QDate cellDate = startDate.addDays(col - 1);
 
-            item->setTextAlignment(Qt::AlignCenter);
-            item->setFlags(item->flags() & ~Qt::ItemIsEditable); // Не редактируемая
-            ui->tableWidget->setItem(row, col, item);
-        }
-    }
+    // Номер комнаты строки берем из текущей раскладки, а не из текста ячейки
+    int roomNumber = roomNumberAtRow(row);
 
-    // Настройка ширины столбцов
-    ui->tableWidget->horizontalHeader()->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    for (int i = 1; i < ui->tableWidget->columnCount(); i++) {
-        ui->tableWidget->horizontalHeader()->setSectionResizeMode(i, QHeaderView::Fixed);
-        ui->tableWidget->horizontalHeader()->resizeSection(i, 80);
-    }
+    QTableWidgetItem *item = new QTableWidgetItem();
 
-    // Делаем первую колонку (номера) нередактируемой
-    for (int row = 0; row < ui->tableWidget->rowCount(); row++) {
-        if (ui->tableWidget->item(row, 0)) {
-            ui->tableWidget->item(row, 0)->setFlags(ui->tableWidget->item(row, 0)->flags() & ~Qt::ItemIsEditable);
-        }
+    // Проверяем занятость через кэш
+    if (occupancy.isOccupied(roomNumber, cellDate)) {
+        item->setBackground(QBrush(QColor(144, 238, 144))); // светло-зеленый
+        item->setText("Занят");
+        item->setToolTip(QString("Комната %1 занята на %2")
+            .arg(roomNumber)
+            .arg(cellDate.toString("dd.MM.yyyy")));
+    } else {
+        item->setBackground(QBrush(QColor(255, 255, 255))); // белый
+        item->setText("Свободен");
+        item->setToolTip(QString("Комната %1 свободна на %2")
+            .arg(roomNumber)
+            .arg(cellDate.toString("dd.MM.yyyy")));
     }
 
-    // Устанавливаем высоту строк
-    ui->tableWidget->verticalHeader()->setDefaultSectionSize(30);
+    item->setTextAlignment(Qt::AlignCenter);
+    item->setFlags(item->flags() & ~Qt::ItemIsEditable); // Не редактируемая
+    // setItem заменяет и удаляет прежнюю ячейку
+    ui->tableWidget->setItem(row, col, item);
 }
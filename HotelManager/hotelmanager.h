@@ -12,11 +12,34 @@
 #include <QSet>
 #include <QPair>
 
+#include "sqltracer.h"
+#include "sharedoccupancy.h"
+#include "availabilitycache.h"
+#include "bookingwritequeue.h"
+#include "editcommands.h"
+#include "occupancyforecast.h"
+#include "occupancyhistory.h"
+#include "operationtrace.h"
+#include "reportgenerator.h"
+#include "ratetable.h"
+#include "refreshscheduler.h"
+#include "roomindex.h"
+
+class ApiServer;
+class BookingArchiver;
+class PropertyManager;
+class QDockWidget;
+class QMenu;
+class QTimer;
+template <typename T> class QFutureWatcher;
+class QUndoStack;
+class YearOverview;
+
 QT_BEGIN_NAMESPACE
 namespace Ui { class HotelManager; }
 QT_END_NAMESPACE
 
-class HotelManager : public QMainWindow
+class HotelManager : public QMainWindow, private EditTarget
 {
     Q_OBJECT
 
@@ -24,33 +47,139 @@ public:
     HotelManager(QWidget *parent = nullptr);
     ~HotelManager();
 
+    // Повторяет действие из трассы так же, как его выполняет интерфейс, но без диалогов
+    // (tools/tracereplay). Отчет строится синхронно
+    bool replay(const OperationTrace::Operation &operation, QString *error = nullptr);
+
 private slots:
     void onDateChanged();
     void onTableClicked(const QModelIndex &index);
     void addBooking();
+    void addGroupBooking();
+    void manageRates();
+    void quoteStay();
     void removeBooking();
     void addRoom();
     void deleteRoom();
+    void importFromCsv();
+    void configureArchive();
     void manageClients();
     void manageServices();
     void viewReports();
+    void exportBookings();
+    void showSqlProfile();
+    void applyRoomFilter();
+    void switchProperty(int index);
+    void addProperty();
+    void viewGroupReport();
+    void toggleApiServer(bool enabled);
+    void toggleWriteBehind(bool enabled);
+    void toggleTrace(bool enabled);
+    void showOverviewCell(int roomNumber, const QDate &date);
 
 private:
     void initDatabase();
+    void initSchema(QSqlDatabase database);
+    void rebuildPropertyMenu();
+    void watchArchiver(int index);
+    void activateProperty();
+    void startWriteQueue();
+    void stopWriteQueue();
+    void flushPendingWrites();
+    void startTrace();
+    void flushBookingEdits();
+    bool writeBookingStates(const QVector<BookingState> &states, QString *error);
+    void recordBookingStates(const QVector<BookingState> &states);
+    void reloadAfterImport();
+    void editSelectedCells(bool occupied);
+    QVector<BookingCommand::Change> bookingChanges(const QVector<OperationTrace::Cell> &cells, bool occupied) const;
+    bool pushDeleteRoom(int roomNumber, QString *error);
+    ReportGenerator::DataVersion reportVersion(const QDate &from, const QDate &to) const;
+    ReportGenerator::Request reportRequest(const QDate &from, const QDate &to) const;
+    void refreshGrid();
+    void reportWriteConflicts(const QVector<BookingWriteQueue::Conflict> &conflicts);
     void initMenuBar();
     void updateTableHeaders();
+    void updateDateHeaders();
+    void shiftDayColumns(int days);
+    void fillDayColumn(int col, const OccupancyStore &occupancy);
+    void fillCell(int row, int col, const OccupancyStore &occupancy);
+    void performRefresh(const RefreshScheduler::Region &region);
     void loadOccupancyFromDB();
+    void loadArchivedHistory();
+    void loadArchivedOccupancy();
+    bool dropArchivedNights(OccupancyStore &store, qint64 keepFrom, qint64 keepTo) const;
     void loadRoomsFromDB();
-    void saveOccupancyToDB(int roomNumber, const QDate &date, bool occupied);
+    void setRooms(const QVector<RoomInfo> &rooms);
+    void reloadRates();
+    void buildForecast();
+    void advanceForecast();
+    void advanceForecastCurves();
+    void initRoomFilter();
+    void layoutRoomRows();
+    int roomNumberAtRow(int row) const;
+
+    // EditTarget: сюда приходят команды стека отмены
+    void applyBookingStates(const QVector<BookingState> &states) override;
+    bool insertRoom(const RoomInfo &room, const QVector<qint64> &bookedDays) override;
+    bool removeRoom(int roomNumber) override;
+
     bool isRoomOccupied(int roomNumber, const QDate &date);
     bool isValidRoomName(const QString &name);
     QString getRoomNameFromUser(const QString &title, const QString &label, const QString &defaultValue = "");
 
     Ui::HotelManager *ui;
     QDate startDate;
+    // Первый день, для которого сейчас заполнена сетка (невалиден, пока она не построена)
+    QDate gridStartDate;
+    // Перерисовки сетки копятся и выполняются одним проходом; до чтения сетки - flush()
+    RefreshScheduler *refreshScheduler;
+    // Отели группы; db и archiver указывают на активный
+    PropertyManager *properties;
     QSqlDatabase db;
+    BookingArchiver *archiver;
+    QMenu *propertyMenu;
+    QAction *apiAction;
+    ApiServer *apiServer;
+    QAction *writeBehindAction;
+    // Отложенная запись бронирований активного отеля; nullptr - запись сразу в БД
+    BookingWriteQueue *writeQueue;
+    QAction *traceAction;
+    // Запись действий в трассу (trace/enabled); файл меняется вместе с активным отелем
+    OperationTrace trace;
+
+    // Стек отмены правок активного отеля
+    QUndoStack *undoStack;
+    // Правки бронирований, еще не записанные в БД; уходят одной транзакцией по таймеру
+    QVector<BookingState> pendingEdits;
+    QTimer *editFlushTimer;
+
+    // Кэш занятости для быстрого доступа; общий с API-сервером
+    SharedOccupancy occupancyCache;
+    // Архив активного отеля, сжатый по сериям ночей; из него кэш дополняется видимым окном в прошлом
+    OccupancyHistory archivedHistory;
+    // Дни [archivedFrom, archivedTo] архива, сейчас добавленные в кэш; пусто, если from > to
+    qint64 archivedFrom;
+    qint64 archivedTo;
+    // Обзор года по кэшу и архиву; панель скрыта, пока ее не откроют из меню
+    QDockWidget *overviewDock;
+    YearOverview *yearOverview;
+    // Готовые ответы о доступности (API), точечно инвалидируются записями в occupancyCache
+    AvailabilityCache availabilityCache;
+    // Прогноз загрузки активного отеля; кривые догрузки строятся в фоне
+    OccupancyForecast forecast;
+    QFutureWatcher<OccupancyForecast::Curves> *forecastWatcher;
+    // Фоновые отчеты и их кэш; roomsVersion и ratesVersion меняются при каждом изменении
+    // списка комнат и тарифов
+    ReportGenerator *reportGenerator;
+    quint64 roomsVersion;
+    quint64 ratesVersion;
+
+    // Комнаты с индексами по атрибутам и номера комнат в строках сетки после фильтра
+    RoomIndex roomIndex;
+    QVector<int> visibleRooms;
 
-    // Кэш занятости для быстрого доступа
-    QMap<QPair<int, QDate>, bool> occupancyCache;
+    // Тарифы активного отеля, скомпилированные в массивы цен по дням
+    RateTable rateTable;
 };
 #endif // HOTELMANAGER_H
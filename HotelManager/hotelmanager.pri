@@ -0,0 +1,70 @@
+# Исходники приложения без main.cpp: общие для HotelManager.pro и инструментов в tools/,
+# которым нужно настоящее окно или загрузчики приложения
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/apiserver.cpp \
+    $$PWD/availabilitycache.cpp \
+    $$PWD/bookingarchiver.cpp \
+    $$PWD/bookingexporter.cpp \
+    $$PWD/bookingwritequeue.cpp \
+    $$PWD/bulkimporter.cpp \
+    $$PWD/connectionpool.cpp \
+    $$PWD/dbmigration.cpp \
+    $$PWD/editcommands.cpp \
+    $$PWD/groupbooking.cpp \
+    $$PWD/hotelmanager.cpp \
+    $$PWD/occupancyforecast.cpp \
+    $$PWD/occupancyhistory.cpp \
+    $$PWD/occupancystore.cpp \
+    $$PWD/operationtrace.cpp \
+    $$PWD/propertymanager.cpp \
+    $$PWD/ratetable.cpp \
+    $$PWD/refreshscheduler.cpp \
+    $$PWD/reportgenerator.cpp \
+    $$PWD/roomindex.cpp \
+    $$PWD/sharedoccupancy.cpp \
+    $$PWD/sqlitefastpath.cpp \
+    $$PWD/sqltracer.cpp \
+    $$PWD/validation.cpp \
+    $$PWD/yearoverview.cpp
+
+HEADERS += \
+    $$PWD/apiserver.h \
+    $$PWD/appsettings.h \
+    $$PWD/availabilitycache.h \
+    $$PWD/bookingarchiver.h \
+    $$PWD/bookingexporter.h \
+    $$PWD/bookingwritequeue.h \
+    $$PWD/bulkimporter.h \
+    $$PWD/connectionpool.h \
+    $$PWD/dbmigration.h \
+    $$PWD/editcommands.h \
+    $$PWD/groupbooking.h \
+    $$PWD/hotelmanager.h \
+    $$PWD/occupancyforecast.h \
+    $$PWD/occupancyhistory.h \
+    $$PWD/occupancystore.h \
+    $$PWD/operationtrace.h \
+    $$PWD/propertymanager.h \
+    $$PWD/ratetable.h \
+    $$PWD/refreshscheduler.h \
+    $$PWD/reportgenerator.h \
+    $$PWD/roomindex.h \
+    $$PWD/schema.h \
+    $$PWD/sharedoccupancy.h \
+    $$PWD/sqlitefastpath.h \
+    $$PWD/sqltracer.h \
+    $$PWD/validation.h \
+    $$PWD/yearoverview.h
+
+# Быстрая загрузка через sqlite3 напрямую (sqlitefastpath.h): qmake CONFIG+=sqlite_fastpath.
+# Только вместе с Qt, собранным с -system-sqlite: приложение и плагин QSQLITE
+# должны использовать одну и ту же копию библиотеки
+sqlite_fastpath {
+    DEFINES += HOTEL_SQLITE_FASTPATH
+    LIBS += -lsqlite3
+}
+
+FORMS += \
+    $$PWD/hotelmanager.ui
@@ -1,9 +1,61 @@
 #include "hotelmanager.h"
+#include "apiserver.h"
+#include "availabilitycache.h"
+#include "propertymanager.h"
+#include "sharedoccupancy.h"
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+
+namespace
+{
+    // Режим без окна: только API поверх активного отеля.
+    // База должна быть заранее создана и обновлена обычным запуском приложения.
+    int runHeadless(int argc, char *argv[])
+    {
+        QCoreApplication a(argc, argv);
+
+        QCommandLineParser parser;
+        parser.setApplicationDescription("Hotel Manager: локальный JSON API без интерфейса");
+        parser.addHelpOption();
+        parser.addOption(QCommandLineOption("serve", "Запустить API без окна"));
+        parser.addOption(QCommandLineOption("port", "Порт API (по умолчанию из настроек api/port)", "port"));
+        parser.process(a);
+
+        PropertyManager properties;
+        properties.loadSettings();
+        const PropertyManager::Property &property = properties.property(properties.activeIndex());
+
+        PropertySnapshot snapshot = PropertyManager::loadSnapshot(property.databaseFile);
+
+        SharedOccupancy occupancy;
+        occupancy.reset(std::move(snapshot.occupancy));
+
+        AvailabilityCache availabilityCache(occupancy);
+        ApiServer server(occupancy, availabilityCache);
+        server.setRooms(snapshot.rooms);
+        server.setDatabaseFile(property.databaseFile);
+
+        if (!server.start(quint16(parser.value("port").toUInt()))) {
+            qCritical() << "Не удалось запустить API:" << server.errorString();
+            return 1;
+        }
+
+        qInfo() << "Отель" << property.name << "- API на http://127.0.0.1:" << server.serverPort();
+        return a.exec();
+    }
+}
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; i++) {
+        if (qstrcmp(argv[i], "--serve") == 0) {
+            return runHeadless(argc, argv);
+        }
+    }
+
     QApplication a(argc, argv);
     HotelManager w;
     w.show();
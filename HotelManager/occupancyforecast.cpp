@@ -0,0 +1,261 @@
+#include "occupancyforecast.h"
+#include "bookingarchiver.h"
+#include "connectionpool.h"
+#include "sharedoccupancy.h"
+#include "sqltracer.h"
+
+#include <QDate>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QtConcurrent>
+#include <QDebug>
+
+namespace
+{
+    // Размер куска истории для одной задачи пула
+    const int ChunkDays = 91;
+
+    int dayOfWeekIndex(qint64 day)
+    {
+        return QDate::fromJulianDay(day).dayOfWeek() - 1;
+    }
+
+    struct Chunk {
+        QString databaseFile;
+        qint64 fromDay;
+        qint64 toDay;
+    };
+
+    OccupancyForecast::Curves scanChunk(const Chunk &chunk)
+    {
+        OccupancyForecast::Curves curves;
+        curves.fromDay = chunk.fromDay;
+        curves.toDay = chunk.toDay;
+        for (qint64 day = chunk.fromDay; day < chunk.toDay; day++) {
+            curves.nights[dayOfWeekIndex(day)]++;
+        }
+
+        ConnectionPool::Lease connection = ConnectionPool::instance().acquire(chunk.databaseFile);
+        {
+            QSqlDatabase db = connection.database();
+            if (!db.isOpen()) return curves;
+
+            QString source = "bookings";
+            if (BookingArchiver::attachArchive(db, BookingArchiver::archiveFileFor(chunk.databaseFile))) {
+                source = "all_bookings";
+            }
+
+            // Срок бронирования - дни от created_at до ночи; броней без даты создания
+            // или созданных задним числом (импорт) в кривых нет
+            TracedQuery query(db);
+            query.setForwardOnly(true);
+            query.prepare("SELECT booking_date, booking_date - CAST(julianday(date(created_at)) + 0.5 AS INTEGER) AS lead, "
+                          "COUNT(*) FROM " + source + " "
+                          "WHERE booking_date >= ? AND booking_date < ? AND created_at IS NOT NULL "
+                          "GROUP BY booking_date, lead HAVING lead >= 0 AND lead < ?");
+            query.addBindValue(chunk.fromDay);
+            query.addBindValue(chunk.toDay);
+            query.addBindValue(OccupancyForecast::HorizonDays);
+
+            if (!query.exec()) {
+                qDebug() << "Ошибка чтения истории для прогноза: " << query.lastError().text();
+                return curves;
+            }
+
+            while (query.next()) {
+                int dow = dayOfWeekIndex(query.value(0).toLongLong());
+                int lead = query.value(1).toInt();
+                curves.leadHistogram[dow * OccupancyForecast::HorizonDays + lead] += query.value(2).toLongLong();
+            }
+        }
+        return curves;
+    }
+
+    // Первая ночь, по которой есть данные о догрузке (бронь с created_at), в основной таблице
+    // и архиве; toDay, если таких броней нет
+    qint64 firstTrackedNight(const QString &databaseFile, qint64 toDay)
+    {
+        ConnectionPool::Lease connection = ConnectionPool::instance().acquire(databaseFile);
+        QSqlDatabase db = connection.database();
+        if (!db.isOpen()) return toDay;
+
+        QString source = "bookings";
+        if (BookingArchiver::attachArchive(db, BookingArchiver::archiveFileFor(databaseFile))) {
+            source = "all_bookings";
+        }
+
+        TracedQuery query("SELECT MIN(booking_date) FROM " + source + " WHERE created_at IS NOT NULL", db);
+        if (!query.next() || query.value(0).isNull()) return toDay;
+        return query.value(0).toLongLong();
+    }
+}
+
+void OccupancyForecast::Curves::merge(const Curves &other)
+{
+    if (other.isEmpty()) return;
+
+    fromDay = isEmpty() ? other.fromDay : qMin(fromDay, other.fromDay);
+    toDay = qMax(toDay, other.toDay);
+    for (int i = 0; i < 7; i++) {
+        nights[i] += other.nights[i];
+    }
+    for (int i = 0; i < leadHistogram.size(); i++) {
+        leadHistogram[i] += other.leadHistogram[i];
+    }
+}
+
+void OccupancyForecast::Curves::subtract(const Curves &other)
+{
+    if (other.isEmpty()) return;
+
+    for (int i = 0; i < 7; i++) {
+        nights[i] -= other.nights[i];
+    }
+    for (int i = 0; i < leadHistogram.size(); i++) {
+        leadHistogram[i] -= other.leadHistogram[i];
+    }
+}
+
+OccupancyForecast::OccupancyForecast(SharedOccupancy &occupancy)
+    : occupancy(occupancy)
+    , pickup(7 * HorizonDays, 0.0)
+    , onBooks(HorizonDays, 0)
+{
+    listenerId = occupancy.addListener([this](const QVector<OccupancyStore::Change> &changes, quint64) {
+        onChanges(changes);
+    });
+}
+
+OccupancyForecast::~OccupancyForecast()
+{
+    occupancy.removeListener(listenerId);
+}
+
+OccupancyForecast::Curves OccupancyForecast::buildCurves(const QString &databaseFile, qint64 fromDay, qint64 toDay)
+{
+    // Ночи до первой учтенной брони в знаменатель не идут: иначе молодая база,
+    // у которой история короче HistoryDays, занижала бы догрузку
+    fromDay = qMax(fromDay, firstTrackedNight(databaseFile, toDay));
+
+    QVector<Chunk> chunks;
+    for (qint64 day = fromDay; day < toDay; day += ChunkDays) {
+        chunks.append({databaseFile, day, qMin(day + ChunkDays, toDay)});
+    }
+
+    return QtConcurrent::blockingMappedReduced<Curves>(
+        chunks, scanChunk, [](Curves &result, const Curves &chunk) { result.merge(chunk); });
+}
+
+OccupancyForecast::Curves OccupancyForecast::advanceCurves(const QString &databaseFile, Curves curves, qint64 today)
+{
+    // Пустые кривые (в истории еще не было броней) строятся заново за весь период
+    const qint64 keepFrom = today - HistoryDays;
+    if (curves.isEmpty()) {
+        return buildCurves(databaseFile, keepFrom, today);
+    }
+
+    if (curves.toDay < today) {
+        curves.merge(buildCurves(databaseFile, curves.toDay, today));
+    }
+    // Кривые складываются по ночам, поэтому ночи старше окна истории можно просто вычесть
+    if (curves.fromDay < keepFrom) {
+        curves.subtract(buildCurves(databaseFile, curves.fromDay, qMin(keepFrom, curves.toDay)));
+        curves.fromDay = qMin(keepFrom, curves.toDay);
+    }
+    return curves;
+}
+
+void OccupancyForecast::setCurves(const Curves &curves)
+{
+    QMutexLocker locker(&mutex);
+    history = curves;
+    rebuildPickup();
+}
+
+OccupancyForecast::Curves OccupancyForecast::curves() const
+{
+    QMutexLocker locker(&mutex);
+    return history;
+}
+
+void OccupancyForecast::rebuildPickup()
+{
+    // Догрузка за последние L дней - накопленная сумма гистограммы сроков
+    for (int dow = 0; dow < 7; dow++) {
+        double sum = 0.0;
+        for (int lead = 0; lead < HorizonDays; lead++) {
+            sum += history.leadHistogram[dow * HorizonDays + lead];
+            pickup[dow * HorizonDays + lead] = history.nights[dow] > 0 ? sum / history.nights[dow] : 0.0;
+        }
+    }
+}
+
+void OccupancyForecast::setRooms(const QVector<int> &roomNumbers)
+{
+    SharedOccupancy::Snapshot store = occupancy.snapshot();
+
+    QMutexLocker locker(&mutex);
+    rooms = roomNumbers;
+    recount(*store, windowStart, windowStart + HorizonDays);
+}
+
+void OccupancyForecast::setToday(qint64 today)
+{
+    SharedOccupancy::Snapshot store = occupancy.snapshot();
+
+    QMutexLocker locker(&mutex);
+    windowStart = today;
+    recount(*store, windowStart, windowStart + HorizonDays);
+}
+
+qint64 OccupancyForecast::today() const
+{
+    QMutexLocker locker(&mutex);
+    return windowStart;
+}
+
+void OccupancyForecast::recount(const OccupancyStore &store, qint64 fromDay, qint64 toDay)
+{
+    fromDay = qMax(fromDay, windowStart);
+    toDay = qMin(toDay, windowStart + HorizonDays);
+
+    for (qint64 day = fromDay; day < toDay; day++) {
+        int count = 0;
+        for (int room : rooms) {
+            if (store.isOccupied(room, day)) count++;
+        }
+        onBooks[day - windowStart] = count;
+    }
+}
+
+void OccupancyForecast::onChanges(const QVector<OccupancyStore::Change> &changes)
+{
+    // Вызывается под блокировкой писателей, снимок уже опубликован
+    SharedOccupancy::Snapshot store = occupancy.snapshot();
+
+    QMutexLocker locker(&mutex);
+    for (const OccupancyStore::Change &change : changes) {
+        if (change.toDay < windowStart || change.fromDay >= windowStart + HorizonDays) continue;
+        recount(*store, change.fromDay, change.toDay + 1);
+    }
+}
+
+QVector<OccupancyForecast::Day> OccupancyForecast::forecast(qint64 fromDay, int days) const
+{
+    QMutexLocker locker(&mutex);
+
+    QVector<Day> result;
+    qint64 first = qMax(fromDay, windowStart);
+    qint64 last = qMin(fromDay + days, windowStart + HorizonDays);
+    for (qint64 day = first; day < last; day++) {
+        int lead = int(day - windowStart);
+
+        Day entry;
+        entry.day = day;
+        entry.rooms = rooms.size();
+        entry.onBooks = onBooks[lead];
+        entry.expected = qMin(double(entry.rooms), entry.onBooks + pickup[dayOfWeekIndex(day) * HorizonDays + lead]);
+        result.append(entry);
+    }
+    return result;
+}
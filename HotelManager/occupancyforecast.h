@@ -0,0 +1,89 @@
+#ifndef OCCUPANCYFORECAST_H
+#define OCCUPANCYFORECAST_H
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include "occupancystore.h"
+
+class SharedOccupancy;
+
+// Прогноз загрузки на HorizonDays дней вперед: то, что уже забронировано,
+// плюс средняя догрузка из прошлых лет.
+// Кривая догрузки - для дня недели ночи и срока L дней до нее: сколько комнато-ночей
+// в среднем бронировалось за последние L дней (по created_at). Кривые строятся одним
+// параллельным проходом по истории; дальше завершившиеся дни дописываются, а ночи старше
+// HistoryDays вычитаются, так что история не растет.
+// Уже забронированное по дням пересчитывается по изменениям из SharedOccupancy -
+// только в затронутых днях.
+class OccupancyForecast
+{
+public:
+    static const int HorizonDays = 90;
+    static const int HistoryDays = 3 * 365;
+
+    struct Curves {
+        qint64 fromDay = 0;    // история - ночи [fromDay, toDay)
+        qint64 toDay = 0;
+        qint64 nights[7] = {}; // учтено ночей по дням недели
+        // Комнато-ночей, забронированных ровно за lead дней: [dayOfWeek * HorizonDays + lead]
+        QVector<qint64> leadHistogram = QVector<qint64>(7 * HorizonDays, 0);
+
+        bool isEmpty() const { return toDay <= fromDay; }
+        // Прибавляет кривые соседнего периода истории
+        void merge(const Curves &other);
+        // Вычитает кривые начального отрезка истории; начало истории сдвигает вызывающий
+        void subtract(const Curves &other);
+    };
+
+    struct Day {
+        qint64 day = 0;
+        int onBooks = 0;        // уже забронировано
+        double expected = 0.0;  // с учетом ожидаемой догрузки
+        int rooms = 0;
+
+        double onBooksRate() const { return rooms > 0 ? double(onBooks) / rooms : 0.0; }
+        double expectedRate() const { return rooms > 0 ? expected / rooms : 0.0; }
+    };
+
+    explicit OccupancyForecast(SharedOccupancy &occupancy);
+    ~OccupancyForecast();
+
+    // Проход по ночам [fromDay, toDay) основной таблицы и архива: каждый квартал - задача пула
+    // со своим соединением, результаты складываются. Начало сдвигается на первую ночь с
+    // учтенной бронью; если таких нет, кривые пустые. Можно вызывать из любого потока
+    static Curves buildCurves(const QString &databaseFile, qint64 fromDay, qint64 toDay);
+    // Кривые на новый день: дописывает завершившиеся ночи и отрезает историю старше HistoryDays.
+    // Читаются только добавленные и отрезанные ночи; можно вызывать из любого потока
+    static Curves advanceCurves(const QString &databaseFile, Curves curves, qint64 today);
+
+    void setCurves(const Curves &curves);
+    Curves curves() const;
+
+    void setRooms(const QVector<int> &roomNumbers);
+    // Сдвигает окно прогноза на сегодняшний день и пересчитывает его целиком
+    void setToday(qint64 today);
+    qint64 today() const;
+
+    // Прогноз на дни [fromDay, fromDay + days) в пределах окна; остальные дни пропускаются
+    QVector<Day> forecast(qint64 fromDay, int days) const;
+
+private:
+    void recount(const OccupancyStore &store, qint64 fromDay, qint64 toDay);
+    void rebuildPickup();
+    void onChanges(const QVector<OccupancyStore::Change> &changes);
+
+    SharedOccupancy &occupancy;
+    int listenerId;
+
+    mutable QMutex mutex;
+    Curves history;
+    // Средняя догрузка за последние lead дней, включая сам день lead: [dayOfWeek * HorizonDays + lead]
+    QVector<double> pickup;
+    QVector<int> rooms;
+    qint64 windowStart = 0;
+    QVector<int> onBooks;    // по дням окна [windowStart, windowStart + HorizonDays)
+};
+
+#endif // OCCUPANCYFORECAST_H
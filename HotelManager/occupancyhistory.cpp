@@ -0,0 +1,212 @@
+#include "occupancyhistory.h"
+#include "sqltracer.h"
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <algorithm>
+
+bool OccupancyHistory::load(const QSqlDatabase &db, const QString &source, qint64 fromDay, qint64 toDay,
+                            OccupancyHistory *history, QString *error)
+{
+    // По порядку (комната, день) каждая ночь продолжает последнюю серию или начинает новую
+    TracedQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT room_number, booking_date FROM " + source + " "
+                  "WHERE booking_date BETWEEN ? AND ? ORDER BY room_number, booking_date");
+    query.addBindValue(fromDay);
+    query.addBindValue(toDay);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+
+    history->clear();
+    while (query.next()) {
+        history->append(query.value(0).toInt(), query.value(1).toLongLong());
+    }
+    for (Timeline &timeline : history->rooms) {
+        timeline.squeeze();
+    }
+    return true;
+}
+
+int OccupancyHistory::spanFrom(const Timeline &timeline, qint64 day)
+{
+    auto it = std::upper_bound(timeline.cbegin(), timeline.cend(), day, [](qint64 value, const Span &span) {
+        return value < qint64(span.start) + span.length;
+    });
+    return int(it - timeline.cbegin());
+}
+
+qint64 OccupancyHistory::nightsBefore(const Timeline &timeline, qint64 day)
+{
+    int index = spanFrom(timeline, day);
+    qint64 count = index > 0 ? qint64(timeline[index - 1].before) + timeline[index - 1].length : 0;
+    if (index < timeline.size() && timeline[index].start < day) {
+        count += day - timeline[index].start;
+    }
+    return count;
+}
+
+void OccupancyHistory::renumber(Timeline &timeline, int fromIndex)
+{
+    for (int i = qMax(0, fromIndex); i < timeline.size(); i++) {
+        timeline[i].before = i > 0 ? timeline[i - 1].before + timeline[i - 1].length : 0;
+    }
+}
+
+void OccupancyHistory::append(int roomNumber, qint64 day)
+{
+    Timeline &timeline = rooms[roomNumber];
+    if (!timeline.isEmpty()) {
+        Span &last = timeline.last();
+        qint64 end = qint64(last.start) + last.length;
+        if (day == end) {
+            last.length++;
+            return;
+        }
+        if (day < end) {
+            setOccupied(roomNumber, day, true);
+            return;
+        }
+        timeline.append({qint32(day), 1, last.before + last.length});
+        return;
+    }
+    timeline.append({qint32(day), 1, 0});
+}
+
+bool OccupancyHistory::isOccupied(int roomNumber, qint64 day) const
+{
+    auto it = rooms.constFind(roomNumber);
+    if (it == rooms.constEnd()) return false;
+
+    int index = spanFrom(*it, day);
+    return index < it->size() && (*it)[index].start <= day;
+}
+
+void OccupancyHistory::setOccupied(int roomNumber, qint64 day, bool occupied)
+{
+    if (occupied) {
+        Timeline &timeline = rooms[roomNumber];
+        int index = spanFrom(timeline, day);
+        if (index < timeline.size() && timeline[index].start <= day) return;
+
+        // Ночь может продолжить предыдущую серию, начать следующую или склеить их
+        bool joinsPrevious = index > 0 && qint64(timeline[index - 1].start) + timeline[index - 1].length == day;
+        bool joinsNext = index < timeline.size() && timeline[index].start == day + 1;
+        if (joinsPrevious && joinsNext) {
+            timeline[index - 1].length += 1 + timeline[index].length;
+            timeline.remove(index);
+        } else if (joinsPrevious) {
+            timeline[index - 1].length++;
+        } else if (joinsNext) {
+            timeline[index].start--;
+            timeline[index].length++;
+        } else {
+            timeline.insert(index, {qint32(day), 1, 0});
+        }
+        renumber(timeline, index - 1);
+        return;
+    }
+
+    auto it = rooms.find(roomNumber);
+    if (it == rooms.end()) return;
+
+    Timeline &timeline = *it;
+    int index = spanFrom(timeline, day);
+    if (index >= timeline.size() || timeline[index].start > day) return;
+
+    Span &span = timeline[index];
+    qint64 end = qint64(span.start) + span.length;
+    if (span.length == 1) {
+        timeline.remove(index);
+    } else if (day == span.start) {
+        span.start++;
+        span.length--;
+    } else if (day == end - 1) {
+        span.length--;
+    } else {
+        // Ночь в середине серии делит ее на две
+        Span tail = {qint32(day + 1), qint32(end - day - 1), 0};
+        span.length = qint32(day - span.start);
+        timeline.insert(index + 1, tail);
+    }
+    renumber(timeline, index);
+
+    if (timeline.isEmpty()) {
+        rooms.erase(it);
+    }
+}
+
+int OccupancyHistory::countOccupied(int roomNumber, qint64 fromDay, qint64 toDay) const
+{
+    auto it = rooms.constFind(roomNumber);
+    if (it == rooms.constEnd() || toDay < fromDay) return 0;
+
+    return int(nightsBefore(*it, toDay + 1) - nightsBefore(*it, fromDay));
+}
+
+QVector<OccupancyHistory::Run> OccupancyHistory::runs(int roomNumber, qint64 fromDay, qint64 toDay) const
+{
+    QVector<Run> result;
+    auto it = rooms.constFind(roomNumber);
+    if (it == rooms.constEnd()) return result;
+
+    const Timeline &timeline = *it;
+    for (int i = spanFrom(timeline, fromDay); i < timeline.size() && timeline[i].start <= toDay; i++) {
+        qint64 start = qMax<qint64>(timeline[i].start, fromDay);
+        qint64 end = qMin<qint64>(qint64(timeline[i].start) + timeline[i].length, toDay + 1);
+        result.append({start, int(end - start)});
+    }
+    return result;
+}
+
+QVector<int> OccupancyHistory::occupiedPerDay(qint64 fromDay, qint64 toDay) const
+{
+    if (toDay < fromDay) return QVector<int>();
+
+    // Разностный массив: +1 в начале серии, -1 после ее конца
+    const int days = int(toDay - fromDay + 1);
+    QVector<int> counts(days + 1, 0);
+    for (const Timeline &timeline : rooms) {
+        for (int i = spanFrom(timeline, fromDay); i < timeline.size() && timeline[i].start <= toDay; i++) {
+            qint64 start = qMax<qint64>(timeline[i].start, fromDay);
+            qint64 end = qMin<qint64>(qint64(timeline[i].start) + timeline[i].length, toDay + 1);
+            counts[int(start - fromDay)]++;
+            counts[int(end - fromDay)]--;
+        }
+    }
+
+    for (int i = 1; i < days; i++) {
+        counts[i] += counts[i - 1];
+    }
+    counts.resize(days);
+    return counts;
+}
+
+qint64 OccupancyHistory::nights() const
+{
+    qint64 total = 0;
+    for (const Timeline &timeline : rooms) {
+        if (!timeline.isEmpty()) total += qint64(timeline.last().before) + timeline.last().length;
+    }
+    return total;
+}
+
+qint64 OccupancyHistory::runCount() const
+{
+    qint64 total = 0;
+    for (const Timeline &timeline : rooms) {
+        total += timeline.size();
+    }
+    return total;
+}
+
+qint64 OccupancyHistory::memoryBytes() const
+{
+    qint64 total = 0;
+    for (const Timeline &timeline : rooms) {
+        total += qint64(timeline.capacity()) * qint64(sizeof(Span)) + qint64(sizeof(Timeline)) + qint64(sizeof(int));
+    }
+    return total;
+}
@@ -0,0 +1,70 @@
+#ifndef OCCUPANCYHISTORY_H
+#define OCCUPANCYHISTORY_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+class QSqlDatabase;
+
+// Сжатая история занятости на годы: для каждой комнаты - отсортированные непересекающиеся
+// серии занятых ночей. Брони идут сериями по несколько ночей, поэтому серия (12 байт)
+// заменяет несколько элементов QSet<qint64> из OccupancyStore.
+// Поиск ночи, подсчет и выборка серий в диапазоне - двоичный поиск без распаковки:
+// у каждой серии хранится число занятых ночей комнаты до нее.
+// Дни - юлианские номера; у реальных дат они укладываются в 32 бита.
+class OccupancyHistory
+{
+public:
+    // Ночи [start, start + length)
+    struct Run {
+        qint64 start = 0;
+        int length = 0;
+    };
+
+    // Ночи [fromDay, toDay] из source (bookings, archive.bookings, all_bookings)
+    static bool load(const QSqlDatabase &db, const QString &source, qint64 fromDay, qint64 toDay,
+                     OccupancyHistory *history, QString *error = nullptr);
+
+    // Быстрое добавление при загрузке по возрастанию дней комнаты; иначе - как setOccupied
+    void append(int roomNumber, qint64 day);
+
+    bool isOccupied(int roomNumber, qint64 day) const;
+    void setOccupied(int roomNumber, qint64 day, bool occupied);
+
+    // Число занятых ночей комнаты в диапазоне [fromDay, toDay]
+    int countOccupied(int roomNumber, qint64 fromDay, qint64 toDay) const;
+    // Серии комнаты, обрезанные по диапазону [fromDay, toDay]
+    QVector<Run> runs(int roomNumber, qint64 fromDay, qint64 toDay) const;
+    // Сколько комнат занято в каждый день [fromDay, toDay]
+    QVector<int> occupiedPerDay(qint64 fromDay, qint64 toDay) const;
+
+    QList<int> roomNumbers() const { return rooms.keys(); }
+    void removeRoom(int roomNumber) { rooms.remove(roomNumber); }
+    void clear() { rooms.clear(); }
+    bool isEmpty() const { return rooms.isEmpty(); }
+
+    qint64 nights() const;
+    qint64 runCount() const;
+    // Память под серии (без служебных данных QHash)
+    qint64 memoryBytes() const;
+
+private:
+    struct Span {
+        qint32 start;
+        qint32 length;
+        qint32 before;   // занятых ночей комнаты в предыдущих сериях
+    };
+    using Timeline = QVector<Span>;
+
+    // Первая серия, которая заканчивается после day (может начинаться позже него)
+    static int spanFrom(const Timeline &timeline, qint64 day);
+    // Занятых ночей раньше day
+    static qint64 nightsBefore(const Timeline &timeline, qint64 day);
+    static void renumber(Timeline &timeline, int fromIndex);
+
+    QHash<int, Timeline> rooms;
+};
+
+#endif // OCCUPANCYHISTORY_H
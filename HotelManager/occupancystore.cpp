@@ -0,0 +1,105 @@
+#include "occupancystore.h"
+
+#include <limits>
+
+bool OccupancyStore::isOccupied(int roomNumber, qint64 day) const
+{
+    auto it = rooms.constFind(roomNumber);
+    return it != rooms.constEnd() && it->contains(day);
+}
+
+void OccupancyStore::setOccupied(int roomNumber, qint64 day, bool occupied)
+{
+    if (occupied) {
+        rooms[roomNumber].insert(day);
+        record(roomNumber, day, day);
+        return;
+    }
+
+    auto it = rooms.find(roomNumber);
+    if (it == rooms.end()) return;
+
+    if (it->remove(day)) {
+        record(roomNumber, day, day);
+    }
+    if (it->isEmpty()) {
+        rooms.erase(it);
+    }
+}
+
+int OccupancyStore::countOccupied(int roomNumber, qint64 fromDay, qint64 toDay) const
+{
+    auto it = rooms.constFind(roomNumber);
+    if (it == rooms.constEnd()) return 0;
+
+    int count = 0;
+    for (qint64 day = fromDay; day <= toDay; day++) {
+        if (it->contains(day)) count++;
+    }
+    return count;
+}
+
+void OccupancyStore::removeRoom(int roomNumber)
+{
+    if (rooms.remove(roomNumber)) {
+        record(roomNumber, std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max());
+    }
+}
+
+void OccupancyStore::removeBefore(qint64 day)
+{
+    record(AllRooms, std::numeric_limits<qint64>::min(), day - 1);
+
+    for (auto it = rooms.begin(); it != rooms.end(); ) {
+        for (auto dayIt = it->begin(); dayIt != it->end(); ) {
+            if (*dayIt < day) {
+                dayIt = it->erase(dayIt);
+            } else {
+                ++dayIt;
+            }
+        }
+
+        if (it->isEmpty()) {
+            it = rooms.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void OccupancyStore::clear()
+{
+    rooms.clear();
+    record(AllRooms, std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max());
+}
+
+void OccupancyStore::setJournalEnabled(bool enabled)
+{
+    journalEnabled = enabled;
+    journal.clear();
+}
+
+QVector<OccupancyStore::Change> OccupancyStore::takeChanges()
+{
+    QVector<Change> changes;
+    changes.swap(journal);
+    return changes;
+}
+
+void OccupancyStore::record(int roomNumber, qint64 fromDay, qint64 toDay)
+{
+    if (!journalEnabled) return;
+
+    // Бронь на несколько ночей подряд - одна запись журнала, а не по записи на ночь
+    if (!journal.isEmpty()) {
+        Change &last = journal.last();
+        bool apart = (fromDay > last.toDay && fromDay - last.toDay > 1) ||
+                     (toDay < last.fromDay && last.fromDay - toDay > 1);
+        if (last.roomNumber == roomNumber && !apart) {
+            last.fromDay = qMin(last.fromDay, fromDay);
+            last.toDay = qMax(last.toDay, toDay);
+            return;
+        }
+    }
+    journal.append({roomNumber, fromDay, toDay});
+}
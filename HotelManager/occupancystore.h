@@ -0,0 +1,69 @@
+#ifndef OCCUPANCYSTORE_H
+#define OCCUPANCYSTORE_H
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QDate>
+
+// Кэш занятости: для каждой комнаты - множество занятых дней.
+// Дни хранятся как юлианские номера (QDate::toJulianDay), как и в колонке bookings.booking_date.
+class OccupancyStore
+{
+public:
+    // Изменившийся диапазон дней [fromDay, toDay] комнаты; AllRooms - любой комнаты
+    struct Change {
+        int roomNumber;
+        qint64 fromDay;
+        qint64 toDay;
+    };
+    static const int AllRooms = 0;
+
+    bool isOccupied(int roomNumber, qint64 day) const;
+    bool isOccupied(int roomNumber, const QDate &date) const { return isOccupied(roomNumber, date.toJulianDay()); }
+
+    void setOccupied(int roomNumber, qint64 day, bool occupied);
+
+    // Число занятых ночей комнаты в диапазоне [fromDay, toDay]
+    int countOccupied(int roomNumber, qint64 fromDay, qint64 toDay) const;
+    // Вызывает visit(day) для каждой занятой ночи комнаты в [fromDay, toDay], в любом порядке
+    template <typename Visit>
+    void forEachOccupied(int roomNumber, qint64 fromDay, qint64 toDay, Visit visit) const;
+
+    void removeRoom(int roomNumber);
+    void removeBefore(qint64 day);
+    void clear();
+
+    // Журнал изменений для точной инвалидации кэшей ответов (см. AvailabilityCache).
+    // По умолчанию выключен; присваивание другого хранилища его сбрасывает.
+    void setJournalEnabled(bool enabled);
+    bool isJournalEnabled() const { return journalEnabled; }
+    QVector<Change> takeChanges();
+
+private:
+    void record(int roomNumber, qint64 fromDay, qint64 toDay);
+
+    QHash<int, QSet<qint64>> rooms;
+    bool journalEnabled = false;
+    QVector<Change> journal;
+};
+
+template <typename Visit>
+void OccupancyStore::forEachOccupied(int roomNumber, qint64 fromDay, qint64 toDay, Visit visit) const
+{
+    auto it = rooms.constFind(roomNumber);
+    if (it == rooms.constEnd() || toDay < fromDay) return;
+
+    // Короткий диапазон дешевле проверить по дням, длинный - перебором ночей комнаты
+    if (toDay - fromDay + 1 < it->size()) {
+        for (qint64 day = fromDay; day <= toDay; day++) {
+            if (it->contains(day)) visit(day);
+        }
+    } else {
+        for (qint64 day : *it) {
+            if (day >= fromDay && day <= toDay) visit(day);
+        }
+    }
+}
+
+#endif // OCCUPANCYSTORE_H
@@ -0,0 +1,241 @@
+#include "operationtrace.h"
+#include "appsettings.h"
+
+#include <QFileInfo>
+#include <QDateTime>
+#include <QUrl>
+#include <QDebug>
+#include <cstring>
+
+namespace
+{
+    const char KindLetters[] = "BCDARPGI";
+
+    QByteArray encode(const QString &text)
+    {
+        // Пустую строку не пропустить при разбиении по пробелам
+        return text.isEmpty() ? QByteArray("-") : QUrl::toPercentEncoding(text);
+    }
+
+    QString decode(const QByteArray &field)
+    {
+        return field == "-" ? QString() : QUrl::fromPercentEncoding(field);
+    }
+}
+
+QString OperationTrace::kindName(Kind kind)
+{
+    switch (kind) {
+    case Book:
+        return "Бронирование";
+    case Cancel:
+        return "Снятие брони";
+    case DateChange:
+        return "Смена даты";
+    case AddRoom:
+        return "Добавление комнаты";
+    case DeleteRoom:
+        return "Удаление комнаты";
+    case Report:
+        return "Отчет";
+    case GroupBook:
+        return "Групповое бронирование";
+    case Import:
+        return "Импорт CSV";
+    }
+    return QString();
+}
+
+QByteArray OperationTrace::format(const Operation &operation)
+{
+    QByteArray line = QByteArray::number(operation.atMs) + ' ' + KindLetters[operation.kind];
+
+    switch (operation.kind) {
+    case Book:
+    case Cancel:
+        for (const Cell &cell : operation.cells) {
+            line += ' ' + QByteArray::number(cell.roomNumber) + ' ' + QByteArray::number(cell.day);
+        }
+        break;
+    case DateChange:
+        line += ' ' + QByteArray::number(operation.fromDay);
+        break;
+    case AddRoom:
+        line += ' ' + QByteArray::number(operation.room.number) + ' ' +
+                QByteArray::number(operation.room.capacity) + ' ' +
+                QByteArray::number(operation.room.price, 'g', 17) + ' ' +
+                encode(operation.room.type) + ' ' + encode(operation.room.description);
+        break;
+    case DeleteRoom:
+        line += ' ' + QByteArray::number(operation.room.number);
+        break;
+    case Report:
+        line += ' ' + QByteArray::number(operation.fromDay) + ' ' + QByteArray::number(operation.toDay);
+        break;
+    case GroupBook:
+        line += ' ' + QByteArray::number(operation.fromDay) + ' ' + QByteArray::number(operation.toDay);
+        for (int room : operation.rooms) {
+            line += ' ' + QByteArray::number(room);
+        }
+        break;
+    case Import:
+        line += ' ' + QByteArray::number(operation.importKind) + ' ' + encode(operation.fileName);
+        break;
+    }
+    return line + '\n';
+}
+
+bool OperationTrace::parse(const QByteArray &line, Operation *operation)
+{
+    QList<QByteArray> fields = line.trimmed().split(' ');
+    if (fields.size() < 2 || fields[1].size() != 1) return false;
+
+    const char *letter = strchr(KindLetters, fields[1][0]);
+    if (!letter || !*letter) return false;
+
+    Operation result;
+    bool ok = false;
+    result.atMs = fields[0].toLongLong(&ok);
+    if (!ok) return false;
+    result.kind = Kind(letter - KindLetters);
+
+    bool allOk = true;
+    auto number = [&](int i) {
+        bool fieldOk = false;
+        qint64 value = fields[i].toLongLong(&fieldOk);
+        allOk = allOk && fieldOk;
+        return value;
+    };
+
+    switch (result.kind) {
+    case Book:
+    case Cancel:
+        if (fields.size() < 4 || fields.size() % 2 != 0) return false;
+        for (int i = 2; i < fields.size(); i += 2) {
+            Cell cell;
+            cell.roomNumber = int(number(i));
+            cell.day = number(i + 1);
+            result.cells.append(cell);
+        }
+        break;
+    case DateChange:
+        if (fields.size() != 3) return false;
+        result.fromDay = number(2);
+        break;
+    case AddRoom:
+        if (fields.size() != 7) return false;
+        result.room.number = int(number(2));
+        result.room.capacity = int(number(3));
+        result.room.price = fields[4].toDouble(&ok);
+        allOk = allOk && ok;
+        result.room.type = decode(fields[5]);
+        result.room.description = decode(fields[6]);
+        break;
+    case DeleteRoom:
+        if (fields.size() != 3) return false;
+        result.room.number = int(number(2));
+        break;
+    case Report:
+        if (fields.size() != 4) return false;
+        result.fromDay = number(2);
+        result.toDay = number(3);
+        break;
+    case GroupBook:
+        if (fields.size() < 5) return false;
+        result.fromDay = number(2);
+        result.toDay = number(3);
+        for (int i = 4; i < fields.size(); i++) {
+            result.rooms.append(int(number(i)));
+        }
+        break;
+    case Import:
+        if (fields.size() != 4) return false;
+        result.importKind = int(number(2));
+        result.fileName = decode(fields[3]);
+        break;
+    }
+
+    if (!allOk) return false;
+    *operation = result;
+    return true;
+}
+
+bool OperationTrace::load(const QString &fileName, QVector<Operation> *operations, QString *error)
+{
+    QFile input(fileName);
+    if (!input.open(QIODevice::ReadOnly)) {
+        if (error) *error = "Не удалось открыть трассу: " + input.errorString();
+        return false;
+    }
+
+    int lineNumber = 0;
+    while (!input.atEnd()) {
+        QByteArray line = input.readLine();
+        lineNumber++;
+        // Недописанная строка - запись прервалась вместе с приложением
+        if (!line.endsWith('\n')) break;
+        if (line.startsWith('#') || line.trimmed().isEmpty()) continue;
+
+        Operation operation;
+        if (!parse(line, &operation)) {
+            if (error) *error = QString("Ошибка в строке %1 трассы").arg(lineNumber);
+            return false;
+        }
+        operations->append(operation);
+    }
+    return true;
+}
+
+bool OperationTrace::isEnabled()
+{
+    AppSettings settings;
+    return settings.value("trace/enabled", false).toBool();
+}
+
+void OperationTrace::setEnabled(bool enabled)
+{
+    AppSettings settings;
+    settings.setValue("trace/enabled", enabled);
+}
+
+QString OperationTrace::traceFileFor(const QString &databaseFile)
+{
+    QFileInfo info(databaseFile);
+    return info.absolutePath() + "/" + info.completeBaseName() + "_trace_" +
+           QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss") + ".txt";
+}
+
+bool OperationTrace::start(const QString &fileName, QString *error)
+{
+    stop();
+
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = "Не удалось создать файл трассы: " + file.errorString();
+        return false;
+    }
+
+    file.write("# HotelManager trace " + QDateTime::currentDateTime().toString(Qt::ISODate).toUtf8() + '\n');
+    file.flush();
+    clock.start();
+    return true;
+}
+
+void OperationTrace::stop()
+{
+    if (file.isOpen()) {
+        file.close();
+    }
+}
+
+void OperationTrace::record(Operation operation)
+{
+    if (!file.isOpen()) return;
+
+    operation.atMs = clock.elapsed();
+    // Сбрасываем сразу: трасса нужна и после аварийного завершения
+    if (file.write(format(operation)) < 0 || !file.flush()) {
+        qDebug() << "Запись трассы остановлена:" << file.errorString();
+        file.close();
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef OPERATIONTRACE_H
+#define OPERATIONTRACE_H
+
+#include <QFile>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+#include "roomindex.h"
+
+// Трасса действий администратора для воспроизведения на копии базы (tools/tracereplay).
+// Одна строка на действие: миллисекунды от начала записи, буква действия и параметры:
+//   <мс> B <комната> <день> [<комната> <день> ...]   бронирование ночей
+//   <мс> C <комната> <день> [...]                    снятие брони
+//   <мс> D <день>                                     первый день сетки
+//   <мс> A <комната> <вместимость> <цена> <тип> <описание>   (тип и описание в percent-encoding)
+//   <мс> R <комната>                                  удаление комнаты
+//   <мс> P <день> <день>                              отчет за период
+//   <мс> G <заезд> <выезд> <комната> [<комната> ...]  групповое бронирование
+//   <мс> I <вид> <файл>                               импорт CSV (вид - BulkImporter::Kind, файл в percent-encoding)
+// Дни - юлианские. Строки, начинающиеся с '#', - комментарии.
+// Отмена и повтор пишутся как результат: бронирования и снятия броней, добавление и удаление комнат.
+// Запись включается в меню (trace/enabled) и идет в файл рядом с базой активного отеля.
+class OperationTrace
+{
+public:
+    enum Kind {
+        Book,
+        Cancel,
+        DateChange,
+        AddRoom,
+        DeleteRoom,
+        Report,
+        GroupBook,
+        Import
+    };
+
+    struct Cell {
+        int roomNumber = 0;
+        qint64 day = 0;
+    };
+
+    struct Operation {
+        qint64 atMs = 0;
+        Kind kind = Book;
+        QVector<Cell> cells;   // Book, Cancel
+        qint64 fromDay = 0;    // DateChange - первый день сетки, Report - начало периода, GroupBook - заезд
+        qint64 toDay = 0;      // Report - конец периода (включительно), GroupBook - день выезда
+        RoomInfo room;         // AddRoom; для DeleteRoom задан только номер
+        QVector<int> rooms;    // GroupBook
+        int importKind = 0;    // Import
+        QString fileName;      // Import
+    };
+
+    static const int KindCount = Import + 1;
+
+    static QString kindName(Kind kind);
+    static QByteArray format(const Operation &operation);
+    static bool parse(const QByteArray &line, Operation *operation);
+    static bool load(const QString &fileName, QVector<Operation> *operations, QString *error = nullptr);
+
+    // Включена ли запись; хранится в настройках (trace/enabled)
+    static bool isEnabled();
+    static void setEnabled(bool enabled);
+    // Новый файл трассы рядом с базой: <база>_trace_<дата-время>.txt
+    static QString traceFileFor(const QString &databaseFile);
+
+    bool start(const QString &fileName, QString *error = nullptr);
+    void stop();
+    bool isRecording() const { return file.isOpen(); }
+    QString fileName() const { return file.fileName(); }
+
+    // Время действия проставляется здесь; без начатой записи ничего не делает
+    void record(Operation operation);
+
+private:
+    QFile file;
+    QElapsedTimer clock;
+};
+
+#endif // OPERATIONTRACE_H
@@ -0,0 +1,265 @@
+#include "propertymanager.h"
+#include "appsettings.h"
+#include "bookingarchiver.h"
+#include "connectionpool.h"
+#include "schema.h"
+#include "sqlitefastpath.h"
+#include "sqltracer.h"
+
+#include <QSqlError>
+#include <QtConcurrent>
+#include <QDebug>
+
+PropertyManager::PropertyManager(QObject *parent)
+    : QObject(parent)
+    , active(0)
+{
+}
+
+PropertyManager::~PropertyManager()
+{
+    for (const Property &property : properties) {
+        // Архиваторы держат копии соединений - удаляем их до removeDatabase
+        delete property.archiver;
+        {
+            QSqlDatabase db = QSqlDatabase::database(property.connectionName, false);
+            if (db.isOpen()) {
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(property.connectionName);
+    }
+}
+
+void PropertyManager::loadSettings()
+{
+    AppSettings settings;
+
+    properties.clear();
+    int size = settings.beginReadArray("properties");
+    for (int i = 0; i < size; i++) {
+        settings.setArrayIndex(i);
+        Property property;
+        property.name = settings.value("name").toString();
+        property.databaseFile = settings.value("databaseFile").toString();
+        if (!property.databaseFile.isEmpty()) {
+            properties.append(property);
+        }
+    }
+    settings.endArray();
+
+    // Первый запуск: единственный отель в прежнем файле
+    if (properties.isEmpty()) {
+        Property property;
+        property.name = "Основной отель";
+        property.databaseFile = "hotel_bookings.db";
+        properties.append(property);
+    }
+
+    for (int i = 0; i < properties.size(); i++) {
+        properties[i].connectionName = QString("property_%1").arg(i);
+    }
+
+    active = qBound(0, settings.value("activeProperty", 0).toInt(), int(properties.size()) - 1);
+}
+
+void PropertyManager::saveSettings() const
+{
+    AppSettings settings;
+
+    settings.beginWriteArray("properties", properties.size());
+    for (int i = 0; i < properties.size(); i++) {
+        settings.setArrayIndex(i);
+        settings.setValue("name", properties[i].name);
+        settings.setValue("databaseFile", properties[i].databaseFile);
+    }
+    settings.endArray();
+
+    settings.setValue("activeProperty", active);
+}
+
+void PropertyManager::setActiveIndex(int index)
+{
+    if (index < 0 || index >= properties.size()) return;
+
+    active = index;
+    saveSettings();
+}
+
+int PropertyManager::addProperty(const QString &name, const QString &databaseFile)
+{
+    Property property;
+    property.name = name;
+    property.databaseFile = databaseFile;
+    property.connectionName = QString("property_%1").arg(properties.size());
+    properties.append(property);
+
+    saveSettings();
+    return properties.size() - 1;
+}
+
+bool PropertyManager::openDatabase(int index, QString *error)
+{
+    Property &property = properties[index];
+
+    QSqlDatabase db = QSqlDatabase::contains(property.connectionName)
+                          ? QSqlDatabase::database(property.connectionName, false)
+                          : QSqlDatabase::addDatabase("QSQLITE", property.connectionName);
+    db.setDatabaseName(property.databaseFile);
+
+    if (!db.isOpen()) {
+        if (!db.open()) {
+            if (error) *error = db.lastError().text();
+            return false;
+        }
+        ConnectionPool::applyPragmas(db);
+    }
+
+    if (!property.archiver) {
+        property.archiver = new BookingArchiver(db, this);
+    }
+    return true;
+}
+
+QSqlDatabase PropertyManager::database(int index) const
+{
+    return QSqlDatabase::database(properties[index].connectionName, false);
+}
+
+QVector<RoomInfo> PropertyManager::loadRooms(const QSqlDatabase &db)
+{
+    QVector<RoomInfo> rooms;
+    QString fastError;
+    if (SqliteFastPath::loadRooms(db, &rooms, &fastError)) {
+        return rooms;
+    }
+    if (!fastError.isEmpty()) {
+        qDebug() << "Быстрая загрузка комнат не удалась: " << fastError;
+    }
+
+    TracedQuery query(Schema::selectSql<Schema::Rooms>(), db);
+
+    RoomInfo room;
+    while (query.next()) {
+        Schema::read<Schema::Rooms>(query, room);
+        rooms.append(room);
+    }
+    return rooms;
+}
+
+bool PropertyManager::loadOccupancy(const QSqlDatabase &db, OccupancyStore &store)
+{
+    QString fastError;
+    if (SqliteFastPath::loadOccupancy(db, &store, &fastError)) {
+        return true;
+    }
+    if (!fastError.isEmpty()) {
+        qDebug() << "Быстрая загрузка бронирований не удалась: " << fastError;
+    }
+
+    store.clear();
+
+    TracedQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(Schema::selectSql<Schema::Bookings>());
+
+    if (!query.exec()) {
+        qDebug() << "Ошибка загрузки данных: " << query.lastError().text();
+        return false;
+    }
+
+    Schema::Booking booking;
+    while (query.next()) {
+        Schema::read<Schema::Bookings>(query, booking);
+        store.setOccupied(booking.roomNumber, booking.day, true);
+    }
+    return true;
+}
+
+PropertySnapshot PropertyManager::loadSnapshot(const QString &databaseFile)
+{
+    PropertySnapshot snapshot;
+
+    ConnectionPool::Lease connection = ConnectionPool::instance().acquire(databaseFile);
+    {
+        QSqlDatabase db = connection.database();
+        if (db.isOpen()) {
+            snapshot.rooms = loadRooms(db);
+            loadOccupancy(db, snapshot.occupancy);
+        }
+    }
+    return snapshot;
+}
+
+void PropertyManager::loadAll()
+{
+    QStringList files;
+    for (const Property &property : properties) {
+        files.append(property.databaseFile);
+    }
+
+    // Каждый отель - отдельная задача пула; ждем, пока загрузятся все
+    QList<PropertySnapshot> snapshots = QtConcurrent::blockingMapped<QList<PropertySnapshot>>(
+        files, &PropertyManager::loadSnapshot);
+
+    for (int i = 0; i < properties.size() && i < snapshots.size(); i++) {
+        properties[i].data = std::move(snapshots[i]);
+    }
+}
+
+PropertyReport PropertyManager::reportFor(const QString &databaseFile, const QDate &from, const QDate &to)
+{
+    PropertyReport report;
+
+    ConnectionPool::Lease connection = ConnectionPool::instance().acquire(databaseFile);
+    {
+        QSqlDatabase db = connection.database();
+        if (!db.isOpen()) {
+            report.error = connection.errorText();
+            return report;
+        }
+
+        // История нужна для прошедших периодов - считаем вместе с архивом
+        QString source = "bookings";
+        if (BookingArchiver::attachArchive(db, BookingArchiver::archiveFileFor(databaseFile))) {
+            source = "all_bookings";
+        }
+
+        TracedQuery roomsQuery("SELECT COUNT(*) FROM rooms", db);
+        if (roomsQuery.next()) {
+            report.rooms = roomsQuery.value(0).toInt();
+        }
+        roomsQuery.finish();
+        report.roomNights = qint64(report.rooms) * (from.daysTo(to) + 1);
+
+        TracedQuery bookedQuery(db);
+        bookedQuery.prepare("SELECT COUNT(*), COALESCE(SUM(r.price_per_night), 0) "
+                            "FROM " + source + " b JOIN rooms r ON r.room_number = b.room_number "
+                            "WHERE b.booking_date BETWEEN ? AND ?");
+        bookedQuery.addBindValue(from.toJulianDay());
+        bookedQuery.addBindValue(to.toJulianDay());
+
+        if (bookedQuery.exec() && bookedQuery.next()) {
+            report.bookedNights = bookedQuery.value(0).toLongLong();
+            report.revenue = bookedQuery.value(1).toDouble();
+        } else {
+            report.error = bookedQuery.lastError().text();
+        }
+    }
+    return report;
+}
+
+QFuture<PropertyReport> PropertyManager::groupReport(const QDate &from, const QDate &to) const
+{
+    // Имена и файлы копируются здесь - задачи не обращаются к списку отелей
+    QVector<QPair<QString, QString>> targets;
+    for (const Property &property : properties) {
+        targets.append(qMakePair(property.name, property.databaseFile));
+    }
+
+    return QtConcurrent::mapped(targets, [from, to](const QPair<QString, QString> &target) {
+        PropertyReport report = PropertyManager::reportFor(target.second, from, to);
+        report.name = target.first;
+        return report;
+    });
+}
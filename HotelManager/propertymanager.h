@@ -0,0 +1,87 @@
+#ifndef PROPERTYMANAGER_H
+#define PROPERTYMANAGER_H
+
+#include <QObject>
+#include <QSqlDatabase>
+#include <QVector>
+#include <QDate>
+#include <QFuture>
+
+#include "occupancystore.h"
+#include "roomindex.h"
+
+class BookingArchiver;
+
+// Данные одного отеля, загружаемые в память
+struct PropertySnapshot
+{
+    QVector<RoomInfo> rooms;
+    OccupancyStore occupancy;
+};
+
+// Строка сводного отчета по группе отелей
+struct PropertyReport
+{
+    QString name;
+    int rooms = 0;
+    qint64 roomNights = 0;   // комнат x дней периода
+    qint64 bookedNights = 0;
+    double revenue = 0.0;
+    QString error;
+};
+
+// Отели группы: у каждого свой файл БД и свое именованное соединение.
+// Список хранится в настройках (properties/*). Загрузка данных всех отелей при старте
+// и сводные отчеты выполняются параллельно на пуле потоков, каждый поток - со своим соединением.
+class PropertyManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Property {
+        QString name;
+        QString databaseFile;
+        QString connectionName;
+        // Данные неактивного отеля; данные активного держит окно (см. HotelManager::switchProperty)
+        PropertySnapshot data;
+        BookingArchiver *archiver = nullptr;
+    };
+
+    explicit PropertyManager(QObject *parent = nullptr);
+    ~PropertyManager();
+
+    void loadSettings();
+    void saveSettings() const;
+
+    int count() const { return properties.size(); }
+    Property &property(int index) { return properties[index]; }
+    const Property &property(int index) const { return properties[index]; }
+
+    int activeIndex() const { return active; }
+    void setActiveIndex(int index);
+
+    int addProperty(const QString &name, const QString &databaseFile);
+
+    // Соединение отеля для потока интерфейса
+    bool openDatabase(int index, QString *error = nullptr);
+    QSqlDatabase database(int index) const;
+
+    // Параллельно загружает комнаты и занятость всех отелей
+    void loadAll();
+
+    static PropertySnapshot loadSnapshot(const QString &databaseFile);
+    static QVector<RoomInfo> loadRooms(const QSqlDatabase &db);
+    static bool loadOccupancy(const QSqlDatabase &db, OccupancyStore &store);
+
+    // Сводка по занятости и выручке всех отелей за период, отели считаются параллельно
+    // в пуле потоков; результаты идут в порядке отелей
+    QFuture<PropertyReport> groupReport(const QDate &from, const QDate &to) const;
+
+private:
+    static PropertyReport reportFor(const QString &databaseFile, const QDate &from, const QDate &to);
+
+    QVector<Property> properties;
+    int active;
+};
+
+#endif // PROPERTYMANAGER_H
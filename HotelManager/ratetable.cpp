@@ -0,0 +1,244 @@
+#include "ratetable.h"
+#include "occupancystore.h"
+#include "sqltracer.h"
+
+#include <QDate>
+#include <QPair>
+#include <QSqlError>
+#include <algorithm>
+
+namespace
+{
+    // Четыре независимые суммы: без -ffast-math компилятор не переставляет сложения
+    // одной цепочки, а так каждая полоса складывается отдельно и цикл векторизуется
+    double sumNights(const double *nights, qint64 count)
+    {
+        double lanes[4] = {0.0, 0.0, 0.0, 0.0};
+        qint64 i = 0;
+        for (; i + 4 <= count; i += 4) {
+            lanes[0] += nights[i];
+            lanes[1] += nights[i + 1];
+            lanes[2] += nights[i + 2];
+            lanes[3] += nights[i + 3];
+        }
+        double total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        for (; i < count; i++) {
+            total += nights[i];
+        }
+        return total;
+    }
+}
+
+QVector<RateTable::Rule> RateTable::loadRules(const QSqlDatabase &db, QString *error)
+{
+    TracedQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, room_type, room_number, from_date, to_date, price FROM rates ORDER BY id");
+
+    QVector<Rule> rules;
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return rules;
+    }
+
+    while (query.next()) {
+        Rule rule;
+        rule.id = query.value(0).toLongLong();
+        rule.roomType = query.value(1).toString();
+        rule.roomNumber = query.value(2).toInt();
+        rule.fromDay = query.value(3).toLongLong();
+        rule.toDay = query.value(4).toLongLong();
+        rule.price = query.value(5).toDouble();
+        rules.append(rule);
+    }
+    return rules;
+}
+
+bool RateTable::addRule(const QSqlDatabase &db, const Rule &rule, QString *error)
+{
+    TracedQuery query(db);
+    query.prepare("INSERT INTO rates (room_type, room_number, from_date, to_date, price) VALUES (?, ?, ?, ?, ?)");
+    query.addBindValue(rule.roomNumber > 0 ? QVariant() : QVariant(rule.roomType));
+    query.addBindValue(rule.roomNumber > 0 ? QVariant(rule.roomNumber) : QVariant());
+    query.addBindValue(rule.fromDay);
+    query.addBindValue(rule.toDay);
+    query.addBindValue(rule.price);
+
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool RateTable::removeRule(const QSqlDatabase &db, qint64 id, QString *error)
+{
+    TracedQuery query(db);
+    query.prepare("DELETE FROM rates WHERE id = ?");
+    query.addBindValue(id);
+
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void RateTable::compile(const QVector<RoomInfo> &rooms, const QVector<Rule> &rules, qint64 firstDay, int days)
+{
+    roomList = rooms;
+    ruleList = rules;
+    std::sort(ruleList.begin(), ruleList.end(), [](const Rule &a, const Rule &b) { return a.id < b.id; });
+
+    windowStart = firstDay;
+    windowDays = qMax(0, days);
+    prices.clear();
+    rowByRoom.clear();
+    positionByRoom.clear();
+
+    QHash<int, QVector<int>> roomRules;
+    QHash<QString, QVector<int>> typeRules;
+    for (int i = 0; i < ruleList.size(); i++) {
+        if (ruleList[i].roomNumber > 0) {
+            roomRules[ruleList[i].roomNumber].append(i);
+        } else {
+            typeRules[ruleList[i].roomType].append(i);
+        }
+    }
+
+    // Правила накладываются по возрастанию id - более позднее перекрывает раннее
+    auto paint = [this](int row, const Rule &rule) {
+        qint64 from = qMax(rule.fromDay, windowStart);
+        qint64 to = qMin(rule.toDay, windowStart + windowDays - 1);
+        if (from > to) return;
+        auto begin = prices.begin() + qint64(row) * windowDays;
+        std::fill(begin + (from - windowStart), begin + (to - windowStart) + 1, rule.price);
+    };
+
+    // Комнаты одного типа и базовой цены без своих правил делят одну строку
+    QHash<QPair<QString, double>, int> profileRows;
+    int rows = 0;
+
+    for (int pos = 0; pos < roomList.size(); pos++) {
+        const RoomInfo &room = roomList[pos];
+        positionByRoom.insert(room.number, pos);
+
+        bool ownRules = roomRules.contains(room.number);
+        QPair<QString, double> profile = qMakePair(room.type, room.price);
+        if (!ownRules) {
+            auto it = profileRows.constFind(profile);
+            if (it != profileRows.constEnd()) {
+                rowByRoom.insert(room.number, *it);
+                continue;
+            }
+        }
+
+        int row = rows++;
+        prices.resize(size_t(rows) * windowDays, room.price);
+        for (int index : typeRules.value(room.type)) {
+            paint(row, ruleList[index]);
+        }
+        if (ownRules) {
+            for (int index : roomRules.value(room.number)) {
+                paint(row, ruleList[index]);
+            }
+        } else {
+            profileRows.insert(profile, row);
+        }
+        rowByRoom.insert(room.number, row);
+    }
+}
+
+void RateTable::setRooms(const QVector<RoomInfo> &rooms)
+{
+    if (windowDays == 0) {
+        compile(rooms, ruleList, QDate::currentDate().toJulianDay() - PastDays, PastDays + FutureDays);
+    } else {
+        compile(rooms, ruleList, windowStart, windowDays);
+    }
+}
+
+void RateTable::setRules(const QVector<Rule> &rules)
+{
+    if (windowDays == 0) {
+        compile(roomList, rules, QDate::currentDate().toJulianDay() - PastDays, PastDays + FutureDays);
+    } else {
+        compile(roomList, rules, windowStart, windowDays);
+    }
+}
+
+double RateTable::slowPrice(const RoomInfo &room, qint64 day) const
+{
+    const Rule *typeRule = nullptr;
+    for (int i = ruleList.size() - 1; i >= 0; i--) {
+        const Rule &rule = ruleList[i];
+        if (day < rule.fromDay || day > rule.toDay) continue;
+
+        if (rule.roomNumber == room.number) {
+            return rule.price;
+        }
+        if (!typeRule && rule.roomNumber == 0 && rule.roomType == room.type) {
+            typeRule = &rule;
+        }
+    }
+    return typeRule ? typeRule->price : room.price;
+}
+
+double RateTable::priceOn(int roomNumber, qint64 day) const
+{
+    return quote(roomNumber, day, day + 1);
+}
+
+double RateTable::quote(int roomNumber, qint64 fromDay, qint64 toDay) const
+{
+    auto it = rowByRoom.constFind(roomNumber);
+    if (it == rowByRoom.constEnd()) return -1.0;
+    if (toDay <= fromDay) return 0.0;
+
+    qint64 windowEnd = windowStart + windowDays;
+    qint64 from = qMax(fromDay, windowStart);
+    qint64 to = qMin(toDay, windowEnd);
+
+    double total = 0.0;
+    if (from < to) {
+        const double *row = prices.data() + qint64(*it) * windowDays;
+        total = sumNights(row + (from - windowStart), to - from);
+    } else {
+        from = to = fromDay;
+    }
+
+    // Ночи вне окна - по правилам напрямую
+    if (fromDay < from || toDay > to) {
+        const RoomInfo &room = roomList[positionByRoom.value(roomNumber)];
+        for (qint64 day = fromDay; day < from; day++) {
+            total += slowPrice(room, day);
+        }
+        for (qint64 day = qMax(to, fromDay); day < toDay; day++) {
+            total += slowPrice(room, day);
+        }
+    }
+    return total;
+}
+
+QVector<RateTable::Quote> RateTable::quoteFree(const RoomIndex &rooms, const OccupancyStore &occupancy,
+                                               qint64 fromDay, qint64 toDay, const QString &type) const
+{
+    QVector<Quote> result;
+    if (toDay <= fromDay) return result;
+
+    result.reserve(rooms.rooms().size());
+    for (const RoomInfo &room : rooms.rooms()) {
+        if (!type.isEmpty() && room.type != type) continue;
+        if (occupancy.countOccupied(room.number, fromDay, toDay - 1) > 0) continue;
+
+        double total = quote(room.number, fromDay, toDay);
+        if (total >= 0.0) {
+            result.append({room.number, total});
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const Quote &a, const Quote &b) {
+        return a.total < b.total || (a.total == b.total && a.roomNumber < b.roomNumber);
+    });
+    return result;
+}
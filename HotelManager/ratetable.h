@@ -0,0 +1,76 @@
+#ifndef RATETABLE_H
+#define RATETABLE_H
+
+#include <QHash>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include <vector>
+
+#include "roomindex.h"
+
+class OccupancyStore;
+
+// Тарифы: цена за ночь для типа комнаты или конкретной комнаты на диапазон дат.
+// Для окна дней правила компилируются в плотные массивы цен по дням - по строке на
+// каждый ценовой профиль (тип + базовая цена комнаты, либо комната со своими правилами).
+// Стоимость проживания - сумма по непрерывному отрезку строки, без поиска правил.
+class RateTable
+{
+public:
+    struct Rule {
+        qint64 id = 0;
+        QString roomType;     // правило для типа; пусто, если для комнаты
+        int roomNumber = 0;   // правило для комнаты; 0, если для типа
+        qint64 fromDay = 0;   // первая ночь (юлианский день)
+        qint64 toDay = 0;     // последняя ночь, включительно
+        double price = 0.0;
+    };
+
+    struct Quote {
+        int roomNumber = 0;
+        double total = 0.0;
+    };
+
+    // Окно компиляции по умолчанию: месяц назад и два года вперед
+    static const int PastDays = 31;
+    static const int FutureDays = 2 * 366;
+
+    static QVector<Rule> loadRules(const QSqlDatabase &db, QString *error = nullptr);
+    static bool addRule(const QSqlDatabase &db, const Rule &rule, QString *error = nullptr);
+    static bool removeRule(const QSqlDatabase &db, qint64 id, QString *error = nullptr);
+
+    // Правило для комнаты важнее правила для типа; среди равных побеждает более позднее (больший id).
+    // Ночи без правил стоят rooms.price_per_night.
+    void compile(const QVector<RoomInfo> &rooms, const QVector<Rule> &rules, qint64 firstDay, int days);
+    void setRooms(const QVector<RoomInfo> &rooms);
+    void setRules(const QVector<Rule> &rules);
+
+    const QVector<Rule> &rules() const { return ruleList; }
+    qint64 firstDay() const { return windowStart; }
+    int dayCount() const { return windowDays; }
+
+    // Стоимость ночей [fromDay, toDay) комнаты; < 0 - комната неизвестна.
+    // Ночи вне окна считаются по правилам напрямую (медленнее)
+    double quote(int roomNumber, qint64 fromDay, qint64 toDay) const;
+    double priceOn(int roomNumber, qint64 day) const;
+
+    // Все комнаты, свободные на ночи [fromDay, toDay), с итоговой стоимостью по возрастанию цены
+    QVector<Quote> quoteFree(const RoomIndex &rooms, const OccupancyStore &occupancy,
+                             qint64 fromDay, qint64 toDay, const QString &type = QString()) const;
+
+private:
+    double slowPrice(const RoomInfo &room, qint64 day) const;
+
+    QVector<RoomInfo> roomList;
+    QVector<Rule> ruleList;
+    qint64 windowStart = 0;
+    int windowDays = 0;
+
+    // Строки цен подряд в одном буфере: строка r - prices[r * windowDays, (r + 1) * windowDays)
+    std::vector<double> prices;
+    QHash<int, int> rowByRoom;
+    QHash<int, int> positionByRoom;
+};
+
+#endif // RATETABLE_H
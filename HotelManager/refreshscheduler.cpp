@@ -0,0 +1,79 @@
+#include "refreshscheduler.h"
+#include "occupancystore.h"
+
+#include <QElapsedTimer>
+
+RefreshScheduler::RefreshScheduler(Performer perform, QObject *parent)
+    : QObject(parent)
+    , perform(std::move(perform))
+{
+    timer.setSingleShot(true);
+    timer.setInterval(0);
+    connect(&timer, &QTimer::timeout, this, &RefreshScheduler::flush);
+}
+
+void RefreshScheduler::request(Parts parts)
+{
+    pending.parts |= parts;
+    schedule();
+}
+
+void RefreshScheduler::requestCells(int roomNumber, qint64 fromDay, qint64 toDay)
+{
+    if (roomNumber == OccupancyStore::AllRooms) {
+        request(AllCells);
+        return;
+    }
+
+    auto it = pending.cells.find(roomNumber);
+    if (it == pending.cells.end()) {
+        pending.cells.insert(roomNumber, qMakePair(fromDay, toDay));
+    } else {
+        it->first = qMin(it->first, fromDay);
+        it->second = qMax(it->second, toDay);
+    }
+    schedule();
+}
+
+void RefreshScheduler::schedule()
+{
+    counters.requests++;
+    if (timer.isActive()) {
+        counters.coalesced++;
+        return;
+    }
+    timer.start();
+}
+
+void RefreshScheduler::flush()
+{
+    timer.stop();
+    if (pending.isEmpty()) return;
+
+    // Запросы, сделанные во время обновления, уйдут следующим проходом
+    Region region;
+    std::swap(region, pending);
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    perform(region);
+    counters.refreshes++;
+    counters.refreshTime.add(elapsed.nsecsElapsed() / 1000);
+}
+
+QString RefreshScheduler::reportHtml() const
+{
+    const Stats &s = counters;
+
+    QString html;
+    html += "<h3>Обновления сетки</h3>";
+    html += QString("<p>Запросов: %1, объединено с уже запланированными: %2, обновлений: %3<br>"
+                    "Время обновления, мкс: среднее %4, p95 %5, макс %6</p>")
+                .arg(s.requests)
+                .arg(s.coalesced)
+                .arg(s.refreshes)
+                .arg(s.refreshTime.count() > 0 ? s.refreshTime.total() / s.refreshTime.count() : 0)
+                .arg(s.refreshTime.percentile(0.95))
+                .arg(s.refreshTime.max());
+    return html;
+}
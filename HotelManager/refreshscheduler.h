@@ -0,0 +1,75 @@
+#ifndef REFRESHSCHEDULER_H
+#define REFRESHSCHEDULER_H
+
+#include <QObject>
+#include <QFlags>
+#include <QHash>
+#include <QPair>
+#include <QTimer>
+#include <functional>
+
+#include "sqltracer.h"
+
+// Отложенное обновление сетки окна. Запросы не перерисовывают сразу, а копятся как грязная
+// область: части сетки (раскладка строк, окно дат, заголовки, все ячейки) и диапазоны дней
+// отдельных комнат. Накопленное выполняется одним объединенным обновлением на следующем
+// проходе цикла событий (таймер с нулевым интервалом), так что серия запросов подряд -
+// удержанная стрелка в поле даты, массовая правка - стоит одной перерисовки.
+// Перед чтением сетки (выделение, номер комнаты строки) нужно вызвать flush().
+// Только для главного потока.
+class RefreshScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Part {
+        Layout = 0x1,    // строки: набор комнат, фильтр, сортировка; перерисовывает все ячейки
+        Window = 0x2,    // сдвинулась первая дата сетки
+        Headers = 0x4,   // заголовки дней: даты и прогноз
+        AllCells = 0x8   // все ячейки вместе с заголовками
+    };
+    Q_DECLARE_FLAGS(Parts, Part)
+
+    struct Region {
+        Parts parts;
+        // Комната -> дни [from, to], ячейки которых изменились (объединение всех запросов)
+        QHash<int, QPair<qint64, qint64>> cells;
+
+        bool isEmpty() const { return !parts && cells.isEmpty(); }
+    };
+
+    struct Stats {
+        qint64 requests = 0;
+        qint64 coalesced = 0;    // запросы, присоединенные к уже запланированному обновлению
+        qint64 refreshes = 0;
+        LatencyHistogram refreshTime;
+    };
+
+    using Performer = std::function<void(const Region &region)>;
+
+    explicit RefreshScheduler(Performer perform, QObject *parent = nullptr);
+
+    void request(Parts parts);
+    // Ячейки комнаты за дни [fromDay, toDay]; OccupancyStore::AllRooms - все ячейки
+    void requestCells(int roomNumber, qint64 fromDay, qint64 toDay);
+
+    // Выполняет накопленное сейчас, не дожидаясь цикла событий
+    void flush();
+    bool isPending() const { return !pending.isEmpty(); }
+
+    Stats stats() const { return counters; }
+    void resetStats() { counters = Stats(); }
+    QString reportHtml() const;
+
+private:
+    void schedule();
+
+    Performer perform;
+    Region pending;
+    QTimer timer;
+    Stats counters;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(RefreshScheduler::Parts)
+
+#endif // REFRESHSCHEDULER_H
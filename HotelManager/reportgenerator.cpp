@@ -0,0 +1,335 @@
+#include "reportgenerator.h"
+#include "bookingarchiver.h"
+#include "connectionpool.h"
+#include "sqltracer.h"
+
+#include <QThread>
+#include <QMap>
+#include <QMutexLocker>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QTextStream>
+#include <iterator>
+
+namespace
+{
+    // Дней между сигналами прогресса и проверками отмены
+    const int ProgressInterval = 7;
+    // Сколько отчетов за разные периоды хранить
+    const int MaxCachedReports = 8;
+    // Примерный объем HTML на один день периода - чтобы строка не перераспределялась по ходу
+    const int BytesPerDay = 160;
+
+    QString percent(double value)
+    {
+        return QString::number(value * 100, 'f', 1) + "%";
+    }
+
+    // Цена ночи по тарифам; комнаты, которой нет в тарифах, - по ее базовой цене
+    double nightPrice(const RateTable &rates, int roomNumber, qint64 day, double basePrice)
+    {
+        double price = rates.priceOn(roomNumber, day);
+        return price >= 0.0 ? price : basePrice;
+    }
+}
+
+ReportGenerator::ReportGenerator(QObject *parent)
+    : QObject(parent)
+    , worker(nullptr)
+{
+}
+
+ReportGenerator::~ReportGenerator()
+{
+    stop();
+    delete worker;
+}
+
+void ReportGenerator::stop()
+{
+    if (worker) {
+        cancel();
+        worker->wait();
+    }
+}
+
+bool ReportGenerator::isRunning() const
+{
+    return worker && worker->isRunning();
+}
+
+bool ReportGenerator::cached(const QDate &from, const QDate &to, const DataVersion &version, QString *html) const
+{
+    QMutexLocker locker(&cacheMutex);
+
+    auto it = reports.constFind(qMakePair(from.toJulianDay(), to.toJulianDay()));
+    if (it == reports.constEnd() || it->version != version) return false;
+
+    if (html) *html = it->html;
+    return true;
+}
+
+void ReportGenerator::start(const Request &request, const DataVersion &version)
+{
+    if (isRunning()) return;
+
+    delete worker;
+    cancelRequested.storeRelaxed(0);
+
+    worker = QThread::create([this, request, version]() {
+        run(request, version);
+    });
+    worker->start();
+}
+
+void ReportGenerator::run(const Request &request, const DataVersion &version)
+{
+    QString html;
+    QString error;
+
+    {
+        // Соединение QSqlDatabase нельзя использовать из другого потока - берем соединение потока из пула
+        ConnectionPool::Lease connection = ConnectionPool::instance().acquire(version.databaseFile);
+        QSqlDatabase reportDb = connection.database();
+
+        if (!reportDb.isOpen()) {
+            error = "Не удалось открыть базу данных: " + connection.errorText();
+        } else {
+            // Период может уходить в историю - читаем рабочую таблицу вместе с архивом
+            QString source = "bookings";
+            if (BookingArchiver::attachArchive(reportDb, BookingArchiver::archiveFileFor(version.databaseFile))) {
+                source = "all_bookings";
+            }
+
+            html.reserve(int(request.from.daysTo(request.to) + 1) * BytesPerDay + 4096);
+            QTextStream out(&html);
+            writeReport(reportDb, source, request, out, &error);
+            out.flush();
+        }
+    }
+
+    if (error.isEmpty()) {
+        QMutexLocker locker(&cacheMutex);
+
+        // Отчеты по прежним комнатам, тарифам или другой базе больше не понадобятся; отчеты
+        // за другие периоды со своей версией занятости остаются - их проверит cached()
+        for (auto it = reports.begin(); it != reports.end();) {
+            it = !it->version.sameSource(version) ? reports.erase(it) : std::next(it);
+        }
+        if (reports.size() >= MaxCachedReports) {
+            reports.erase(reports.begin());
+        }
+        reports.insert(qMakePair(request.from.toJulianDay(), request.to.toJulianDay()), {version, html});
+    }
+
+    emit finished(error.isEmpty(), html, error);
+}
+
+bool ReportGenerator::writeReport(const QSqlDatabase &db, const QString &source, const Request &request,
+                                  QTextStream &out, QString *error)
+{
+    const qint64 fromDay = request.from.toJulianDay();
+    const qint64 toDay = request.to.toJulianDay();
+    const int days = int(toDay - fromDay + 1);
+    const qint64 today = QDate::currentDate().toJulianDay();
+    // Шаги прогресса: дни периода, заезды, прогноз
+    const int steps = days + 2;
+    emit progress(0, steps);
+
+    out << "<h2>Отчет по отелю</h2>"
+        << "<h3>Период: " << request.from.toString("dd.MM.yyyy") << " - " << request.to.toString("dd.MM.yyyy")
+        << " (" << days << " дн.)</h3>";
+
+    // Комнаты по типам - знаменатель загрузки
+    QMap<QString, int> roomsByType;
+    int totalRooms = 0;
+    {
+        TracedQuery roomsQuery("SELECT room_type, COUNT(*) FROM rooms GROUP BY room_type", db);
+        while (roomsQuery.next()) {
+            roomsByType.insert(roomsQuery.value(0).toString(), roomsQuery.value(1).toInt());
+            totalRooms += roomsQuery.value(1).toInt();
+        }
+    }
+
+    // Итоги отдельным проходом по ночам периода, чтобы вывести их до подробных таблиц
+    {
+        TracedQuery totalsQuery(db);
+        totalsQuery.setForwardOnly(true);
+        totalsQuery.prepare("SELECT b.room_number, b.booking_date, r.price_per_night "
+                            "FROM " + source + " b JOIN rooms r ON r.room_number = b.room_number "
+                            "WHERE b.booking_date BETWEEN ? AND ?");
+        totalsQuery.addBindValue(fromDay);
+        totalsQuery.addBindValue(toDay);
+        if (!totalsQuery.exec()) {
+            if (error) *error = "Ошибка запроса: " + totalsQuery.lastError().text();
+            return false;
+        }
+
+        qint64 nights = 0;
+        double revenue = 0.0;
+        while (totalsQuery.next()) {
+            nights++;
+            revenue += nightPrice(request.rates, totalsQuery.value(0).toInt(),
+                                  totalsQuery.value(1).toLongLong(), totalsQuery.value(2).toDouble());
+        }
+        qint64 roomNights = qint64(totalRooms) * days;
+
+        out << "<p><b>Всего комнат:</b> " << totalRooms << "</p>"
+            << "<p><b>Продано ночей:</b> " << nights << " из " << roomNights
+            << " (" << percent(roomNights > 0 ? double(nights) / roomNights : 0.0) << ")</p>"
+            << "<p><b>Выручка:</b> " << QString::number(revenue, 'f', 2) << " руб.; "
+            << "средняя цена ночи " << QString::number(nights > 0 ? revenue / nights : 0.0, 'f', 2) << " руб.; "
+            << "на доступную ночь " << QString::number(roomNights > 0 ? revenue / roomNights : 0.0, 'f', 2)
+            << " руб.</p>";
+    }
+
+    // Загрузка по дням и типам: один проход по упорядоченным ночам вместе с перебором дней.
+    // Ночи не группируются в SQL - цена каждой своя, по тарифам
+    TracedQuery dayQuery(db);
+    dayQuery.setForwardOnly(true);
+    dayQuery.prepare("SELECT b.booking_date, r.room_type, b.room_number, r.price_per_night "
+                     "FROM " + source + " b JOIN rooms r ON r.room_number = b.room_number "
+                     "WHERE b.booking_date BETWEEN ? AND ? "
+                     "ORDER BY b.booking_date");
+    dayQuery.addBindValue(fromDay);
+    dayQuery.addBindValue(toDay);
+    if (!dayQuery.exec()) {
+        if (error) *error = "Ошибка запроса: " + dayQuery.lastError().text();
+        return false;
+    }
+
+    QStringList types = roomsByType.keys();
+    QHash<QString, int> typeColumn;
+    for (int i = 0; i < types.size(); i++) {
+        typeColumn.insert(types[i], i);
+    }
+
+    struct MonthTotals {
+        qint64 nights = 0;
+        int days = 0;
+        double revenue = 0.0;
+    };
+    QMap<QString, MonthTotals> months;
+
+    out << "<h3>Загрузка по дням</h3><table border='1' cellspacing='0' cellpadding='2'><tr><th>Дата</th><th>Всего</th>";
+    for (const QString &type : types) {
+        out << "<th>" << type.toHtmlEscaped() << " (" << roomsByType.value(type) << ")</th>";
+    }
+    out << "</tr>";
+
+    QVector<int> counts(types.size());
+    bool hasRow = dayQuery.next();
+    for (qint64 day = fromDay; day <= toDay; day++) {
+        counts.fill(0);
+        int booked = 0;
+        double revenue = 0.0;
+        while (hasRow && dayQuery.value(0).toLongLong() == day) {
+            int column = typeColumn.value(dayQuery.value(1).toString(), -1);
+            if (column >= 0) counts[column]++;
+            booked++;
+            revenue += nightPrice(request.rates, dayQuery.value(2).toInt(), day, dayQuery.value(3).toDouble());
+            hasRow = dayQuery.next();
+        }
+
+        QDate date = QDate::fromJulianDay(day);
+        MonthTotals &month = months[date.toString("yyyy-MM")];
+        month.nights += booked;
+        month.days++;
+        month.revenue += revenue;
+
+        out << "<tr><td>" << date.toString("dd.MM.yyyy") << "</td><td align='right'>"
+            << percent(totalRooms > 0 ? double(booked) / totalRooms : 0.0) << "</td>";
+        for (int i = 0; i < types.size(); i++) {
+            out << "<td align='right'>" << counts[i] << "</td>";
+        }
+        out << "</tr>";
+
+        int done = int(day - fromDay + 1);
+        if (done % ProgressInterval == 0) {
+            emit progress(done, steps);
+            if (cancelRequested.loadRelaxed()) {
+                if (error) *error = "Построение отчета отменено";
+                return false;
+            }
+        }
+    }
+    out << "</table>";
+    dayQuery.finish();
+
+    out << "<h3>Выручка по месяцам</h3><table border='1' cellspacing='0' cellpadding='2'>"
+        << "<tr><th>Месяц</th><th>Ночей</th><th>Загрузка</th><th>Выручка</th><th>Средняя цена</th></tr>";
+    for (auto it = months.cbegin(); it != months.cend(); ++it) {
+        qint64 roomNights = qint64(totalRooms) * it->days;
+        out << "<tr><td>" << it.key() << "</td><td align='right'>" << it->nights << "</td><td align='right'>"
+            << percent(roomNights > 0 ? double(it->nights) / roomNights : 0.0) << "</td><td align='right'>"
+            << QString::number(it->revenue, 'f', 2) << "</td><td align='right'>"
+            << QString::number(it->nights > 0 ? it->revenue / it->nights : 0.0, 'f', 2) << "</td></tr>";
+    }
+    out << "</table>";
+    emit progress(days, steps);
+
+    // Заезды: занятая ночь, перед которой комната была свободна. Будущее - только в рабочей таблице
+    out << "<h3>Предстоящие заезды</h3>";
+    qint64 arrivalsFrom = qMax(fromDay, today);
+    if (arrivalsFrom > toDay) {
+        out << "<p>Период уже прошел</p>";
+    } else {
+        TracedQuery arrivalsQuery(db);
+        arrivalsQuery.setForwardOnly(true);
+        arrivalsQuery.prepare("SELECT b.room_number, b.booking_date FROM main.bookings b "
+                              "WHERE b.booking_date BETWEEN ? AND ? AND NOT EXISTS ("
+                              "SELECT 1 FROM main.bookings p "
+                              "WHERE p.room_number = b.room_number AND p.booking_date = b.booking_date - 1) "
+                              "ORDER BY b.booking_date, b.room_number");
+        arrivalsQuery.addBindValue(arrivalsFrom);
+        arrivalsQuery.addBindValue(toDay);
+        if (!arrivalsQuery.exec()) {
+            if (error) *error = "Ошибка запроса: " + arrivalsQuery.lastError().text();
+            return false;
+        }
+
+        qint64 currentDay = -1;
+        int arrivals = 0;
+        while (arrivalsQuery.next()) {
+            qint64 day = arrivalsQuery.value(1).toLongLong();
+            if (day != currentDay) {
+                out << (currentDay < 0 ? "<p><b>" : "</p><p><b>")
+                    << QDate::fromJulianDay(day).toString("dd.MM.yyyy") << ":</b> ";
+                currentDay = day;
+            } else {
+                out << ", ";
+            }
+            out << arrivalsQuery.value(0).toInt();
+            arrivals++;
+        }
+        out << (arrivals > 0 ? "</p>" : "<p>Заездов нет</p>");
+    }
+    emit progress(days + 1, steps);
+
+    // Прогноз загрузки по неделям
+    if (!request.forecast.isEmpty()) {
+        const QVector<OccupancyForecast::Day> &forecast = request.forecast;
+        out << "<h3>Прогноз загрузки (" << forecast.size() << " дн.)</h3>"
+            << "<table border='1' cellspacing='0' cellpadding='2'>"
+            << "<tr><th>Неделя</th><th>Забронировано</th><th>Прогноз</th><th>Пик</th></tr>";
+        for (int i = 0; i < forecast.size(); i += 7) {
+            double booked = 0.0;
+            double expected = 0.0;
+            double peak = 0.0;
+            int weekDays = qMin(7, int(forecast.size()) - i);
+            for (int j = i; j < i + weekDays; j++) {
+                booked += forecast[j].onBooksRate();
+                expected += forecast[j].expectedRate();
+                peak = qMax(peak, forecast[j].expectedRate());
+            }
+            out << "<tr><td>" << QDate::fromJulianDay(forecast[i].day).toString("dd.MM") << " - "
+                << QDate::fromJulianDay(forecast[i + weekDays - 1].day).toString("dd.MM")
+                << "</td><td align='right'>" << percent(booked / weekDays)
+                << "</td><td align='right'>" << percent(expected / weekDays)
+                << "</td><td align='right'>" << percent(peak) << "</td></tr>";
+        }
+        out << "</table>";
+    }
+    emit progress(steps, steps);
+    return true;
+}
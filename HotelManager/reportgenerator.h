@@ -0,0 +1,93 @@
+#ifndef REPORTGENERATOR_H
+#define REPORTGENERATOR_H
+
+#include <QObject>
+#include <QDate>
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+#include "occupancyforecast.h"
+#include "ratetable.h"
+
+class QThread;
+class QTextStream;
+class QSqlDatabase;
+
+// Фоновое построение отчета за период (до нескольких месяцев): загрузка по дням и типам комнат,
+// выручка по месяцам, заезды, прогноз. Работает в отдельном потоке со своим соединением;
+// HTML пишется потоком в заранее зарезервированную строку, а не склейкой фрагментов.
+// Готовые отчеты хранятся, пока не изменились данные, по которым они построены.
+class ReportGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    // По чему построен отчет: при любом изменении кэшированный отчет устаревает
+    struct DataVersion {
+        QString databaseFile;
+        // Последняя версия снимка SharedOccupancy, изменившая ночи периода или окна прогноза:
+        // брони за пределами отчета его не сбрасывают
+        quint64 occupancy = 0;
+        quint64 rooms = 0;       // счетчик изменений списка комнат
+        qint64 history = 0;      // конец истории кривых прогноза (0 - еще строятся)
+        quint64 rates = 0;       // счетчик изменений тарифов
+
+        // Совпадает все, кроме занятости - она у каждого периода своя
+        bool sameSource(const DataVersion &other) const
+        {
+            return rooms == other.rooms && history == other.history && rates == other.rates &&
+                   databaseFile == other.databaseFile;
+        }
+        bool operator==(const DataVersion &other) const
+        {
+            return occupancy == other.occupancy && sameSource(other);
+        }
+        bool operator!=(const DataVersion &other) const { return !(*this == other); }
+    };
+
+    struct Request {
+        QDate from;
+        QDate to;
+        // Прогноз считается в окне по кэшу занятости - передается готовым
+        QVector<OccupancyForecast::Day> forecast;
+        // Тарифы, скомпилированные на период отчета: выручка - цена каждой ночи по ним
+        RateTable rates;
+    };
+
+    explicit ReportGenerator(QObject *parent = nullptr);
+    ~ReportGenerator();
+
+    bool cached(const QDate &from, const QDate &to, const DataVersion &version, QString *html) const;
+
+    void start(const Request &request, const DataVersion &version);
+    bool isRunning() const;
+
+public slots:
+    void cancel() { cancelRequested.storeRelaxed(1); }
+    // Отменяет построение и ждет остановки потока
+    void stop();
+
+signals:
+    void progress(int done, int total);
+    void finished(bool ok, const QString &html, const QString &error);
+
+private:
+    struct CachedReport {
+        DataVersion version;
+        QString html;
+    };
+
+    void run(const Request &request, const DataVersion &version);
+    bool writeReport(const QSqlDatabase &db, const QString &source, const Request &request,
+                     QTextStream &out, QString *error);
+
+    QThread *worker;
+    QAtomicInt cancelRequested;
+
+    mutable QMutex cacheMutex;
+    QHash<QPair<qint64, qint64>, CachedReport> reports;
+};
+
+#endif // REPORTGENERATOR_H
@@ -0,0 +1,161 @@
+#include "roomindex.h"
+#include "occupancystore.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Равны ли комнаты по основному ключу сортировки (без номера-вторичного ключа)
+    bool sameKey(RoomIndex::SortKey key, const RoomInfo &a, const RoomInfo &b)
+    {
+        switch (key) {
+        case RoomIndex::ByType:
+            return a.type == b.type;
+        case RoomIndex::ByCapacity:
+            return a.capacity == b.capacity;
+        case RoomIndex::ByPrice:
+            return a.price == b.price;
+        case RoomIndex::ByNumber:
+            break;
+        }
+        return a.number == b.number;
+    }
+}
+
+void RoomIndex::rebuild(const QVector<RoomInfo> &rooms)
+{
+    roomList = rooms;
+
+    positionByNumber.clear();
+    positionsByType.clear();
+    positionByNumber.reserve(roomList.size());
+
+    QVector<int> positions(roomList.size());
+    for (int i = 0; i < roomList.size(); i++) {
+        positions[i] = i;
+        positionByNumber.insert(roomList[i].number, i);
+        positionsByType[roomList[i].type].append(i);
+    }
+
+    // Вторичный ключ - номер комнаты, чтобы порядок внутри равных значений был стабильным
+    auto sorted = [this, &positions](auto less) {
+        QVector<int> result = positions;
+        std::sort(result.begin(), result.end(), [this, less](int a, int b) {
+            const RoomInfo &ra = roomList[a];
+            const RoomInfo &rb = roomList[b];
+            if (less(ra, rb)) return true;
+            if (less(rb, ra)) return false;
+            return ra.number < rb.number;
+        });
+        return result;
+    };
+
+    orderByNumber = sorted([](const RoomInfo &a, const RoomInfo &b) { return a.number < b.number; });
+    orderByType = sorted([](const RoomInfo &a, const RoomInfo &b) { return a.type < b.type; });
+    orderByCapacity = sorted([](const RoomInfo &a, const RoomInfo &b) { return a.capacity < b.capacity; });
+    orderByPrice = sorted([](const RoomInfo &a, const RoomInfo &b) { return a.price < b.price; });
+}
+
+const RoomInfo *RoomIndex::find(int roomNumber) const
+{
+    auto it = positionByNumber.constFind(roomNumber);
+    return it == positionByNumber.constEnd() ? nullptr : &roomList[it.value()];
+}
+
+QStringList RoomIndex::types() const
+{
+    QStringList result = positionsByType.keys();
+    result.sort();
+    return result;
+}
+
+const QVector<int> &RoomIndex::order(SortKey key) const
+{
+    switch (key) {
+    case ByType:
+        return orderByType;
+    case ByCapacity:
+        return orderByCapacity;
+    case ByPrice:
+        return orderByPrice;
+    case ByNumber:
+        break;
+    }
+    return orderByNumber;
+}
+
+QVector<int> RoomIndex::select(const Filter &filter, SortKey key, bool descending,
+                               const OccupancyStore &occupancy) const
+{
+    // Отметки позиций, прошедших все условия; каждое условие сужает набор по своему индексу
+    QVector<char> passed(roomList.size(), 1);
+
+    if (!filter.type.isEmpty()) {
+        passed.fill(0);
+        for (int pos : positionsByType.value(filter.type)) {
+            passed[pos] = 1;
+        }
+    }
+
+    if (filter.minCapacity > 0) {
+        auto first = std::lower_bound(orderByCapacity.cbegin(), orderByCapacity.cend(), filter.minCapacity,
+                                      [this](int pos, int value) { return roomList[pos].capacity < value; });
+        for (auto it = orderByCapacity.cbegin(); it != first; ++it) {
+            passed[*it] = 0;
+        }
+    }
+
+    if (filter.minPrice > 0.0 || filter.maxPrice > 0.0) {
+        auto first = std::lower_bound(orderByPrice.cbegin(), orderByPrice.cend(), filter.minPrice,
+                                      [this](int pos, double value) { return roomList[pos].price < value; });
+        auto last = orderByPrice.cend();
+        if (filter.maxPrice > 0.0) {
+            last = std::upper_bound(orderByPrice.cbegin(), orderByPrice.cend(), filter.maxPrice,
+                                    [this](double value, int pos) { return value < roomList[pos].price; });
+        }
+        for (auto it = orderByPrice.cbegin(); it != first; ++it) {
+            passed[*it] = 0;
+        }
+        for (auto it = last; it != orderByPrice.cend(); ++it) {
+            passed[*it] = 0;
+        }
+    }
+
+    const qint64 lastFreeNight = qMax(filter.freeFrom, filter.freeTo - 1);
+
+    const QVector<int> &sortOrder = order(key);
+
+    // По убыванию обращается только основной ключ: группы равных значений идут с конца,
+    // а внутри группы номера остаются по возрастанию, как и без обращения
+    QVector<int> traversal;
+    if (descending) {
+        traversal.reserve(sortOrder.size());
+        for (int end = sortOrder.size(); end > 0;) {
+            int begin = end - 1;
+            while (begin > 0 && sameKey(key, roomList[sortOrder[begin - 1]], roomList[sortOrder[end - 1]])) {
+                begin--;
+            }
+            for (int i = begin; i < end; i++) {
+                traversal.append(sortOrder[i]);
+            }
+            end = begin;
+        }
+    }
+    const QVector<int> &positions = descending ? traversal : sortOrder;
+
+    QVector<int> result;
+    result.reserve(positions.size());
+
+    for (int pos : positions) {
+        if (!passed[pos]) continue;
+
+        const RoomInfo &room = roomList[pos];
+        // Занятость проверяем последней: она дороже остальных условий
+        if (filter.freeOnly &&
+            occupancy.countOccupied(room.number, filter.freeFrom, lastFreeNight) > 0) {
+            continue;
+        }
+        result.append(room.number);
+    }
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef ROOMINDEX_H
+#define ROOMINDEX_H
+
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class OccupancyStore;
+
+struct RoomInfo
+{
+    int number = 0;
+    QString type;
+    int capacity = 0;
+    double price = 0.0;
+    QString description;
+};
+
+// Комнаты в памяти с индексами по атрибутам для фильтрации и сортировки сетки без запросов к БД.
+// Индексы - это перестановки позиций в списке комнат, отсортированные по атрибуту:
+// диапазон по цене или вместимости находится двоичным поиском, а вывод в нужном порядке -
+// одним проходом по перестановке без сортировки.
+class RoomIndex
+{
+public:
+    enum SortKey {
+        ByNumber,
+        ByType,
+        ByCapacity,
+        ByPrice
+    };
+
+    struct Filter {
+        QString type;            // пусто - любой тип
+        int minCapacity = 0;
+        double minPrice = 0.0;
+        double maxPrice = 0.0;   // 0 - без ограничения
+        // Только свободные на все ночи [freeFrom, freeTo): freeTo - день выезда, как везде.
+        // Пустой или перевернутый диапазон - одна ночь freeFrom
+        bool freeOnly = false;
+        qint64 freeFrom = 0;     // юлианские дни
+        qint64 freeTo = 0;
+    };
+
+    void rebuild(const QVector<RoomInfo> &rooms);
+
+    const QVector<RoomInfo> &rooms() const { return roomList; }
+    const RoomInfo *find(int roomNumber) const;
+    QStringList types() const;
+
+    // Номера комнат, прошедших фильтр, в порядке сортировки
+    QVector<int> select(const Filter &filter, SortKey key, bool descending,
+                        const OccupancyStore &occupancy) const;
+
+private:
+    const QVector<int> &order(SortKey key) const;
+
+    QVector<RoomInfo> roomList;
+    QHash<int, int> positionByNumber;
+    QHash<QString, QVector<int>> positionsByType;
+    QVector<int> orderByNumber;
+    QVector<int> orderByType;
+    QVector<int> orderByCapacity;
+    QVector<int> orderByPrice;
+};
+
+#endif // ROOMINDEX_H
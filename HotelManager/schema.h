@@ -0,0 +1,272 @@
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <QSqlQuery>
+#include <QString>
+#include <QVariant>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+#include "roomindex.h"
+
+// Таблицы базы, описанные один раз как типы C++.
+// Каждая таблица - структура с типом строки (Row), именем и кортежем столбцов; столбец связывает
+// имя в БД с полем строки, а SQL-тип выводится из типа поля. Из этого описания при компиляции
+// собираются тексты CREATE/SELECT/INSERT (constexpr-массивы символов), а чтение и привязка
+// разворачиваются в цепочку типизированных обращений по фиксированным индексам столбцов.
+// Таблица bookings здесь описана для создания и загрузки; служебные запросы к ней (архив,
+// запись правок) остаются рукописными.
+namespace Schema
+{
+    struct Booking {
+        int roomNumber = 0;
+        qint64 day = 0;      // юлианский день
+    };
+
+    struct Client {
+        qint64 id = 0;
+        QString fullName;
+        QString phone;
+        QString email;
+        QString passport;
+    };
+
+    struct Service {
+        QString name;
+        double price = 0.0;
+        QString description;
+    };
+
+    // SQL-тип по типу поля
+    template <typename T> struct SqlType;
+    template <> struct SqlType<int> { static constexpr const char *name = "INTEGER"; };
+    template <> struct SqlType<qint64> { static constexpr const char *name = "INTEGER"; };
+    template <> struct SqlType<double> { static constexpr const char *name = "REAL"; };
+    template <> struct SqlType<QString> { static constexpr const char *name = "TEXT"; };
+
+    template <typename RowType, typename T>
+    struct Column {
+        using Row = RowType;
+        using Type = T;
+
+        const char *name;
+        T RowType::*member;
+        const char *constraints;
+        bool generated;      // значение назначает БД (AUTOINCREMENT): в INSERT не входит
+    };
+
+    template <typename Row, typename T>
+    constexpr Column<Row, T> column(const char *name, T Row::*member, const char *constraints = "")
+    {
+        return {name, member, constraints, false};
+    }
+
+    template <typename Row, typename T>
+    constexpr Column<Row, T> generatedColumn(const char *name, T Row::*member, const char *constraints)
+    {
+        return {name, member, constraints, true};
+    }
+
+    // leading/trailing - определения, не связанные с полями строки (ключ, created_at, UNIQUE);
+    // order - порядок строк в SELECT, пусто - без ORDER BY
+    struct Rooms {
+        using Row = RoomInfo;
+        static constexpr const char *name = "rooms";
+        static constexpr const char *leading = "id INTEGER PRIMARY KEY AUTOINCREMENT";
+        static constexpr auto columns = std::make_tuple(
+            column("room_number", &RoomInfo::number, "UNIQUE NOT NULL"),
+            column("room_type", &RoomInfo::type, "DEFAULT 'Стандарт'"),
+            column("capacity", &RoomInfo::capacity, "DEFAULT 2"),
+            column("price_per_night", &RoomInfo::price, "DEFAULT 3000.0"),
+            column("description", &RoomInfo::description));
+        static constexpr const char *trailing = "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP";
+        static constexpr const char *order = "room_number";
+    };
+
+    struct Bookings {
+        using Row = Booking;
+        // Явно main: при подключенном архиве там есть своя таблица bookings
+        static constexpr const char *name = "main.bookings";
+        static constexpr const char *leading = "id INTEGER PRIMARY KEY AUTOINCREMENT";
+        static constexpr auto columns = std::make_tuple(
+            column("room_number", &Booking::roomNumber, "NOT NULL"),
+            column("booking_date", &Booking::day, "NOT NULL"));
+        static constexpr const char *trailing = "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+                                                "UNIQUE(room_number, booking_date)";
+        static constexpr const char *order = "";
+    };
+
+    struct Clients {
+        using Row = Client;
+        static constexpr const char *name = "clients";
+        static constexpr const char *leading = "";
+        static constexpr auto columns = std::make_tuple(
+            generatedColumn("id", &Client::id, "PRIMARY KEY AUTOINCREMENT"),
+            column("full_name", &Client::fullName, "NOT NULL"),
+            column("phone", &Client::phone),
+            column("email", &Client::email),
+            column("passport", &Client::passport));
+        static constexpr const char *trailing = "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP";
+        static constexpr const char *order = "full_name";
+    };
+
+    struct Services {
+        using Row = Service;
+        static constexpr const char *name = "services";
+        static constexpr const char *leading = "id INTEGER PRIMARY KEY AUTOINCREMENT";
+        static constexpr auto columns = std::make_tuple(
+            column("service_name", &Service::name, "NOT NULL"),
+            column("price", &Service::price, "DEFAULT 0.0"),
+            column("description", &Service::description));
+        static constexpr const char *trailing = "";
+        static constexpr const char *order = "";
+    };
+
+    namespace Detail
+    {
+        // Пишет текст в буфер или, если буфера нет, только считает длину
+        struct Writer {
+            char *out = nullptr;
+            std::size_t size = 0;
+
+            constexpr void put(const char *text)
+            {
+                for (; *text; ++text) {
+                    if (out) out[size] = *text;
+                    ++size;
+                }
+            }
+        };
+
+        template <std::size_t N>
+        struct Text {
+            char data[N + 1] = {};
+        };
+
+        constexpr void separate(Writer &w, bool &first)
+        {
+            if (!first) w.put(", ");
+            first = false;
+        }
+
+        struct Create {
+            template <typename Table>
+            static constexpr void write(Writer &w)
+            {
+                w.put("CREATE TABLE IF NOT EXISTS ");
+                w.put(Table::name);
+                w.put(" (");
+                bool first = true;
+                if (*Table::leading) {
+                    separate(w, first);
+                    w.put(Table::leading);
+                }
+                std::apply([&w, &first](const auto &... column) {
+                    ((separate(w, first), w.put(column.name), w.put(" "),
+                      w.put(SqlType<typename std::decay_t<decltype(column)>::Type>::name),
+                      (*column.constraints ? (w.put(" "), w.put(column.constraints)) : void())), ...);
+                }, Table::columns);
+                if (*Table::trailing) {
+                    separate(w, first);
+                    w.put(Table::trailing);
+                }
+                w.put(")");
+            }
+        };
+
+        struct Select {
+            template <typename Table>
+            static constexpr void write(Writer &w)
+            {
+                w.put("SELECT ");
+                bool first = true;
+                std::apply([&w, &first](const auto &... column) {
+                    ((separate(w, first), w.put(column.name)), ...);
+                }, Table::columns);
+                w.put(" FROM ");
+                w.put(Table::name);
+                if (*Table::order) {
+                    w.put(" ORDER BY ");
+                    w.put(Table::order);
+                }
+            }
+        };
+
+        struct Insert {
+            template <typename Table>
+            static constexpr void write(Writer &w)
+            {
+                w.put("INSERT INTO ");
+                w.put(Table::name);
+                w.put(" (");
+                bool first = true;
+                std::apply([&w, &first](const auto &... column) {
+                    ((column.generated ? void() : (separate(w, first), w.put(column.name))), ...);
+                }, Table::columns);
+                w.put(") VALUES (");
+                first = true;
+                std::apply([&w, &first](const auto &... column) {
+                    ((column.generated ? void() : (separate(w, first), w.put("?"))), ...);
+                }, Table::columns);
+                w.put(")");
+            }
+        };
+
+        template <typename Table, typename Generator>
+        constexpr std::size_t measure()
+        {
+            Writer w;
+            Generator::template write<Table>(w);
+            return w.size;
+        }
+
+        template <typename Table, typename Generator, std::size_t N>
+        constexpr Text<N> render()
+        {
+            Text<N> text;
+            Writer w;
+            w.out = text.data;
+            Generator::template write<Table>(w);
+            return text;
+        }
+
+        template <typename Table, typename Generator>
+        struct Sql {
+            static constexpr std::size_t size = measure<Table, Generator>();
+            static constexpr Text<size> text = render<Table, Generator, size>();
+        };
+    }
+
+    template <typename Table>
+    constexpr const char *createSql() { return Detail::Sql<Table, Detail::Create>::text.data; }
+
+    template <typename Table>
+    constexpr const char *selectSql() { return Detail::Sql<Table, Detail::Select>::text.data; }
+
+    template <typename Table>
+    constexpr const char *insertSql() { return Detail::Sql<Table, Detail::Insert>::text.data; }
+
+    // Строка из текущей записи запроса, выполненного по selectSql<Table>(): каждое поле
+    // читается по своему индексу сразу в свой тип. Query - TracedQuery или QSqlQuery
+    template <typename Table, typename Query>
+    void read(const Query &query, typename Table::Row &row)
+    {
+        int index = 0;
+        std::apply([&query, &row, &index](const auto &... column) {
+            ((row.*(column.member) =
+                  query.value(index++).template value<typename std::decay_t<decltype(column)>::Type>()), ...);
+        }, Table::columns);
+    }
+
+    // Значения для запроса insertSql<Table>() в порядке его параметров
+    template <typename Table, typename Query>
+    void bindInsert(Query &query, const typename Table::Row &row)
+    {
+        std::apply([&query, &row](const auto &... column) {
+            ((column.generated ? void() : query.addBindValue(QVariant::fromValue(row.*(column.member)))), ...);
+        }, Table::columns);
+    }
+}
+
+#endif // SCHEMA_H
@@ -0,0 +1,132 @@
+#include "sharedoccupancy.h"
+
+#include <QMutexLocker>
+#include <limits>
+
+namespace
+{
+    // Изменение длиннее этого хранится отрезком, а не по дням
+    const qint64 MaxTrackedDays = 4 * 366;
+    // Сколько таких отрезков помнить
+    const int MaxWideChanges = 64;
+}
+
+SharedOccupancy::SharedOccupancy()
+    : current(std::make_shared<const OccupancyStore>())
+    , generation(0)
+{
+}
+
+void SharedOccupancy::reset(OccupancyStore store)
+{
+    QMutexLocker locker(&writeMutex);
+    publish(std::move(store), {{OccupancyStore::AllRooms, std::numeric_limits<qint64>::min(),
+                                std::numeric_limits<qint64>::max()}});
+}
+
+bool SharedOccupancy::update(const std::function<bool(OccupancyStore &)> &apply)
+{
+    QMutexLocker locker(&writeMutex);
+
+    // Журнал нужен всегда: по нему считаются версии периодов (changedVersion)
+    OccupancyStore copy = *current;
+    copy.setJournalEnabled(true);
+    if (!apply(copy)) {
+        return false;
+    }
+
+    QVector<OccupancyStore::Change> changes;
+    if (copy.isJournalEnabled()) {
+        changes = copy.takeChanges();
+        copy.setJournalEnabled(false);
+    } else {
+        // apply заменил хранилище целиком (журнал при этом сбрасывается) - изменилось все
+        changes.append({OccupancyStore::AllRooms, std::numeric_limits<qint64>::min(),
+                        std::numeric_limits<qint64>::max()});
+    }
+
+    publish(std::move(copy), changes);
+    return true;
+}
+
+int SharedOccupancy::addListener(const Listener &listener)
+{
+    QMutexLocker locker(&writeMutex);
+    int id = nextListenerId++;
+    listeners.insert(id, listener);
+    return id;
+}
+
+void SharedOccupancy::removeListener(int id)
+{
+    QMutexLocker locker(&writeMutex);
+    listeners.remove(id);
+}
+
+void SharedOccupancy::publish(OccupancyStore store, const QVector<OccupancyStore::Change> &changes)
+{
+    std::atomic_store(&current, Snapshot(std::make_shared<const OccupancyStore>(std::move(store))));
+    quint64 version = generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+    if (changes.isEmpty()) return;
+    recordChanges(changes, version);
+    for (const Listener &listener : std::as_const(listeners)) {
+        listener(changes, version);
+    }
+}
+
+void SharedOccupancy::recordChanges(const QVector<OccupancyStore::Change> &changes, quint64 version)
+{
+    const qint64 minDay = std::numeric_limits<qint64>::min();
+    const qint64 maxDay = std::numeric_limits<qint64>::max();
+
+    QMutexLocker locker(&changesMutex);
+    for (const OccupancyStore::Change &change : changes) {
+        // Полная замена: все прежние версии перекрыты
+        if (change.fromDay == minDay && change.toDay == maxDay) {
+            dayVersions.clear();
+            wideChanges.clear();
+            baseVersion = version;
+            continue;
+        }
+
+        if (change.fromDay == minDay || change.toDay == maxDay || change.toDay - change.fromDay > MaxTrackedDays) {
+            wideChanges.append({change.fromDay, change.toDay, version});
+            if (wideChanges.size() > MaxWideChanges) {
+                baseVersion = qMax(baseVersion, wideChanges.first().version);
+                wideChanges.removeFirst();
+            }
+            continue;
+        }
+
+        for (qint64 day = change.fromDay; day <= change.toDay; day++) {
+            dayVersions.insert(day, version);
+        }
+    }
+}
+
+quint64 SharedOccupancy::changedVersion(qint64 fromDay, qint64 toDay) const
+{
+    QMutexLocker locker(&changesMutex);
+
+    quint64 result = baseVersion;
+    for (const WideChange &change : wideChanges) {
+        if (change.fromDay <= toDay && change.toDay >= fromDay) {
+            result = qMax(result, change.version);
+        }
+    }
+
+    // Перебираем то, что короче: дни периода или записанные дни
+    if (toDay - fromDay >= dayVersions.size()) {
+        for (auto it = dayVersions.cbegin(); it != dayVersions.cend(); ++it) {
+            if (it.key() >= fromDay && it.key() <= toDay) {
+                result = qMax(result, it.value());
+            }
+        }
+    } else {
+        for (qint64 day = fromDay; day <= toDay; day++) {
+            result = qMax(result, dayVersions.value(day, 0));
+        }
+    }
+    return result;
+}
@@ -0,0 +1,74 @@
+#ifndef SHAREDOCCUPANCY_H
+#define SHAREDOCCUPANCY_H
+
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "occupancystore.h"
+
+// Кэш занятости, общий для окна и API-сервера.
+// Читатели берут неизменяемый снимок и работают с ним без блокировок.
+// Писатели сериализуются между собой: изменение применяется к копии, после чего
+// копия публикуется как новый снимок. Первая правка копии отделяет таблицу комнат
+// целиком (O(число комнат)); множества ночей остаются общими, глубоко копируются
+// только множества измененных комнат. Пока писатель работает, читатели продолжают
+// видеть предыдущий снимок.
+class SharedOccupancy
+{
+public:
+    using Snapshot = std::shared_ptr<const OccupancyStore>;
+    // Вызывается под блокировкой писателей после публикации снимка version
+    using Listener = std::function<void(const QVector<OccupancyStore::Change> &changes, quint64 version)>;
+
+    SharedOccupancy();
+
+    Snapshot snapshot() const { return std::atomic_load(&current); }
+    quint64 version() const { return generation.load(std::memory_order_acquire); }
+
+    // Полная замена содержимого (загрузка из БД, смена отеля)
+    void reset(OccupancyStore store);
+
+    // apply выполняется под блокировкой писателей над копией текущего снимка;
+    // копия публикуется, только если apply вернул true. Блокировку ждут все писатели,
+    // включая потоки API: запись в БД, которую должен отразить снимок, делается внутри apply,
+    // иначе другой писатель успеет вклиниться между фиксацией и публикацией
+    bool update(const std::function<bool(OccupancyStore &)> &apply);
+
+    // Подписка на изменения: каждое опубликованное обновление - со списком затронутых
+    // комнат и дней; полная замена приходит как изменение всех комнат
+    int addListener(const Listener &listener);
+    void removeListener(int id);
+
+    // Последняя версия снимка, изменившая хотя бы одну ночь из [fromDay, toDay]: результат,
+    // посчитанный за период (отчет), не устаревает от правок вне него
+    quint64 changedVersion(qint64 fromDay, qint64 toDay) const;
+
+private:
+    struct WideChange {
+        qint64 fromDay;
+        qint64 toDay;
+        quint64 version;
+    };
+
+    void publish(OccupancyStore store, const QVector<OccupancyStore::Change> &changes);
+    void recordChanges(const QVector<OccupancyStore::Change> &changes, quint64 version);
+
+    QMutex writeMutex;
+    QHash<int, Listener> listeners;
+    int nextListenerId = 1;
+    Snapshot current;
+    std::atomic<quint64> generation;
+
+    // Версии последних изменений по дням; изменения длиннее нескольких лет (удаление комнаты,
+    // обрезка прошлого) хранятся отрезками, самые старые из них сводятся в baseVersion
+    mutable QMutex changesMutex;
+    QHash<qint64, quint64> dayVersions;
+    QVector<WideChange> wideChanges;
+    quint64 baseVersion = 0;
+};
+
+#endif // SHAREDOCCUPANCY_H
@@ -0,0 +1,204 @@
+#include "sqlitefastpath.h"
+#include "occupancystore.h"
+#include "sqltracer.h"
+
+#include <QSqlDriver>
+#include <QElapsedTimer>
+#include <QVariant>
+
+#ifdef HOTEL_SQLITE_FASTPATH
+#include <sqlite3.h>
+
+namespace
+{
+    sqlite3 *nativeHandle(const QSqlDatabase &db)
+    {
+        static const bool disabled = qEnvironmentVariableIsSet("HOTEL_SQLITE_FASTPATH") &&
+                                     qEnvironmentVariableIntValue("HOTEL_SQLITE_FASTPATH") == 0;
+        if (disabled || !db.isOpen() || db.driverName() != "QSQLITE") return nullptr;
+
+        QVariant handle = db.driver()->handle();
+        if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*") != 0) return nullptr;
+        return *static_cast<sqlite3 *const *>(handle.constData());
+    }
+
+    // Запрос sqlite3 с замером подготовки и выполнения для SqlTracer - как у TracedQuery
+    class Statement
+    {
+    public:
+        Statement(sqlite3 *handle, const char *sql)
+            : handle(handle)
+            , sql(sql)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            if (sqlite3_prepare_v2(handle, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+                errorText = QString::fromUtf8(sqlite3_errmsg(handle));
+            }
+            prepareMicros = timer.nsecsElapsed() / 1000;
+            stepTimer.start();
+        }
+
+        ~Statement()
+        {
+            sqlite3_finalize(stmt);
+
+            QString text = QString::fromUtf8(sql);
+            SqlTracer::instance().record(SqlTracer::normalize(text), text, 0, rows,
+                                         prepareMicros, stepTimer.nsecsElapsed() / 1000);
+        }
+
+        Statement(const Statement &) = delete;
+        Statement &operator=(const Statement &) = delete;
+
+        bool next()
+        {
+            if (!stmt) return false;
+
+            int rc = sqlite3_step(stmt);
+            if (rc == SQLITE_ROW) {
+                rows++;
+                return true;
+            }
+            if (rc != SQLITE_DONE) {
+                errorText = QString::fromUtf8(sqlite3_errmsg(handle));
+            }
+            return false;
+        }
+
+        bool failed(QString *error) const
+        {
+            if (errorText.isEmpty()) return false;
+            if (error) *error = errorText;
+            return true;
+        }
+
+        sqlite3_stmt *statement() const { return stmt; }
+
+    private:
+        sqlite3 *handle;
+        const char *sql;
+        sqlite3_stmt *stmt = nullptr;
+        QString errorText;
+        qint64 rows = 0;
+        qint64 prepareMicros = 0;
+        QElapsedTimer stepTimer;
+    };
+
+    // Чтение столбца в поле строки; специализация выбирается по типу поля при компиляции
+    template <typename T> struct NativeColumn;
+
+    template <> struct NativeColumn<int> {
+        static int read(sqlite3_stmt *stmt, int column) { return sqlite3_column_int(stmt, column); }
+    };
+
+    template <> struct NativeColumn<qint64> {
+        static qint64 read(sqlite3_stmt *stmt, int column) { return sqlite3_column_int64(stmt, column); }
+    };
+
+    template <> struct NativeColumn<double> {
+        static double read(sqlite3_stmt *stmt, int column) { return sqlite3_column_double(stmt, column); }
+    };
+
+    template <> struct NativeColumn<QString> {
+        static QString read(sqlite3_stmt *stmt, int column)
+        {
+            // Сначала text, потом bytes - так длина относится к уже полученному UTF-8
+            const char *text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, column));
+            return text ? QString::fromUtf8(text, sqlite3_column_bytes(stmt, column)) : QString();
+        }
+    };
+
+    template <typename Table>
+    void readRow(sqlite3_stmt *stmt, typename Table::Row &row)
+    {
+        int index = 0;
+        std::apply([stmt, &row, &index](const auto &... column) {
+            ((row.*(column.member) =
+                  NativeColumn<typename std::decay_t<decltype(column)>::Type>::read(stmt, index++)), ...);
+        }, Table::columns);
+    }
+}
+
+bool SqliteFastPath::isCompiledIn()
+{
+    return true;
+}
+
+bool SqliteFastPath::isAvailable(const QSqlDatabase &db)
+{
+    return nativeHandle(db) != nullptr;
+}
+
+template <typename Table>
+bool SqliteFastPath::forEachRow(const QSqlDatabase &db, const std::function<void(const typename Table::Row &)> &visit,
+                                QString *error)
+{
+    sqlite3 *handle = nativeHandle(db);
+    if (!handle) return false;
+
+    Statement query(handle, Schema::selectSql<Table>());
+    typename Table::Row row;
+    while (query.next()) {
+        readRow<Table>(query.statement(), row);
+        visit(row);
+    }
+    return !query.failed(error);
+}
+
+#else
+
+bool SqliteFastPath::isCompiledIn()
+{
+    return false;
+}
+
+bool SqliteFastPath::isAvailable(const QSqlDatabase &)
+{
+    return false;
+}
+
+template <typename Table>
+bool SqliteFastPath::forEachRow(const QSqlDatabase &, const std::function<void(const typename Table::Row &)> &,
+                                QString *)
+{
+    return false;
+}
+
+#endif // HOTEL_SQLITE_FASTPATH
+
+// Шаблон определен здесь, чтобы sqlite3.h не попадал в заголовок: инстанцируем для всех таблиц
+template bool SqliteFastPath::forEachRow<Schema::Rooms>(const QSqlDatabase &, const std::function<void(const RoomInfo &)> &, QString *);
+template bool SqliteFastPath::forEachRow<Schema::Bookings>(const QSqlDatabase &, const std::function<void(const Schema::Booking &)> &, QString *);
+template bool SqliteFastPath::forEachRow<Schema::Clients>(const QSqlDatabase &, const std::function<void(const Schema::Client &)> &, QString *);
+template bool SqliteFastPath::forEachRow<Schema::Services>(const QSqlDatabase &, const std::function<void(const Schema::Service &)> &, QString *);
+
+bool SqliteFastPath::loadRooms(const QSqlDatabase &db, QVector<RoomInfo> *rooms, QString *error)
+{
+    QVector<RoomInfo> result;
+    if (!forEachRow<Schema::Rooms>(db, [&result](const RoomInfo &room) { result.append(room); }, error)) {
+        return false;
+    }
+    *rooms = std::move(result);
+    return true;
+}
+
+bool SqliteFastPath::loadOccupancy(const QSqlDatabase &db, OccupancyStore *store, QString *error)
+{
+    if (!isAvailable(db)) return false;
+
+    store->clear();
+    return forEachRow<Schema::Bookings>(db, [store](const Schema::Booking &booking) {
+        store->setOccupied(booking.roomNumber, booking.day, true);
+    }, error);
+}
+
+bool SqliteFastPath::loadClients(const QSqlDatabase &db, QVector<Schema::Client> *clients, QString *error)
+{
+    QVector<Schema::Client> result;
+    if (!forEachRow<Schema::Clients>(db, [&result](const Schema::Client &client) { result.append(client); }, error)) {
+        return false;
+    }
+    *clients = std::move(result);
+    return true;
+}
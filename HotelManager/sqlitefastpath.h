@@ -0,0 +1,39 @@
+#ifndef SQLITEFASTPATH_H
+#define SQLITEFASTPATH_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+#include "schema.h"
+
+class OccupancyStore;
+
+// Быстрая загрузка больших таблиц напрямую через sqlite3 (QSqlDriver::handle()):
+// столбцы читаются sqlite3_column_* сразу в структуры, без QVariant на каждое значение.
+// Запросы и разбор строк берутся из описаний таблиц Schema: функция чтения каждого столбца
+// выбирается по типу поля при компиляции.
+// Собирается только с qmake CONFIG+=sqlite_fastpath - и только если плагин QSQLITE
+// использует системную SQLite (-system-sqlite): иначе у приложения и плагина разные
+// копии библиотеки и чужой дескриптор использовать нельзя.
+// В рантайме выключается переменной HOTEL_SQLITE_FASTPATH=0.
+// Каждый метод возвращает false, если быстрый путь недоступен или запрос не удался, -
+// тогда вызывающий читает обычным QSqlQuery.
+class SqliteFastPath
+{
+public:
+    static bool isCompiledIn();
+    static bool isAvailable(const QSqlDatabase &db);
+
+    // Все строки selectSql<Table>() по очереди в visit; реализован для таблиц Schema
+    template <typename Table>
+    static bool forEachRow(const QSqlDatabase &db, const std::function<void(const typename Table::Row &)> &visit,
+                           QString *error = nullptr);
+
+    static bool loadRooms(const QSqlDatabase &db, QVector<RoomInfo> *rooms, QString *error = nullptr);
+    static bool loadOccupancy(const QSqlDatabase &db, OccupancyStore *store, QString *error = nullptr);
+    static bool loadClients(const QSqlDatabase &db, QVector<Schema::Client> *clients, QString *error = nullptr);
+};
+
+#endif // SQLITEFASTPATH_H
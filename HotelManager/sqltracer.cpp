@@ -0,0 +1,312 @@
+#include "sqltracer.h"
+
+#include <QSqlError>
+#include <QRegularExpression>
+#include <QMutexLocker>
+#include <QDebug>
+#include <QtGlobal>
+#include <algorithm>
+
+void LatencyHistogram::add(qint64 micros)
+{
+    if (micros < 0) micros = 0;
+
+    int bucket = 0;
+    qint64 bound = 2;
+    while (bucket < BucketCount - 1 && micros >= bound) {
+        bound <<= 1;
+        bucket++;
+    }
+
+    buckets[bucket]++;
+    samples++;
+    sum += micros;
+    maximum = qMax(maximum, micros);
+}
+
+qint64 LatencyHistogram::percentile(double p) const
+{
+    if (samples == 0) return 0;
+
+    qint64 target = qMax<qint64>(1, qint64(samples * p + 0.5));
+    qint64 seen = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            // Для последней корзины границы нет, отдаем фактический максимум
+            return i == BucketCount - 1 ? maximum : qMin(maximum, (qint64(1) << (i + 1)));
+        }
+    }
+    return maximum;
+}
+
+SqlTracer &SqlTracer::instance()
+{
+    static SqlTracer tracer;
+    return tracer;
+}
+
+SqlTracer::SqlTracer()
+{
+    bool ok = false;
+    int ms = qEnvironmentVariableIntValue("HOTEL_SQL_SLOW_MS", &ok);
+    slowThreshold = ok ? ms : 50;
+}
+
+QString SqlTracer::normalize(const QString &sql)
+{
+    static const QRegularExpression stringLiteral("'(?:[^']|'')*'");
+    static const QRegularExpression numberLiteral("\\b\\d+(?:\\.\\d+)?\\b");
+    static const QRegularExpression spaces("\\s+");
+
+    QString result = sql;
+    result.replace(stringLiteral, "?");
+    result.replace(numberLiteral, "?");
+    result.replace(spaces, " ");
+    return result.trimmed();
+}
+
+void SqlTracer::record(const QString &statement, const QString &sql, int binds, qint64 rows,
+                       qint64 prepareMicros, qint64 stepMicros)
+{
+    if (statement.isEmpty()) return;
+
+    const QString &key = statement;
+    bool slow = (prepareMicros + stepMicros) > qint64(slowThresholdMs()) * 1000;
+
+    {
+        QMutexLocker locker(&mutex);
+        SqlStatementStats &entry = stats[key];
+        if (entry.executions == 0) {
+            entry.statement = key;
+            entry.sampleSql = sql;
+            entry.sampleBinds = binds;
+        }
+        entry.executions++;
+        entry.binds += binds;
+        entry.rows += rows;
+        if (prepareMicros > 0) {
+            entry.prepareTime.add(prepareMicros);
+        }
+        entry.stepTime.add(stepMicros);
+        if (slow) {
+            entry.slowCount++;
+        }
+    }
+
+    if (slow) {
+        qWarning() << "Медленный запрос:" << (prepareMicros + stepMicros) / 1000.0 << "мс,"
+                   << rows << "строк:" << key;
+    }
+}
+
+void SqlTracer::setSlowThresholdMs(int ms)
+{
+    QMutexLocker locker(&mutex);
+    slowThreshold = qMax(0, ms);
+}
+
+int SqlTracer::slowThresholdMs() const
+{
+    QMutexLocker locker(&mutex);
+    return slowThreshold;
+}
+
+QVector<SqlStatementStats> SqlTracer::topStatements(int limit) const
+{
+    QVector<SqlStatementStats> result;
+    {
+        QMutexLocker locker(&mutex);
+        result.reserve(stats.size());
+        for (auto it = stats.cbegin(); it != stats.cend(); ++it) {
+            result.append(it.value());
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const SqlStatementStats &a, const SqlStatementStats &b) {
+        return a.totalMicros() > b.totalMicros();
+    });
+
+    if (limit > 0 && result.size() > limit) {
+        result.resize(limit);
+    }
+    return result;
+}
+
+QString SqlTracer::reportHtml(int limit) const
+{
+    QVector<SqlStatementStats> top = topStatements(limit);
+
+    QString html;
+    html += "<h3>Профиль SQL-запросов</h3>";
+    html += QString("<p>Порог медленного запроса: %1 мс</p>").arg(slowThresholdMs());
+
+    if (top.isEmpty()) {
+        html += "<p>Запросы еще не выполнялись</p>";
+        return html;
+    }
+
+    html += "<table border=\"1\" cellspacing=\"0\" cellpadding=\"3\">"
+            "<tr><th>Запрос</th><th>Вызовов</th><th>Параметров</th><th>Строк</th>"
+            "<th>Подготовка p50/p99, мкс</th><th>Выполнение p50/p99, мкс</th>"
+            "<th>Всего, мс</th><th>Медленных</th></tr>";
+
+    for (const SqlStatementStats &s : top) {
+        html += QString("<tr><td>%1</td><td>%2</td><td>%3</td><td>%4</td>"
+                        "<td>%5 / %6</td><td>%7 / %8</td><td>%9</td><td>%10</td></tr>")
+                    .arg(s.statement.toHtmlEscaped())
+                    .arg(s.executions)
+                    .arg(s.binds)
+                    .arg(s.rows)
+                    .arg(s.prepareTime.percentile(0.5))
+                    .arg(s.prepareTime.percentile(0.99))
+                    .arg(s.stepTime.percentile(0.5))
+                    .arg(s.stepTime.percentile(0.99))
+                    .arg(s.totalMicros() / 1000.0, 0, 'f', 2)
+                    .arg(s.slowCount);
+    }
+
+    html += "</table>";
+    return html;
+}
+
+QString SqlTracer::explainTopOffenders(const QSqlDatabase &db, int limit) const
+{
+    static const QRegularExpression explainable("^\\s*(SELECT|INSERT|UPDATE|DELETE|REPLACE|WITH)\\b",
+                                                QRegularExpression::CaseInsensitiveOption);
+
+    QString html;
+    html += "<h3>Планы выполнения самых дорогих запросов</h3>";
+
+    int shown = 0;
+    for (const SqlStatementStats &s : topStatements(0)) {
+        if (shown >= limit) break;
+        if (!explainable.match(s.sampleSql).hasMatch()) continue;
+
+        // Намеренно обычный QSqlQuery: EXPLAIN не должен попадать в статистику
+        QSqlQuery explain(db);
+        if (!explain.prepare("EXPLAIN QUERY PLAN " + s.sampleSql)) {
+            continue;
+        }
+        for (int i = 0; i < s.sampleBinds; i++) {
+            explain.addBindValue(QVariant());
+        }
+
+        html += "<p><b>" + s.statement.toHtmlEscaped() + "</b><br>";
+        if (explain.exec()) {
+            while (explain.next()) {
+                html += explain.value(3).toString().toHtmlEscaped() + "<br>";
+            }
+        } else {
+            html += "Ошибка: " + explain.lastError().text().toHtmlEscaped();
+        }
+        html += "</p>";
+        shown++;
+    }
+
+    if (shown == 0) {
+        html += "<p>Нет запросов для анализа</p>";
+    }
+    return html;
+}
+
+void SqlTracer::reset()
+{
+    QMutexLocker locker(&mutex);
+    stats.clear();
+}
+
+TracedQuery::TracedQuery(const QSqlDatabase &db)
+    : query(db)
+{
+}
+
+TracedQuery::TracedQuery(const QString &sql, const QSqlDatabase &db)
+    : query(db)
+{
+    exec(sql);
+}
+
+TracedQuery::~TracedQuery()
+{
+    flush();
+}
+
+bool TracedQuery::prepare(const QString &sql)
+{
+    flush();
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = query.prepare(sql);
+    prepareMicros = timer.nsecsElapsed() / 1000;
+    sqlText = sql;
+    statementKey = SqlTracer::normalize(sql);
+    return ok;
+}
+
+bool TracedQuery::exec()
+{
+    // Повторное выполнение подготовленного запроса: предыдущий прогон
+    // отправляем в статистику, время подготовки учитывается только один раз
+    flush();
+
+    bindCount = query.boundValues().size();
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = query.exec();
+    stepMicros = timer.nsecsElapsed() / 1000;
+    rowCount = (ok && !query.isSelect()) ? qMax(0, query.numRowsAffected()) : 0;
+    pending = true;
+    return ok;
+}
+
+bool TracedQuery::exec(const QString &sql)
+{
+    flush();
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = query.exec(sql);
+    sqlText = sql;
+    statementKey = SqlTracer::normalize(sql);
+    bindCount = 0;
+    prepareMicros = 0;
+    stepMicros = timer.nsecsElapsed() / 1000;
+    rowCount = (ok && !query.isSelect()) ? qMax(0, query.numRowsAffected()) : 0;
+    pending = true;
+    return ok;
+}
+
+bool TracedQuery::next()
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = query.next();
+    stepMicros += timer.nsecsElapsed() / 1000;
+
+    if (ok) {
+        rowCount++;
+    } else {
+        flush();
+    }
+    return ok;
+}
+
+void TracedQuery::finish()
+{
+    flush();
+    query.finish();
+}
+
+void TracedQuery::flush()
+{
+    if (!pending) return;
+    pending = false;
+
+    SqlTracer::instance().record(statementKey, sqlText, bindCount, rowCount, prepareMicros, stepMicros);
+    rowCount = 0;
+    prepareMicros = 0;
+    stepMicros = 0;
+}
@@ -0,0 +1,128 @@
+#ifndef SQLTRACER_H
+#define SQLTRACER_H
+
+#include <QSqlQuery>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+#include <QString>
+
+// Гистограмма задержек с логарифмическими корзинами (микросекунды)
+class LatencyHistogram
+{
+public:
+    static const int BucketCount = 25; // [0,2) мкс ... [2^24, ∞) мкс
+
+    void add(qint64 micros);
+    qint64 count() const { return samples; }
+    qint64 total() const { return sum; }
+    qint64 max() const { return maximum; }
+    // Верхняя граница корзины, в которую попадает перцентиль p (0..1)
+    qint64 percentile(double p) const;
+
+private:
+    qint64 buckets[BucketCount] = {};
+    qint64 samples = 0;
+    qint64 sum = 0;
+    qint64 maximum = 0;
+};
+
+// Накопленная статистика по одному нормализованному запросу
+struct SqlStatementStats
+{
+    QString statement;   // нормализованный текст
+    QString sampleSql;   // исходный текст (для EXPLAIN QUERY PLAN)
+    int sampleBinds = 0; // число параметров в исходном тексте
+    qint64 executions = 0;
+    qint64 binds = 0;
+    qint64 rows = 0;
+    qint64 slowCount = 0;
+    LatencyHistogram prepareTime;
+    LatencyHistogram stepTime;
+
+    qint64 totalMicros() const { return prepareTime.total() + stepTime.total(); }
+};
+
+// Сборщик статистики по всем SQL-запросам приложения
+class SqlTracer
+{
+public:
+    static SqlTracer &instance();
+
+    // Заменяет литералы на '?' и схлопывает пробелы
+    static QString normalize(const QString &sql);
+
+    // statement - уже нормализованный текст (см. normalize), sql - исходный
+    void record(const QString &statement, const QString &sql, int binds, qint64 rows,
+                qint64 prepareMicros, qint64 stepMicros);
+
+    // Порог "медленного" запроса; по умолчанию берется из HOTEL_SQL_SLOW_MS
+    void setSlowThresholdMs(int ms);
+    int slowThresholdMs() const;
+
+    // Самые дорогие запросы по суммарному времени
+    QVector<SqlStatementStats> topStatements(int limit) const;
+
+    QString reportHtml(int limit = 20) const;
+    QString explainTopOffenders(const QSqlDatabase &db, int limit = 5) const;
+    void reset();
+
+private:
+    SqlTracer();
+
+    mutable QMutex mutex;
+    QHash<QString, SqlStatementStats> stats;
+    int slowThreshold;
+};
+
+// Запрос, который замеряет подготовку и выполнение и отдает их в SqlTracer.
+// Используется вместо QSqlQuery во всех местах, где выполняются запросы. QSqlQuery лежит
+// внутри, а не наследуется: его методы не виртуальные, и код, получивший ссылку на
+// QSqlQuery, выполнял бы запрос мимо замеров. Наружу выдаются только чтение результата
+// и привязка параметров.
+class TracedQuery
+{
+public:
+    explicit TracedQuery(const QSqlDatabase &db = QSqlDatabase());
+    explicit TracedQuery(const QString &sql, const QSqlDatabase &db = QSqlDatabase());
+    ~TracedQuery();
+
+    TracedQuery(const TracedQuery &) = delete;
+    TracedQuery &operator=(const TracedQuery &) = delete;
+
+    bool prepare(const QString &sql);
+    bool exec();
+    bool exec(const QString &sql);
+    bool next();
+    void finish();
+
+    void addBindValue(const QVariant &value) { query.addBindValue(value); }
+    void bindValue(int pos, const QVariant &value) { query.bindValue(pos, value); }
+    void setForwardOnly(bool forward) { query.setForwardOnly(forward); }
+
+    QVariant value(int index) const { return query.value(index); }
+    QVariant value(const QString &name) const { return query.value(name); }
+    bool isActive() const { return query.isActive(); }
+    bool isSelect() const { return query.isSelect(); }
+    int numRowsAffected() const { return query.numRowsAffected(); }
+    QVariant lastInsertId() const { return query.lastInsertId(); }
+    QSqlError lastError() const { return query.lastError(); }
+
+private:
+    void flush();
+
+    QSqlQuery query;
+    QString sqlText;
+    QString statementKey; // нормализуется один раз на prepare, а не на каждый exec
+    int bindCount = 0;
+    qint64 rowCount = 0;
+    qint64 prepareMicros = 0;
+    qint64 stepMicros = 0;
+    bool pending = false;
+};
+
+#endif // SQLTRACER_H
@@ -0,0 +1,14 @@
+#include "validation.h"
+
+const QRegularExpression &Validation::roomNamePattern()
+{
+    // Компилируем один раз: при импорте проверка выполняется на каждой строке
+    static const QRegularExpression regex("^[а-яА-ЯёЁa-zA-Z0-9\\s\\(\\)\\/\\-\\.\\,]+$");
+    return regex;
+}
+
+bool Validation::isValidRoomName(const QString &name)
+{
+    QRegularExpressionMatch match = roomNamePattern().match(name);
+    return match.hasMatch() && !name.trimmed().isEmpty();
+}
@@ -0,0 +1,24 @@
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+#include <QString>
+#include <QRegularExpression>
+
+// Общие правила проверки ввода: используются и в диалогах, и при импорте
+namespace Validation
+{
+    // Кириллица, латиница, цифры, пробелы и символы ( ) / - . ,
+    const QRegularExpression &roomNamePattern();
+
+    bool isValidRoomName(const QString &name);
+
+    // Ограничения совпадают с диалогами добавления комнаты
+    const int MinRoomNumber = 1;
+    const int MaxRoomNumber = 999;
+    const int MinCapacity = 1;
+    const int MaxCapacity = 10;
+    const double MinPrice = 500.0;
+    const double MaxPrice = 50000.0;
+}
+
+#endif // VALIDATION_H
@@ -0,0 +1,246 @@
+#include "yearoverview.h"
+#include "occupancyhistory.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QHelpEvent>
+#include <QToolTip>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <algorithm>
+
+namespace
+{
+    // Цвета те же, что у ячеек сетки; архивные ночи темнее
+    const QRgb FreeColor = qRgb(255, 255, 255);
+    const QRgb WeekendColor = qRgb(236, 236, 236);
+    const QRgb OccupiedColor = qRgb(144, 238, 144);
+    const QRgb ArchivedColor = qRgb(96, 176, 96);
+}
+
+YearOverview::YearOverview(SharedOccupancy &occupancy, QWidget *parent)
+    : QWidget(parent)
+    , occupancy(occupancy)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setCursor(Qt::CrossCursor);
+
+    listenerId = occupancy.addListener([this](const QVector<OccupancyStore::Change> &changes, quint64) {
+        // Вызывается под блокировкой писателей в их потоке - только копим и будим главный поток
+        QMutexLocker locker(&changesMutex);
+        pendingChanges += changes;
+        if (changesScheduled) return;
+        changesScheduled = true;
+        QMetaObject::invokeMethod(this, [this]() { applyChanges(); }, Qt::QueuedConnection);
+    });
+}
+
+YearOverview::~YearOverview()
+{
+    occupancy.removeListener(listenerId);
+}
+
+void YearOverview::setRooms(const QVector<int> &roomNumbers)
+{
+    rooms = roomNumbers;
+    rowOfRoom.clear();
+    rowOfRoom.reserve(rooms.size());
+    for (int row = 0; row < rooms.size(); row++) {
+        rowOfRoom.insert(rooms[row], row);
+    }
+    setFixedSize(qMax(1, days), qMax(1, int(rooms.size())));
+    render();
+}
+
+void YearOverview::setHistory(const OccupancyHistory *history)
+{
+    this->history = history;
+    render();
+}
+
+void YearOverview::setWindow(const QDate &fromDate, int days)
+{
+    // Рамка сетки - поверх картинки, ее перенос картинку не трогает
+    update(windowRect());
+    windowFrom = fromDate;
+    windowDays = days;
+    update(windowRect());
+
+    QDate yearStart(fromDate.year(), 1, 1);
+    if (yearStart == firstDay) return;
+
+    firstDay = yearStart;
+    this->days = yearStart.daysInYear();
+    background.resize(this->days);
+    for (int col = 0; col < this->days; col++) {
+        background[col] = firstDay.addDays(col).dayOfWeek() >= 6 ? WeekendColor : FreeColor;
+    }
+    setFixedSize(this->days, qMax(1, int(rooms.size())));
+    render();
+}
+
+void YearOverview::redraw()
+{
+    render();
+}
+
+void YearOverview::redraw(int roomNumber, qint64 fromDay, qint64 toDay)
+{
+    if (dirty || !isVisible()) {
+        dirty = true;
+        return;
+    }
+
+    const qint64 base = firstDay.toJulianDay();
+    int row = rowOfRoom.value(roomNumber, -1);
+    qint64 from = qMax(fromDay, base);
+    qint64 to = qMin(toDay, base + days - 1);
+    if (row < 0 || to < from) return;
+
+    renderRow(row, *occupancy.snapshot(), int(from - base), int(to - base));
+    update(QRect(int(from - base), row, int(to - from + 1), 1));
+}
+
+void YearOverview::render()
+{
+    // Скрытый обзор дорисуется при показе
+    if (!isVisible()) {
+        dirty = true;
+        return;
+    }
+    dirty = false;
+
+    if (rooms.isEmpty() || days <= 0) {
+        image = QImage();
+        update();
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (image.width() != days || image.height() != rooms.size()) {
+        image = QImage(days, int(rooms.size()), QImage::Format_RGB32);
+    }
+
+    SharedOccupancy::Snapshot store = occupancy.snapshot();
+    for (int row = 0; row < rooms.size(); row++) {
+        renderRow(row, *store, 0, days - 1);
+    }
+    update();
+
+    emit rendered(firstDay.year(), timer.nsecsElapsed() / 1000);
+}
+
+void YearOverview::renderRow(int row, const OccupancyStore &store, int fromColumn, int toColumn)
+{
+    QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(row));
+    std::copy(background.cbegin() + fromColumn, background.cbegin() + toColumn + 1, line + fromColumn);
+
+    const int roomNumber = rooms[row];
+    const qint64 base = firstDay.toJulianDay();
+    store.forEachOccupied(roomNumber, base + fromColumn, base + toColumn, [line, base](qint64 day) {
+        line[day - base] = OccupiedColor;
+    });
+
+    // Архив поверх кэша: его ночи в кэше есть только для видимого окна
+    if (history) {
+        for (const OccupancyHistory::Run &run : history->runs(roomNumber, base + fromColumn, base + toColumn)) {
+            std::fill(line + (run.start - base), line + (run.start - base + run.length), ArchivedColor);
+        }
+    }
+}
+
+void YearOverview::applyChanges()
+{
+    QVector<OccupancyStore::Change> changes;
+    {
+        QMutexLocker locker(&changesMutex);
+        changes.swap(pendingChanges);
+        changesScheduled = false;
+    }
+
+    for (const OccupancyStore::Change &change : changes) {
+        if (change.roomNumber == OccupancyStore::AllRooms) {
+            render();
+            return;
+        }
+        redraw(change.roomNumber, change.fromDay, change.toDay);
+    }
+}
+
+QRect YearOverview::windowRect() const
+{
+    if (!firstDay.isValid() || !windowFrom.isValid()) return QRect();
+    return QRect(int(firstDay.daysTo(windowFrom)), 0, windowDays, qMax(1, int(rooms.size())));
+}
+
+bool YearOverview::cellAt(const QPoint &pos, int *roomNumber, QDate *date) const
+{
+    if (pos.x() < 0 || pos.y() < 0 || pos.x() >= days || pos.y() >= rooms.size()) return false;
+    *roomNumber = rooms[pos.y()];
+    *date = firstDay.addDays(pos.x());
+    return true;
+}
+
+QSize YearOverview::sizeHint() const
+{
+    return QSize(qMax(1, days), qMax(1, int(rooms.size())));
+}
+
+void YearOverview::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    const QRect area = event->rect();
+    painter.fillRect(area, palette().window());
+    if (!image.isNull()) {
+        painter.drawImage(area.topLeft(), image, area);
+    }
+
+    // Рамка дней, которые сейчас в сетке
+    QRect frame = windowRect();
+    if (frame.intersects(area)) {
+        painter.setPen(QColor(30, 90, 200));
+        painter.drawRect(frame.adjusted(0, 0, -1, -1));
+    }
+}
+
+void YearOverview::mousePressEvent(QMouseEvent *event)
+{
+    int roomNumber = 0;
+    QDate date;
+    if (event->button() == Qt::LeftButton && cellAt(event->position().toPoint(), &roomNumber, &date)) {
+        emit cellActivated(roomNumber, date);
+        return;
+    }
+    QWidget::mousePressEvent(event);
+}
+
+bool YearOverview::event(QEvent *event)
+{
+    if (event->type() == QEvent::ToolTip) {
+        QHelpEvent *help = static_cast<QHelpEvent *>(event);
+        int roomNumber = 0;
+        QDate date;
+        if (cellAt(help->pos(), &roomNumber, &date)) {
+            bool occupied = occupancy.snapshot()->isOccupied(roomNumber, date) ||
+                            (history && history->isOccupied(roomNumber, date.toJulianDay()));
+            QToolTip::showText(help->globalPos(), QString("Комната %1, %2: %3")
+                                                      .arg(roomNumber)
+                                                      .arg(date.toString("dd.MM.yyyy"))
+                                                      .arg(occupied ? "занят" : "свободен"), this);
+        } else {
+            QToolTip::hideText();
+            event->ignore();
+        }
+        return true;
+    }
+    return QWidget::event(event);
+}
+
+void YearOverview::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    if (dirty) render();
+}
@@ -0,0 +1,80 @@
+#ifndef YEAROVERVIEW_H
+#define YEAROVERVIEW_H
+
+#include <QWidget>
+#include <QImage>
+#include <QDate>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+#include "sharedoccupancy.h"
+
+class OccupancyHistory;
+
+// Обзор года: пиксель на комнато-ночь, строки - комнаты в порядке сетки, столбцы - дни года.
+// Картинка рисуется прямо в QImage по снимку занятости и архиву (OccupancyHistory), без виджетов
+// на ячейку. Изменения бронирований приходят от SharedOccupancy из любого потока и
+// перерисовывают в главном потоке только затронутые отрезки строк. Пока обзор скрыт,
+// изменения лишь помечают картинку устаревшей. Щелчок по пикселю - cellActivated.
+class YearOverview : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit YearOverview(SharedOccupancy &occupancy, QWidget *parent = nullptr);
+    ~YearOverview();
+
+    void setRooms(const QVector<int> &roomNumbers);
+    // Архивные ночи; история принадлежит окну и должна жить дольше обзора
+    void setHistory(const OccupancyHistory *history);
+    // Окно основной сетки; обзор показывает год, в котором оно начинается
+    void setWindow(const QDate &fromDate, int days);
+
+    // Перерисовка всей картинки или ночей комнаты [fromDay, toDay]
+    void redraw();
+    void redraw(int roomNumber, qint64 fromDay, qint64 toDay);
+
+    QSize sizeHint() const override;
+
+signals:
+    void cellActivated(int roomNumber, const QDate &date);
+    // Полная перерисовка закончена
+    void rendered(int year, qint64 micros);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    bool event(QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+
+private:
+    void render();
+    void renderRow(int row, const OccupancyStore &store, int fromColumn, int toColumn);
+    QRect windowRect() const;
+    bool cellAt(const QPoint &pos, int *roomNumber, QDate *date) const;
+    void applyChanges();
+
+    SharedOccupancy &occupancy;
+    int listenerId;
+    const OccupancyHistory *history = nullptr;
+
+    QVector<int> rooms;
+    QHash<int, int> rowOfRoom;
+    QDate firstDay;
+    int days = 0;
+    QDate windowFrom;
+    int windowDays = 0;
+
+    QImage image;
+    // Фон столбцов: будни и выходные
+    QVector<QRgb> background;
+    bool dirty = true;
+
+    // Изменения из потоков писателей ждут главного потока
+    QMutex changesMutex;
+    QVector<OccupancyStore::Change> pendingChanges;
+    bool changesScheduled = false;
+};
+
+#endif // YEAROVERVIEW_H
@@ -0,0 +1,293 @@
+// Нагрузочный клиент для локального API HotelManager (см. HotelManager/apiserver.h).
+// Держит N keep-alive соединений, каждое шлет следующий запрос сразу после ответа.
+// Смесь: чтение доступности и, с заданной долей, бронирование со снятием той же брони.
+// В конце печатает пропускную способность и перцентили задержки отдельно для чтения и записи.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTcpSocket>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QRandomGenerator>
+#include <QDate>
+#include <QTimer>
+#include <QMap>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+
+namespace
+{
+    struct Options {
+        QString host = "127.0.0.1";
+        quint16 port = 8765;
+        int connections = 16;
+        int durationSec = 10;
+        double writeRatio = 0.05;
+        int maxNights = 30;
+    };
+
+    struct Stats {
+        QVector<qint64> micros;
+        QMap<int, qint64> statuses;
+    };
+
+    QByteArray request(const QByteArray &method, const QByteArray &target, const QByteArray &body = QByteArray())
+    {
+        QByteArray data = method + ' ' + target + " HTTP/1.1\r\nHost: localhost\r\n";
+        if (!body.isEmpty()) {
+            data += "Content-Type: application/json\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n";
+        }
+        return data + "\r\n" + body;
+    }
+
+    // Разбирает один полный ответ из начала буфера; false - ответ еще не дочитан
+    bool takeResponse(QByteArray &buffer, int &status, QByteArray &body)
+    {
+        int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) return false;
+
+        QList<QByteArray> lines = buffer.left(headerEnd).split('\n');
+        qint64 length = 0;
+        for (const QByteArray &line : lines) {
+            if (line.toLower().startsWith("content-length:")) {
+                length = line.mid(15).trimmed().toLongLong();
+            }
+        }
+        if (buffer.size() < headerEnd + 4 + length) return false;
+
+        status = lines.first().split(' ').value(1).toInt();
+        body = buffer.mid(headerEnd + 4, length);
+        buffer.remove(0, headerEnd + 4 + length);
+        return true;
+    }
+
+    // Одиночный GET с ожиданием ответа - для служебных запросов до и после прогона
+    QJsonObject fetch(const Options &options, const QByteArray &target)
+    {
+        QTcpSocket socket;
+        socket.connectToHost(options.host, options.port);
+        if (!socket.waitForConnected(3000)) return QJsonObject();
+
+        socket.write(request("GET", target));
+        QByteArray buffer;
+        int status = 0;
+        QByteArray body;
+        while (!takeResponse(buffer, status, body)) {
+            if (!socket.waitForReadyRead(3000)) return QJsonObject();
+            buffer += socket.readAll();
+        }
+        return QJsonDocument::fromJson(body).object();
+    }
+
+    QVector<int> fetchRooms(const Options &options)
+    {
+        QVector<int> rooms;
+        const QJsonArray list = fetch(options, "/rooms").value("rooms").toArray();
+        for (const QJsonValue &room : list) {
+            rooms.append(room.toObject().value("number").toInt());
+        }
+        return rooms;
+    }
+
+    class LoadConnection : public QObject
+    {
+    public:
+        LoadConnection(const Options &options, const QVector<int> &rooms, const QElapsedTimer &clock,
+                       Stats &reads, Stats &writes, std::function<void()> done)
+            : options(options), rooms(rooms), clock(clock), reads(reads), writes(writes), done(done)
+            , socket(new QTcpSocket(this)), isWrite(false), bookedRoom(0)
+        {
+            connect(socket, &QTcpSocket::connected, this, [this]() { sendNext(); });
+            connect(socket, &QTcpSocket::readyRead, this, [this]() { onReadyRead(); });
+            connect(socket, &QTcpSocket::errorOccurred, this, [this]() { finish(); });
+            socket->connectToHost(options.host, options.port);
+        }
+
+    private:
+        void sendNext()
+        {
+            if (clock.elapsed() >= options.durationSec * 1000LL) {
+                finish();
+                return;
+            }
+
+            QRandomGenerator *random = QRandomGenerator::global();
+            QDate today = QDate::currentDate();
+            QByteArray data;
+
+            if (bookedRoom) {
+                // Снимаем собственную бронь, чтобы база не заполнялась
+                isWrite = true;
+                data = request("DELETE", QString("/bookings?room=%1&from=%2&to=%3")
+                                             .arg(bookedRoom)
+                                             .arg(bookedFrom.toString(Qt::ISODate))
+                                             .arg(bookedTo.toString(Qt::ISODate)).toLatin1());
+                bookedRoom = 0;
+            } else if (!rooms.isEmpty() && random->generateDouble() < options.writeRatio) {
+                isWrite = true;
+                QJsonObject booking;
+                pendingRoom = rooms[random->bounded(int(rooms.size()))];
+                pendingFrom = today.addDays(365 + random->bounded(365));
+                pendingTo = pendingFrom.addDays(1 + random->bounded(3));
+                booking["room"] = pendingRoom;
+                booking["from"] = pendingFrom.toString(Qt::ISODate);
+                booking["to"] = pendingTo.toString(Qt::ISODate);
+                data = request("POST", "/bookings", QJsonDocument(booking).toJson(QJsonDocument::Compact));
+            } else {
+                isWrite = false;
+                QDate from = today.addDays(random->bounded(180));
+                QDate to = from.addDays(1 + random->bounded(options.maxNights));
+                data = request("GET", QString("/availability?from=%1&to=%2")
+                                          .arg(from.toString(Qt::ISODate))
+                                          .arg(to.toString(Qt::ISODate)).toLatin1());
+            }
+
+            started = clock.nsecsElapsed();
+            socket->write(data);
+        }
+
+        void onReadyRead()
+        {
+            buffer += socket->readAll();
+
+            int status = 0;
+            QByteArray body;
+            if (!takeResponse(buffer, status, body)) return;
+
+            Stats &stats = isWrite ? writes : reads;
+            stats.micros.append((clock.nsecsElapsed() - started) / 1000);
+            stats.statuses[status]++;
+
+            if (status == 201) {
+                bookedRoom = pendingRoom;
+                bookedFrom = pendingFrom;
+                bookedTo = pendingTo;
+            }
+            sendNext();
+        }
+
+        void finish()
+        {
+            if (!done) return;
+            socket->disconnectFromHost();
+            std::function<void()> callback = done;
+            done = nullptr;
+            callback();
+        }
+
+        const Options &options;
+        const QVector<int> &rooms;
+        const QElapsedTimer &clock;
+        Stats &reads;
+        Stats &writes;
+        std::function<void()> done;
+
+        QTcpSocket *socket;
+        QByteArray buffer;
+        qint64 started = 0;
+        bool isWrite;
+        int pendingRoom = 0;
+        QDate pendingFrom, pendingTo;
+        int bookedRoom;
+        QDate bookedFrom, bookedTo;
+    };
+
+    qint64 percentile(const QVector<qint64> &sorted, double p)
+    {
+        if (sorted.isEmpty()) return 0;
+        int index = qBound(0, int(sorted.size() * p + 0.5) - 1, int(sorted.size()) - 1);
+        return sorted[index];
+    }
+
+    void printStats(QTextStream &out, const QString &title, Stats stats, double seconds)
+    {
+        std::sort(stats.micros.begin(), stats.micros.end());
+
+        out << title << ": " << stats.micros.size() << " запросов, "
+            << QString::number(stats.micros.size() / seconds, 'f', 0) << " в сек\n";
+        out << "  задержка, мкс: p50 " << percentile(stats.micros, 0.5)
+            << "  p90 " << percentile(stats.micros, 0.9)
+            << "  p99 " << percentile(stats.micros, 0.99)
+            << "  p99.9 " << percentile(stats.micros, 0.999)
+            << "  max " << (stats.micros.isEmpty() ? 0 : stats.micros.last()) << "\n";
+        out << "  коды ответа:";
+        for (auto it = stats.statuses.cbegin(); it != stats.statuses.cend(); ++it) {
+            out << " " << it.key() << "=" << it.value();
+        }
+        out << "\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Нагрузочный клиент для API HotelManager");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("host", "Адрес сервера", "host", "127.0.0.1"));
+    parser.addOption(QCommandLineOption("port", "Порт сервера", "port", "8765"));
+    parser.addOption(QCommandLineOption("connections", "Число одновременных соединений", "n", "16"));
+    parser.addOption(QCommandLineOption("duration", "Длительность, сек", "sec", "10"));
+    parser.addOption(QCommandLineOption("write-ratio", "Доля бронирований среди запросов (0..1)", "ratio", "0.05"));
+    parser.addOption(QCommandLineOption("max-nights", "Максимальная длина периода доступности", "n", "30"));
+    parser.process(a);
+
+    Options options;
+    options.host = parser.value("host");
+    options.port = quint16(parser.value("port").toUInt());
+    options.connections = qMax(1, parser.value("connections").toInt());
+    options.durationSec = qMax(1, parser.value("duration").toInt());
+    options.writeRatio = qBound(0.0, parser.value("write-ratio").toDouble(), 1.0);
+    options.maxNights = qBound(1, parser.value("max-nights").toInt(), 366);
+
+    QTextStream out(stdout);
+
+    QVector<int> rooms = fetchRooms(options);
+    if (rooms.isEmpty()) {
+        out << "Не удалось получить список комнат с " << options.host << ":" << options.port << "\n";
+        return 1;
+    }
+
+    Stats reads, writes;
+    QElapsedTimer clock;
+    clock.start();
+
+    int running = options.connections;
+    for (int i = 0; i < options.connections; i++) {
+        LoadConnection *connection = new LoadConnection(options, rooms, clock, reads, writes, [&running, &a]() {
+            if (--running == 0) {
+                QTimer::singleShot(0, &a, &QCoreApplication::quit);
+            }
+        });
+        connection->setParent(&a);
+    }
+
+    a.exec();
+
+    double seconds = clock.elapsed() / 1000.0;
+    out << "Соединений: " << options.connections << ", комнат: " << rooms.size()
+        << ", длительность: " << QString::number(seconds, 'f', 1) << " сек\n";
+    printStats(out, "Чтение доступности", reads, seconds);
+    printStats(out, "Бронирование и отмена", writes, seconds);
+
+    Stats total = reads;
+    total.micros += writes.micros;
+    for (auto it = writes.statuses.cbegin(); it != writes.statuses.cend(); ++it) {
+        total.statuses[it.key()] += it.value();
+    }
+    printStats(out, "Всего", total, seconds);
+
+    QJsonObject cache = fetch(options, "/stats").value("availability_cache").toObject();
+    if (!cache.isEmpty()) {
+        out << "Кэш доступности: попаданий " << cache.value("hits").toInteger()
+            << ", промахов " << cache.value("misses").toInteger()
+            << ", доля " << QString::number(cache.value("hit_rate").toDouble() * 100.0, 'f', 1) << "%"
+            << ", удалено записью " << cache.value("invalidated").toInteger()
+            << ", записей " << cache.value("entries").toInteger() << "/" << cache.value("capacity").toInteger() << "\n";
+    }
+    return 0;
+}
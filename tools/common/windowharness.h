@@ -0,0 +1,17 @@
+#ifndef WINDOWHARNESS_H
+#define WINDOWHARNESS_H
+
+#include <QString>
+
+// Общее для инструментов, которые запускают настоящее окно HotelManager (guilatency, tracereplay)
+namespace WindowHarness
+{
+    // Настройки приложения (AppSettings) и стандартные каталоги - в каталоге dir. Вызывать до
+    // создания окна: настоящие настройки пользователя инструмент не читает и не меняет
+    void isolateSettings(const QString &dir);
+
+    // Окно обработало все, что накопилось: отложенные события, перерисовку
+    void settle();
+}
+
+#endif // WINDOWHARNESS_H
@@ -0,0 +1,8 @@
+# Общие исходники инструментов, запускающих окно HotelManager
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/windowharness.cpp
+
+HEADERS += \
+    $$PWD/windowharness.h
@@ -0,0 +1,13 @@
+QT       += core gui widgets sql concurrent network testlib
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = guilatency
+
+# Настоящее окно HotelManager со всеми его исходниками
+include($$PWD/../../HotelManager/hotelmanager.pri)
+include($$PWD/../common/windowharness.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,550 @@
+// Задержка отклика окна HotelManager на действия администратора - от щелчка до обработки
+// всех событий, включая перерисовку. Работает без дисплея (платформа offscreen) на временной
+// базе заданного размера: открытие окна, смена даты (шаг и прыжок), бронирование ячейки,
+// снятие брони, добавление комнаты, отчет, отрисовка обзора года. Каждое действие повторяется несколько раз;
+// тест действия проваливается, если медиана повторов больше бюджета.
+//
+// Настройки - переменные окружения (аргументы командной строки разбирает QTest):
+//   HOTEL_GUI_ROOMS (800, не больше 800), HOTEL_GUI_DAYS (730), HOTEL_GUI_OCCUPANCY (0.6),
+//   HOTEL_GUI_REPEATS (5)
+//   HOTEL_GUI_BUDGET_MS - бюджет всех действий, мс;
+//   HOTEL_GUI_BUDGET_<ДЕЙСТВИЕ>_MS - бюджет одного действия
+//   (OPEN, DATE_STEP, DATE_JUMP, BOOK, CANCEL, ADD_ROOM, REPORTS, OVERVIEW)
+// Настройки приложения на время прогона хранятся во временном каталоге; настоящие не затрагиваются.
+
+#include <QtTest>
+#include <QApplication>
+#include <QAction>
+#include <QDateEdit>
+#include <QDialog>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QStatusBar>
+#include <QTableWidget>
+#include <QTextEdit>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QTemporaryDir>
+#include <QRandomGenerator>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+#include "appsettings.h"
+#include "hotelmanager.h"
+#include "schema.h"
+#include "windowharness.h"
+#include "yearoverview.h"
+
+namespace
+{
+    const int FirstRoom = 100;
+    // Комнаты добавляются с номерами от 900: в окне номер комнаты не больше 999
+    const int MaxRooms = 800;
+    const int AddedRoomBase = 900;
+    // Последние комнаты базы остаются свободными - на них бронирует тест
+    const int FreeRooms = 10;
+    // Сколько ждать модальный диалог, прежде чем закрыть его и провалить действие
+    const int ModalTimeoutMs = 60000;
+
+    int envInt(const char *name, int defaultValue)
+    {
+        bool ok = false;
+        int value = qEnvironmentVariableIntValue(name, &ok);
+        return ok ? value : defaultValue;
+    }
+
+    double envDouble(const char *name, double defaultValue)
+    {
+        bool ok = false;
+        double value = qEnvironmentVariable(name).toDouble(&ok);
+        return ok ? value : defaultValue;
+    }
+
+    int budgetMs(const char *id, int defaultValue)
+    {
+        return envInt(QByteArray("HOTEL_GUI_BUDGET_") + id + "_MS", envInt("HOTEL_GUI_BUDGET_MS", defaultValue));
+    }
+
+    double median(QVector<double> values)
+    {
+        if (values.isEmpty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    // Отвечает на модальные диалоги действия, пока handler не скажет, что действие закончено.
+    // Таймер срабатывает и внутри exec() диалогов
+    class ModalDriver : public QObject
+    {
+    public:
+        using Handler = std::function<bool(QWidget *modal)>;
+
+        explicit ModalDriver(Handler handler)
+            : handler(std::move(handler))
+        {
+            timer.setInterval(1);
+            connect(&timer, &QTimer::timeout, this, [this]() {
+                QWidget *modal = QApplication::activeModalWidget();
+                if (!modal || done) return;
+
+                if (sinceModal.isValid() && sinceModal.elapsed() > ModalTimeoutMs) {
+                    timedOut = true;
+                    modal->close();
+                    return;
+                }
+                if (!sinceModal.isValid()) sinceModal.start();
+                done = this->handler(modal);
+            });
+            timer.start();
+        }
+
+        bool timedOut = false;
+
+    private:
+        Handler handler;
+        QTimer timer;
+        QElapsedTimer sinceModal;
+        bool done = false;
+    };
+}
+
+class GuiLatency : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void open();
+    void changeDate();
+    void bookCell();
+    void cancelBooking();
+    void addRoom();
+    void openReports();
+    void overview();
+    void cleanupTestCase();
+
+private:
+    struct Result {
+        QString id;
+        QString title;
+        QVector<double> samples;
+        int budget = 0;
+    };
+
+    bool generate(QString *error);
+    QAction *action(const QString &text) const;
+    int rowOfRoom(int roomNumber) const;
+    void clickCell(int row, int col);
+    void toggleBooking(int roomNumber, int col);
+    bool record(const char *id, const QString &title, int defaultBudget, const QVector<double> &samples,
+                QString *message);
+
+    QTemporaryDir workDir;
+    QString databaseFile;
+    int rooms = 0;
+    int days = 0;
+    double occupancy = 0.0;
+    int repeats = 0;
+
+    std::unique_ptr<HotelManager> window;
+    QTableWidget *table = nullptr;
+    QDateEdit *dateEdit = nullptr;
+    QVector<Result> results;
+};
+
+void GuiLatency::initTestCase()
+{
+    QVERIFY(workDir.isValid());
+
+    rooms = qBound(FreeRooms + 1, envInt("HOTEL_GUI_ROOMS", MaxRooms), MaxRooms);
+    days = qMax(1, envInt("HOTEL_GUI_DAYS", 730));
+    occupancy = qBound(0.0, envDouble("HOTEL_GUI_OCCUPANCY", 0.6), 1.0);
+    repeats = qMax(1, envInt("HOTEL_GUI_REPEATS", 5));
+
+    // До создания окна: настоящие настройки пользователя замер не читает и не меняет
+    WindowHarness::isolateSettings(workDir.path());
+
+    // Список отелей - из одной временной базы
+    {
+        AppSettings settings;
+        databaseFile = workDir.filePath("latency.db");
+        settings.beginWriteArray("properties", 1);
+        settings.setArrayIndex(0);
+        settings.setValue("name", "Замер задержек");
+        settings.setValue("databaseFile", databaseFile);
+        settings.endArray();
+        settings.setValue("activeProperty", 0);
+    }
+
+    QString error;
+    QVERIFY2(generate(&error), qPrintable(error));
+    qInfo().noquote() << QString("База: %1 комнат, %2 дней, занятость %3").arg(rooms).arg(days).arg(occupancy);
+}
+
+bool GuiLatency::generate(QString *error)
+{
+    bool ok = true;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "guilatency");
+        db.setDatabaseName(databaseFile);
+        if (!db.open()) {
+            *error = db.lastError().text();
+            ok = false;
+        } else {
+            QSqlQuery query(db);
+            for (const char *sql : {Schema::createSql<Schema::Rooms>(), Schema::createSql<Schema::Bookings>(),
+                                    Schema::createSql<Schema::Clients>(), Schema::createSql<Schema::Services>()}) {
+                if (!query.exec(sql)) {
+                    *error = "Ошибка схемы: " + query.lastError().text();
+                    ok = false;
+                }
+            }
+
+            const QStringList types = QStringList() << "Стандарт" << "Люкс" << "Семейный" << "Бизнес" << "Апартаменты";
+            QRandomGenerator random(42);
+            const qint64 firstDay = QDate::currentDate().toJulianDay() - days / 2;
+
+            db.transaction();
+
+            query.prepare(Schema::insertSql<Schema::Rooms>());
+            for (int i = 0; i < rooms && ok; i++) {
+                RoomInfo room;
+                room.number = FirstRoom + i;
+                room.type = types[i % types.size()];
+                room.capacity = 1 + i % 4;
+                room.price = 2000.0 + (i % 20) * 250.0;
+                room.description = QString("Комната %1").arg(room.number);
+                Schema::bindInsert<Schema::Rooms>(query, room);
+                ok = query.exec();
+            }
+
+            query.prepare(Schema::insertSql<Schema::Bookings>());
+            for (int i = 0; i < rooms - FreeRooms && ok; i++) {
+                for (int day = 0; day < days && ok; day++) {
+                    if (random.generateDouble() >= occupancy) continue;
+                    Schema::Booking booking;
+                    booking.roomNumber = FirstRoom + i;
+                    booking.day = firstDay + day;
+                    Schema::bindInsert<Schema::Bookings>(query, booking);
+                    ok = query.exec();
+                }
+            }
+
+            if (!ok && error->isEmpty()) *error = query.lastError().text();
+            if (!db.commit()) {
+                if (ok) *error = db.lastError().text();
+                ok = false;
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase("guilatency");
+    return ok;
+}
+
+QAction *GuiLatency::action(const QString &text) const
+{
+    for (QAction *candidate : window->findChildren<QAction *>()) {
+        if (candidate->text() == text) return candidate;
+    }
+    return nullptr;
+}
+
+int GuiLatency::rowOfRoom(int roomNumber) const
+{
+    const QString prefix = QString("Комната %1 ").arg(roomNumber);
+    for (int row = 0; row < table->rowCount(); row++) {
+        QTableWidgetItem *item = table->item(row, 0);
+        if (item && item->text().startsWith(prefix)) return row;
+    }
+    return -1;
+}
+
+void GuiLatency::clickCell(int row, int col)
+{
+    QModelIndex index = table->model()->index(row, col);
+    QTest::mouseClick(table->viewport(), Qt::LeftButton, Qt::NoModifier, table->visualRect(index).center());
+}
+
+// Бронирует и сразу снимает ночь вне замера: меняет версию данных, чтобы отчет не брался из кэша
+void GuiLatency::toggleBooking(int roomNumber, int col)
+{
+    int row = rowOfRoom(roomNumber);
+    table->scrollTo(table->model()->index(row, col));
+    clickCell(row, col);
+    action("&Новое бронирование")->trigger();
+    QMetaObject::invokeMethod(window.get(), "removeBooking");
+    WindowHarness::settle();
+}
+
+bool GuiLatency::record(const char *id, const QString &title, int defaultBudget, const QVector<double> &samples,
+                        QString *message)
+{
+    Result result;
+    result.id = id;
+    result.title = title;
+    result.samples = samples;
+    result.budget = budgetMs(id, defaultBudget);
+    results.append(result);
+
+    double med = median(samples);
+    *message = QString("%1: медиана %2 мс при бюджете %3 мс").arg(title).arg(med, 0, 'f', 1).arg(result.budget);
+    return med <= result.budget;
+}
+
+void GuiLatency::open()
+{
+    QVector<double> samples;
+    for (int i = 0; i < repeats; i++) {
+        window.reset();
+        WindowHarness::settle();
+
+        QElapsedTimer timer;
+        timer.start();
+        window.reset(new HotelManager());
+        window->show();
+        QVERIFY(QTest::qWaitForWindowExposed(window.get()));
+        WindowHarness::settle();
+        samples.append(timer.nsecsElapsed() / 1e6);
+    }
+
+    table = window->findChild<QTableWidget *>("tableWidget");
+    dateEdit = window->findChild<QDateEdit *>("dateEdit");
+    QVERIFY(table && dateEdit);
+    QCOMPARE(table->rowCount(), rooms);
+
+    QString message;
+    QVERIFY2(record("OPEN", "Открытие окна", 5000, samples, &message), qPrintable(message));
+}
+
+void GuiLatency::changeDate()
+{
+    QVERIFY(window);
+
+    // Шаг на день сдвигает столбцы, прыжок перестраивает сетку целиком
+    QVector<double> step;
+    QVector<double> jump;
+    for (int i = 0; i < repeats; i++) {
+        QElapsedTimer timer;
+        timer.start();
+        dateEdit->setDate(dateEdit->date().addDays(1));
+        WindowHarness::settle();
+        step.append(timer.nsecsElapsed() / 1e6);
+
+        timer.restart();
+        dateEdit->setDate(dateEdit->date().addDays(i % 2 ? -60 : 60));
+        WindowHarness::settle();
+        jump.append(timer.nsecsElapsed() / 1e6);
+    }
+    dateEdit->setDate(QDate::currentDate());
+    WindowHarness::settle();
+
+    QString stepMessage;
+    QString jumpMessage;
+    bool stepOk = record("DATE_STEP", "Следующий день", 100, step, &stepMessage);
+    bool jumpOk = record("DATE_JUMP", "Переход на 60 дней", 300, jump, &jumpMessage);
+    QVERIFY2(stepOk, qPrintable(stepMessage));
+    QVERIFY2(jumpOk, qPrintable(jumpMessage));
+}
+
+void GuiLatency::bookCell()
+{
+    QVERIFY(window);
+
+    QAction *book = action("&Новое бронирование");
+    QVERIFY(book);
+
+    QVector<double> samples;
+    for (int i = 0; i < repeats; i++) {
+        int row = rowOfRoom(FirstRoom + rooms - 1 - i % FreeRooms);
+        int col = 1 + i % 29;
+        QVERIFY(row >= 0);
+        table->scrollTo(table->model()->index(row, col));
+        WindowHarness::settle();
+
+        QElapsedTimer timer;
+        timer.start();
+        clickCell(row, col);
+        book->trigger();
+        WindowHarness::settle();
+        samples.append(timer.nsecsElapsed() / 1e6);
+
+        QVERIFY2(window->statusBar()->currentMessage().contains("забронирована"),
+                 qPrintable(window->statusBar()->currentMessage()));
+    }
+
+    QString message;
+    QVERIFY2(record("BOOK", "Бронирование ячейки", 100, samples, &message), qPrintable(message));
+}
+
+void GuiLatency::cancelBooking()
+{
+    QVERIFY(window);
+
+    // Снимаются брони, поставленные в bookCell; в окне это пункт контекстного меню
+    QVector<double> samples;
+    for (int i = 0; i < repeats; i++) {
+        int row = rowOfRoom(FirstRoom + rooms - 1 - i % FreeRooms);
+        int col = 1 + i % 29;
+        QVERIFY(row >= 0);
+        table->scrollTo(table->model()->index(row, col));
+        WindowHarness::settle();
+
+        QElapsedTimer timer;
+        timer.start();
+        clickCell(row, col);
+        QMetaObject::invokeMethod(window.get(), "removeBooking");
+        WindowHarness::settle();
+        samples.append(timer.nsecsElapsed() / 1e6);
+
+        QVERIFY2(window->statusBar()->currentMessage().contains("снята"),
+                 qPrintable(window->statusBar()->currentMessage()));
+    }
+
+    QString message;
+    QVERIFY2(record("CANCEL", "Снятие брони", 100, samples, &message), qPrintable(message));
+}
+
+void GuiLatency::addRoom()
+{
+    QVERIFY(window);
+
+    QAction *add = action("&Добавить комнату");
+    QVERIFY(add);
+
+    // Время включает показ и закрытие всех диалогов мастера
+    QVector<double> samples;
+    for (int i = 0; i < repeats; i++) {
+        const int roomNumber = AddedRoomBase + i;
+        ModalDriver driver([roomNumber](QWidget *modal) {
+            if (QInputDialog *input = qobject_cast<QInputDialog *>(modal)) {
+                if (input->inputMode() == QInputDialog::IntInput && input->labelText().contains("номер")) {
+                    input->setIntValue(roomNumber);
+                }
+                input->accept();
+            } else if (QMessageBox *box = qobject_cast<QMessageBox *>(modal)) {
+                box->accept();
+            } else if (QLineEdit *edit = modal->findChild<QLineEdit *>()) {
+                edit->setText("Добавлена при замере");
+                for (QPushButton *button : modal->findChildren<QPushButton *>()) {
+                    if (button->text() == "OK") button->click();
+                }
+            }
+            return false;
+        });
+
+        QElapsedTimer timer;
+        timer.start();
+        add->trigger();
+        WindowHarness::settle();
+        samples.append(timer.nsecsElapsed() / 1e6);
+
+        QVERIFY(!driver.timedOut);
+        QVERIFY2(rowOfRoom(roomNumber) >= 0, qPrintable(QString("Комната %1 не появилась в сетке").arg(roomNumber)));
+    }
+
+    QString message;
+    QVERIFY2(record("ADD_ROOM", "Добавление комнаты", 1000, samples, &message), qPrintable(message));
+}
+
+void GuiLatency::openReports()
+{
+    QVERIFY(window);
+
+    QAction *reports = action("&Отчеты");
+    QVERIFY(reports);
+
+    // Замер - от выбора пункта меню до показа готового отчета за три месяца
+    QVector<double> samples;
+    for (int i = 0; i < repeats; i++) {
+        toggleBooking(FirstRoom + rooms - 1, 1);
+
+        QElapsedTimer timer;
+        qint64 shownNs = -1;
+        ModalDriver driver([&timer, &shownNs](QWidget *modal) {
+            QTextEdit *text = modal->findChild<QTextEdit *>();
+            if (!text || text->toPlainText().isEmpty() || text->toPlainText() == "Отчет строится...") {
+                return false;
+            }
+            shownNs = timer.nsecsElapsed();
+            modal->close();
+            return true;
+        });
+
+        timer.start();
+        reports->trigger();
+        WindowHarness::settle();
+
+        QVERIFY(!driver.timedOut);
+        QVERIFY(shownNs >= 0);
+        samples.append(shownNs / 1e6);
+    }
+
+    QString message;
+    QVERIFY2(record("REPORTS", "Отчет за квартал", 10000, samples, &message), qPrintable(message));
+}
+
+void GuiLatency::overview()
+{
+    QVERIFY(window);
+
+    QAction *show = action("Обзор &года");
+    YearOverview *overview = window->findChild<YearOverview *>();
+    QVERIFY(show && overview);
+
+    // Замер - полная отрисовка картинки всех комнат за год, без вывода на экран
+    QVector<double> samples;
+    QMetaObject::Connection connection = connect(overview, &YearOverview::rendered, this,
+                                                 [&samples](int, qint64 micros) { samples.append(micros / 1000.0); });
+    show->trigger();
+    WindowHarness::settle();
+    samples.clear();
+    for (int i = 0; i < repeats; i++) {
+        overview->redraw();
+    }
+    disconnect(connection);
+    show->trigger();
+    WindowHarness::settle();
+
+    QCOMPARE(samples.size(), repeats);
+    QString message;
+    QVERIFY2(record("OVERVIEW", "Отрисовка обзора года", 20, samples, &message), qPrintable(message));
+}
+
+void GuiLatency::cleanupTestCase()
+{
+    window.reset();
+    WindowHarness::settle();
+
+    qInfo().noquote() << QString("%1 %2 %3 %4")
+                             .arg(QString("Действие"), -24)
+                             .arg(QString("медиана, мс"), 12)
+                             .arg(QString("макс, мс"), 10)
+                             .arg(QString("бюджет, мс"), 12);
+    for (const Result &result : results) {
+        double max = *std::max_element(result.samples.begin(), result.samples.end());
+        qInfo().noquote() << QString("%1 %2 %3 %4")
+                                 .arg(result.title, -24)
+                                 .arg(median(result.samples), 12, 'f', 1)
+                                 .arg(max, 10, 'f', 1)
+                                 .arg(result.budget, 12);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Без дисплея окно рисуется в памяти; явно заданную платформу не трогаем
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    GuiLatency test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "main.moc"
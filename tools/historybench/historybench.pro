@@ -0,0 +1,19 @@
+QT       += core sql
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = historybench
+
+APP_DIR = $$PWD/../../HotelManager
+INCLUDEPATH += $$APP_DIR
+
+SOURCES += \
+    main.cpp \
+    $$APP_DIR/occupancyhistory.cpp \
+    $$APP_DIR/sqltracer.cpp
+
+HEADERS += \
+    $$APP_DIR/occupancyhistory.h \
+    $$APP_DIR/sqltracer.h
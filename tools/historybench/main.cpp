@@ -0,0 +1,303 @@
+// Сравнение сжатой истории занятости (HotelManager/occupancyhistory.h) с несжатым битовым
+// массивом (бит на ночь каждой комнаты) на синтетической истории за несколько лет:
+// память, построение, поиск ночи, подсчет за 30 дней, занятость по дням и полная распаковка.
+// Брони - серии ночей со случайной длиной около --stay, между ними свободные промежутки
+// такой длины, чтобы средняя занятость была --occupancy. Печатается медиана по прогонам;
+// контрольные суммы обеих структур должны совпасть.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QHash>
+#include <QVector>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "occupancyhistory.h"
+
+namespace
+{
+    struct Options {
+        int rooms = 2000;
+        int years = 5;
+        double occupancy = 0.7;
+        double stay = 3.0;
+        int lookups = 1000000;
+        int iterations = 5;
+    };
+
+    // Бит на каждую ночь [firstDay, firstDay + days) каждой комнаты
+    class Bitmap
+    {
+    public:
+        Bitmap(qint64 firstDay, int days) : firstDay(firstDay), days(days) {}
+
+        void set(int roomNumber, qint64 day)
+        {
+            QVector<quint64> &words = rooms[roomNumber];
+            if (words.isEmpty()) words.resize((days + 63) / 64);
+            qint64 bit = day - firstDay;
+            words[int(bit / 64)] |= quint64(1) << (bit % 64);
+        }
+
+        bool isOccupied(int roomNumber, qint64 day) const
+        {
+            auto it = rooms.constFind(roomNumber);
+            qint64 bit = day - firstDay;
+            if (it == rooms.constEnd() || bit < 0 || bit >= days) return false;
+            return ((*it)[int(bit / 64)] >> (bit % 64)) & 1;
+        }
+
+        int countOccupied(int roomNumber, qint64 fromDay, qint64 toDay) const
+        {
+            auto it = rooms.constFind(roomNumber);
+            if (it == rooms.constEnd()) return 0;
+            qint64 from = qMax<qint64>(0, fromDay - firstDay);
+            qint64 to = qMin<qint64>(days - 1, toDay - firstDay);
+            if (to < from) return 0;
+
+            const QVector<quint64> &words = *it;
+            int first = int(from / 64), last = int(to / 64);
+            int count = 0;
+            for (int w = first; w <= last; w++) {
+                quint64 word = words[w];
+                if (w == first) word &= ~quint64(0) << (from % 64);
+                if (w == last && to % 64 != 63) word &= (quint64(1) << (to % 64 + 1)) - 1;
+                count += qPopulationCount(word);
+            }
+            return count;
+        }
+
+        QVector<int> occupiedPerDay(qint64 fromDay, qint64 toDay) const
+        {
+            QVector<int> counts(int(toDay - fromDay + 1), 0);
+            for (const QVector<quint64> &words : rooms) {
+                for (qint64 day = fromDay; day <= toDay; day++) {
+                    qint64 bit = day - firstDay;
+                    if (bit >= 0 && bit < days && ((words[int(bit / 64)] >> (bit % 64)) & 1)) {
+                        counts[int(day - fromDay)]++;
+                    }
+                }
+            }
+            return counts;
+        }
+
+        // Перебор всех занятых ночей
+        void forEachNight(const std::function<void(int, qint64)> &visit) const
+        {
+            for (auto it = rooms.cbegin(); it != rooms.cend(); ++it) {
+                for (int w = 0; w < it->size(); w++) {
+                    quint64 word = (*it)[w];
+                    while (word) {
+                        int bit = qCountTrailingZeroBits(word);
+                        visit(it.key(), firstDay + qint64(w) * 64 + bit);
+                        word &= word - 1;
+                    }
+                }
+            }
+        }
+
+        qint64 memoryBytes() const
+        {
+            qint64 total = 0;
+            for (const QVector<quint64> &words : rooms) {
+                total += qint64(words.capacity()) * qint64(sizeof(quint64)) + qint64(sizeof(words)) + qint64(sizeof(int));
+            }
+            return total;
+        }
+
+    private:
+        qint64 firstDay;
+        int days;
+        QHash<int, QVector<quint64>> rooms;
+    };
+
+    struct Night {
+        int roomNumber;
+        qint64 day;
+    };
+
+    // Ночи по порядку (комната, день), как их отдает OccupancyHistory::load
+    QVector<Night> generate(const Options &options, qint64 firstDay, int days)
+    {
+        QRandomGenerator random(42);
+        const double gap = options.stay * (1.0 - options.occupancy) / qMax(options.occupancy, 1e-6);
+        auto length = [&random](double mean) {
+            // Геометрическое распределение со средним mean, не короче одной ночи
+            double p = 1.0 / qMax(1.0, mean);
+            return 1 + int(std::log(1.0 - random.generateDouble()) / std::log(1.0 - qMin(p, 0.999999)));
+        };
+
+        QVector<Night> nights;
+        if (options.occupancy <= 0.0) return nights;
+        nights.reserve(int(qint64(options.rooms) * days * options.occupancy * 1.1));
+        for (int room = 0; room < options.rooms; room++) {
+            qint64 day = firstDay + (options.occupancy < 1.0 ? length(gap) - 1 : 0);
+            while (day < firstDay + days) {
+                int stay = length(options.stay);
+                for (int i = 0; i < stay && day < firstDay + days; i++, day++) {
+                    nights.append({100 + room, day});
+                }
+                if (options.occupancy < 1.0) day += length(gap);
+            }
+        }
+        return nights;
+    }
+
+    // Медиана времени прогона, мс
+    double measure(int iterations, const std::function<void()> &run)
+    {
+        QVector<double> times;
+        for (int i = 0; i < iterations; i++) {
+            QElapsedTimer timer;
+            timer.start();
+            run();
+            times.append(timer.nsecsElapsed() / 1e6);
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    void report(QTextStream &out, const QString &title, double runsMs, double bitmapMs, const QString &unit = "мс")
+    {
+        out << QString("%1\n").arg(title)
+            << QString("  серии    %1 %2\n").arg(runsMs, 0, 'f', 3).arg(unit)
+            << QString("  битмап   %1 %2\n").arg(bitmapMs, 0, 'f', 3).arg(unit)
+            << QString("  серии/битмап %1x\n").arg(bitmapMs > 0 ? runsMs / bitmapMs : 0.0, 0, 'f', 2);
+        out.flush();
+    }
+
+    bool check(QTextStream &out, const QString &title, qint64 runsSum, qint64 bitmapSum)
+    {
+        if (runsSum == bitmapSum) return true;
+        out << "Расхождение (" << title << "): " << runsSum << " != " << bitmapSum << "\n";
+        return false;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Сжатая история занятости против битового массива");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("rooms", "Комнат", "n", "2000"));
+    parser.addOption(QCommandLineOption("years", "Лет истории", "n", "5"));
+    parser.addOption(QCommandLineOption("occupancy", "Доля занятых ночей (0..1)", "ratio", "0.7"));
+    parser.addOption(QCommandLineOption("stay", "Средняя длина брони, ночей", "n", "3"));
+    parser.addOption(QCommandLineOption("lookups", "Запросов на замер поиска и подсчета", "n", "1000000"));
+    parser.addOption(QCommandLineOption("iterations", "Прогонов на каждый вариант", "n", "5"));
+    parser.process(a);
+
+    Options options;
+    options.rooms = qMax(1, parser.value("rooms").toInt());
+    options.years = qMax(1, parser.value("years").toInt());
+    options.occupancy = qBound(0.0, parser.value("occupancy").toDouble(), 1.0);
+    options.stay = qMax(1.0, parser.value("stay").toDouble());
+    options.lookups = qMax(1, parser.value("lookups").toInt());
+    options.iterations = qMax(1, parser.value("iterations").toInt());
+
+    QTextStream out(stdout);
+
+    const int days = options.years * 365;
+    const qint64 firstDay = QDate::currentDate().toJulianDay() - days;
+    QVector<Night> nights = generate(options, firstDay, days);
+
+    OccupancyHistory history;
+    Bitmap bitmap(firstDay, days);
+    double runsMs = measure(options.iterations, [&]() {
+        history.clear();
+        for (const Night &night : nights) history.append(night.roomNumber, night.day);
+    });
+    double bitmapMs = measure(options.iterations, [&]() {
+        bitmap = Bitmap(firstDay, days);
+        for (const Night &night : nights) bitmap.set(night.roomNumber, night.day);
+    });
+
+    out << QString("%1 комнат x %2 дней, занято ночей %3 (%4), серий %5, в среднем %6 ночи на серию\n\n")
+               .arg(options.rooms).arg(days).arg(history.nights())
+               .arg(double(history.nights()) / (qint64(options.rooms) * days), 0, 'f', 3)
+               .arg(history.runCount())
+               .arg(history.runCount() > 0 ? double(history.nights()) / history.runCount() : 0.0, 0, 'f', 2);
+    out << QString("Память\n  серии    %1 КБ\n  битмап   %2 КБ\n  серии/битмап %3x\n")
+               .arg(history.memoryBytes() / 1024.0, 0, 'f', 1)
+               .arg(bitmap.memoryBytes() / 1024.0, 0, 'f', 1)
+               .arg(bitmap.memoryBytes() > 0 ? double(history.memoryBytes()) / bitmap.memoryBytes() : 0.0, 0, 'f', 3);
+    report(out, "Построение из отсортированных ночей", runsMs, bitmapMs);
+
+    // Одни и те же случайные запросы для обеих структур
+    QRandomGenerator random(7);
+    QVector<Night> probes(options.lookups);
+    for (Night &probe : probes) {
+        probe.roomNumber = 100 + int(random.bounded(options.rooms));
+        probe.day = firstDay + random.bounded(days);
+    }
+
+    bool ok = true;
+    qint64 runsSum = 0, bitmapSum = 0;
+    runsMs = measure(options.iterations, [&]() {
+        runsSum = 0;
+        for (const Night &probe : probes) runsSum += history.isOccupied(probe.roomNumber, probe.day);
+    });
+    bitmapMs = measure(options.iterations, [&]() {
+        bitmapSum = 0;
+        for (const Night &probe : probes) bitmapSum += bitmap.isOccupied(probe.roomNumber, probe.day);
+    });
+    report(out, "Поиск ночи, нс на запрос", runsMs * 1e6 / probes.size(), bitmapMs * 1e6 / probes.size(), "нс");
+    ok = check(out, "поиск", runsSum, bitmapSum) && ok;
+
+    runsMs = measure(options.iterations, [&]() {
+        runsSum = 0;
+        for (const Night &probe : probes) runsSum += history.countOccupied(probe.roomNumber, probe.day, probe.day + 29);
+    });
+    bitmapMs = measure(options.iterations, [&]() {
+        bitmapSum = 0;
+        for (const Night &probe : probes) bitmapSum += bitmap.countOccupied(probe.roomNumber, probe.day, probe.day + 29);
+    });
+    report(out, "Подсчет занятых ночей за 30 дней, нс на запрос",
+           runsMs * 1e6 / probes.size(), bitmapMs * 1e6 / probes.size(), "нс");
+    ok = check(out, "подсчет", runsSum, bitmapSum) && ok;
+
+    // Знаменатель отчета по дням: все комнаты за последний год
+    const qint64 yearFrom = firstDay + days - 365;
+    const qint64 yearTo = firstDay + days - 1;
+    runsMs = measure(options.iterations, [&]() {
+        runsSum = 0;
+        for (int count : history.occupiedPerDay(yearFrom, yearTo)) runsSum += count;
+    });
+    bitmapMs = measure(options.iterations, [&]() {
+        bitmapSum = 0;
+        for (int count : bitmap.occupiedPerDay(yearFrom, yearTo)) bitmapSum += count;
+    });
+    report(out, "Занятость по дням за год", runsMs, bitmapMs);
+    ok = check(out, "по дням", runsSum, bitmapSum) && ok;
+
+    // Распаковка: перебор каждой занятой ночи всей истории
+    runsMs = measure(options.iterations, [&]() {
+        runsSum = 0;
+        for (int roomNumber : history.roomNumbers()) {
+            for (const OccupancyHistory::Run &run : history.runs(roomNumber, firstDay, firstDay + days - 1)) {
+                for (qint64 day = run.start; day < run.start + run.length; day++) runsSum += day - firstDay + roomNumber;
+            }
+        }
+    });
+    bitmapMs = measure(options.iterations, [&]() {
+        bitmapSum = 0;
+        bitmap.forEachNight([&bitmapSum, firstDay](int roomNumber, qint64 day) {
+            bitmapSum += day - firstDay + roomNumber;
+        });
+    });
+    report(out, "Распаковка всех ночей", runsMs, bitmapMs);
+    out << QString("  серии    %1 млн ночей/с\n  битмап   %2 млн ночей/с\n")
+               .arg(runsMs > 0 ? history.nights() / runsMs / 1000.0 : 0.0, 0, 'f', 1)
+               .arg(bitmapMs > 0 ? history.nights() / bitmapMs / 1000.0 : 0.0, 0, 'f', 1);
+    ok = check(out, "распаковка", runsSum, bitmapSum) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+QT       += core sql concurrent
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = hotelctl
+
+APP_DIR = $$PWD/../../HotelManager
+INCLUDEPATH += $$APP_DIR
+
+SOURCES += \
+    main.cpp \
+    $$APP_DIR/bookingarchiver.cpp \
+    $$APP_DIR/connectionpool.cpp \
+    $$APP_DIR/dbmigration.cpp \
+    $$APP_DIR/occupancyforecast.cpp \
+    $$APP_DIR/occupancystore.cpp \
+    $$APP_DIR/propertymanager.cpp \
+    $$APP_DIR/ratetable.cpp \
+    $$APP_DIR/reportgenerator.cpp \
+    $$APP_DIR/sharedoccupancy.cpp \
+    $$APP_DIR/sqlitefastpath.cpp \
+    $$APP_DIR/sqltracer.cpp \
+    $$APP_DIR/validation.cpp
+
+HEADERS += \
+    $$APP_DIR/appsettings.h \
+    $$APP_DIR/bookingarchiver.h \
+    $$APP_DIR/connectionpool.h \
+    $$APP_DIR/dbmigration.h \
+    $$APP_DIR/occupancyforecast.h \
+    $$APP_DIR/occupancystore.h \
+    $$APP_DIR/propertymanager.h \
+    $$APP_DIR/ratetable.h \
+    $$APP_DIR/reportgenerator.h \
+    $$APP_DIR/roomindex.h \
+    $$APP_DIR/schema.h \
+    $$APP_DIR/sharedoccupancy.h \
+    $$APP_DIR/sqlitefastpath.h \
+    $$APP_DIR/sqltracer.h \
+    $$APP_DIR/validation.h
+
+# Как у приложения: qmake CONFIG+=sqlite_fastpath, только с Qt, собранным с -system-sqlite
+sqlite_fastpath {
+    DEFINES += HOTEL_SQLITE_FASTPATH
+    LIBS += -lsqlite3
+}
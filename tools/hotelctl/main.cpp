@@ -0,0 +1,762 @@
+// Работа с базой HotelManager из командной строки, без окна: ночные и пакетные задачи
+// (закрыть этаж на ремонт, снять бронь группы, заезды на сегодня) и задания cron.
+// Схема та же, что у приложения; по умолчанию - база активного отеля из настроек HotelManager.
+// Запись идет подготовленными запросами, одна транзакция на команду; run выполняет файл команд
+// целиком в одной транзакции: либо все строки, либо ни одной, и одна фиксация на тысячи операций.
+// Данные (списки комнат, отчет) печатаются в stdout, итоги и ошибки - в stderr.
+// Окно и API (--serve) держат занятость в памяти и видят эти изменения после "Обновить" или
+// перезапуска; с отложенной записью в окне пересечения с ними оно покажет как конфликты.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QFile>
+#include <QFileInfo>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QMap>
+#include <QProcess>
+#include <QSet>
+#include <QTextStream>
+#include <algorithm>
+#include <memory>
+
+#include "bookingarchiver.h"
+#include "connectionpool.h"
+#include "dbmigration.h"
+#include "occupancyforecast.h"
+#include "propertymanager.h"
+#include "ratetable.h"
+#include "reportgenerator.h"
+#include "schema.h"
+#include "sharedoccupancy.h"
+#include "sqltracer.h"
+#include "validation.h"
+
+namespace
+{
+    const char *Commands =
+        "Команды:\n"
+        "  book КОМНАТЫ С ПО                     забронировать ночи с С по ПО включительно\n"
+        "  cancel КОМНАТЫ С ПО                   снять бронь (и в архиве)\n"
+        "  add-room НОМЕР ТИП ВМЕСТ. ЦЕНА [ОПИСАНИЕ]\n"
+        "  availability С ПО [ТИП [ВМЕСТ.]]      комнаты, свободные все ночи периода\n"
+        "  arrivals [ДАТА]                       заезды дня (по умолчанию сегодня)\n"
+        "  report С ПО [ФАЙЛ.html]               отчет по отелю, как в окне\n"
+        "  run ФАЙЛ|-                            команды из файла или stdin, по одной в строке,\n"
+        "                                        одной транзакцией; # - комментарий\n"
+        "\n"
+        "КОМНАТЫ: 101,102,300-399 или all; в диапазон попадают только существующие комнаты.\n"
+        "Даты: yyyy-MM-dd, dd.MM.yyyy, today, tomorrow, yesterday, +N/-N дней от сегодня.\n";
+
+    // Опечатка в годе не должна бронировать столетие
+    const int MaxPeriodDays = 3660;
+
+    const char *ConnectionName = "hotelctl";
+
+    bool parseDay(const QString &text, qint64 *day)
+    {
+        const qint64 today = QDate::currentDate().toJulianDay();
+        if (text == "today") {
+            *day = today;
+            return true;
+        }
+        if (text == "tomorrow") {
+            *day = today + 1;
+            return true;
+        }
+        if (text == "yesterday") {
+            *day = today - 1;
+            return true;
+        }
+        if (text.startsWith('+') || text.startsWith('-')) {
+            bool ok = false;
+            int offset = text.toInt(&ok);
+            if (ok) *day = today + offset;
+            return ok;
+        }
+
+        QDate date = QDate::fromString(text, "yyyy-MM-dd");
+        if (!date.isValid()) date = QDate::fromString(text, "dd.MM.yyyy");
+        if (!date.isValid()) return false;
+        *day = date.toJulianDay();
+        return true;
+    }
+
+    QString dayText(qint64 day)
+    {
+        return QDate::fromJulianDay(day).toString("yyyy-MM-dd");
+    }
+
+    class Control
+    {
+    public:
+        struct Counters {
+            qint64 booked = 0;
+            qint64 alreadyBooked = 0;
+            qint64 cancelled = 0;
+            qint64 notBooked = 0;
+            int roomsAdded = 0;
+        };
+
+        Control(QTextStream &out, QTextStream &err)
+            : out(out)
+            , err(err)
+        {
+        }
+
+        ~Control()
+        {
+            // Запросы держат соединение - освобождаем их до removeDatabase
+            insertBooking.reset();
+            removeBooking.reset();
+            removeArchived.reset();
+            if (db.isOpen()) db.close();
+            db = QSqlDatabase();
+            QSqlDatabase::removeDatabase(ConnectionName);
+        }
+
+        bool open(const QString &databaseFile, QString *error);
+
+        bool begin(QString *error);
+        bool commit(QString *error);
+        void rollback() { db.rollback(); }
+
+        // Команды записи внутри run выполняются в общей транзакции; report и run там недоступны
+        static bool isWrite(const QString &command)
+        {
+            return command == "book" || command == "cancel" || command == "add-room";
+        }
+        bool execute(const QStringList &args, bool inBatch, QString *error);
+
+        const Counters &counters() const { return totals; }
+
+    private:
+        bool parseRooms(const QString &text, QVector<int> *numbers, QString *error) const;
+        bool parsePeriod(const QString &fromText, const QString &toText, qint64 *fromDay, qint64 *toDay,
+                         QString *error) const;
+        QString bookingSource(qint64 fromDay) const;
+
+        bool book(const QStringList &args, QString *error);
+        bool cancel(const QStringList &args, QString *error);
+        bool addRoom(const QStringList &args, QString *error);
+        bool availability(const QStringList &args, QString *error);
+        bool arrivals(const QStringList &args, QString *error);
+        bool report(const QStringList &args, QString *error);
+
+        QTextStream &out;
+        QTextStream &err;
+        QSqlDatabase db;
+        bool archive = false;
+        // Комнаты по номеру - для проверки команд и диапазонов без запросов к БД
+        QMap<int, RoomInfo> rooms;
+
+        // Готовятся один раз: пакет из тысяч ночей - только привязка и выполнение
+        std::unique_ptr<TracedQuery> insertBooking;
+        std::unique_ptr<TracedQuery> removeBooking;
+        std::unique_ptr<TracedQuery> removeArchived;
+
+        Counters totals;
+    };
+
+    bool Control::open(const QString &databaseFile, QString *error)
+    {
+        db = QSqlDatabase::addDatabase("QSQLITE", ConnectionName);
+        db.setDatabaseName(databaseFile);
+        if (!db.open()) {
+            if (error) *error = "Не удалось открыть базу " + databaseFile + ": " + db.lastError().text();
+            return false;
+        }
+        ConnectionPool::applyPragmas(db);
+
+        // Новая база - те же таблицы, что создает окно
+        {
+            TracedQuery query(db);
+            const QString statements[] = {
+                Schema::createSql<Schema::Bookings>(),
+                "CREATE INDEX IF NOT EXISTS idx_bookings_date ON bookings(booking_date)",
+                Schema::createSql<Schema::Rooms>()
+            };
+            for (const QString &sql : statements) {
+                if (!query.exec(sql)) {
+                    if (error) *error = "Не удалось создать таблицы: " + query.lastError().text();
+                    return false;
+                }
+            }
+        }
+
+        QString archiveError;
+        archive = BookingArchiver::attachArchive(db, BookingArchiver::archiveFileFor(databaseFile), &archiveError);
+        if (!archive) {
+            err << "Архив не подключен, работаем только с рабочей таблицей: " << archiveError << "\n";
+        }
+
+        if (!DatabaseMigration::migrateBookingDates(db, "main", error)) {
+            return false;
+        }
+        QString migrationError;
+        if (archive && !DatabaseMigration::migrateBookingDates(db, "archive", &migrationError)) {
+            err << "Не удалось обновить формат дат в архиве: " << migrationError << "\n";
+        }
+
+        for (const RoomInfo &room : PropertyManager::loadRooms(db)) {
+            rooms.insert(room.number, room);
+        }
+
+        // Архивную ночь не бронируем второй раз в рабочей таблице
+        insertBooking.reset(new TracedQuery(db));
+        insertBooking->prepare(archive
+            ? "INSERT OR IGNORE INTO main.bookings (room_number, booking_date) SELECT ?, ? "
+              "WHERE NOT EXISTS (SELECT 1 FROM archive.bookings WHERE room_number = ? AND booking_date = ?)"
+            : "INSERT OR IGNORE INTO main.bookings (room_number, booking_date) VALUES (?, ?)");
+        removeBooking.reset(new TracedQuery(db));
+        removeBooking->prepare("DELETE FROM main.bookings WHERE room_number = ? AND booking_date = ?");
+        if (archive) {
+            removeArchived.reset(new TracedQuery(db));
+            removeArchived->prepare("DELETE FROM archive.bookings WHERE room_number = ? AND booking_date = ?");
+        }
+        return true;
+    }
+
+    bool Control::begin(QString *error)
+    {
+        if (db.transaction()) return true;
+        if (error) *error = "Не удалось начать транзакцию: " + db.lastError().text();
+        return false;
+    }
+
+    bool Control::commit(QString *error)
+    {
+        if (db.commit()) return true;
+        if (error) *error = "Не удалось зафиксировать изменения: " + db.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    bool Control::execute(const QStringList &args, bool inBatch, QString *error)
+    {
+        const QString command = args.value(0);
+        if (command == "book") return book(args, error);
+        if (command == "cancel") return cancel(args, error);
+        if (command == "add-room") return addRoom(args, error);
+        if (command == "availability") return availability(args, error);
+        if (command == "arrivals") return arrivals(args, error);
+        if (command == "report" && !inBatch) return report(args, error);
+
+        if (error) {
+            *error = inBatch && (command == "report" || command == "run")
+                         ? "Команда " + command + " недоступна внутри run"
+                         : "Неизвестная команда: " + command;
+        }
+        return false;
+    }
+
+    bool Control::parseRooms(const QString &text, QVector<int> *numbers, QString *error) const
+    {
+        QSet<int> selected;
+        for (QString part : text.split(',', Qt::SkipEmptyParts)) {
+            part = part.trimmed();
+            if (part == "all") {
+                for (auto it = rooms.keyBegin(); it != rooms.keyEnd(); ++it) {
+                    selected.insert(*it);
+                }
+                continue;
+            }
+
+            bool fromOk = false;
+            bool toOk = false;
+            int dash = part.indexOf('-', 1);
+            if (dash > 0) {
+                int from = part.left(dash).toInt(&fromOk);
+                int to = part.mid(dash + 1).toInt(&toOk);
+                if (!fromOk || !toOk || to < from) {
+                    if (error) *error = "Некорректный диапазон комнат: " + part;
+                    return false;
+                }
+                int found = 0;
+                for (auto it = rooms.lowerBound(from); it != rooms.end() && it.key() <= to; ++it) {
+                    selected.insert(it.key());
+                    found++;
+                }
+                if (found == 0) {
+                    if (error) *error = "В диапазоне " + part + " нет комнат";
+                    return false;
+                }
+            } else {
+                int number = part.toInt(&fromOk);
+                if (!fromOk) {
+                    if (error) *error = "Некорректный номер комнаты: " + part;
+                    return false;
+                }
+                if (!rooms.contains(number)) {
+                    if (error) *error = QString("Комнаты %1 нет").arg(number);
+                    return false;
+                }
+                selected.insert(number);
+            }
+        }
+
+        if (selected.isEmpty()) {
+            if (error) *error = "Не указаны комнаты";
+            return false;
+        }
+        *numbers = QVector<int>(selected.cbegin(), selected.cend());
+        std::sort(numbers->begin(), numbers->end());
+        return true;
+    }
+
+    bool Control::parsePeriod(const QString &fromText, const QString &toText, qint64 *fromDay, qint64 *toDay,
+                              QString *error) const
+    {
+        if (!parseDay(fromText, fromDay)) {
+            if (error) *error = "Некорректная дата: " + fromText;
+            return false;
+        }
+        if (!parseDay(toText, toDay)) {
+            if (error) *error = "Некорректная дата: " + toText;
+            return false;
+        }
+        if (*toDay < *fromDay) {
+            if (error) *error = "Конец периода раньше начала";
+            return false;
+        }
+        if (*toDay - *fromDay + 1 > MaxPeriodDays) {
+            if (error) *error = QString("Период длиннее %1 дней").arg(MaxPeriodDays);
+            return false;
+        }
+        return true;
+    }
+
+    QString Control::bookingSource(qint64 fromDay) const
+    {
+        // В архиве только прошлые ночи - будущее читаем из рабочей таблицы по ее индексам
+        return archive && fromDay < QDate::currentDate().toJulianDay() ? "all_bookings" : "main.bookings";
+    }
+
+    bool Control::book(const QStringList &args, QString *error)
+    {
+        QVector<int> numbers;
+        qint64 fromDay = 0;
+        qint64 toDay = 0;
+        if (args.size() != 4) {
+            if (error) *error = "Формат: book КОМНАТЫ С ПО";
+            return false;
+        }
+        if (!parseRooms(args[1], &numbers, error) || !parsePeriod(args[2], args[3], &fromDay, &toDay, error)) {
+            return false;
+        }
+
+        for (int roomNumber : numbers) {
+            for (qint64 day = fromDay; day <= toDay; day++) {
+                insertBooking->addBindValue(roomNumber);
+                insertBooking->addBindValue(day);
+                if (archive) {
+                    insertBooking->addBindValue(roomNumber);
+                    insertBooking->addBindValue(day);
+                }
+                if (!insertBooking->exec()) {
+                    if (error) *error = "Ошибка записи: " + insertBooking->lastError().text();
+                    return false;
+                }
+                if (insertBooking->numRowsAffected() > 0) {
+                    totals.booked++;
+                } else {
+                    totals.alreadyBooked++;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool Control::cancel(const QStringList &args, QString *error)
+    {
+        QVector<int> numbers;
+        qint64 fromDay = 0;
+        qint64 toDay = 0;
+        if (args.size() != 4) {
+            if (error) *error = "Формат: cancel КОМНАТЫ С ПО";
+            return false;
+        }
+        if (!parseRooms(args[1], &numbers, error) || !parsePeriod(args[2], args[3], &fromDay, &toDay, error)) {
+            return false;
+        }
+
+        for (int roomNumber : numbers) {
+            for (qint64 day = fromDay; day <= toDay; day++) {
+                removeBooking->addBindValue(roomNumber);
+                removeBooking->addBindValue(day);
+                if (!removeBooking->exec()) {
+                    if (error) *error = "Ошибка записи: " + removeBooking->lastError().text();
+                    return false;
+                }
+                bool removed = removeBooking->numRowsAffected() > 0;
+
+                // Бронь могла уже уехать в архив
+                if (!removed && archive) {
+                    removeArchived->addBindValue(roomNumber);
+                    removeArchived->addBindValue(day);
+                    if (!removeArchived->exec()) {
+                        if (error) *error = "Ошибка записи в архив: " + removeArchived->lastError().text();
+                        return false;
+                    }
+                    removed = removeArchived->numRowsAffected() > 0;
+                }
+
+                if (removed) {
+                    totals.cancelled++;
+                } else {
+                    totals.notBooked++;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool Control::addRoom(const QStringList &args, QString *error)
+    {
+        if (args.size() < 5 || args.size() > 6) {
+            if (error) *error = "Формат: add-room НОМЕР ТИП ВМЕСТИМОСТЬ ЦЕНА [ОПИСАНИЕ]";
+            return false;
+        }
+
+        // Те же ограничения, что в диалоге добавления и при импорте
+        bool numberOk = false, capacityOk = false, priceOk = false;
+        RoomInfo room;
+        room.number = args[1].toInt(&numberOk);
+        room.type = args[2];
+        room.capacity = args[3].toInt(&capacityOk);
+        room.price = args[4].toDouble(&priceOk);
+        room.description = args.value(5);
+
+        if (!numberOk || room.number < Validation::MinRoomNumber || room.number > Validation::MaxRoomNumber) {
+            if (error) *error = "Некорректный номер комнаты: " + args[1];
+            return false;
+        }
+        if (rooms.contains(room.number)) {
+            if (error) *error = QString("Комната %1 уже существует").arg(room.number);
+            return false;
+        }
+        if (!Validation::isValidRoomName(room.type)) {
+            if (error) *error = "Некорректный тип комнаты: " + room.type;
+            return false;
+        }
+        if (!capacityOk || room.capacity < Validation::MinCapacity || room.capacity > Validation::MaxCapacity) {
+            if (error) *error = "Некорректная вместимость: " + args[3];
+            return false;
+        }
+        if (!priceOk || room.price < Validation::MinPrice || room.price > Validation::MaxPrice) {
+            if (error) *error = "Некорректная цена: " + args[4];
+            return false;
+        }
+        if (!room.description.isEmpty() && !Validation::isValidRoomName(room.description)) {
+            if (error) *error = "Некорректное описание: " + room.description;
+            return false;
+        }
+
+        TracedQuery query(db);
+        query.prepare(Schema::insertSql<Schema::Rooms>());
+        Schema::bindInsert<Schema::Rooms>(query, room);
+        if (!query.exec()) {
+            if (error) *error = QString("Не удалось добавить комнату %1: %2").arg(room.number).arg(query.lastError().text());
+            return false;
+        }
+
+        // Следующие строки пакета уже могут бронировать новую комнату
+        rooms.insert(room.number, room);
+        totals.roomsAdded++;
+        return true;
+    }
+
+    bool Control::availability(const QStringList &args, QString *error)
+    {
+        qint64 fromDay = 0;
+        qint64 toDay = 0;
+        if (args.size() < 3 || args.size() > 5) {
+            if (error) *error = "Формат: availability С ПО [ТИП [ВМЕСТИМОСТЬ]]";
+            return false;
+        }
+        if (!parsePeriod(args[1], args[2], &fromDay, &toDay, error)) return false;
+
+        bool capacityOk = true;
+        const QString type = args.value(3);
+        const int minCapacity = args.size() > 4 ? args[4].toInt(&capacityOk) : 0;
+        if (!capacityOk) {
+            if (error) *error = "Некорректная вместимость: " + args[4];
+            return false;
+        }
+
+        // Свободна - ни одной брони в периоде; проверка идет по уникальному индексу (комната, дата)
+        QString sql = "SELECT r.room_number, r.room_type, r.capacity, r.price_per_night FROM rooms r "
+                      "WHERE NOT EXISTS (SELECT 1 FROM " + bookingSource(fromDay) + " b "
+                      "WHERE b.room_number = r.room_number AND b.booking_date BETWEEN ? AND ?)";
+        if (!type.isEmpty() && type != "all") sql += " AND r.room_type = ?";
+        if (minCapacity > 0) sql += " AND r.capacity >= ?";
+        sql += " ORDER BY r.room_number";
+
+        TracedQuery query(db);
+        query.setForwardOnly(true);
+        query.prepare(sql);
+        query.addBindValue(fromDay);
+        query.addBindValue(toDay);
+        if (!type.isEmpty() && type != "all") query.addBindValue(type);
+        if (minCapacity > 0) query.addBindValue(minCapacity);
+        if (!query.exec()) {
+            if (error) *error = "Ошибка запроса: " + query.lastError().text();
+            return false;
+        }
+
+        int count = 0;
+        while (query.next()) {
+            out << query.value(0).toInt() << '\t' << query.value(1).toString() << '\t'
+                << query.value(2).toInt() << '\t' << query.value(3).toDouble() << '\n';
+            count++;
+        }
+        out.flush();
+        err << QString("Свободно комнат на %1 - %2: %3 из %4\n")
+                   .arg(dayText(fromDay)).arg(dayText(toDay)).arg(count).arg(rooms.size());
+        return true;
+    }
+
+    bool Control::arrivals(const QStringList &args, QString *error)
+    {
+        qint64 day = QDate::currentDate().toJulianDay();
+        if (args.size() > 2 || (args.size() == 2 && !parseDay(args[1], &day))) {
+            if (error) *error = "Формат: arrivals [ДАТА]";
+            return false;
+        }
+
+        // Заезд - занятая ночь, перед которой комната была свободна (как в отчете)
+        const QString source = bookingSource(day - 1);
+        TracedQuery query(db);
+        query.setForwardOnly(true);
+        query.prepare("SELECT b.room_number, r.room_type, r.capacity FROM " + source + " b "
+                      "JOIN rooms r ON r.room_number = b.room_number "
+                      "WHERE b.booking_date = ? AND NOT EXISTS (SELECT 1 FROM " + source + " p "
+                      "WHERE p.room_number = b.room_number AND p.booking_date = ?) "
+                      "ORDER BY b.room_number");
+        query.addBindValue(day);
+        query.addBindValue(day - 1);
+        if (!query.exec()) {
+            if (error) *error = "Ошибка запроса: " + query.lastError().text();
+            return false;
+        }
+
+        // Длина проживания - подряд занятые ночи от дня заезда
+        TracedQuery stay(db);
+        stay.setForwardOnly(true);
+        stay.prepare("SELECT booking_date FROM " + source + " WHERE room_number = ? AND booking_date >= ? "
+                     "ORDER BY booking_date");
+
+        int count = 0;
+        while (query.next()) {
+            const int roomNumber = query.value(0).toInt();
+            qint64 nights = 0;
+            stay.addBindValue(roomNumber);
+            stay.addBindValue(day);
+            if (stay.exec()) {
+                while (stay.next() && stay.value(0).toLongLong() == day + nights) {
+                    nights++;
+                }
+                stay.finish();
+            }
+
+            out << roomNumber << '\t' << query.value(1).toString() << '\t' << query.value(2).toInt() << '\t'
+                << nights << '\t' << dayText(day + nights) << '\n';
+            count++;
+        }
+        out.flush();
+        err << QString("Заездов на %1: %2\n").arg(dayText(day)).arg(count);
+        return true;
+    }
+
+    bool Control::report(const QStringList &args, QString *error)
+    {
+        qint64 fromDay = 0;
+        qint64 toDay = 0;
+        if (args.size() < 3 || args.size() > 4) {
+            if (error) *error = "Формат: report С ПО [ФАЙЛ.html]";
+            return false;
+        }
+        if (!parsePeriod(args[1], args[2], &fromDay, &toDay, error)) return false;
+
+        // Прогноз в отчете считается так же, как в окне: по занятости в памяти и кривым догрузки
+        OccupancyStore store;
+        if (!PropertyManager::loadOccupancy(db, store)) {
+            if (error) *error = "Не удалось загрузить бронирования";
+            return false;
+        }
+        SharedOccupancy occupancy;
+        occupancy.reset(std::move(store));
+
+        const qint64 today = QDate::currentDate().toJulianDay();
+        OccupancyForecast forecast(occupancy);
+        forecast.setRooms(QVector<int>(rooms.keyBegin(), rooms.keyEnd()));
+        forecast.setToday(today);
+        forecast.setCurves(OccupancyForecast::buildCurves(db.databaseName(), today - OccupancyForecast::HistoryDays, today));
+
+        ReportGenerator::Request request;
+        request.from = QDate::fromJulianDay(fromDay);
+        request.to = QDate::fromJulianDay(toDay);
+        request.forecast = forecast.forecast(today, OccupancyForecast::HorizonDays);
+        // Выручка - по тарифам отеля, как в окне
+        QString ratesError;
+        QVector<RateTable::Rule> rules = RateTable::loadRules(db, &ratesError);
+        if (!ratesError.isEmpty()) {
+            err << "Ошибка загрузки тарифов: " << ratesError << "\n";
+        }
+        request.rates.compile(rooms.values(), rules, fromDay, int(toDay - fromDay + 1));
+        ReportGenerator::DataVersion version;
+        version.databaseFile = db.databaseName();
+
+        // Генератор строит отчет в своем потоке - ждем его сигнала
+        ReportGenerator generator;
+        bool ok = false;
+        QString html;
+        QEventLoop loop;
+        QObject::connect(&generator, &ReportGenerator::finished, &loop,
+                         [&](bool done, const QString &result, const QString &message) {
+            ok = done;
+            html = result;
+            if (!done && error) *error = message;
+            loop.quit();
+        });
+        generator.start(request, version);
+        loop.exec();
+        if (!ok) return false;
+
+        if (args.size() < 4) {
+            out << html << '\n';
+            out.flush();
+            return true;
+        }
+
+        QFile file(args[3]);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            if (error) *error = "Не удалось записать " + args[3] + ": " + file.errorString();
+            return false;
+        }
+        file.write(html.toUtf8());
+        err << "Отчет записан в " << args[3] << "\n";
+        return true;
+    }
+
+    // Файл команд: пустые строки и # пропускаются, аргументы с пробелами - в кавычках
+    bool runScript(Control &control, const QString &fileName, QTextStream &err, int *lines)
+    {
+        QFile file(fileName);
+        bool opened = fileName == "-" ? file.open(stdin, QIODevice::ReadOnly | QIODevice::Text)
+                                      : file.open(QIODevice::ReadOnly | QIODevice::Text);
+        if (!opened) {
+            err << "Не удалось открыть " << fileName << ": " << file.errorString() << "\n";
+            return false;
+        }
+
+        QString error;
+        if (!control.begin(&error)) {
+            err << error << "\n";
+            return false;
+        }
+
+        QTextStream in(&file);
+        int lineNumber = 0;
+        *lines = 0;
+        while (!in.atEnd()) {
+            QString line = in.readLine().trimmed();
+            lineNumber++;
+            if (line.isEmpty() || line.startsWith('#')) continue;
+
+            if (!control.execute(QProcess::splitCommand(line), true, &error)) {
+                control.rollback();
+                err << "Строка " << lineNumber << ": " << error << "\n"
+                    << "Изменения пакета отменены\n";
+                return false;
+            }
+            (*lines)++;
+        }
+
+        if (!control.commit(&error)) {
+            err << error << "\n";
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QString("Пакетные операции с базой HotelManager без окна\n\n") + Commands);
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("db", "Файл базы (по умолчанию - активный отель из настроек)", "file"));
+    parser.addPositionalArgument("command", "Команда и ее аргументы");
+    // Отрицательные смещения дат (-7) - аргументы команды, а не ключи
+    parser.setOptionsAfterPositionalArgumentsMode(QCommandLineParser::ParseAsPositionalArguments);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.isEmpty()) {
+        err << Commands;
+        return 2;
+    }
+
+    QString databaseFile = parser.value("db");
+    if (databaseFile.isEmpty()) {
+        PropertyManager properties;
+        properties.loadSettings();
+        databaseFile = properties.property(properties.activeIndex()).databaseFile;
+    }
+    databaseFile = QFileInfo(databaseFile).absoluteFilePath();
+
+    int status = 0;
+    {
+        Control control(out, err);
+        QString error;
+        if (!control.open(databaseFile, &error)) {
+            err << error << "\n";
+            return 1;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        int commands = 1;
+
+        if (args.first() == "run") {
+            if (args.size() != 2) {
+                err << "Формат: run ФАЙЛ|-\n";
+                return 2;
+            }
+            if (!runScript(control, args[1], err, &commands)) status = 1;
+        } else if (Control::isWrite(args.first())) {
+            bool ok = control.begin(&error) && control.execute(args, false, &error);
+            if (!ok) control.rollback();
+            if (!ok || !control.commit(&error)) {
+                err << error << "\n";
+                status = 1;
+            }
+        } else if (!control.execute(args, false, &error)) {
+            err << error << "\n";
+            status = 1;
+        }
+
+        const Control::Counters &counters = control.counters();
+        if (status == 0 && (Control::isWrite(args.first()) || args.first() == "run")) {
+            err << QString("Команд: %1, забронировано ночей: %2 (уже были заняты: %3), снято броней: %4 "
+                           "(не было: %5), добавлено комнат: %6, %7 мс\n")
+                       .arg(commands)
+                       .arg(counters.booked)
+                       .arg(counters.alreadyBooked)
+                       .arg(counters.cancelled)
+                       .arg(counters.notBooked)
+                       .arg(counters.roomsAdded)
+                       .arg(timer.elapsed());
+        }
+    }
+    return status;
+}
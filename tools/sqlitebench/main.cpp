@@ -0,0 +1,244 @@
+// Сравнение загрузки больших таблиц HotelManager: QSqlQuery::value() (QVariant на каждое значение)
+// против быстрого пути через sqlite3 (HotelManager/sqlitefastpath.h).
+// Обе стороны читают те же запросы в те же структуры; печатается медиана по нескольким прогонам.
+// Без --db создает временную базу заданного размера.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QDate>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+
+#include "occupancystore.h"
+#include "sqlitefastpath.h"
+
+namespace
+{
+    struct Options {
+        QString databaseFile;
+        int rooms = 2000;
+        int days = 365;
+        double occupancy = 0.6;
+        int clients = 50000;
+        int iterations = 5;
+    };
+
+    bool generate(QSqlDatabase &db, const Options &options, QTextStream &out)
+    {
+        QSqlQuery query(db);
+        const char *schema[] = {
+            "CREATE TABLE rooms (id INTEGER PRIMARY KEY AUTOINCREMENT, room_number INTEGER UNIQUE NOT NULL, "
+            "room_type TEXT DEFAULT 'Стандарт', capacity INTEGER DEFAULT 2, price_per_night REAL DEFAULT 3000.0, "
+            "description TEXT, created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP)",
+            "CREATE TABLE bookings (id INTEGER PRIMARY KEY AUTOINCREMENT, room_number INTEGER NOT NULL, "
+            "booking_date INTEGER NOT NULL, created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+            "UNIQUE(room_number, booking_date))",
+            "CREATE TABLE clients (id INTEGER PRIMARY KEY AUTOINCREMENT, full_name TEXT NOT NULL, phone TEXT, "
+            "email TEXT, passport TEXT, created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP)"
+        };
+        for (const char *sql : schema) {
+            if (!query.exec(sql)) {
+                out << "Ошибка схемы: " << query.lastError().text() << "\n";
+                return false;
+            }
+        }
+
+        QRandomGenerator random(42);
+        const QStringList types = QStringList() << "Стандарт" << "Люкс" << "Семейный" << "Бизнес" << "Апартаменты";
+        const qint64 firstDay = QDate::currentDate().toJulianDay();
+
+        db.transaction();
+
+        query.prepare("INSERT INTO rooms (room_number, room_type, capacity, price_per_night, description) "
+                      "VALUES (?, ?, ?, ?, ?)");
+        for (int i = 0; i < options.rooms; i++) {
+            query.addBindValue(100 + i);
+            query.addBindValue(types[i % types.size()]);
+            query.addBindValue(1 + i % 4);
+            query.addBindValue(2000.0 + (i % 20) * 250.0);
+            query.addBindValue(QString("Комната %1, вид во двор").arg(100 + i));
+            query.exec();
+        }
+
+        query.prepare("INSERT INTO bookings (room_number, booking_date) VALUES (?, ?)");
+        for (int i = 0; i < options.rooms; i++) {
+            for (int day = 0; day < options.days; day++) {
+                if (random.generateDouble() >= options.occupancy) continue;
+                query.addBindValue(100 + i);
+                query.addBindValue(firstDay + day);
+                query.exec();
+            }
+        }
+
+        query.prepare("INSERT INTO clients (full_name, phone, email, passport) VALUES (?, ?, ?, ?)");
+        for (int i = 0; i < options.clients; i++) {
+            query.addBindValue(QString("Клиент Тестовый %1").arg(i));
+            query.addBindValue(QString("+7 900 %1").arg(i, 7, 10, QChar('0')));
+            query.addBindValue(QString("client%1@example.com").arg(i));
+            query.addBindValue(QString("45 %1").arg(i, 8, 10, QChar('0')));
+            query.exec();
+        }
+
+        return db.commit();
+    }
+
+    // Медиана времени прогона, мс
+    double measure(int iterations, const std::function<void()> &run)
+    {
+        QVector<double> times;
+        for (int i = 0; i < iterations; i++) {
+            QElapsedTimer timer;
+            timer.start();
+            run();
+            times.append(timer.nsecsElapsed() / 1e6);
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    void report(QTextStream &out, const QString &title, qint64 rows, double slowMs, double fastMs)
+    {
+        out << QString("%1: %2 строк\n").arg(title).arg(rows)
+            << QString("  QSqlQuery   %1 мс (%2 тыс. строк/с)\n")
+                   .arg(slowMs, 0, 'f', 2).arg(slowMs > 0 ? rows / slowMs : 0.0, 0, 'f', 0)
+            << QString("  sqlite3     %1 мс (%2 тыс. строк/с)\n")
+                   .arg(fastMs, 0, 'f', 2).arg(fastMs > 0 ? rows / fastMs : 0.0, 0, 'f', 0)
+            << QString("  ускорение   %1x\n").arg(fastMs > 0 ? slowMs / fastMs : 0.0, 0, 'f', 2);
+        out.flush();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Сравнение загрузки через QSqlQuery и напрямую через sqlite3");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("db", "Существующая база HotelManager (иначе создается временная)", "file"));
+    parser.addOption(QCommandLineOption("rooms", "Комнат во временной базе", "n", "2000"));
+    parser.addOption(QCommandLineOption("days", "Дней бронирований во временной базе", "n", "365"));
+    parser.addOption(QCommandLineOption("occupancy", "Доля занятых ночей (0..1)", "ratio", "0.6"));
+    parser.addOption(QCommandLineOption("clients", "Клиентов во временной базе", "n", "50000"));
+    parser.addOption(QCommandLineOption("iterations", "Прогонов на каждый вариант", "n", "5"));
+    parser.process(a);
+
+    Options options;
+    options.databaseFile = parser.value("db");
+    options.rooms = qMax(1, parser.value("rooms").toInt());
+    options.days = qMax(1, parser.value("days").toInt());
+    options.occupancy = qBound(0.0, parser.value("occupancy").toDouble(), 1.0);
+    options.clients = qMax(0, parser.value("clients").toInt());
+    options.iterations = qMax(1, parser.value("iterations").toInt());
+
+    QTextStream out(stdout);
+
+    QTemporaryDir tempDir;
+    bool generated = options.databaseFile.isEmpty();
+    if (generated) {
+        options.databaseFile = tempDir.filePath("bench.db");
+    }
+
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "bench");
+        db.setDatabaseName(options.databaseFile);
+        if (!db.open()) {
+            out << "Не удалось открыть базу: " << db.lastError().text() << "\n";
+            return 1;
+        }
+
+        if (generated) {
+            out << QString("Создается база: %1 комнат x %2 дней, занятость %3, клиентов %4...\n")
+                       .arg(options.rooms).arg(options.days).arg(options.occupancy).arg(options.clients);
+            out.flush();
+            if (!generate(db, options, out)) return 1;
+        }
+
+        if (!SqliteFastPath::isAvailable(db)) {
+            out << "Быстрый путь недоступен: драйвер не отдает дескриптор sqlite3*\n";
+            return 1;
+        }
+
+        // Прогрев страничного кэша SQLite, чтобы первый вариант не платил за чтение файла
+        {
+            OccupancyStore warm;
+            SqliteFastPath::loadOccupancy(db, &warm);
+        }
+
+        qint64 rows = 0;
+
+        double slowMs = measure(options.iterations, [&]() {
+            OccupancyStore store;
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.exec("SELECT room_number, booking_date FROM main.bookings");
+            rows = 0;
+            while (query.next()) {
+                store.setOccupied(query.value(0).toInt(), query.value(1).toLongLong(), true);
+                rows++;
+            }
+        });
+        double fastMs = measure(options.iterations, [&]() {
+            OccupancyStore store;
+            SqliteFastPath::loadOccupancy(db, &store);
+        });
+        report(out, "Бронирования (loadOccupancyFromDB)", rows, slowMs, fastMs);
+
+        slowMs = measure(options.iterations, [&]() {
+            QVector<RoomInfo> rooms;
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.exec("SELECT room_number, room_type, capacity, price_per_night, description "
+                       "FROM rooms ORDER BY room_number");
+            while (query.next()) {
+                RoomInfo room;
+                room.number = query.value(0).toInt();
+                room.type = query.value(1).toString();
+                room.capacity = query.value(2).toInt();
+                room.price = query.value(3).toDouble();
+                room.description = query.value(4).toString();
+                rooms.append(room);
+            }
+            rows = rooms.size();
+        });
+        fastMs = measure(options.iterations, [&]() {
+            QVector<RoomInfo> rooms;
+            SqliteFastPath::loadRooms(db, &rooms);
+        });
+        report(out, "Комнаты (loadRoomsFromDB)", rows, slowMs, fastMs);
+
+        slowMs = measure(options.iterations, [&]() {
+            QVector<Schema::Client> clients;
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.exec("SELECT id, full_name, phone, email, passport FROM clients ORDER BY full_name");
+            while (query.next()) {
+                Schema::Client client;
+                client.id = query.value(0).toLongLong();
+                client.fullName = query.value(1).toString();
+                client.phone = query.value(2).toString();
+                client.email = query.value(3).toString();
+                client.passport = query.value(4).toString();
+                clients.append(client);
+            }
+            rows = clients.size();
+        });
+        fastMs = measure(options.iterations, [&]() {
+            QVector<Schema::Client> clients;
+            SqliteFastPath::loadClients(db, &clients);
+        });
+        report(out, "Клиенты (manageClients)", rows, slowMs, fastMs);
+
+        db.close();
+    }
+    QSqlDatabase::removeDatabase("bench");
+    return 0;
+}
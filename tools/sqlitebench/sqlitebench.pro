@@ -0,0 +1,27 @@
+QT       += core sql
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = sqlitebench
+
+# Сравнивает с быстрым путем HotelManager - он нужен всегда.
+# Qt должен быть собран с -system-sqlite (см. HotelManager.pro)
+DEFINES += HOTEL_SQLITE_FASTPATH
+LIBS += -lsqlite3
+
+APP_DIR = $$PWD/../../HotelManager
+INCLUDEPATH += $$APP_DIR
+
+SOURCES += \
+    main.cpp \
+    $$APP_DIR/occupancystore.cpp \
+    $$APP_DIR/sqlitefastpath.cpp \
+    $$APP_DIR/sqltracer.cpp
+
+HEADERS += \
+    $$APP_DIR/occupancystore.h \
+    $$APP_DIR/schema.h \
+    $$APP_DIR/sqlitefastpath.h \
+    $$APP_DIR/sqltracer.h
@@ -0,0 +1,222 @@
+// Воспроизведение трассы действий администратора (см. HotelManager/operationtrace.h) на копии базы.
+// База, ее архив и журнал отложенной записи копируются во временный каталог; окно HotelManager
+// открывается без дисплея (платформа offscreen) и повторяет действия через HotelManager::replay.
+// По умолчанию действия идут подряд без пауз; с --paced - в темпе записи (--speed ускоряет).
+// Задержка действия - от вызова до обработки всех событий, включая перерисовку.
+// В конце печатает пропускную способность и задержки по видам действий.
+// Настройки приложения на время прогона хранятся во временном каталоге; настоящие не затрагиваются.
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateEdit>
+#include <QMessageBox>
+#include <QTemporaryDir>
+#include <QFileInfo>
+#include <QFile>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTextStream>
+#include <algorithm>
+#include <memory>
+
+#include "appsettings.h"
+#include "bookingarchiver.h"
+#include "bookingwritequeue.h"
+#include "hotelmanager.h"
+#include "operationtrace.h"
+#include "windowharness.h"
+
+namespace
+{
+    struct Stats {
+        QVector<qint64> micros;
+        int failed = 0;
+    };
+
+    qint64 percentile(const QVector<qint64> &sorted, double p)
+    {
+        if (sorted.isEmpty()) return 0;
+        int index = qMin(sorted.size() - 1, int(p * sorted.size()));
+        return sorted[index];
+    }
+
+    // Ждет до момента времени, обрабатывая события, как простаивающее окно
+    void idleUntil(const QElapsedTimer &clock, qint64 atMs)
+    {
+        qint64 left = atMs - clock.elapsed();
+        if (left <= 0) return;
+        QEventLoop loop;
+        QTimer::singleShot(int(left), &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    bool copyIfExists(const QString &from, const QString &to, QString *error)
+    {
+        if (!QFile::exists(from)) return true;
+        if (!QFile::copy(from, to)) {
+            *error = "Не удалось скопировать " + from;
+            return false;
+        }
+        QFile::setPermissions(to, QFile::permissions(to) | QFileDevice::WriteOwner);
+        return true;
+    }
+
+    // Все трое обязаны лежать рядом: так их находит приложение
+    bool copyDatabase(const QString &source, const QString &target, QString *error)
+    {
+        return copyIfExists(source, target, error) &&
+               copyIfExists(BookingArchiver::archiveFileFor(source), BookingArchiver::archiveFileFor(target), error) &&
+               copyIfExists(BookingWriteQueue::journalFileFor(source), BookingWriteQueue::journalFileFor(target), error);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // Без дисплея окно рисуется в памяти; явно заданную платформу не трогаем
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Воспроизведение трассы действий HotelManager на копии базы");
+    parser.addHelpOption();
+    parser.addOption(QCommandLineOption("db", "Файл базы, на которой записана трасса", "file"));
+    parser.addOption(QCommandLineOption("trace", "Файл трассы", "file"));
+    parser.addOption(QCommandLineOption("paced", "Соблюдать паузы между действиями, как при записи"));
+    parser.addOption(QCommandLineOption("speed", "Ускорение темпа записи для --paced", "factor", "1"));
+    parser.process(app);
+
+    QTextStream out(stdout);
+    if (!parser.isSet("db") || !parser.isSet("trace")) {
+        out << "Нужны --db и --trace\n";
+        return 1;
+    }
+    const bool paced = parser.isSet("paced");
+    const double speed = qMax(0.001, parser.value("speed").toDouble());
+
+    QString error;
+    QVector<OperationTrace::Operation> operations;
+    if (!OperationTrace::load(parser.value("trace"), &operations, &error)) {
+        out << error << "\n";
+        return 1;
+    }
+
+    QTemporaryDir workDir;
+    QString databaseFile = workDir.filePath(QFileInfo(parser.value("db")).fileName());
+    if (!workDir.isValid() || !QFile::exists(parser.value("db")) ||
+        !copyDatabase(parser.value("db"), databaseFile, &error)) {
+        out << (error.isEmpty() ? "Нет файла базы " + parser.value("db") : error) << "\n";
+        return 1;
+    }
+
+    // До создания окна: настоящие настройки пользователя прогон не читает и не меняет
+    WindowHarness::isolateSettings(workDir.path());
+
+    // Список отелей - из одной копии базы
+    {
+        AppSettings settings;
+        settings.beginWriteArray("properties", 1);
+        settings.setArrayIndex(0);
+        settings.setValue("name", "Воспроизведение трассы");
+        settings.setValue("databaseFile", databaseFile);
+        settings.endArray();
+        settings.setValue("activeProperty", 0);
+    }
+
+    // Окно сообщает об ошибках модальными диалогами - закрываем их, чтобы прогон не встал
+    int dialogs = 0;
+    QTimer modalGuard;
+    modalGuard.setInterval(10);
+    QObject::connect(&modalGuard, &QTimer::timeout, [&dialogs, &out]() {
+        QWidget *modal = QApplication::activeModalWidget();
+        if (!modal) return;
+        if (QMessageBox *box = qobject_cast<QMessageBox *>(modal)) {
+            out << "  диалог: " << box->text() << "\n";
+        }
+        dialogs++;
+        modal->close();
+    });
+    modalGuard.start();
+
+    QElapsedTimer openTimer;
+    openTimer.start();
+    std::unique_ptr<HotelManager> window(new HotelManager);
+    window->show();
+    WindowHarness::settle();
+    out << "Окно открыто за " << openTimer.elapsed() << " мс, действий в трассе: " << operations.size()
+        << (paced ? QString(", темп записи x%1").arg(speed) : QString(", без пауз")) << "\n";
+
+    Stats stats[OperationTrace::KindCount];
+    QElapsedTimer clock;
+    clock.start();
+    qint64 busyMicros = 0;
+
+    for (int i = 0; i < operations.size(); i++) {
+        const OperationTrace::Operation &operation = operations[i];
+        if (paced) {
+            idleUntil(clock, qint64(operation.atMs / speed));
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        QString message;
+        bool ok = window->replay(operation, &message);
+        WindowHarness::settle();
+        qint64 micros = timer.nsecsElapsed() / 1000;
+
+        Stats &kindStats = stats[operation.kind];
+        kindStats.micros.append(micros);
+        busyMicros += micros;
+        if (!ok) {
+            kindStats.failed++;
+            out << "Действие " << (i + 1) << " (" << OperationTrace::kindName(operation.kind) << "): "
+                << (message.isEmpty() ? QString("не выполнено") : message) << "\n";
+        }
+    }
+    qint64 wallMicros = clock.nsecsElapsed() / 1000;
+
+    // Закрытие дописывает в БД отложенные правки - это уже не часть трассы
+    window.reset();
+    WindowHarness::settle();
+    modalGuard.stop();
+
+    double seconds = wallMicros / 1e6;
+    out << "\nДействий: " << operations.size() << " за " << QString::number(seconds, 'f', 2) << " с, "
+        << QString::number(seconds > 0 ? operations.size() / seconds : 0.0, 'f', 1) << " в секунду; "
+        << "занято окно " << QString::number(busyMicros / 1e6, 'f', 2) << " с";
+    if (dialogs > 0) out << "; закрыто диалогов: " << dialogs;
+    out << "\n\n";
+
+    out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+               .arg(QString("Действие"), -20)
+               .arg(QString("число"), 7)
+               .arg(QString("ошибок"), 7)
+               .arg(QString("p50, мс"), 9)
+               .arg(QString("p95, мс"), 9)
+               .arg(QString("макс, мс"), 9)
+               .arg(QString("всего, мс"), 10);
+    for (int kind = 0; kind < OperationTrace::KindCount; kind++) {
+        QVector<qint64> sorted = stats[kind].micros;
+        if (sorted.isEmpty()) continue;
+        std::sort(sorted.begin(), sorted.end());
+        qint64 total = 0;
+        for (qint64 micros : sorted) total += micros;
+
+        out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+                   .arg(OperationTrace::kindName(OperationTrace::Kind(kind)), -20)
+                   .arg(sorted.size(), 7)
+                   .arg(stats[kind].failed, 7)
+                   .arg(percentile(sorted, 0.5) / 1000.0, 9, 'f', 2)
+                   .arg(percentile(sorted, 0.95) / 1000.0, 9, 'f', 2)
+                   .arg(sorted.last() / 1000.0, 9, 'f', 2)
+                   .arg(total / 1000.0, 10, 'f', 1);
+    }
+    out.flush();
+
+    int failed = 0;
+    for (const Stats &kindStats : stats) failed += kindStats.failed;
+    return failed > 0 ? 2 : 0;
+}
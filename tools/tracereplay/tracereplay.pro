@@ -0,0 +1,13 @@
+QT       += core gui widgets sql concurrent network
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = tracereplay
+
+# Действия воспроизводит настоящее окно HotelManager
+include($$PWD/../../HotelManager/hotelmanager.pri)
+include($$PWD/../common/windowharness.pri)
+
+SOURCES += \
+    main.cpp